@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <windows.h>
+#include <atomic>
+
+#pragma comment(lib, "iphlpapi.lib")
+
+// 接口地址
+struct InterfaceAddress {
+    bool ipv6 = false;          // 是否为IPv6地址
+    BYTE bytes[16] = {};        // 地址字节（网络字节序，IPv4只使用前4字节）
+};
+
+// 视为可用的地址族
+enum class AddressFamily {
+    IPv4,       // 只有IPv4地址（校园网认证和探测都使用IPv4，只有IPv6地址时还不能登录）
+    IPv6,       // 只有IPv6地址
+    Any         // IPv4或IPv6地址
+};
+
+// IP地址监视器
+// 通过NotifyUnicastIpAddressChange监视无线接口的地址变化，
+// 接口获得指定地址族的可用地址（DHCP或SLAAC完成、重复地址检测通过）时触发事件
+class AddressMonitor {
+public:
+    AddressMonitor();
+    ~AddressMonitor();
+
+    // 开始监视指定接口的地址变化，只有family中的地址算作可用
+    bool Start(const GUID& interfaceGuid, AddressFamily family = AddressFamily::IPv4);
+
+    // 停止监视
+    void Stop();
+
+    // 是否正在监视
+    bool IsRunning() const { return m_hNotification != NULL; }
+
+    // 接口当前是否已有可用的地址
+    bool HasUsableAddress() const;
+
+    // 获取接口当前可用的地址（同时可用时优先IPv4），没有可用地址时返回false
+    bool GetUsableAddress(InterfaceAddress& address) const;
+
+    // 获取事件句柄，接口获得可用地址时被触发（自动重置）
+    HANDLE GetEventHandle() const { return m_hEvent; }
+
+private:
+    // 地址变化通知的回调（定义在实现文件中）
+    friend struct AddressChangeCallback;
+
+    // 地址变化通知句柄
+    HANDLE m_hNotification;
+
+    // 获得可用地址时触发的事件句柄
+    HANDLE m_hEvent;
+
+    // 被监视接口的LUID
+    std::atomic<ULONG64> m_interfaceLuid;
+
+    // 视为可用的地址族（在注册通知前设置）
+    AddressFamily m_family;
+};
@@ -0,0 +1,155 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// 日志级别
+enum class LogLevel : uint8_t {
+    Info,
+    Warning,
+    Error
+};
+
+// 日志事件ID，对应的文字格式见binary_log.cpp中的事件表
+// 只能在末尾追加，已有的ID不能修改，否则旧的日志文件无法正确解码
+enum class LogEvent : uint16_t {
+    LogDropped = 1,         // 环形缓冲区已满丢弃的记录数
+    ServiceStarted,
+    ServiceStopped,         // 停止耗时
+    StateChanged,           // 原状态、新状态、触发事件
+    ScanCompleted,          // 扫描耗时
+    WifiConnected,          // 关联耗时
+    WifiConnectFailed,      // WLAN原因码
+    WifiDisconnected,       // WLAN原因码
+    AddressReady,           // 获取地址耗时
+    ProbeResult,            // 探测结论、HTTP状态码、耗时
+    LoginResult,            // 登录结果、耗时
+    ServiceResume,          // 控制码、事件类型
+    WorkerException,
+    HttpFailed              // 失败的阶段（HttpStage）、WinHTTP或套接字错误码
+};
+
+// 二进制日志记录，固定64字节
+struct LogRecord {
+    uint64_t timestamp;     // 自1970年以来的微秒数
+    uint16_t event;         // LogEvent
+    uint8_t level;          // LogLevel
+    uint8_t argCount;       // 有效参数个数
+    uint32_t threadId;      // 写日志的线程序号（进程内从1开始分配）
+    uint64_t args[6];
+};
+
+// 低开销的二进制环形缓冲区日志
+// 写日志只把定长记录放入预先分配好的无锁环形缓冲区，不分配内存、不做格式化、不做IO；
+// 后台线程定期把记录批量写入文件，文件超过上限时轮转。缓冲区满时丢弃新记录并计数，不会阻塞调用方。
+// 日志文件由Decode转换回文字
+class BinaryLog {
+public:
+    // 环形缓冲区容量（记录数，必须是2的幂）
+    static constexpr size_t kCapacity = 4096;
+
+    // 一次Log调用最多携带的参数个数
+    static constexpr size_t kMaxArgs = 6;
+
+    // 保留在内存中供查询的最近记录数
+    static constexpr size_t kRecentCount = 64;
+
+    // 进程内的全局日志
+    static BinaryLog& Instance();
+
+    ~BinaryLog();
+
+    // 开始把日志写入path，单个文件超过maxFileBytes时轮转，最多保留maxFiles个文件（含当前文件）
+    bool Start(const std::filesystem::path& path, uint64_t maxFileBytes = 4 * 1024 * 1024, int maxFiles = 3);
+
+    // 写出缓冲区中剩余的记录并停止后台线程
+    void Stop();
+
+    // 是否已经开始记录
+    bool IsRunning() const { return m_running.load(std::memory_order_relaxed); }
+
+    // 写一条日志，参数必须是整数或枚举；未开始记录时直接返回
+    template <typename... Args>
+    void Log(LogLevel level, LogEvent event, Args... args) {
+        static_assert(sizeof...(Args) <= kMaxArgs, "too many log arguments");
+        if (!IsRunning()) {
+            return;
+        }
+        const uint64_t values[sizeof...(Args) + 1] = { static_cast<uint64_t>(args)..., 0 };
+        Write(level, event, values, sizeof...(Args));
+    }
+
+    // 因缓冲区满被丢弃的记录总数
+    uint64_t DroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    // 最近写出到文件的记录（按时间顺序，最多maxCount条）
+    std::vector<LogRecord> RecentRecords(size_t maxCount = kRecentCount) const;
+
+    // 把日志文件解码为文字，每条记录一行
+    static bool Decode(const std::filesystem::path& path, std::wostream& out);
+
+    // 把一条记录格式化为文字（不含换行）
+    static void FormatRecord(const LogRecord& record, std::wostream& out);
+
+private:
+    BinaryLog();
+    BinaryLog(const BinaryLog&) = delete;
+    BinaryLog& operator=(const BinaryLog&) = delete;
+
+    // 环形缓冲区的槽：sequence表示该槽当前可写（等于写入位置）还是可读（等于写入位置+1）
+    struct Cell {
+        std::atomic<uint64_t> sequence;
+        LogRecord record;
+    };
+
+    // 把记录放入环形缓冲区
+    void Write(LogLevel level, LogEvent event, const uint64_t* args, size_t argCount);
+
+    // 从环形缓冲区取出一条记录（只在后台线程调用）
+    bool Read(LogRecord& record);
+
+    // 后台线程：定期写出记录
+    void FlushLoop();
+
+    // 写出缓冲区中的全部记录
+    void Drain();
+
+    // 打开新的日志文件并写入文件头
+    bool OpenFile();
+
+    // 轮转日志文件：path -> path.1 -> path.2 ...
+    void Rotate();
+
+    std::unique_ptr<Cell[]> m_cells;
+    alignas(64) std::atomic<uint64_t> m_writePos;
+    alignas(64) uint64_t m_readPos;
+    std::atomic<uint64_t> m_dropped;
+    uint64_t m_reportedDropped;
+    std::atomic<bool> m_running;
+
+    // 最近写出的记录，由m_recentMutex保护
+    mutable std::mutex m_recentMutex;
+    LogRecord m_recent[kRecentCount];
+    size_t m_recentNext;
+    size_t m_recentSize;
+
+    // 以下成员由m_mutex保护
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopRequested;
+    std::thread m_flusher;
+    std::filesystem::path m_path;
+    std::ofstream m_file;
+    uint64_t m_fileBytes;
+    uint64_t m_maxFileBytes;
+    int m_maxFiles;
+};
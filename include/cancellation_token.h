@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <windows.h>
+#include <functional>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+// 取消令牌
+// 包装一个手动重置事件，可以直接参与WaitForMultipleObjects；
+// 取消时依次执行已登记的回调（例如关闭正在进行的HTTP请求句柄）
+class CancellationToken {
+public:
+    // 登记回调，析构时自动注销
+    // 注销会等待正在执行的回调结束，因此回调可以安全地引用登记方的局部对象
+    class Registration {
+    public:
+        Registration(CancellationToken* token, std::function<void()> callback);
+        ~Registration();
+
+        Registration(const Registration&) = delete;
+        Registration& operator=(const Registration&) = delete;
+
+    private:
+        CancellationToken* m_token;
+        size_t m_id;
+    };
+
+    CancellationToken();
+    ~CancellationToken();
+
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    // 取消：触发事件并执行所有已登记的回调
+    void Cancel();
+
+    // 恢复为未取消状态（服务重新启动时使用）
+    void Reset();
+
+    // 是否已取消
+    bool IsCancelled() const { return m_cancelled.load(); }
+
+    // 获取事件句柄，取消后处于触发状态
+    HANDLE GetEventHandle() const { return m_hEvent; }
+
+    // 等待指定时间，期间被取消时立即返回true
+    bool WaitForCancellation(DWORD timeoutMs) const;
+
+private:
+    // 手动重置事件
+    HANDLE m_hEvent;
+
+    // 是否已取消
+    std::atomic<bool> m_cancelled;
+
+    // 保护回调列表的互斥锁（执行回调期间保持持有）
+    std::mutex m_mutex;
+
+    // 已登记的回调
+    std::vector<std::pair<size_t, std::function<void()>>> m_callbacks;
+
+    // 下一个回调ID
+    size_t m_nextId;
+
+    // 登记回调，已取消时立即执行并返回0
+    size_t Register(std::function<void()> callback);
+
+    // 注销回调
+    void Unregister(size_t id);
+};
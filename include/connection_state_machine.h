@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include <cstdint>
+
+// 连接状态
+enum class ConnectionState {
+    Disconnected,       // 未连接，等待重连
+    Scanning,           // 正在扫描无线网络
+    Associating,        // 正在连接目标WiFi
+    AwaitingAddress,    // 已连接WiFi，等待获取IP地址
+    PortalRequired,     // 需要校园网认证，等待登录时机
+    LoggingIn,          // 正在登录校园网
+    Online,             // 网络正常
+    Degraded            // 已连接WiFi但无法访问网络
+};
+
+// 状态机事件类型
+enum class ConnectionEventType {
+    LinkUp,             // 已连接到目标WiFi
+    LinkDown,           // WiFi未连接
+    ScanDone,           // 扫描结束
+    ConnectFailed,      // 连接WiFi失败
+    AddressReady,       // 已获取IP地址
+    ProbeOnline,        // 探测结果：可以访问外网
+    ProbePortal,        // 探测结果：需要校园网认证
+    ProbeOffline,       // 探测结果：无法访问网络
+    LoginSucceeded,     // 登录成功或已经在线
+    LoginRejected,      // 账号在线数量超限或被占用
+    LoginFailed,        // 临时错误导致登录失败
+    LoginBlocked,       // 账号或密码错误，不再自动登录
+    TimerExpired,       // 状态定时器到期
+    Resume,             // 系统从睡眠中恢复，立即重新连接
+    ReconnectRequested, // 用户要求立即重新连接
+    LoginRequested,     // 用户要求立即重新登录
+    SessionChanged      // 用户登录、解锁或连接到控制台，立即重新探测（WiFi未连接时立即扫描）
+};
+
+// 状态机事件
+struct ConnectionEvent {
+    ConnectionEventType type;
+    uint64_t now;       // 事件发生时间（毫秒，单调时钟）
+};
+
+// 转换后需要执行的动作，执行结果以事件的形式再交给状态机
+enum class ConnectionAction {
+    None,               // 等待事件或定时器
+    Scan,               // 扫描无线网络，完成后产生ScanDone
+    Connect,            // 连接目标WiFi，产生LinkUp或ConnectFailed
+    Probe,              // 探测网络连通性，产生Probe*事件
+    Login               // 登录校园网，产生Login*事件
+};
+
+// 各状态的超时和重试策略（毫秒）
+struct ConnectionPolicy {
+    uint64_t scanTimeoutMs = 5000;              // 扫描超时后直接尝试连接
+    uint64_t connectTimeoutMs = 50000;          // 连接超时按连接失败处理
+    uint64_t connectBackoffStepMs = 5000;       // 连接失败后的等待时间按失败次数递增
+    uint64_t connectBackoffMaxMs = 60000;       // 连接失败后的最长等待时间
+    uint64_t addressWaitMs = 3000;              // 未收到地址通知时最多等待多久再探测
+    uint64_t healthCheckIntervalMs = 30000;     // 网络正常时的定期探测间隔
+    uint64_t degradedRetryMs = 10000;           // 网络异常时的探测间隔按失败次数递增
+    uint64_t loginHoldMs = 60000;               // 登录成功后至少间隔多久才允许再次登录
+    uint64_t accountLimitDelayMs = 300000;      // 账号被占用时等待其他设备下线的时间
+    uint64_t loginBackoffBaseMs = 10000;        // 临时错误的登录退避起始时间
+    uint64_t loginBackoffMaxMs = 600000;        // 临时错误的登录退避最长时间
+};
+
+// 状态机上下文，包含状态和决定转换所需的全部计数
+struct ConnectionContext {
+    ConnectionState state = ConnectionState::Disconnected;
+    uint64_t stateSince = 0;        // 进入当前状态的时间
+    uint64_t deadline = 0;          // 状态定时器到期时间（0表示没有定时器）
+    uint32_t connectFailures = 0;   // 连续连接失败次数
+    uint32_t probeFailures = 0;     // 连续探测失败次数
+    uint32_t loginFailures = 0;     // 连续登录失败次数
+    uint64_t loginNotBefore = 0;    // 下次允许登录的时间
+    bool loginBlocked = false;      // 是否因永久错误停止登录
+    bool hasCredentials = false;    // 是否设置了校园网账号密码
+};
+
+// 一次状态转换的结果
+struct ConnectionTransition {
+    ConnectionContext context;      // 转换后的上下文
+    ConnectionAction action;        // 需要执行的动作
+};
+
+// 连接状态机
+// Step是纯函数：只根据输入的上下文和事件计算下一个上下文，不访问时钟、网络或系统API，
+// 因此可以在任何平台上测试，也可以逐步推演出最坏情况下的上线时间
+class ConnectionStateMachine {
+public:
+    // 处理一个事件，返回转换后的上下文和需要执行的动作
+    static ConnectionTransition Step(
+        const ConnectionContext& context,
+        const ConnectionEvent& event,
+        const ConnectionPolicy& policy = ConnectionPolicy()
+    );
+
+    // 获取状态名称
+    static const wchar_t* StateToString(ConnectionState state);
+
+    // 获取事件名称
+    static const wchar_t* EventToString(ConnectionEventType type);
+
+private:
+    // 收到需要认证的探测结果或登录失败后，决定立即登录还是等待
+    static void EnterPortalRequired(
+        ConnectionTransition& transition,
+        uint64_t now,
+        const ConnectionPolicy& policy
+    );
+
+    // 是否处于WiFi已连接的状态
+    static bool IsLinkUp(ConnectionState state);
+};
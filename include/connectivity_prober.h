@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "http_transport.h"
+
+// 连通性探测
+// 对所有探测目标并发发出请求，第一个确定的结果（在线或被认证网关重定向）胜出，其余探测被取消；
+// 校园网状态查询作为额外的探测目标，外网全部不通但它可达时判断为需要登录。
+// 只依赖HttpTransport，可以在Linux上对模拟认证服务器测试
+class ConnectivityProber {
+public:
+    // 网络连通性状态
+    enum class Status {
+        Online,         // 可以访问外网
+        CaptivePortal,  // 只能访问校园网登录页面，需要登录
+        Offline         // 无法访问任何测试网站
+    };
+
+    // 探测目标
+    struct Target {
+        std::string url;
+        std::string method;         // 探测方法（GET或HEAD），响应体不会被读取
+        uint32_t expectedStatus;    // 在线时的状态码，0表示任意响应都视为在线
+    };
+
+    // 探测结果
+    struct Result {
+        Status status = Status::Offline;
+        std::string probeUrl;           // 给出结论的探测地址
+        uint32_t statusCode = 0;        // 探测响应的HTTP状态码
+        std::string redirectLocation;   // 认证网关重定向的目标地址
+        uint64_t elapsedMs = 0;         // 从开始探测到得出结论的耗时
+    };
+
+    explicit ConnectivityProber(HttpTransport& transport);
+
+    // 设置探测目标
+    void SetTargets(const std::vector<Target>& targets);
+
+    // 设置校园网状态查询地址，为空时不查询
+    void SetPortalUrl(const std::string& portalUrl);
+
+    // 设置总截止时间（毫秒），也是每个探测请求的超时时间
+    void SetDeadline(uint32_t deadlineMs);
+
+    // 并发探测，stop不为空时可被其他线程中断：取消所有探测并尽快返回
+    Result Probe(HttpCancel* stop = nullptr);
+
+    // 根据探测目标的预期对响应分类
+    static Status Classify(const Target& target, const HttpResponse& response);
+
+private:
+    // HTTP传输层（不归本对象所有）
+    HttpTransport& m_transport;
+
+    // 探测目标
+    std::vector<Target> m_targets;
+
+    // 校园网状态查询地址
+    std::string m_portalUrl;
+
+    // 总截止时间（毫秒）
+    uint32_t m_deadlineMs;
+};
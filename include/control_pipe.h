@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include <windows.h>
+#include <string>
+#include <functional>
+
+// 本地控制通道（命名管道）
+// 客户端每次连接发送一行请求（UTF-8，以换行结束），服务端回复4字节小端长度加UTF-8正文，
+// 然后等待客户端关闭连接。服务端在独立的线程中处理请求，不受工作线程正在进行的连接或登录影响。
+// 管道使用默认的安全描述符：所有用户可以读取，只有管理员和LocalSystem可以写入（发送请求）
+// 只有Windows实现：控制通道由服务进程应答，而服务只能在Windows上构建，可移植的构建中没有服务，也就没有Unix套接字版本
+class ControlPipeServer {
+public:
+    // 请求处理函数，参数为去掉换行的请求，返回回复正文
+    typedef std::function<std::string(const std::string& request)> Handler;
+
+    ControlPipeServer();
+    ~ControlPipeServer();
+
+    // 开始在pipeName上提供服务
+    bool Start(const std::wstring& pipeName, Handler handler);
+
+    // 停止服务并等待服务线程退出
+    void Stop();
+
+    // 服务线程是否在运行
+    bool IsRunning() const { return m_thread != NULL; }
+
+    // 服务对应的管道名称
+    static std::wstring PipeNameForService(const std::wstring& serviceName);
+
+    // 客户端：发送请求并读取回复
+    static bool Query(const std::wstring& pipeName, const std::string& request, std::string& response, DWORD timeoutMs = 2000);
+
+private:
+    // 单个请求或回复的最大长度
+    static const DWORD kMaxRequestBytes = 4096;
+    static const DWORD kMaxResponseBytes = 16 * 1024 * 1024;
+
+    // 单次读写的超时时间（毫秒），防止客户端不读不写时占住服务线程
+    static const DWORD kIoTimeoutMs = 1000;
+
+    // 服务线程
+    static DWORD WINAPI ServerThread(LPVOID lpParam);
+
+    // 依次接受客户端连接并处理请求，直到停止
+    void Serve();
+
+    // 处理一个已连接的客户端
+    void ServeClient(HANDLE hPipe, OVERLAPPED& overlapped);
+
+    // 等待重叠IO完成；超时或服务停止时取消IO并返回false
+    bool WaitIo(HANDLE hPipe, OVERLAPPED& overlapped, DWORD timeoutMs, DWORD& bytes);
+
+    // 服务线程句柄
+    HANDLE m_thread;
+
+    // 停止事件（手动重置）
+    HANDLE m_stopEvent;
+
+    // 管道名称
+    std::wstring m_pipeName;
+
+    // 请求处理函数
+    Handler m_handler;
+};
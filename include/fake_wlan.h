@@ -0,0 +1,142 @@
+﻿#pragma once
+
+#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <iphlpapi.h>
+#include <windows.h>
+#include <wlanapi.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 模拟的无线网卡参数
+struct FakeWlanOptions {
+    std::wstring ssid = L"BenchNet";    // 唯一可见的网络
+    ULONG signalQuality = 80;           // 信号强度（0-100）
+    DWORD scanMs = 0;                   // 从WlanScan到扫描完成通知的时间
+    DWORD associateMs = 30;             // 从WlanConnect到连接完成通知的时间
+    DWORD addressMs = 50;               // 从连接完成到获得IP地址（DHCP）的时间
+    DWORD scanFailReason = 0;           // 不为0时扫描失败，以该原因码发出扫描失败通知
+    DWORD connectFailReason = 0;        // 不为0时连接失败，以该原因码发出连接完成通知
+};
+
+// 模拟的WLAN和IP Helper后端
+// 基准测试用编译选项把WifiManager和AddressMonitor调用的WlanXxx函数和地址通知函数
+// 换成本文件中的同名实现（加Fake前缀），它们操作这个单例：只有一个无线接口和一个开放网络，
+// 扫描、关联和DHCP按设定的时间在独立的“驱动”线程中完成并发出通知，与真实系统的回调线程一致。
+// 单元测试还可以让扫描或连接失败、改变信号强度，检查WifiManager收到的事件及其顺序。
+// 稳定运行时不使用operator new，基准测试统计的内存分配都来自被测代码
+class FakeWlan {
+public:
+    // 接口GUID和LUID
+    static const GUID kInterfaceGuid;
+    static const ULONG64 kInterfaceLuid = 0x0047000000000001ULL;
+
+    static FakeWlan& Instance();
+
+    // 设置参数（在服务启动前调用，之后发起的扫描和连接按新参数完成）
+    void SetOptions(const FakeWlanOptions& options);
+    const FakeWlanOptions& GetOptions() const { return m_options; }
+
+    // 设置参数并恢复为未连接、无地址的状态，丢弃尚未完成的操作（不发出通知），在单元测试之间调用
+    void Reset(const FakeWlanOptions& options);
+
+    // 直接设置为已连接并有地址（不发出通知），模拟服务启动时已经连接的情况
+    void SetConnected();
+
+    // 模拟接入点断开：断开连接、删除地址，并在驱动线程中发出断开通知
+    void DropLink();
+
+    // 改变信号强度，并在驱动线程中发出信号强度变化通知
+    void ChangeSignalQuality(ULONG signalQuality);
+
+    // 是否已连接
+    bool IsConnected() const;
+
+    // 被测代码调用模拟API的次数
+    uint64_t GetApiCallCount() const { return m_apiCalls.load(); }
+
+    // 停止驱动线程（进程退出前调用）
+    void Shutdown();
+
+    // 以下由模拟的API函数调用
+    DWORD OpenHandle(PHANDLE phClientHandle);
+    void CloseHandle();
+    DWORD EnumInterfaces(PWLAN_INTERFACE_INFO_LIST* ppInterfaceList);
+    DWORD RegisterNotification(DWORD source, WLAN_NOTIFICATION_CALLBACK callback, PVOID context);
+    DWORD QueryCurrentConnection(PDWORD pdwDataSize, PVOID* ppData);
+    DWORD Scan();
+    DWORD GetAvailableNetworkList(PWLAN_AVAILABLE_NETWORK_LIST* ppAvailableNetworkList);
+    DWORD Connect(const WLAN_CONNECTION_PARAMETERS* pParameters);
+    DWORD NotifyAddressChange(PUNICAST_IPADDRESS_CHANGE_CALLBACK callback, PVOID context, HANDLE* pHandle);
+    void CancelAddressNotification();
+    DWORD GetAddressEntry(PMIB_UNICASTIPADDRESS_ROW row);
+    DWORD GetAddressTable(PMIB_UNICASTIPADDRESS_TABLE* ppTable);
+    void CountCall() { m_apiCalls++; }
+
+private:
+    FakeWlan();
+    ~FakeWlan();
+
+    FakeWlan(const FakeWlan&) = delete;
+    FakeWlan& operator=(const FakeWlan&) = delete;
+
+    // 驱动线程中的待完成操作
+    enum class Action {
+        ScanComplete,
+        ScanFailed,
+        ConnectComplete,
+        ConnectFailed,
+        AddressAssigned,
+        Disconnected,
+        SignalChanged
+    };
+
+    struct PendingAction {
+        ULONGLONG due;
+        Action action;
+        DWORD value;        // 失败的原因码或新的信号强度
+    };
+
+    // 安排驱动线程在delayMs后完成操作（调用方持有m_mutex）
+    void Schedule(Action action, DWORD delayMs, DWORD value = 0);
+
+    // 驱动线程
+    void DriverLoop();
+
+    // 执行到期的操作并发出通知
+    void Complete(const PendingAction& pending);
+
+    // 发出WLAN连接或扫描通知
+    void NotifyWlan(DWORD code, DWORD reasonCode);
+
+    // 发出信号强度变化通知
+    void NotifySignalQuality(ULONG signalQuality);
+
+    // 填写接口的地址行
+    void FillAddressRow(MIB_UNICASTIPADDRESS_ROW& row) const;
+
+    FakeWlanOptions m_options;
+    DOT11_SSID m_ssid;
+
+    // 接口状态
+    mutable std::mutex m_mutex;
+    bool m_connected;
+    bool m_hasAddress;
+    std::vector<PendingAction> m_pending;
+    std::condition_variable m_wakeup;
+    bool m_stopping;
+    std::thread m_driver;
+
+    // 回调注册；执行回调期间持有m_callbackMutex，注销时等待正在执行的回调结束
+    std::mutex m_callbackMutex;
+    WLAN_NOTIFICATION_CALLBACK m_wlanCallback;
+    PVOID m_wlanContext;
+    PUNICAST_IPADDRESS_CHANGE_CALLBACK m_addressCallback;
+    PVOID m_addressContext;
+
+    std::atomic<uint64_t> m_apiCalls;
+};
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "network_requester.h"
+#include "cancellation_token.h"
+#include "session_sweeper.h"
+
+// 网关模式下由本机代为登录的客户端
+struct GatewayClient {
+    std::wstring ip;            // 客户端IP地址
+    std::wstring mac;           // 客户端MAC地址（12位十六进制数字）
+    std::wstring account;       // 校园网账号
+    std::wstring password;      // 校园网密码
+};
+
+// 单个客户端的登录结果
+struct GatewayLoginOutcome {
+    NetworkRequester::LoginResult result = NetworkRequester::LoginResult::TransportError;
+    DWORD attempts = 0;         // 发送登录请求的次数（0表示因取消而没有尝试）
+    ULONGLONG elapsedMs = 0;    // 从第一次尝试到得出结果的耗时（含重试等待）
+};
+
+// 批量登录的选项
+struct GatewayLoginOptions {
+    DWORD parallelism = 16;         // 同时进行的登录请求数
+    DWORD maxAttempts = 3;          // 每个客户端最多尝试的次数
+    DWORD retryDelayMs = 1000;      // 第一次重试前的等待时间，之后每次加倍
+};
+
+// 批量登录的结果
+struct GatewayLoginReport {
+    std::vector<GatewayLoginOutcome> outcomes;  // 与输入的客户端一一对应
+    ULONGLONG elapsedMs = 0;                    // 总耗时
+    bool cancelled = false;                     // 是否被取消
+};
+
+// 网关批量登录引擎
+// 登录地址中的wlan_user_ip和wlan_user_mac由调用方指定，一台网关可以代多台设备认证；
+// 固定数量的工作线程从客户端列表中依次取出客户端登录，临时错误按指数退避重试
+class GatewayLoginEngine {
+public:
+    explicit GatewayLoginEngine(NetworkRequester& requester);
+
+    // 设置批量登录的选项
+    void SetOptions(const GatewayLoginOptions& options);
+
+    // 为所有客户端登录，全部完成或令牌被取消后返回
+    GatewayLoginReport Run(const std::vector<GatewayClient>& clients, CancellationToken* token = nullptr);
+
+    // 从文件读取客户端列表，每行格式为：IP,MAC[,账号[,密码]]，#开头的行为注释
+    // 省略账号或密码时使用默认值；requireAccount为false时允许没有账号（只查询状态）
+    static bool LoadClients(const std::wstring& filePath, const std::wstring& defaultAccount,
+                            const std::wstring& defaultPassword, std::vector<GatewayClient>& clients,
+                            bool requireAccount = true);
+
+    // 客户端的IP列表
+    static std::vector<std::wstring> ClientIPs(const std::vector<GatewayClient>& clients);
+
+    // 根据会话状态查询的结果选出需要登录的客户端：只跳过确认已在线的客户端，离线和状态未知的客户端都登录
+    // （真实的认证服务器按请求的来源地址返回状态，从网关查询其他客户端时结果都是未知）
+    static std::vector<GatewayClient> SelectForLogin(const std::vector<GatewayClient>& clients, const SessionSweepReport& sweep);
+
+    // 把MAC地址规范化为12位小写十六进制数字（接受:、-、.分隔），格式错误时返回false
+    static bool NormalizeMac(const std::wstring& mac, std::wstring& normalized);
+
+    // 判断登录结果是否值得重试
+    static bool IsRetryable(NetworkRequester::LoginResult result);
+
+    // 输出吞吐量报告和失败的客户端
+    static void PrintReport(const std::vector<GatewayClient>& clients, const GatewayLoginReport& report, std::wostream& out);
+
+private:
+    // 为一个客户端登录，按需重试
+    GatewayLoginOutcome LoginClient(const GatewayClient& client, CancellationToken* token);
+
+    // 网络请求器（不归本对象所有，所有工作线程共用其连接池）
+    NetworkRequester& m_requester;
+
+    // 批量登录的选项
+    GatewayLoginOptions m_options;
+};
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <windows.h>
+#include <winhttp.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include "http_transport.h"
+
+#pragma comment(lib, "winhttp.lib")
+
+// WinHTTP连接句柄池
+// 按 主机/端口/协议 复用WinHttpConnect得到的连接句柄，并限制每个主机同时进行的请求数：
+// 达到上限的请求排队等待，批量登录或查询时对认证服务器的并发压力不会超过设定值。
+// 连接句柄只是WinHTTP的逻辑对象，底层TCP/TLS长连接由WinHTTP会话自己复用和回收，
+// 与本类无关；关闭连接句柄不会关闭套接字
+class HttpConnectionPool {
+public:
+    HttpConnectionPool();
+    ~HttpConnectionPool();
+
+    // 绑定WinHTTP会话句柄（会话关闭前必须先调用Clear）
+    void SetSession(HINTERNET hSession);
+
+    // 设置每个主机的最大并发请求数和空闲连接句柄的回收时间
+    void SetLimits(DWORD maxPerHost, ULONGLONG idleTimeoutMs);
+
+    // 获取连接句柄：优先复用已有句柄，达到上限时一直等待其他请求归还，请求被取消时返回NULL
+    HINTERNET Acquire(const std::wstring& hostName, INTERNET_PORT port, INTERNET_SCHEME scheme,
+                      HttpCancel* cancel = nullptr);
+
+    // 归还连接句柄
+    void Release(HINTERNET hConnect);
+
+    // 关闭超过空闲时间的连接句柄（只释放句柄对象，空闲的套接字由WinHTTP回收）
+    void EvictIdle();
+
+    // 关闭所有连接句柄
+    void Clear();
+
+    // 获取每个主机的最大并发请求数
+    DWORD GetMaxPerHost() const { return m_maxPerHost; }
+
+private:
+    // 连接池条目
+    struct Entry {
+        std::wstring hostName;
+        INTERNET_PORT port;
+        INTERNET_SCHEME scheme;
+        HINTERNET hConnect;
+        DWORD inFlight;
+        ULONGLONG lastUsed;
+    };
+
+    // WinHTTP会话句柄（不归连接池所有）
+    HINTERNET m_hSession;
+
+    // 每个主机的最大并发请求数
+    DWORD m_maxPerHost;
+
+    // 空闲连接句柄回收时间（毫秒）
+    ULONGLONG m_idleTimeoutMs;
+
+    // 连接池条目
+    std::vector<Entry> m_entries;
+
+    // 保护连接池的互斥锁
+    std::mutex m_mutex;
+
+    // 等待连接归还的条件变量
+    std::condition_variable m_released;
+
+    // 等待名额并获取连接句柄（Acquire在登记取消的中断函数后调用）
+    HINTERNET WaitAndAcquire(const std::wstring& hostName, INTERNET_PORT port, INTERNET_SCHEME scheme,
+                              HttpCancel* cancel);
+
+    // 关闭空闲的连接句柄（调用方需持有锁）
+    void EvictIdleLocked(ULONGLONG now);
+
+    // 统计指定主机正在进行的请求数（调用方需持有锁）
+    DWORD CountInFlightLocked(const std::wstring& hostName, INTERNET_PORT port, INTERNET_SCHEME scheme) const;
+};
@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include "response_body_reader.h"
+
+// HTTP请求失败的阶段（记录到二进制日志，名称见binary_log.cpp）
+enum class HttpStage {
+    ParseUrl,       // 解析地址
+    Connect,        // 获取连接
+    OpenRequest,    // 创建请求
+    Send,           // 发送请求
+    Receive,        // 接收响应
+    Read            // 读取响应体
+};
+
+// 请求的取消信号
+// Cancel可在任意线程中调用：置位取消标志，并调用传输层登记的中断函数（唤醒等待连接的线程、关闭套接字的读写、
+// 触发等待中的事件等）。中断函数只负责让发起请求的线程尽快返回，不能释放套接字或句柄；
+// 这些资源始终由发起请求的线程关闭，关闭前先调用ClearInterrupter，该调用返回后Cancel不会再访问它们
+class HttpCancel {
+public:
+    HttpCancel() : m_cancelled(false) {}
+
+    HttpCancel(const HttpCancel&) = delete;
+    HttpCancel& operator=(const HttpCancel&) = delete;
+
+    // 取消请求（可重复调用）
+    void Cancel();
+
+    // 是否已取消
+    bool IsCancelled() const { return m_cancelled.load(std::memory_order_acquire); }
+
+    // 登记中断函数（替换之前登记的），已取消时不登记并返回false
+    bool SetInterrupter(const std::function<void()>& interrupter);
+
+    // 注销中断函数，等待正在执行的中断函数结束
+    void ClearInterrupter();
+
+private:
+    // 保护中断函数，Cancel执行中断函数期间保持持有
+    std::mutex m_mutex;
+    std::atomic<bool> m_cancelled;
+    std::function<void()> m_interrupter;
+};
+
+// HTTP请求
+struct HttpRequest {
+    std::string method = "GET";
+    std::string url;                    // 完整地址（UTF-8），路径包含查询参数
+    std::string headers;                // 附加的请求头，每行以\r\n结尾
+    std::string body;                   // 请求体
+    uint32_t timeoutMs = 0;             // 各阶段超时时间，0表示使用传输层的默认值
+    bool followRedirects = true;        // 是否自动跟随重定向
+    bool readBody = true;               // 是否读取响应体
+    size_t maxBodyBytes = 1024 * 1024;  // 响应体上限，0表示不限制
+    ResponseBodyReader::Consumer consumer;  // 设置后响应体交给consumer处理，不再保存到body
+};
+
+// HTTP响应
+struct HttpResponse {
+    uint32_t statusCode = 0;
+    std::string location;               // 重定向地址
+    std::string body;                   // 原始响应体
+    bool truncated = false;             // 响应体是否因超过上限而被截断
+};
+
+// HTTP传输层接口
+// NetworkRequester在Windows上使用WinHttpTransport；SocketHttpTransport直接使用套接字，
+// 可以在Linux上对模拟认证服务器测试连接复用、单主机并发上限和取消
+class HttpTransport {
+public:
+    virtual ~HttpTransport() {}
+
+    // 发送请求，收到响应头即返回true（读取响应体失败时仍返回true，响应体不完整）；
+    // cancel不为空时可被其他线程取消，取消后尽快返回false。可在多个线程中同时调用
+    virtual bool Send(const HttpRequest& request, HttpResponse& response, HttpCancel* cancel) = 0;
+
+    // 设置每个主机的最大并发请求数（达到上限的请求排队等待）和空闲连接的回收时间
+    virtual void SetLimits(uint32_t maxPerHost, uint64_t idleTimeoutMs) = 0;
+
+    // 关闭空闲时间过长的连接
+    virtual void ReleaseIdleConnections() = 0;
+
+protected:
+    // 请求失败只写入二进制日志：批量登录和批量查询时每秒可能有大量失败，不能逐条输出到控制台
+    static void RecordFailure(HttpStage stage, uint32_t error);
+};
@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// 计数器：只增不减，更新无锁
+class MetricCounter {
+public:
+    MetricCounter() : m_value(0) {}
+
+    // 增加计数
+    void Add(uint64_t delta = 1) { m_value.fetch_add(delta, std::memory_order_relaxed); }
+
+    // 当前计数
+    uint64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_value;
+};
+
+// HDR风格的直方图：对数-线性分桶，相对误差不超过1/8，记录无锁
+// 小于16的值每个值一个桶，之后每个2的幂区间分成8个桶
+class MetricHistogram {
+public:
+    MetricHistogram();
+
+    // 记录一个值
+    void Record(uint64_t value);
+
+    // 记录数量
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+
+    // 所有记录值之和
+    uint64_t Sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+    // 最大记录值
+    uint64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+
+    // 分位数（quantile取0到1），返回所在桶的上界，不超过最大记录值；没有记录时返回0
+    uint64_t Percentile(double quantile) const;
+
+    // 值所在的桶
+    static size_t BucketIndex(uint64_t value);
+
+    // 桶内的最大值
+    static uint64_t BucketUpperBound(size_t index);
+
+private:
+    static constexpr int kLinearBits = 4;
+    static constexpr int kSubBucketBits = 3;
+    static constexpr size_t kLinearBuckets = 1 << kLinearBits;
+    static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+    static constexpr size_t kBucketCount = kLinearBuckets + (64 - kLinearBits) * kSubBuckets;
+
+    std::atomic<uint64_t> m_buckets[kBucketCount];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+// 指标注册表
+// 指标按名称和标签注册一次后地址不变，调用方可以缓存引用；
+// 只有注册和导出需要加锁，计数和记录都是无锁的
+class MetricsRegistry {
+public:
+    // 进程内的全局注册表
+    static MetricsRegistry& Instance();
+
+    // 获取或创建计数器，labels为Prometheus格式的标签（如 reason="timeout"），可以为空
+    MetricCounter& Counter(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    // 获取或创建直方图，单位由名称后缀表示（如 _ms）
+    MetricHistogram& Histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    // 以Prometheus文本格式导出所有指标，直方图导出为summary（p50/p90/p99）
+    std::string ExportPrometheus() const;
+
+    // 转义标签值中的反斜杠、双引号和换行
+    static std::string EscapeLabelValue(const std::string& value);
+
+private:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // 同名的一组指标
+    struct Family {
+        std::string help;
+        bool isHistogram = false;
+        std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+        std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+    };
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Family> m_families;
+};
@@ -0,0 +1,203 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 模拟认证服务器的接口类别
+enum class MockEndpoint {
+    Chkstatus,      // /drcom/chkstatus：会话状态查询
+    Login,          // /eportal/portal/login：登录
+    Probe,          // /generate_204、/probe/*：代替外网探测目标
+    Count
+};
+
+// 故障注入配置，百分比为0-100，每个请求独立抽取
+struct MockPortalFaults {
+    uint32_t latencyMs = 0;             // 固定延迟
+    uint32_t jitterMs = 0;              // 额外的随机延迟（0到jitterMs）
+    uint32_t timeoutPercent = 0;        // 不回复，直到客户端断开连接
+    uint32_t serverErrorPercent = 0;    // 返回503
+    uint32_t truncatePercent = 0;       // 响应体只发送一半就关闭连接
+    uint32_t badCredentialPercent = 0;  // 返回账号或密码错误（只对登录接口有效）
+};
+
+// 模拟认证服务器的统计
+struct MockPortalStats {
+    uint64_t connections = 0;           // 接受的连接数
+    uint64_t requests = 0;              // 处理的请求数
+    uint64_t chkstatusRequests = 0;     // 状态查询请求数
+    uint64_t loginRequests = 0;         // 登录请求数
+    uint64_t loginSucceeded = 0;        // 登录成功数
+    uint64_t probeRequests = 0;         // 探测请求数
+    uint64_t faultsInjected = 0;        // 注入的故障数
+    uint64_t bytesReceived = 0;         // 收到的字节数
+    uint64_t bytesSent = 0;             // 发送的字节数
+    uint64_t sessions = 0;              // 当前在线的客户端数
+};
+
+// 模拟的drcom/eportal校园网认证服务器
+// 在本机监听HTTP，按真实服务器的JSONP格式应答状态查询和登录，按IP记录会话（登录按wlan_user_ip，状态查询按来源地址），
+// 并代替外网探测目标：已认证的IP探测成功，未认证的IP被重定向到登录页面或直接断开。
+// 不依赖Windows，可以在任何平台上构建，用于离线测试和压力测试
+class MockPortal {
+public:
+    MockPortal();
+    ~MockPortal();
+
+    MockPortal(const MockPortal&) = delete;
+    MockPortal& operator=(const MockPortal&) = delete;
+
+    // 在指定地址和端口上开始监听，port为0时由系统分配
+    bool Start(uint16_t port = 0, const std::string& bindAddress = "127.0.0.1");
+
+    // 停止监听并关闭所有连接
+    void Stop();
+
+    // 是否正在运行
+    bool IsRunning() const { return m_acceptThread.joinable(); }
+
+    // 实际监听的端口
+    uint16_t GetPort() const { return m_port; }
+
+    // 基础地址，如 http://127.0.0.1:8080
+    std::string GetBaseUrl() const;
+
+    // 设置指定接口的故障注入（可在运行中修改）
+    void SetFaults(MockEndpoint endpoint, const MockPortalFaults& faults);
+
+    // 添加账号；没有添加任何账号时接受所有账号和密码
+    void AddAccount(const std::string& account, const std::string& password);
+
+    // 每个账号最多同时在线的客户端数，0表示不限制
+    void SetMaxSessionsPerAccount(uint32_t maxSessions);
+
+    // 状态查询是否按wlan_user_ip参数返回指定客户端的状态，默认false。
+    // 真实服务器忽略该参数，只按请求的来源地址返回状态；打开后的行为不是真实服务器的行为，
+    // 只用于在一台机器上模拟大量客户端的状态查询
+    void SetChkstatusByParam(bool enabled);
+
+    // 清除所有会话，所有客户端回到未认证状态
+    void ClearSessions();
+
+    // 客户端是否已认证
+    bool IsOnline(const std::string& ip) const;
+
+    // 获取统计
+    MockPortalStats GetStats() const;
+
+    // URL解码（%XX和+）
+    static std::string UrlDecode(const std::string& text);
+
+    // 从查询字符串中取出参数并解码，不存在时返回空字符串
+    static std::string QueryParam(const std::string& query, const std::string& name);
+
+    // 当前线程是否为模拟认证服务器的接受或连接线程（与被测程序在同一进程中时用于区分统计）
+    static bool IsServerThread();
+
+private:
+    // 已认证的客户端
+    struct Session {
+        std::string account;
+        std::string mac;
+        std::chrono::steady_clock::time_point loginTime;
+    };
+
+    // 解析后的请求
+    struct Request {
+        std::string method;
+        std::string path;
+        std::string query;
+        std::string host;
+        std::string peerIp;
+    };
+
+    // 待发送的响应
+    struct Response {
+        int status = 200;
+        std::string contentType = "text/html; charset=utf-8";
+        std::string location;
+        std::string body;
+        bool withhold = false;      // 不回复（模拟超时）
+        bool drop = false;          // 不回复并立即断开（模拟外网不可达）
+        bool truncate = false;      // 响应体只发送一半后断开
+    };
+
+    // 连接及其处理线程
+    struct Connection {
+        std::thread thread;
+        std::atomic<bool> done{ false };
+    };
+
+    // 接受连接的线程
+    void AcceptLoop();
+
+    // 处理一个连接上的所有请求
+    void ServeConnection(uintptr_t socket, std::string peerIp, uint32_t seed);
+
+    // 根据请求生成响应（含故障注入）
+    Response Handle(const Request& request, std::mt19937& random);
+
+    // 状态查询（按来源地址，或打开SetChkstatusByParam时按wlan_user_ip）
+    Response HandleChkstatus(const Request& request);
+
+    // 登录
+    Response HandleLogin(const Request& request, const std::string& clientIp, bool forceBadCredential);
+
+    // 外网探测
+    Response HandleProbe(const Request& request);
+
+    // 等待指定时间，服务器停止时提前返回false
+    bool Delay(uint32_t ms) const;
+
+    // 关闭已结束的连接线程
+    void ReapConnections(bool all);
+
+    // 监听套接字（Windows为SOCKET，其他平台为文件描述符）
+    uintptr_t m_listenSocket;
+
+    // 实际监听的地址和端口
+    std::string m_bindAddress;
+    uint16_t m_port;
+
+    // 是否正在停止
+    std::atomic<bool> m_stopping;
+
+    // 接受连接的线程
+    std::thread m_acceptThread;
+
+    // 连接线程
+    std::mutex m_connectionsMutex;
+    std::list<std::unique_ptr<Connection>> m_connections;
+
+    // 故障注入配置
+    mutable std::mutex m_configMutex;
+    MockPortalFaults m_faults[(int)MockEndpoint::Count];
+    std::map<std::string, std::string> m_accounts;
+    uint32_t m_maxSessionsPerAccount;
+    bool m_chkstatusByParam;
+
+    // 按IP记录的会话
+    mutable std::mutex m_sessionsMutex;
+    std::map<std::string, Session> m_sessions;
+
+    // 统计
+    std::atomic<uint64_t> m_connectionCount;
+    std::atomic<uint64_t> m_requestCount;
+    std::atomic<uint64_t> m_chkstatusCount;
+    std::atomic<uint64_t> m_loginCount;
+    std::atomic<uint64_t> m_loginSucceededCount;
+    std::atomic<uint64_t> m_probeCount;
+    std::atomic<uint64_t> m_faultCount;
+    std::atomic<uint64_t> m_bytesReceived;
+    std::atomic<uint64_t> m_bytesSent;
+};
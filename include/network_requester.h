@@ -2,13 +2,63 @@
 
 #include <windows.h>
 #include <string>
-#include <functional>
-#include <winhttp.h>
-
-#pragma comment(lib, "winhttp.lib")
+#include <vector>
+#include "cancellation_token.h"
+#include "connectivity_prober.h"
+#include "http_transport.h"
+#include "winhttp_transport.h"
 
 class NetworkRequester {
 public:
+    // 网络连通性状态
+    typedef ConnectivityProber::Status ConnectivityStatus;
+
+    // 网络连通性检测结果
+    struct ConnectivityResult {
+        ConnectivityStatus status;
+        std::wstring probeUrl;          // 给出结论的探测地址
+        DWORD statusCode;               // 探测响应的HTTP状态码
+        std::wstring redirectLocation;  // 认证网关重定向的目标地址
+        ULONGLONG elapsedMs;            // 从开始探测到得出结论的耗时
+    };
+
+    // 校园网登录结果
+    enum class LoginResult {
+        Success,        // 登录成功
+        AlreadyOnline,  // 该IP已经在线
+        BadCredentials, // 账号或密码错误（永久错误）
+        AccountLimit,   // 账号在线数量超限或账号被占用
+        PortalError,    // 认证服务器返回其他错误
+        TransportError  // 无法连接认证服务器
+    };
+
+    // 客户端在认证服务器上的会话状态
+    enum class SessionState {
+        Online,         // 已认证
+        Offline,        // 未认证
+        Unknown         // 查询失败或无法解析响应
+    };
+
+    // 会话状态查询结果
+    struct SessionStatus {
+        SessionState state = SessionState::Unknown;
+        std::wstring uid;               // 在线账号
+        long long flux = 0;             // 已用流量（olflow）
+        long long onlineTime = 0;       // 在线时长（oltime）
+        std::wstring reportedIP;        // 认证服务器在响应中给出的客户端地址（v46ip）
+        bool addressMismatch = false;   // 响应是其他地址的状态（此时state为Unknown）
+    };
+
+    // 连通性探测目标
+    struct ProbeTarget {
+        std::wstring url;
+        std::wstring verb;      // 探测方法（GET或HEAD），响应体不会被读取
+        DWORD expectedStatus;   // 在线时的状态码，0表示任意响应都视为在线
+    };
+
+    // 响应体流式处理函数：每收到一段数据调用一次，返回false表示不再需要后续数据
+    typedef ResponseBodyReader::Consumer BodyConsumer;
+
     NetworkRequester();
     ~NetworkRequester();
 
@@ -19,35 +69,89 @@ public:
     std::wstring GetUserIP();
 
     // 登录校园网
-    bool LoginCampusNetwork(const std::wstring& account, const std::wstring& password, const std::wstring& userIP);
+    LoginResult LoginCampusNetwork(const std::wstring& account, const std::wstring& password, const std::wstring& userIP);
+
+    // 为指定IP和MAC地址的客户端发送一次登录请求，不输出过程信息（可在多个线程中同时调用）
+    // userMac为12位十六进制数字，没有分隔符；message不为空时返回认证服务器的提示信息
+    LoginResult SubmitLogin(const std::wstring& account, const std::wstring& password,
+                            const std::wstring& userIP, const std::wstring& userMac,
+                            std::wstring* message = nullptr);
+
+    // 构建登录地址
+    static std::wstring BuildLoginUrl(const std::wstring& loginUrl, const std::wstring& account, const std::wstring& password,
+                                      const std::wstring& userIP, const std::wstring& userMac);
+
+    // 设置登录接口地址（不含查询参数），用于连接本地的模拟认证服务器
+    void SetLoginUrl(const std::wstring& loginUrl);
+
+    // 查询指定IP的客户端在认证服务器上的会话状态，不输出过程信息（可在多个线程中同时调用）
+    // 真实的认证服务器按请求的来源地址返回状态，响应中的v46ip不是clientIP时结果为Unknown（addressMismatch为true）
+    // timeoutMs为各阶段的超时时间，0表示使用默认值
+    SessionStatus QuerySessionStatus(const std::wstring& clientIP, DWORD timeoutMs = 0);
+
+    // 设置状态查询地址（含查询参数）
+    void SetChkstatusUrl(const std::wstring& chkstatusUrl);
+
+    // 把状态查询、登录和连通性探测都指向同一个认证服务器（如 http://127.0.0.1:8080），
+    // 路径与真实服务器和模拟认证服务器一致
+    void SetPortalBaseUrl(const std::wstring& baseUrl);
+
+    // 根据dr1003响应判断登录结果，不输出信息；message不为空时返回反转义后的提示信息
+    static LoginResult ClassifyLoginResponse(const std::string& body, std::wstring* message = nullptr);
+
+    // 判断登录结果是否为重试无效的永久错误
+    static bool IsPermanentLoginFailure(LoginResult result);
+
+    // 登录结果的文字描述
+    static const wchar_t* LoginResultToString(LoginResult result);
 
     // 检查网络连接状态
     bool CheckNetworkConnection();
 
+    // 并发探测所有测试网站，第一个确定的结果胜出，其余探测被取消
+    ConnectivityResult ProbeConnectivity();
+
+    // 设置连通性探测目标
+    void SetProbeTargets(const std::vector<ProbeTarget>& targets);
+
+    // 设置连通性探测的总截止时间（毫秒）
+    void SetProbeDeadline(DWORD deadlineMs);
+    
+    // 关闭空闲时间过长的连接句柄
+    void ReleaseIdleConnections();
+
+    // 设置每个主机的最大并发请求数（批量登录时与并发数一致）
+    void SetMaxConnectionsPerHost(DWORD maxPerHost);
+
+    // 设置取消令牌，令牌被取消时中断所有正在进行的请求
+    void SetCancellationToken(CancellationToken* token);
+
+    // 将UTF-8字节转换为宽字符串
+    static std::wstring Utf8ToWide(const std::string& utf8);
+    
+    // 将宽字符串转换为UTF-8字节
+    static std::string WideToUtf8(const std::wstring& wide);
+
 private:
-    // HTTP会话句柄
-    HINTERNET m_hSession;
-
-    // 发送HTTP GET请求
-    std::wstring SendHttpGetRequest(const std::wstring& url, bool isSecure = true);
-
-    // 发送HTTP POST请求
-    std::wstring SendHttpPostRequest(
-        const std::wstring& url, 
-        const std::wstring& postData, 
-        const std::wstring& contentType = L"application/x-www-form-urlencoded",
-        bool isSecure = true
-    );
-
-    // 解析URL
-    bool ParseUrl(
-        const std::wstring& url, 
-        std::wstring& hostName, 
-        std::wstring& urlPath, 
-        INTERNET_SCHEME& scheme, 
-        INTERNET_PORT& port
-    );
-
-    // 清理资源
-    void Cleanup();
+    // HTTP传输层
+    WinHttpTransport m_transport;
+
+    // 取消令牌（不归本对象所有）
+    CancellationToken* m_cancelToken;
+
+    // 校园网状态查询地址
+    std::wstring m_chkstatusUrl;
+
+    // 校园网登录接口地址（不含查询参数）
+    std::wstring m_loginUrl;
+
+    // 连通性探测目标
+    std::vector<ProbeTarget> m_probeTargets;
+
+    // 连通性探测的总截止时间（毫秒）
+    DWORD m_probeDeadlineMs;
+
+    // 发送HTTP请求，收到响应头即返回true；服务停止（取消令牌被取消）时中断请求，
+    // cancel不为空时也可由其他线程单独取消
+    bool SendHttpRequest(const HttpRequest& request, HttpResponse& response, HttpCancel* cancel = nullptr);
 }; 
\ No newline at end of file
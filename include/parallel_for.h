@@ -0,0 +1,10 @@
+﻿#pragma once
+
+#include <windows.h>
+#include <functional>
+#include "cancellation_token.h"
+
+// 用固定数量的线程处理count个任务
+// 每个线程依次领取下一个任务的序号，直到任务领完或令牌被取消；所有线程结束后返回。
+// body在工作线程中调用，不同序号的任务写入各自的结果位置时不需要加锁
+void ParallelFor(size_t count, DWORD parallelism, CancellationToken* token, const std::function<void(size_t index)>& body);
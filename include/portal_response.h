@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+
+// 校园网认证接口返回的数据（dr1002(...) / dr1003(...) 格式的JSONP）
+// 字符串字段直接引用响应体中的原始字节（未反转义），响应体释放后不可再使用
+struct PortalResponse {
+    // JSONP回调名称，如 dr1002、dr1003
+    std::string_view callback;
+
+    // 认证结果，1表示成功
+    bool hasResult = false;
+    long long result = 0;
+
+    // 返回码，登录失败时说明失败原因
+    bool hasRetCode = false;
+    long long retCode = 0;
+
+    // 提示信息（原始JSON字符串，可能包含\uXXXX转义）
+    std::string_view msg;
+
+    // 在线账号
+    std::string_view uid;
+
+    // 用户IP地址
+    std::string_view v46ip;
+
+    // 已用流量（olflow）
+    bool hasFlux = false;
+    long long flux = 0;
+
+    // 在线时长（oltime）
+    bool hasTime = false;
+    long long time = 0;
+};
+
+// 校园网认证接口响应解析器
+// 对UTF-8字节只扫描一遍，解析过程中不分配内存
+class PortalResponseParser {
+public:
+    // 解析JSONP（或不带回调的JSON）响应，成功解析出对象时返回true
+    static bool Parse(const char* data, size_t length, PortalResponse& response);
+
+    // 解析JSONP响应
+    static bool Parse(const std::string& body, PortalResponse& response);
+
+    // 将原始JSON字符串反转义并转换为宽字符串（仅在需要显示时调用）
+    static std::wstring DecodeString(std::string_view raw);
+
+    // 响应中的地址（如v46ip）是否就是查询的地址，按字符比较，忽略IPv6十六进制数字的大小写
+    static bool IsSameAddress(std::string_view reported, std::string_view address);
+
+private:
+    // 跳过空白字符
+    static const char* SkipWhitespace(const char* p, const char* end);
+
+    // 读取JSON字符串（p指向开头的引号），返回结尾引号之后的位置，失败返回nullptr
+    static const char* ReadString(const char* p, const char* end, std::string_view& value);
+
+    // 跳过嵌套的对象或数组，返回结束括号之后的位置，失败返回nullptr
+    static const char* SkipNested(const char* p, const char* end);
+
+    // 将数字或数字字符串转换为整数，超出范围时返回false
+    static bool ToInteger(std::string_view text, long long& value);
+};
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// 分块读取HTTP响应体：每块数据读入线程复用的接收缓冲区，再交给consumer处理或追加到body，超过上限时截断
+// 读取过程本身不分配内存（追加到body时只在超出预留空间后扩容），与具体的HTTP实现无关，
+// NetworkRequester用它读取WinHTTP的响应体，单元测试和基准测试用模拟的分块数据驱动它
+class ResponseBodyReader {
+public:
+    // 响应体处理函数：每收到一块数据调用一次，返回false表示已拿到所需数据，停止读取
+    typedef std::function<bool(const char* data, size_t length)> Consumer;
+
+    // 接收缓冲区大小（每次读取的最大字节数）
+    static const size_t kBufferSize = 16 * 1024;
+
+    // maxBytes为响应体上限（0表示不限制）；consumer为空时数据追加到body
+    ResponseBodyReader(size_t maxBytes, const Consumer& consumer, std::string& body);
+
+    // 按Content-Length为body预留空间（不超过上限），设置了consumer时不预留
+    void Reserve(size_t contentLength);
+
+    // 取得下一次读取的缓冲区和可读字节数，已达到上限时返回false并标记为截断
+    bool NextBuffer(char*& buffer, size_t& capacity);
+
+    // 处理读入缓冲区的length字节，返回false表示读取应当结束（响应体已结束或consumer要求停止）
+    bool Commit(size_t length);
+
+    // 响应体是否因超过上限而被截断
+    bool IsTruncated() const { return m_truncated; }
+
+    // 已读取的字节数
+    size_t GetTotalRead() const { return m_totalRead; }
+
+private:
+    size_t m_maxBytes;
+    const Consumer& m_consumer;
+    std::string& m_body;
+    char* m_buffer;
+    size_t m_totalRead;
+    bool m_truncated;
+};
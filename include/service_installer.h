@@ -14,7 +14,8 @@ public:
         const std::wstring& targetSsid,
         const std::wstring& targetPassword = L"",
         const std::wstring& campusAccount = L"",
-        const std::wstring& campusPassword = L""
+        const std::wstring& campusPassword = L"",
+        const std::wstring& portalBaseUrl = L""
     );
     
     // 卸载服务
@@ -51,7 +52,8 @@ private:
         const std::wstring& targetSsid,
         const std::wstring& targetPassword,
         const std::wstring& campusAccount,
-        const std::wstring& campusPassword
+        const std::wstring& campusPassword,
+        const std::wstring& portalBaseUrl
     );
     
     // 删除服务配置注册表项
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "network_requester.h"
+#include "cancellation_token.h"
+
+// 批量查询会话状态的选项
+struct SessionSweepOptions {
+    DWORD parallelism = 32;         // 同时进行的查询数，也是到认证服务器的长连接数
+    DWORD timeoutMs = 5000;         // 单次查询各阶段的超时时间
+};
+
+// 批量查询的结果
+struct SessionSweepReport {
+    std::vector<NetworkRequester::SessionStatus> statuses;  // 与输入的IP一一对应
+    ULONGLONG elapsedMs = 0;                                // 总耗时
+    bool cancelled = false;                                 // 是否被取消（未查询的IP状态为Unknown）
+};
+
+// 会话状态批量查询器
+// 并发查询大量客户端IP在认证服务器上的会话状态（drcom/chkstatus）；
+// 所有请求共用网络请求器的连接池，每个工作线程持有一条到认证服务器的长连接，不必每次重新握手
+class SessionSweeper {
+public:
+    explicit SessionSweeper(NetworkRequester& requester);
+
+    // 设置查询选项
+    void SetOptions(const SessionSweepOptions& options);
+
+    // 查询所有IP的会话状态，全部完成或令牌被取消后返回
+    SessionSweepReport Run(const std::vector<std::wstring>& clientIPs, CancellationToken* token = nullptr);
+
+    // 状态的文字描述
+    static const wchar_t* StateToString(NetworkRequester::SessionState state);
+
+    // 输出紧凑的状态表（IP、状态、账号、流量、在线时长）和汇总
+    static void PrintTable(const std::vector<std::wstring>& clientIPs, const SessionSweepReport& report, std::wostream& out);
+
+    // 认证服务器返回了其他地址的状态的IP数
+    static size_t CountMismatched(const SessionSweepReport& report);
+
+private:
+    // 网络请求器（不归本对象所有）
+    NetworkRequester& m_requester;
+
+    // 查询选项
+    SessionSweepOptions m_options;
+};
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "http_transport.h"
+
+// 直接使用套接字的HTTP/1.1传输层，只支持明文HTTP
+// 按 主机:端口 保存空闲的长连接并复用，限制每个主机同时进行的请求数，空闲超时的连接被关闭。
+// 取消时关闭套接字的读写（shutdown），阻塞中的连接、发送和接收立即返回；套接字只由发起请求的线程关闭。
+// 不支持分块传输编码的响应体（模拟认证服务器和探测目标都不使用），名称解析不能被取消
+class SocketHttpTransport : public HttpTransport {
+public:
+    // 默认的各阶段超时时间（毫秒）
+    static const uint32_t kDefaultTimeoutMs = 30000;
+
+    // 最多跟随的重定向次数
+    static const int kMaxRedirects = 5;
+
+    SocketHttpTransport();
+    ~SocketHttpTransport() override;
+
+    SocketHttpTransport(const SocketHttpTransport&) = delete;
+    SocketHttpTransport& operator=(const SocketHttpTransport&) = delete;
+
+    bool Send(const HttpRequest& request, HttpResponse& response, HttpCancel* cancel) override;
+
+    void SetLimits(uint32_t maxPerHost, uint64_t idleTimeoutMs) override;
+
+    void ReleaseIdleConnections() override;
+
+    // 关闭所有空闲连接
+    void Clear();
+
+    // 解析http://地址，路径包含查询参数；不是明文HTTP地址时返回false
+    static bool ParseUrl(const std::string& url, std::string& host, uint16_t& port, std::string& path);
+
+private:
+    // 空闲的长连接
+    struct IdleConnection {
+        uintptr_t socket;
+        uint64_t lastUsedMs;
+    };
+
+    // 每个主机的状态
+    struct HostState {
+        uint32_t inFlight = 0;
+        std::vector<IdleConnection> idle;   // 最近使用的在末尾
+    };
+
+    // 一次请求的结果
+    enum class ExchangeResult {
+        Completed,      // 收到响应头
+        Stale,          // 复用的连接已被服务器关闭，可以换一个新连接重试
+        Failed
+    };
+
+    // 等待该主机的请求数低于上限并占用一个名额，有空闲连接时取出（没有时socket为无效值）；被取消时返回false
+    bool AcquireConnection(const std::string& key, HttpCancel* cancel, uintptr_t& socket);
+
+    // 归还名额，reusable时连接放回空闲列表，否则关闭
+    void ReleaseConnection(const std::string& key, uintptr_t socket, bool reusable);
+
+    // 建立新连接
+    bool Connect(const std::string& host, uint16_t port, uint32_t timeoutMs, HttpCancel* cancel, uintptr_t& socket);
+
+    // 在连接上发送一个请求并读取响应；reusable返回连接能否继续使用
+    ExchangeResult Exchange(uintptr_t socket, const HttpRequest& request, const std::string& method,
+                            const std::string& host, uint16_t port, const std::string& path,
+                            uint32_t timeoutMs, bool reused, HttpResponse& response, bool& reusable);
+
+    // 向一个地址发送请求（不跟随重定向）
+    bool SendOnce(const HttpRequest& request, const std::string& method, const std::string& url,
+                  HttpCancel* cancel, HttpResponse& response);
+
+    // 关闭空闲超时的连接（调用方需持有锁）
+    void EvictIdleLocked(uint64_t nowMs);
+
+    // 每个主机的最大并发请求数
+    uint32_t m_maxPerHost;
+
+    // 空闲连接的回收时间（毫秒）
+    uint64_t m_idleTimeoutMs;
+
+    // 按 主机:端口 记录的状态
+    std::map<std::string, HostState> m_hosts;
+
+    // 保护以上成员
+    std::mutex m_mutex;
+
+    // 等待名额归还的条件变量
+    std::condition_variable m_released;
+};
@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// 共享状态页中的状态数据
+// 布局固定，只在末尾追加字段；修改已有字段时提高StatusPage::kVersion
+// 时间均为Unix时间（毫秒），0表示没有记录
+struct StatusPageData {
+    uint64_t publishTimeMs;         // 最近一次发布的时间
+    uint64_t stateSinceMs;          // 进入当前连接状态的时间
+    uint64_t lastProbeTimeMs;       // 最近一次网络探测的时间
+    uint64_t lastLoginTimeMs;       // 最近一次登录的时间
+    uint64_t connectCount;          // WiFi连接成功次数
+    uint64_t disconnectCount;       // WiFi断开次数
+    uint64_t loginCount;            // 登录次数
+    uint64_t loginFailureCount;     // 登录失败次数
+    uint64_t wakeupCount;           // 工作线程唤醒次数
+    uint32_t serviceRunning;        // 服务是否在运行（停止前发布0）
+    uint32_t state;                 // 连接状态（ConnectionState的值）
+    uint32_t wifiConnected;         // WiFi是否已连接
+    uint32_t signalQuality;         // 信号强度（0-100）
+    int32_t rssi;                   // 近似RSSI（dBm）
+    uint32_t ssidLength;            // SSID字节数（0-32）
+    uint8_t ssid[32];               // SSID原始字节（通常为UTF-8）
+    uint32_t lastProbeStatus;       // 最近一次探测结果（NetworkRequester::ConnectivityStatus的值）
+    uint32_t lastProbeElapsedMs;    // 最近一次探测的耗时
+    uint32_t lastLoginResult;       // 最近一次登录结果（NetworkRequester::LoginResult的值）
+    uint16_t addressFamily;         // 地址类型：0表示没有可用地址，4为IPv4，6为IPv6
+    uint16_t reserved;
+    uint8_t address[16];            // 可用的IP地址（IPv4只使用前4字节）
+};
+
+// 以seqlock保护的共享状态页
+// 只有服务一个写者，写入时不加锁也不通知任何人；读者不会唤醒服务，
+// 读到写了一半的数据时重新读取。数据按64位原子字复制，读写双方都没有数据竞争
+class StatusPage {
+public:
+    // 页头标识（"WFSP"）和布局版本
+    static const uint32_t kMagic = 0x50534657;
+    static const uint32_t kVersion = 1;
+
+    // 状态数据占用的64位字数
+    static const size_t kDataWords = (sizeof(StatusPageData) + 7) / 8;
+
+    // 共享内存中的布局
+    struct Layout {
+        std::atomic<uint32_t> magic;        // 写者初始化完成后才写入kMagic
+        std::atomic<uint32_t> version;      // 布局版本
+        std::atomic<uint32_t> sequence;     // 序号：奇数表示正在写入
+        uint32_t reserved;
+        std::atomic<uint64_t> words[kDataWords];
+    };
+
+    // 初始化状态页（写者在发布第一份数据之前调用一次）
+    static void Initialize(Layout* page);
+
+    // 发布状态数据（只能由一个线程调用）
+    static void Publish(Layout* page, const StatusPageData& data);
+
+    // 读取一次状态数据；页面未初始化、版本不符或读取时正好在写入返回false
+    static bool TryRead(const Layout* page, StatusPageData& data);
+
+    // 读取状态数据，遇到正在写入时重试，最多maxAttempts次；pRetries返回重试的次数
+    static bool Read(const Layout* page, StatusPageData& data, uint32_t maxAttempts = 1000, uint32_t* pRetries = nullptr);
+
+    // 页面是否已由兼容版本的写者初始化
+    static bool IsCompatible(const Layout* page);
+
+    // 把地址格式化为文字（IPv6按RFC 5952压缩最长的连续零），没有地址时返回空字符串
+    static std::string FormatAddress(const StatusPageData& data);
+
+    // SSID原始字节
+    static std::string Ssid(const StatusPageData& data);
+
+    static_assert(std::is_trivially_copyable<StatusPageData>::value, "状态数据必须可以按字节复制");
+    static_assert(sizeof(StatusPageData) % 8 == 0, "状态数据的大小必须是8的倍数");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "跨进程共享需要无锁的64位原子操作");
+};
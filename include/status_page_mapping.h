@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <windows.h>
+#include <string>
+#include "status_page.h"
+
+// 共享状态页的写者：服务创建命名共享内存并发布状态
+// 共享内存名称为"Global\<服务名>.Status"，没有创建全局对象的权限时（如非管理员直接运行）
+// 退回到当前会话的"Local\<服务名>.Status"
+class StatusPageWriter {
+public:
+    StatusPageWriter();
+    ~StatusPageWriter();
+
+    StatusPageWriter(const StatusPageWriter&) = delete;
+    StatusPageWriter& operator=(const StatusPageWriter&) = delete;
+
+    // 创建共享状态页；同名的状态页已存在（另一个实例正在发布）时失败
+    bool Create(const std::wstring& serviceName);
+
+    // 关闭共享状态页，所有读者也关闭后系统释放共享内存
+    void Close();
+
+    // 是否已创建
+    bool IsOpen() const { return m_page != nullptr; }
+
+    // 发布状态数据（只能在一个线程中调用），不唤醒任何读者
+    void Publish(const StatusPageData& data);
+
+    // 实际使用的共享内存名称
+    const std::wstring& GetMappingName() const { return m_mappingName; }
+
+    // 服务对应的共享内存名称（不含Global\或Local\前缀）
+    static std::wstring NameForService(const std::wstring& serviceName);
+
+private:
+    // 以指定的完整名称创建共享内存
+    bool CreateMapping(const std::wstring& mappingName);
+
+    // 共享内存句柄
+    HANDLE m_hMapping;
+
+    // 映射的状态页
+    StatusPage::Layout* m_page;
+
+    // 实际使用的共享内存名称
+    std::wstring m_mappingName;
+};
+
+// 共享状态页的读者：以只读方式打开服务发布的状态页
+// 读取只访问共享内存，不经过服务控制管理器或控制通道，也不会唤醒服务，可以频繁调用
+class StatusPageReader {
+public:
+    StatusPageReader();
+    ~StatusPageReader();
+
+    StatusPageReader(const StatusPageReader&) = delete;
+    StatusPageReader& operator=(const StatusPageReader&) = delete;
+
+    // 打开服务的状态页，先找全局的，再找当前会话的
+    bool Open(const std::wstring& serviceName);
+
+    // 关闭状态页
+    void Close();
+
+    // 是否已打开
+    bool IsOpen() const { return m_page != nullptr; }
+
+    // 读取一致的状态数据；pRetries返回遇到写入而重试的次数
+    bool Read(StatusPageData& data, uint32_t* pRetries = nullptr) const;
+
+    // 映射的状态页
+    const StatusPage::Layout* GetLayout() const { return m_page; }
+
+private:
+    // 共享内存句柄
+    HANDLE m_hMapping;
+
+    // 映射的状态页（只读）
+    const StatusPage::Layout* m_page;
+};
@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+// 分层时间轮定时器
+// 4层、每层64个槽，第0层每个槽对应一个tick，上一层每个槽对应下一层的一整圈。
+// 定时器按到期时间放入对应层，到期前逐层下移，插入、取消、到期都是O(1)。
+// 时钟可以注入，测试和基准测试可以用虚拟时钟快进
+class TimerWheel {
+public:
+    // 定时器ID，0表示无效
+    typedef uint64_t TimerId;
+
+    // 定时器回调（在Advance中执行）
+    typedef std::function<void()> Callback;
+
+    // 时钟函数，返回单调递增的毫秒数
+    typedef std::function<uint64_t()> Clock;
+
+    // 没有定时器时NextDeadline的返回值
+    static constexpr uint64_t kNoDeadline = UINT64_MAX;
+
+    // clock为空时使用std::chrono::steady_clock，tickMs为时间轮精度
+    explicit TimerWheel(Clock clock = Clock(), uint64_t tickMs = 10);
+
+    // 添加定时器，delayMs后执行；periodMs不为0时之后每隔periodMs执行一次
+    TimerId Schedule(uint64_t delayMs, Callback callback, uint64_t periodMs = 0);
+
+    // 把定时器的下次执行时间改为delayMs之后，周期不变
+    bool Reschedule(TimerId id, uint64_t delayMs);
+
+    // 取消定时器
+    bool Cancel(TimerId id);
+
+    // 定时器是否仍在等待执行
+    bool IsScheduled(TimerId id) const;
+
+    // 最早到期的定时器的到期时间（毫秒），没有定时器时返回kNoDeadline
+    uint64_t NextDeadline() const;
+
+    // 执行所有已到期的定时器，返回执行的数量
+    size_t Advance();
+
+    // 当前时间（毫秒）
+    uint64_t Now() const;
+
+    // 等待执行的定时器数量
+    size_t Size() const { return m_timers.size(); }
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 6;
+    static constexpr uint64_t kSlots = 1ULL << kSlotBits;
+    static constexpr uint64_t kSlotMask = kSlots - 1;
+
+    // 定时器
+    struct Timer {
+        uint64_t expires;           // 到期tick
+        uint64_t periodTicks;       // 周期（tick），0表示只执行一次
+        Callback callback;
+        int level;                  // 所在层
+        uint64_t slot;              // 所在槽
+        std::list<TimerId>::iterator position;  // 在槽链表中的位置
+    };
+
+    // 时钟函数
+    Clock m_clock;
+
+    // 时间轮精度（毫秒）
+    uint64_t m_tickMs;
+
+    // 已处理到的tick
+    uint64_t m_currentTick;
+
+    // 下一个定时器ID
+    TimerId m_nextId;
+
+    // 各层的槽
+    std::list<TimerId> m_slots[kLevels][kSlots];
+
+    // 所有等待执行的定时器
+    std::unordered_map<TimerId, Timer> m_timers;
+
+    // 毫秒转换为tick（向上取整，保证定时器不会提前执行）
+    uint64_t ToTicks(uint64_t ms) const { return (ms + m_tickMs - 1) / m_tickMs; }
+
+    // 从现在起delayMs之后的到期tick，至少为下一个tick
+    uint64_t ExpiryTick(uint64_t delayMs) const;
+
+    // 按到期时间把定时器放入对应的层和槽（到期时间不早于当前tick）
+    void Place(TimerId id, Timer& timer);
+
+    // 把定时器从所在的槽中移除
+    void Unlink(Timer& timer);
+
+    // 把上层的一个槽中的定时器重新放入下层
+    void Cascade(int level, uint64_t slot);
+
+    // 执行第0层当前槽中的定时器
+    size_t Expire(uint64_t slot);
+};
@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 按重连周期记录的分段追踪
+// 一个周期从状态机开始执行动作（扫描、连接、探测、登录）起，到回到稳定状态为止，
+// 期间各步骤以及HTTP请求的各阶段记录为时间段。内存中只保留最近的若干个周期，
+// 可以导出为Chrome trace JSON（在chrome://tracing或Perfetto中打开）
+class Tracer {
+public:
+    // 时间段
+    struct Span {
+        std::string name;
+        std::string category;
+        uint64_t startUs;       // 开始时间（微秒，Tracer::NowUs的时间基准）
+        uint64_t durationUs;
+        uint32_t threadId;
+        std::vector<std::pair<std::string, std::string>> args;
+    };
+
+    // 重连周期
+    struct Cycle {
+        uint64_t id;
+        std::string reason;     // 开始周期的原因
+        uint64_t startUs;
+        uint64_t endUs;
+        std::vector<Span> spans;
+    };
+
+    // 进程内的全局追踪器
+    static Tracer& Instance();
+
+    // 单调时钟的当前时间（微秒）
+    static uint64_t NowUs();
+
+    // 当前线程的序号（进程内从1开始分配）
+    static uint32_t CurrentThreadId();
+
+    // 宽字符串转换为UTF-8
+    static std::string ToUtf8(const std::wstring& text);
+
+    // 开始新的周期，已有未结束的周期时先结束它
+    void BeginCycle(const std::string& reason);
+
+    // 结束当前周期，keep为false时丢弃该周期（例如例行的健康检查）
+    void EndCycle(bool keep = true);
+
+    // 是否处于周期中（只有周期中的时间段才会被记录）
+    bool InCycle() const { return m_inCycle.load(std::memory_order_relaxed); }
+
+    // 把时间段加入当前周期，不在周期中时丢弃
+    void AddSpan(Span span);
+
+    // 设置保留的周期数
+    void SetMaxCycles(size_t maxCycles);
+
+    // 已保留的周期数
+    size_t CycleCount() const;
+
+    // 把保留的周期导出为Chrome trace JSON
+    std::string ExportChromeTrace() const;
+
+private:
+    Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // JSON字符串转义
+    static void AppendJsonString(std::string& out, const std::string& text);
+
+    mutable std::mutex m_mutex;
+    std::atomic<bool> m_inCycle;
+    Cycle m_current;
+    uint64_t m_nextCycleId;
+    size_t m_maxCycles;
+    std::deque<Cycle> m_cycles;
+};
+
+// 作用域时间段：构造时开始计时，析构时加入当前周期
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const char* category = "wifi");
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // 添加参数
+    void AddArg(const char* key, const std::string& value);
+    void AddArg(const char* key, const std::wstring& value);
+    void AddArg(const char* key, uint64_t value);
+
+private:
+    bool m_active;
+    Tracer::Span m_span;
+};
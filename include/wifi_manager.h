@@ -5,10 +5,50 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <deque>
+#include <mutex>
 
 #pragma comment(lib, "wlanapi.lib")
 #pragma comment(lib, "ole32.lib")
 
+// WiFi事件类型
+enum class WifiEventType {
+    Disconnected,       // 连接已断开
+    ConnectComplete,    // 连接成功
+    ConnectFailed,      // 连接失败
+    ScanComplete,       // 扫描完成
+    ScanFailed,         // 扫描失败
+    SignalChanged       // 信号强度变化
+};
+
+// WiFi事件
+struct WifiEvent {
+    WifiEventType type;
+    std::wstring ssid;      // 连接相关事件的SSID
+    DWORD reasonCode;       // 连接/扫描失败的原因码
+    ULONG signalQuality;    // 信号强度（0-100）
+    ULONGLONG timestamp;    // 事件发生时间（GetTickCount64）
+};
+
+// WiFi连接快照，由一次WlanQueryInterface查询得到，创建后不再修改
+struct WifiSnapshot {
+    WLAN_INTERFACE_STATE state = wlan_interface_state_disconnected;  // 接口状态
+    bool connected = false;                     // 是否已连接
+    DOT11_SSID ssidBytes = {};                  // SSID原始字节
+    std::wstring ssid;                          // SSID
+    std::wstring profileName;                   // 配置文件名称
+    DOT11_MAC_ADDRESS bssid = {};               // 接入点MAC地址
+    ULONG signalQuality = 0;                    // 信号强度（0-100）
+    LONG rssi = -100;                           // 由信号强度换算的近似RSSI（dBm）
+    DOT11_PHY_TYPE phyType = dot11_phy_type_unknown;  // 物理层类型
+    ULONG rxRate = 0;                           // 接收速率（kbps）
+    ULONG txRate = 0;                           // 发送速率（kbps）
+    bool securityEnabled = false;               // 是否启用加密
+    DOT11_AUTH_ALGORITHM authAlgorithm = DOT11_AUTH_ALGO_80211_OPEN;  // 认证算法
+    DOT11_CIPHER_ALGORITHM cipherAlgorithm = DOT11_CIPHER_ALGO_NONE;  // 加密算法
+    ULONGLONG timestamp = 0;                    // 查询时间（GetTickCount64）
+};
+
 class WifiManager {
 public:
     WifiManager();
@@ -17,17 +57,57 @@ public:
     // 初始化WiFi管理器
     bool Initialize();
     
+    // 获取WiFi连接快照：缓存未过期时直接返回缓存，refresh为true时强制重新查询
+    std::shared_ptr<const WifiSnapshot> Snapshot(bool refresh = false);
+    
+    // 设置连接快照的缓存时间（毫秒），0表示每次都重新查询
+    void SetSnapshotTtl(ULONGLONG ttlMs) { m_snapshotTtlMs = ttlMs; }
+    
     // 检查WiFi连接状态
     bool IsConnected();
     
     // 获取当前连接的SSID
     std::wstring GetCurrentSSID();
     
-    // 获取可用的WiFi网络列表
-    std::vector<std::wstring> GetAvailableNetworks();
+    // 获取可用的WiFi网络列表（扫描缓存足够新时不重新扫描），hCancelEvent被触发时停止等待扫描
+    std::vector<std::wstring> GetAvailableNetworks(HANDLE hCancelEvent = NULL);
+    
+    // 设置扫描缓存的有效期（毫秒），超过有效期才重新扫描
+    void SetScanCacheMaxAge(ULONGLONG maxAgeMs) { m_scanCacheMaxAgeMs = maxAgeMs; }
     
     // 连接到指定SSID的WiFi
-    bool ConnectToNetwork(const std::wstring& ssid, const std::wstring& password = L"");
+    // 等待连接完成或失败的通知，最多45秒；hCancelEvent被触发时立即返回
+    // 失败时pReasonCode返回WLAN原因码（取消时为ERROR_CANCELLED，超时为ERROR_TIMEOUT）
+    bool ConnectToNetwork(
+        const std::wstring& ssid,
+        const std::wstring& password = L"",
+        HANDLE hCancelEvent = NULL,
+        DWORD* pReasonCode = NULL
+    );
+    
+    // 获取最近一次成功连接从发起到关联完成的耗时（毫秒）
+    ULONGLONG GetLastAssociateTime() const { return m_lastAssociateTimeMs; }
+    
+    // 获取正在使用的无线接口GUID
+    const GUID& GetInterfaceGuid() const { return m_interfaceGuid; }
+    
+    // 是否已注册WLAN通知
+    bool HasNotifications() const { return m_notificationsRegistered; }
+    
+    // 获取WiFi事件句柄，有新事件时被触发
+    HANDLE GetEventHandle() const { return m_hEvent; }
+    
+    // 取出一个WiFi事件，队列为空时返回false
+    bool PopEvent(WifiEvent& event);
+    
+    // 将SSID字节转换为字符串
+    static std::wstring ConvertSSIDToString(const DOT11_SSID& ssid);
+    
+    // 创建WiFi配置文件（WPA2PSK和AES）
+    static std::wstring CreateProfileXml(const std::wstring& ssid, const std::wstring& password);
+    
+    // 根据网络信息创建WiFi配置文件
+    static std::wstring CreateProfileXml(const std::wstring& ssid, const std::wstring& password, const WLAN_AVAILABLE_NETWORK& network);
 
 private:
     // WLAN句柄
@@ -36,18 +116,109 @@ private:
     // 接口GUID
     GUID m_interfaceGuid = {};
     
+    // WLAN通知是否已注册
+    bool m_notificationsRegistered = false;
+    
+    // WiFi事件句柄（自动重置）
+    HANDLE m_hEvent = NULL;
+    
+    // WiFi事件队列
+    std::deque<WifiEvent> m_events;
+    
+    // 保护事件队列和连接等待状态的互斥锁
+    std::mutex m_eventMutex;
+    
+    // 连接完成事件句柄（手动重置）
+    HANDLE m_hConnectEvent = NULL;
+    
+    // 正在等待连接结果的SSID
+    std::wstring m_pendingConnectSsid;
+    
+    // 连接结果
+    bool m_connectSucceeded = false;
+    
+    // 连接失败原因码
+    DWORD m_connectReasonCode = 0;
+    
+    // 最近一次成功连接的关联耗时（毫秒）
+    ULONGLONG m_lastAssociateTimeMs = 0;
+    
+    // 缓存的连接快照
+    std::shared_ptr<const WifiSnapshot> m_snapshot;
+    
+    // 保护连接快照的互斥锁
+    std::mutex m_snapshotMutex;
+    
+    // 连接快照缓存时间（毫秒）
+    ULONGLONG m_snapshotTtlMs = 1000;
+    
+    // 使缓存的连接快照失效
+    void InvalidateSnapshot();
+    
+    // 扫描完成事件句柄（手动重置）
+    HANDLE m_hScanEvent = NULL;
+    
+    // 保护扫描状态和扫描缓存的互斥锁
+    std::mutex m_scanMutex;
+    
+    // 是否有正在进行的扫描
+    bool m_scanInProgress = false;
+    
+    // 正在进行的扫描的开始时间
+    ULONGLONG m_scanStartTime = 0;
+    
+    // 最近一次扫描完成的时间（包括系统自动发起的扫描）
+    ULONGLONG m_lastScanTime = 0;
+    
+    // 缓存的可用网络列表
+    std::vector<WLAN_AVAILABLE_NETWORK> m_scanCache;
+    
+    // 可用网络列表的获取时间
+    ULONGLONG m_scanCacheTime = 0;
+    
+    // 扫描缓存有效期（毫秒）
+    ULONGLONG m_scanCacheMaxAgeMs = 30000;
+    
+    // 上次成功连接的网络
+    WLAN_AVAILABLE_NETWORK m_lastGoodNetwork = {};
+    bool m_hasLastGoodNetwork = false;
+    
+    // 扫描无线网络并等待扫描完成；已有扫描在进行时直接等待该扫描的结果
+    bool Scan(HANDLE hCancelEvent);
+    
+    // 获取可用网络列表，缓存超过maxAgeMs时先重新扫描
+    // pFromCache返回结果是否未经本次扫描直接来自缓存
+    bool GetScanResults(ULONGLONG maxAgeMs, HANDLE hCancelEvent, std::vector<WLAN_AVAILABLE_NETWORK>& networks, bool* pFromCache = NULL);
+    
+    // 设置配置文件并连接到网络，优先使用上次成功连接的网络信息，其次使用扫描缓存
+    // 使用缓存结果时找不到目标网络会返回ERROR_NOT_FOUND，由调用方重新扫描后再试
+    bool ConnectWithScanResults(
+        const std::wstring& ssid,
+        const std::wstring& password,
+        HANDLE hCancelEvent,
+        ULONGLONG maxScanAgeMs,
+        bool& fromCache,
+        DWORD& reasonCode
+    );
+    
+    // 等待连接结果
+    bool WaitForConnection(const std::wstring& ssid, HANDLE hCancelEvent, DWORD timeoutMs, DWORD& reasonCode);
+    
+    // 注册WLAN通知
+    bool RegisterNotifications();
+    
+    // WLAN通知回调（在系统线程池线程中执行）
+    static VOID WINAPI NotificationCallback(PWLAN_NOTIFICATION_DATA pData, PVOID pContext);
+    
+    // 处理WLAN通知
+    void OnNotification(PWLAN_NOTIFICATION_DATA pData);
+    
+    // 将事件加入队列并触发事件句柄
+    void PushEvent(const WifiEvent& event);
+    
     // 获取接口信息
     bool GetInterfaceInfo();
     
     // 释放资源
     void Cleanup();
-    
-    // 辅助函数：将SSID字节转换为字符串
-    std::wstring ConvertSSIDToString(const DOT11_SSID& ssid);
-    
-    // 辅助函数：创建WiFi配置文件
-    std::wstring CreateProfileXml(const std::wstring& ssid, const std::wstring& password);
-    
-    // 辅助函数：根据网络信息创建WiFi配置文件
-    std::wstring CreateProfileXml(const std::wstring& ssid, const std::wstring& password, const WLAN_AVAILABLE_NETWORK& network);
 }; 
\ No newline at end of file
@@ -2,8 +2,15 @@
 
 #include <windows.h>
 #include <string>
+#include <mutex>
 #include "wifi_manager.h"
 #include "network_requester.h"
+#include "connection_state_machine.h"
+#include "timer_wheel.h"
+#include "cancellation_token.h"
+#include "address_monitor.h"
+#include "control_pipe.h"
+#include "status_page_mapping.h"
 
 class WifiService {
 public:
@@ -13,9 +20,12 @@ public:
     // 启动服务
     bool Start();
     
-    // 停止服务
+    // 停止服务：取消所有阻塞操作并等待工作线程退出
     void Stop();
     
+    // 获取最近一次停止服务的耗时（毫秒）
+    ULONGLONG GetLastStopLatency() const { return m_lastStopLatencyMs; }
+    
     // 设置服务名称
     void SetServiceName(const std::wstring& name);
     
@@ -25,17 +35,33 @@ public:
     // 设置校园网账号信息
     void SetCampusNetworkCredentials(const std::wstring& account, const std::wstring& password);
     
+    // 设置认证服务器地址（为空时使用默认的校园网认证服务器）
+    void SetPortalBaseUrl(const std::wstring& baseUrl);
+    
     // 服务主函数
     static VOID WINAPI ServiceMain(DWORD dwArgc, LPWSTR* lpszArgv);
     
     // 服务控制处理函数
-    static VOID WINAPI ServiceCtrlHandler(DWORD dwControl);
+    static DWORD WINAPI ServiceCtrlHandlerEx(DWORD dwControl, DWORD dwEventType, LPVOID lpEventData, LPVOID lpContext);
+    
+    // 二进制日志文件路径（与可执行文件在同一目录），用decodelog命令查看
+    static std::wstring GetLogFilePath();
+    
+    // 追踪文件的默认路径（与可执行文件在同一目录），trace命令把通过控制通道取得的追踪写入该文件
+    static std::wstring GetTraceFilePath();
+    
+    // 处理服务控制请求
+    DWORD HandleControl(DWORD dwControl, DWORD dwEventType, LPVOID lpEventData);
     
     // 服务状态报告函数
     void ReportServiceStatus(DWORD dwCurrentState, DWORD dwWin32ExitCode, DWORD dwWaitHint);
     
     // 服务工作线程
     static DWORD WINAPI ServiceWorkerThread(LPVOID lpParam);
+    
+    // 处理控制通道的请求（在控制通道线程中调用）
+    // 支持：status、metrics、events [条数]、trace、reconnect、relogin
+    std::string HandleControlRequest(const std::string& request);
 
 private:
     // 服务状态
@@ -44,8 +70,53 @@ private:
     // 服务状态句柄
     SERVICE_STATUS_HANDLE m_serviceStatusHandle;
     
-    // 服务停止事件
-    HANDLE m_serviceStopEvent;
+    // 服务停止令牌，所有阻塞等待都在令牌被取消时立即返回
+    CancellationToken m_stopToken;
+    
+    // 工作线程句柄
+    HANDLE m_workerThread;
+    
+    // 恢复事件：系统从睡眠中恢复时触发（自动重置）
+    HANDLE m_resumeEvent;
+    
+    // 会话事件：用户登录、解锁或连接到控制台时触发（自动重置）
+    HANDLE m_sessionEvent;
+    
+    // 控制通道要求立即重新连接（自动重置）
+    HANDLE m_reconnectEvent;
+    
+    // 控制通道要求立即重新登录（自动重置）
+    HANDLE m_reloginEvent;
+    
+    // 本地控制通道
+    ControlPipeServer m_controlServer;
+    
+    // 共享状态页，托盘程序和监控程序直接读取，不唤醒服务
+    StatusPageWriter m_statusPage;
+    
+    // 供控制通道查询的运行状态，由工作线程更新
+    struct RuntimeStatus {
+        ConnectionState state = ConnectionState::Disconnected;
+        ULONGLONG stateSince = 0;                   // 进入当前状态的时间（GetTickCount64）
+        bool hasProbe = false;
+        ULONGLONG lastProbeTime = 0;
+        NetworkRequester::ConnectivityStatus lastProbeStatus = NetworkRequester::ConnectivityStatus::Offline;
+        ULONGLONG lastProbeElapsedMs = 0;
+        bool hasLogin = false;
+        ULONGLONG lastLoginTime = 0;
+        NetworkRequester::LoginResult lastLoginResult = NetworkRequester::LoginResult::TransportError;
+        uint64_t connectCount = 0;                  // WiFi连接成功次数
+        uint64_t disconnectCount = 0;               // WiFi断开次数
+        uint64_t loginCount = 0;                    // 登录次数
+        uint64_t loginFailureCount = 0;             // 登录失败次数
+    };
+    
+    // 运行状态及其互斥锁
+    std::mutex m_runtimeMutex;
+    RuntimeStatus m_runtime;
+    
+    // 最近一次停止服务的耗时（毫秒）
+    ULONGLONG m_lastStopLatencyMs;
     
     // 服务名称
     std::wstring m_serviceName;
@@ -68,8 +139,50 @@ private:
     // 网络请求器
     NetworkRequester m_networkRequester;
     
+    // IP地址监视器
+    AddressMonitor m_addressMonitor;
+    
+    // 连接状态机上下文（服务启动后只在工作线程中访问）
+    ConnectionContext m_connection;
+    
+    // 连接状态机的超时和重试策略
+    ConnectionPolicy m_connectionPolicy;
+    
+    // 工作线程的定时任务（只在工作线程中访问）
+    TimerWheel m_timers;
+    
+    // 状态机定时器
+    TimerWheel::TimerId m_stateTimer;
+    
+    // 定期检查WiFi状态的定时器
+    TimerWheel::TimerId m_linkCheckTimer;
+    
+    // 状态机定时器当前的到期时间
+    uint64_t m_stateTimerDeadline;
+    
+    // 当前追踪周期是否从在线状态开始（例行健康检查，结束时仍在线则不保留）
+    bool m_traceCycleFromOnline;
+    
+    // 工作线程被唤醒的次数（只在工作线程中访问）
+    uint64_t m_wakeupCount;
+    
     // 执行校园网登录
-    bool PerformCampusNetworkLogin();
+    NetworkRequester::LoginResult PerformCampusNetworkLogin();
+    
+    // 根据当前WiFi连接状态生成事件，连接到其他WiFi时返回false
+    bool CheckLink(ConnectionEventType& eventType);
+    
+    // 把事件交给状态机，并执行转换产生的动作，直到没有后续动作
+    void HandleConnectionEvent(ConnectionEventType eventType);
+    
+    // 执行状态机要求的动作，返回动作结果对应的事件；服务停止时返回false
+    bool RunConnectionAction(ConnectionAction action, ConnectionEventType& resultEvent);
+    
+    // 按状态机上下文中的到期时间设置或取消状态机定时器
+    void SyncStateTimer();
+    
+    // 把当前状态发布到共享状态页（只在工作线程中调用，停止服务时由Stop在工作线程退出后调用）
+    void PublishStatus(bool running);
     
     // 静态实例指针（用于回调）
     static WifiService* s_serviceInstance;
@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include <windows.h>
+#include <winhttp.h>
+#include <mutex>
+#include <string>
+#include "http_connection_pool.h"
+#include "http_transport.h"
+
+#pragma comment(lib, "winhttp.lib")
+
+// 使用WinHTTP的传输层（Windows上NetworkRequester使用）
+// 支持HTTPS和系统代理；连接句柄由HttpConnectionPool按主机复用并限制并发，底层长连接由WinHTTP会话管理
+// 会话以异步模式打开，发起请求的线程等待每个操作完成或被取消；请求句柄只由发起请求的线程关闭
+class WinHttpTransport : public HttpTransport {
+public:
+    WinHttpTransport();
+    ~WinHttpTransport() override;
+
+    WinHttpTransport(const WinHttpTransport&) = delete;
+    WinHttpTransport& operator=(const WinHttpTransport&) = delete;
+
+    // 打开WinHTTP会话（Send在会话未打开时也会自动打开）
+    bool Initialize();
+
+    bool Send(const HttpRequest& request, HttpResponse& response, HttpCancel* cancel) override;
+
+    void SetLimits(uint32_t maxPerHost, uint64_t idleTimeoutMs) override;
+
+    void ReleaseIdleConnections() override;
+
+    // 解析URL，路径包含查询参数
+    static bool ParseUrl(
+        const std::wstring& url,
+        std::wstring& hostName,
+        std::wstring& urlPath,
+        INTERNET_SCHEME& scheme,
+        INTERNET_PORT& port
+    );
+
+private:
+    // 关闭连接句柄和会话
+    void Cleanup();
+
+    // 保护会话的打开和关闭
+    std::mutex m_sessionMutex;
+
+    // HTTP会话句柄
+    HINTERNET m_hSession;
+
+    // 连接句柄池（复用连接句柄并限制每个主机的并发请求数）
+    HttpConnectionPool m_connectionPool;
+};
@@ -0,0 +1,170 @@
+﻿#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <iphlpapi.h>
+#include "../include/address_monitor.h"
+#include <iostream>
+#include <cstring>
+
+#pragma comment(lib, "iphlpapi.lib")
+
+// 地址族对应的AF_*常量
+static ADDRESS_FAMILY ToAddressFamily(AddressFamily family) {
+    switch (family) {
+    case AddressFamily::IPv4:
+        return AF_INET;
+    case AddressFamily::IPv6:
+        return AF_INET6;
+    default:
+        return AF_UNSPEC;
+    }
+}
+
+// 判断地址是否可用于访问校园网：属于指定的地址族，重复地址检测已通过，且不是链路本地地址
+static bool IsUsableAddress(const MIB_UNICASTIPADDRESS_ROW& row, AddressFamily family) {
+    if (row.DadState != IpDadStatePreferred) {
+        return false;
+    }
+
+    if (row.Address.si_family == AF_INET && family != AddressFamily::IPv6) {
+        // 排除0.0.0.0和DHCP失败时自动分配的169.254.0.0/16
+        const UCHAR* bytes = reinterpret_cast<const UCHAR*>(&row.Address.Ipv4.sin_addr);
+        if (bytes[0] == 0 || (bytes[0] == 169 && bytes[1] == 254)) {
+            return false;
+        }
+        return true;
+    }
+
+    if (row.Address.si_family == AF_INET6 && family != AddressFamily::IPv4) {
+        // 排除fe80::/10链路本地地址和::1
+        const UCHAR* bytes = reinterpret_cast<const UCHAR*>(&row.Address.Ipv6.sin6_addr);
+        if (bytes[0] == 0xFE && (bytes[1] & 0xC0) == 0x80) {
+            return false;
+        }
+        bool loopback = (bytes[15] == 1);
+        for (int i = 0; i < 15 && loopback; i++) {
+            loopback = (bytes[i] == 0);
+        }
+        return !loopback;
+    }
+
+    return false;
+}
+
+// 地址变化通知的回调（在系统线程池线程中执行）
+struct AddressChangeCallback {
+    static VOID NETIOAPI_API_ Invoke(PVOID callerContext, PMIB_UNICASTIPADDRESS_ROW row, MIB_NOTIFICATION_TYPE notificationType) {
+        AddressMonitor* monitor = static_cast<AddressMonitor*>(callerContext);
+        if (monitor == nullptr || row == NULL) {
+            return;
+        }
+
+        if (notificationType != MibAddInstance && notificationType != MibParameterNotification) {
+            return;
+        }
+
+        if (row->InterfaceLuid.Value != monitor->m_interfaceLuid.load()) {
+            return;
+        }
+
+        // 通知中的地址状态可能不完整，重新查询完整的地址信息
+        MIB_UNICASTIPADDRESS_ROW entry = *row;
+        if (GetUnicastIpAddressEntry(&entry) != NO_ERROR) {
+            return;
+        }
+
+        if (IsUsableAddress(entry, monitor->m_family)) {
+            SetEvent(monitor->m_hEvent);
+        }
+    }
+};
+
+AddressMonitor::AddressMonitor() :
+    m_hNotification(NULL),
+    m_interfaceLuid(0),
+    m_family(AddressFamily::IPv4) {
+    m_hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+AddressMonitor::~AddressMonitor() {
+    Stop();
+
+    if (m_hEvent != NULL) {
+        CloseHandle(m_hEvent);
+        m_hEvent = NULL;
+    }
+}
+
+bool AddressMonitor::Start(const GUID& interfaceGuid, AddressFamily family) {
+    Stop();
+
+    NET_LUID luid;
+    NETIO_STATUS status = ConvertInterfaceGuidToLuid(&interfaceGuid, &luid);
+    if (status != NO_ERROR) {
+        std::wcerr << L"ConvertInterfaceGuidToLuid失败，错误码: " << status << std::endl;
+        return false;
+    }
+    m_interfaceLuid = luid.Value;
+    m_family = family;
+
+    // 只订阅需要的地址族，IPv4模式下不会被IPv6地址的变化唤醒
+    status = NotifyUnicastIpAddressChange(
+        ToAddressFamily(family),
+        AddressChangeCallback::Invoke,
+        this,
+        FALSE,
+        &m_hNotification
+    );
+
+    if (status != NO_ERROR) {
+        std::wcerr << L"NotifyUnicastIpAddressChange失败，错误码: " << status << std::endl;
+        m_hNotification = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void AddressMonitor::Stop() {
+    if (m_hNotification != NULL) {
+        // 注销通知，并等待正在执行的回调结束
+        CancelMibChangeNotify2(m_hNotification);
+        m_hNotification = NULL;
+    }
+}
+
+bool AddressMonitor::HasUsableAddress() const {
+    InterfaceAddress address;
+    return GetUsableAddress(address);
+}
+
+bool AddressMonitor::GetUsableAddress(InterfaceAddress& address) const {
+    PMIB_UNICASTIPADDRESS_TABLE pTable = NULL;
+    if (GetUnicastIpAddressTable(ToAddressFamily(m_family), &pTable) != NO_ERROR) {
+        return false;
+    }
+
+    // 校园网认证使用IPv4地址，两种地址都算作可用且同时存在时返回IPv4地址
+    bool found = false;
+    ULONG64 luid = m_interfaceLuid.load();
+    for (ULONG i = 0; i < pTable->NumEntries; i++) {
+        const MIB_UNICASTIPADDRESS_ROW& row = pTable->Table[i];
+        if (row.InterfaceLuid.Value != luid || !IsUsableAddress(row, m_family)) {
+            continue;
+        }
+        if (row.Address.si_family == AF_INET) {
+            address.ipv6 = false;
+            memset(address.bytes, 0, sizeof(address.bytes));
+            memcpy(address.bytes, &row.Address.Ipv4.sin_addr, 4);
+            found = true;
+            break;
+        }
+        if (!found) {
+            address.ipv6 = true;
+            memcpy(address.bytes, &row.Address.Ipv6.sin6_addr, 16);
+            found = true;
+        }
+    }
+
+    FreeMibTable(pTable);
+    return found;
+}
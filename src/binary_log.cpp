@@ -0,0 +1,391 @@
+﻿#include "../include/binary_log.h"
+#include "../include/connection_state_machine.h"
+#include <chrono>
+#include <cstring>
+#include <cwchar>
+#include <ctime>
+#include <iomanip>
+#include <string>
+
+namespace {
+
+// 文件头：8字节魔数 + 记录大小 + 保留字段
+const char kFileMagic[8] = { 'W', 'F', 'B', 'L', 'O', 'G', '0', '1' };
+
+struct FileHeader {
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t reserved;
+};
+
+// 后台线程写出记录的间隔（毫秒）
+const int kFlushIntervalMs = 100;
+
+// 事件的文字格式：{n}为第n个参数（十进制），{n:x}为十六进制，
+// {n:state}、{n:event}、{n:probe}、{n:login}、{n:http}为对应枚举的名称
+struct EventFormat {
+    LogEvent event;
+    const wchar_t* format;
+};
+
+const EventFormat kEventFormats[] = {
+    { LogEvent::LogDropped,         L"日志缓冲区已满，丢弃了{0}条记录" },
+    { LogEvent::ServiceStarted,     L"服务已启动" },
+    { LogEvent::ServiceStopped,     L"服务已停止，耗时{0}毫秒" },
+    { LogEvent::StateChanged,       L"连接状态: {0:state} -> {1:state}（{2:event}）" },
+    { LogEvent::ScanCompleted,      L"扫描完成，耗时{0}毫秒" },
+    { LogEvent::WifiConnected,      L"WiFi连接成功，关联耗时{0}毫秒" },
+    { LogEvent::WifiConnectFailed,  L"WiFi连接失败，原因码: {0}" },
+    { LogEvent::WifiDisconnected,   L"WiFi连接断开，原因码: {0}" },
+    { LogEvent::AddressReady,       L"已获取IP地址，耗时{0}毫秒" },
+    { LogEvent::ProbeResult,        L"网络探测: {0:probe}，状态码{1}，耗时{2}毫秒" },
+    { LogEvent::LoginResult,        L"校园网登录: {0:login}，耗时{1}毫秒" },
+    { LogEvent::ServiceResume,      L"收到恢复通知，控制码{0:x}，事件类型{1:x}" },
+    { LogEvent::WorkerException,    L"工作线程异常" },
+    { LogEvent::HttpFailed,         L"HTTP请求失败: {0:http}，错误码{1}" },
+};
+
+// 与ConnectivityProber::Status的顺序一致
+const wchar_t* const kProbeNames[] = { L"在线", L"需要认证", L"离线" };
+
+// 与NetworkRequester::LoginResult的顺序一致
+const wchar_t* const kLoginNames[] = {
+    L"登录成功", L"已经在线", L"账号或密码错误", L"账号在线数量超限", L"认证服务器错误", L"无法连接认证服务器"
+};
+
+// 与HttpStage（http_transport.h）的顺序一致
+const wchar_t* const kHttpStageNames[] = {
+    L"解析地址", L"建立连接", L"创建请求", L"发送请求", L"接收响应", L"读取响应体"
+};
+
+const wchar_t* FindFormat(uint16_t event) {
+    for (const EventFormat& entry : kEventFormats) {
+        if (static_cast<uint16_t>(entry.event) == event) {
+            return entry.format;
+        }
+    }
+    return nullptr;
+}
+
+const wchar_t* LevelToString(uint8_t level) {
+    switch (static_cast<LogLevel>(level)) {
+    case LogLevel::Warning:
+        return L"WARN";
+    case LogLevel::Error:
+        return L"ERROR";
+    default:
+        return L"INFO";
+    }
+}
+
+// 按格式说明输出一个参数
+void FormatArg(std::wostream& out, uint64_t value, const std::wstring& spec) {
+    if (spec == L"x") {
+        out << L"0x" << std::hex << value << std::dec;
+    } else if (spec == L"state") {
+        out << ConnectionStateMachine::StateToString(static_cast<ConnectionState>(value));
+    } else if (spec == L"event") {
+        out << ConnectionStateMachine::EventToString(static_cast<ConnectionEventType>(value));
+    } else if (spec == L"probe" && value < sizeof(kProbeNames) / sizeof(kProbeNames[0])) {
+        out << kProbeNames[value];
+    } else if (spec == L"login" && value < sizeof(kLoginNames) / sizeof(kLoginNames[0])) {
+        out << kLoginNames[value];
+    } else if (spec == L"http" && value < sizeof(kHttpStageNames) / sizeof(kHttpStageNames[0])) {
+        out << kHttpStageNames[value];
+    } else {
+        out << value;
+    }
+}
+
+// 写日志线程的序号
+uint32_t CurrentThreadNumber() {
+    static std::atomic<uint32_t> nextNumber(1);
+    thread_local uint32_t number = nextNumber.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+} // namespace
+
+BinaryLog& BinaryLog::Instance() {
+    static BinaryLog instance;
+    return instance;
+}
+
+BinaryLog::BinaryLog() :
+    m_cells(new Cell[kCapacity]),
+    m_writePos(0),
+    m_readPos(0),
+    m_dropped(0),
+    m_reportedDropped(0),
+    m_running(false),
+    m_recentNext(0),
+    m_recentSize(0),
+    m_stopRequested(false),
+    m_fileBytes(0),
+    m_maxFileBytes(0),
+    m_maxFiles(1) {
+    
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+    static_assert(sizeof(LogRecord) == 64, "log record must stay 64 bytes");
+    
+    for (size_t i = 0; i < kCapacity; i++) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+BinaryLog::~BinaryLog() {
+    Stop();
+}
+
+bool BinaryLog::Start(const std::filesystem::path& path, uint64_t maxFileBytes, int maxFiles) {
+    Stop();
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_maxFileBytes = maxFileBytes;
+    m_maxFiles = maxFiles < 1 ? 1 : maxFiles;
+    
+    if (!OpenFile()) {
+        return false;
+    }
+    
+    m_stopRequested = false;
+    m_running.store(true, std::memory_order_release);
+    m_flusher = std::thread(&BinaryLog::FlushLoop, this);
+    return true;
+}
+
+void BinaryLog::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_flusher.joinable()) {
+            return;
+        }
+        m_running.store(false, std::memory_order_release);
+        m_stopRequested = true;
+    }
+    m_wake.notify_one();
+    m_flusher.join();
+    
+    // 后台线程已退出，写出最后一批记录
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Drain();
+    m_file.close();
+}
+
+void BinaryLog::Write(LogLevel level, LogEvent event, const uint64_t* args, size_t argCount) {
+    uint64_t pos = m_writePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+        cell = &m_cells[pos & (kCapacity - 1)];
+        uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            // 槽可写，抢占该位置
+            if (m_writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 缓冲区已满，丢弃记录而不是等待
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = m_writePos.load(std::memory_order_relaxed);
+        }
+    }
+    
+    LogRecord& record = cell->record;
+    record.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    record.event = static_cast<uint16_t>(event);
+    record.level = static_cast<uint8_t>(level);
+    record.argCount = static_cast<uint8_t>(argCount);
+    record.threadId = CurrentThreadNumber();
+    for (size_t i = 0; i < kMaxArgs; i++) {
+        record.args[i] = i < argCount ? args[i] : 0;
+    }
+    
+    cell->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool BinaryLog::Read(LogRecord& record) {
+    Cell& cell = m_cells[m_readPos & (kCapacity - 1)];
+    if (cell.sequence.load(std::memory_order_acquire) != m_readPos + 1) {
+        return false;
+    }
+    
+    record = cell.record;
+    cell.sequence.store(m_readPos + kCapacity, std::memory_order_release);
+    m_readPos++;
+    return true;
+}
+
+void BinaryLog::FlushLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopRequested) {
+        m_wake.wait_for(lock, std::chrono::milliseconds(kFlushIntervalMs));
+        Drain();
+    }
+}
+
+void BinaryLog::Drain() {
+    if (!m_file.is_open()) {
+        return;
+    }
+    
+    LogRecord record;
+    bool wrote = false;
+    while (Read(record)) {
+        m_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        m_fileBytes += sizeof(record);
+        wrote = true;
+        
+        {
+            std::lock_guard<std::mutex> lock(m_recentMutex);
+            m_recent[m_recentNext] = record;
+            m_recentNext = (m_recentNext + 1) % kRecentCount;
+            if (m_recentSize < kRecentCount) {
+                m_recentSize++;
+            }
+        }
+        
+        if (m_fileBytes >= m_maxFileBytes) {
+            Rotate();
+            if (!m_file.is_open()) {
+                return;
+            }
+        }
+    }
+    
+    // 把丢弃的记录数作为一条日志写入，方便解码时发现缺失
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_reportedDropped) {
+        LogRecord note = {};
+        note.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        note.event = static_cast<uint16_t>(LogEvent::LogDropped);
+        note.level = static_cast<uint8_t>(LogLevel::Warning);
+        note.argCount = 1;
+        note.args[0] = dropped - m_reportedDropped;
+        m_file.write(reinterpret_cast<const char*>(&note), sizeof(note));
+        m_fileBytes += sizeof(note);
+        m_reportedDropped = dropped;
+        wrote = true;
+    }
+    
+    if (wrote) {
+        m_file.flush();
+    }
+}
+
+std::vector<LogRecord> BinaryLog::RecentRecords(size_t maxCount) const {
+    std::lock_guard<std::mutex> lock(m_recentMutex);
+    
+    size_t count = maxCount < m_recentSize ? maxCount : m_recentSize;
+    std::vector<LogRecord> records;
+    records.reserve(count);
+    for (size_t i = count; i > 0; i--) {
+        records.push_back(m_recent[(m_recentNext + kRecentCount - i) % kRecentCount]);
+    }
+    return records;
+}
+
+bool BinaryLog::OpenFile() {
+    m_file.open(m_path, std::ios::binary | std::ios::out | std::ios::app);
+    if (!m_file.is_open()) {
+        return false;
+    }
+    
+    // 追加到已有文件时不重复写文件头
+    std::error_code error;
+    uint64_t existing = std::filesystem::file_size(m_path, error);
+    m_fileBytes = error ? 0 : existing;
+    if (m_fileBytes == 0) {
+        FileHeader header = {};
+        memcpy(header.magic, kFileMagic, sizeof(header.magic));
+        header.recordSize = sizeof(LogRecord);
+        m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_fileBytes = sizeof(header);
+    }
+    return true;
+}
+
+void BinaryLog::Rotate() {
+    m_file.close();
+    
+    std::error_code error;
+    for (int i = m_maxFiles - 1; i >= 1; i--) {
+        std::filesystem::path from = m_path;
+        if (i > 1) {
+            from += L"." + std::to_wstring(i - 1);
+        }
+        std::filesystem::path to = m_path;
+        to += L"." + std::to_wstring(i);
+        std::filesystem::remove(to, error);
+        std::filesystem::rename(from, to, error);
+    }
+    if (m_maxFiles == 1) {
+        std::filesystem::remove(m_path, error);
+    }
+    
+    OpenFile();
+}
+
+bool BinaryLog::Decode(const std::filesystem::path& path, std::wostream& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 ||
+        header.recordSize != sizeof(LogRecord)) {
+        return false;
+    }
+    
+    LogRecord record;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        FormatRecord(record, out);
+        out << L"\n";
+    }
+    return true;
+}
+
+void BinaryLog::FormatRecord(const LogRecord& record, std::wostream& out) {
+    // 时间戳转换为本地时间
+    std::time_t seconds = static_cast<std::time_t>(record.timestamp / 1000000);
+    std::tm local = *std::localtime(&seconds);
+    wchar_t fill = out.fill(L'0');
+    out << std::setw(4) << (local.tm_year + 1900) << L"-" << std::setw(2) << (local.tm_mon + 1) << L"-"
+        << std::setw(2) << local.tm_mday << L" " << std::setw(2) << local.tm_hour << L":"
+        << std::setw(2) << local.tm_min << L":" << std::setw(2) << local.tm_sec << L"."
+        << std::setw(6) << (record.timestamp % 1000000);
+    out.fill(fill);
+    
+    out << L" [" << LevelToString(record.level) << L"] #" << record.threadId << L" ";
+    
+    const wchar_t* format = FindFormat(record.event);
+    if (format == nullptr) {
+        out << L"未知事件" << record.event;
+        for (size_t i = 0; i < record.argCount && i < kMaxArgs; i++) {
+            out << L" " << record.args[i];
+        }
+        return;
+    }
+    
+    // 替换格式中的{n}和{n:spec}
+    for (const wchar_t* p = format; *p != L'\0'; p++) {
+        if (*p == L'{' && p[1] >= L'0' && p[1] < L'0' + static_cast<int>(kMaxArgs)) {
+            const wchar_t* end = wcschr(p, L'}');
+            if (end != nullptr) {
+                size_t index = static_cast<size_t>(p[1] - L'0');
+                std::wstring spec = (p[2] == L':') ? std::wstring(p + 3, end) : std::wstring();
+                FormatArg(out, record.args[index], spec);
+                p = end;
+                continue;
+            }
+        }
+        out << *p;
+    }
+}
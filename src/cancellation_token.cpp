@@ -0,0 +1,79 @@
+﻿#include "../include/cancellation_token.h"
+#include <algorithm>
+
+CancellationToken::Registration::Registration(CancellationToken* token, std::function<void()> callback) :
+    m_token(token),
+    m_id(0) {
+    if (m_token != NULL) {
+        m_id = m_token->Register(std::move(callback));
+    }
+}
+
+CancellationToken::Registration::~Registration() {
+    if (m_token != NULL && m_id != 0) {
+        m_token->Unregister(m_id);
+    }
+}
+
+CancellationToken::CancellationToken() :
+    m_cancelled(false),
+    m_nextId(1) {
+    m_hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+}
+
+CancellationToken::~CancellationToken() {
+    if (m_hEvent != NULL) {
+        CloseHandle(m_hEvent);
+        m_hEvent = NULL;
+    }
+}
+
+void CancellationToken::Cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_cancelled.exchange(true)) {
+        return;
+    }
+
+    SetEvent(m_hEvent);
+
+    // 在持有锁的情况下执行回调，使注销方在回调结束前不会返回
+    for (auto& entry : m_callbacks) {
+        entry.second();
+    }
+    m_callbacks.clear();
+}
+
+void CancellationToken::Reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cancelled = false;
+    ResetEvent(m_hEvent);
+}
+
+bool CancellationToken::WaitForCancellation(DWORD timeoutMs) const {
+    return WaitForSingleObject(m_hEvent, timeoutMs) == WAIT_OBJECT_0;
+}
+
+size_t CancellationToken::Register(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_cancelled) {
+        callback();
+        return 0;
+    }
+
+    size_t id = m_nextId++;
+    m_callbacks.emplace_back(id, std::move(callback));
+    return id;
+}
+
+void CancellationToken::Unregister(size_t id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = std::find_if(m_callbacks.begin(), m_callbacks.end(), [id](const std::pair<size_t, std::function<void()>>& entry) {
+        return entry.first == id;
+    });
+    if (it != m_callbacks.end()) {
+        m_callbacks.erase(it);
+    }
+}
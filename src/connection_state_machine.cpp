@@ -0,0 +1,327 @@
+﻿#include "../include/connection_state_machine.h"
+
+ConnectionTransition ConnectionStateMachine::Step(
+    const ConnectionContext& context,
+    const ConnectionEvent& event,
+    const ConnectionPolicy& policy) {
+    ConnectionTransition transition = { context, ConnectionAction::None };
+    ConnectionContext& next = transition.context;
+    uint64_t now = event.now;
+
+    // 切换状态并重新设置定时器（timeoutMs为0表示不设置定时器）
+    auto enter = [&next, now](ConnectionState state, uint64_t timeoutMs) {
+        if (next.state != state) {
+            next.state = state;
+            next.stateSince = now;
+        }
+        next.deadline = timeoutMs > 0 ? now + timeoutMs : 0;
+    };
+
+    // 网络异常时的探测间隔：10秒、20秒、30秒……最多等于定期探测间隔
+    auto degradedDelay = [&policy](uint32_t failures) {
+        uint64_t delay = policy.degradedRetryMs * failures;
+        return delay < policy.healthCheckIntervalMs ? delay : policy.healthCheckIntervalMs;
+    };
+
+    switch (event.type) {
+    case ConnectionEventType::LinkDown:
+        // 正在重连或等待重连时忽略，避免绕过连接失败的退避时间
+        if (!IsLinkUp(context.state) &&
+            !(context.state == ConnectionState::Disconnected && context.deadline == 0)) {
+            break;
+        }
+        next.probeFailures = 0;
+        enter(ConnectionState::Scanning, policy.scanTimeoutMs);
+        transition.action = ConnectionAction::Scan;
+        break;
+
+    case ConnectionEventType::LinkUp:
+        if (IsLinkUp(context.state)) {
+            break;
+        }
+        next.connectFailures = 0;
+        enter(ConnectionState::AwaitingAddress, policy.addressWaitMs);
+        break;
+
+    case ConnectionEventType::ScanDone:
+        if (context.state != ConnectionState::Scanning) {
+            break;
+        }
+        enter(ConnectionState::Associating, policy.connectTimeoutMs);
+        transition.action = ConnectionAction::Connect;
+        break;
+
+    case ConnectionEventType::ConnectFailed: {
+        if (context.state != ConnectionState::Associating) {
+            break;
+        }
+        // 连接失败后的等待时间：5秒、10秒、15秒……最多60秒
+        next.connectFailures++;
+        uint64_t delay = policy.connectBackoffStepMs * next.connectFailures;
+        enter(ConnectionState::Disconnected, delay < policy.connectBackoffMaxMs ? delay : policy.connectBackoffMaxMs);
+        break;
+    }
+
+    case ConnectionEventType::AddressReady:
+        if (context.state != ConnectionState::AwaitingAddress) {
+            break;
+        }
+        next.deadline = 0;
+        transition.action = ConnectionAction::Probe;
+        break;
+
+    case ConnectionEventType::ProbeOnline:
+        if (!IsLinkUp(context.state)) {
+            break;
+        }
+        next.probeFailures = 0;
+        enter(ConnectionState::Online, policy.healthCheckIntervalMs);
+        break;
+
+    case ConnectionEventType::ProbePortal:
+        if (!IsLinkUp(context.state)) {
+            break;
+        }
+        next.probeFailures = 0;
+        EnterPortalRequired(transition, now, policy);
+        break;
+
+    case ConnectionEventType::ProbeOffline:
+        if (!IsLinkUp(context.state)) {
+            break;
+        }
+        next.probeFailures++;
+        enter(ConnectionState::Degraded, degradedDelay(next.probeFailures));
+        break;
+
+    case ConnectionEventType::LoginSucceeded:
+        if (context.state != ConnectionState::LoggingIn) {
+            break;
+        }
+        next.loginFailures = 0;
+        next.loginNotBefore = now + policy.loginHoldMs;
+        enter(ConnectionState::Online, policy.healthCheckIntervalMs);
+        break;
+
+    case ConnectionEventType::LoginRejected:
+        if (context.state != ConnectionState::LoggingIn) {
+            break;
+        }
+        // 账号被占用通常需要等待其他设备下线，固定等待
+        next.loginFailures++;
+        next.loginNotBefore = now + policy.accountLimitDelayMs;
+        EnterPortalRequired(transition, now, policy);
+        break;
+
+    case ConnectionEventType::LoginFailed: {
+        if (context.state != ConnectionState::LoggingIn) {
+            break;
+        }
+        // 临时错误按指数退避重试：10秒、20秒、40秒……
+        next.loginFailures++;
+        uint32_t shift = next.loginFailures - 1 < 6 ? next.loginFailures - 1 : 6;
+        uint64_t delay = policy.loginBackoffBaseMs << shift;
+        next.loginNotBefore = now + (delay < policy.loginBackoffMaxMs ? delay : policy.loginBackoffMaxMs);
+        EnterPortalRequired(transition, now, policy);
+        break;
+    }
+
+    case ConnectionEventType::LoginBlocked:
+        if (context.state != ConnectionState::LoggingIn) {
+            break;
+        }
+        next.loginBlocked = true;
+        EnterPortalRequired(transition, now, policy);
+        break;
+
+    case ConnectionEventType::Resume:
+    case ConnectionEventType::ReconnectRequested:
+        // 睡眠前的退避状态已经没有意义，直接用上次成功的网络重新连接，然后重新探测和登录
+        next.connectFailures = 0;
+        next.probeFailures = 0;
+        if (!next.loginBlocked) {
+            next.loginFailures = 0;
+            next.loginNotBefore = 0;
+        }
+        enter(ConnectionState::Associating, policy.connectTimeoutMs);
+        transition.action = ConnectionAction::Connect;
+        break;
+
+    case ConnectionEventType::SessionChanged:
+        // 用户会话变化不代表网络变化：已连接时只提前探测，由探测结果决定是否需要登录；
+        // 等待重连时立即扫描，不清除退避计数；正在扫描、连接、等待地址或登录时忽略
+        if (context.state == ConnectionState::Disconnected) {
+            enter(ConnectionState::Scanning, policy.scanTimeoutMs);
+            transition.action = ConnectionAction::Scan;
+            break;
+        }
+        if (!IsLinkUp(context.state) ||
+            context.state == ConnectionState::AwaitingAddress ||
+            context.state == ConnectionState::LoggingIn) {
+            break;
+        }
+        next.deadline = 0;
+        transition.action = ConnectionAction::Probe;
+        break;
+
+    case ConnectionEventType::LoginRequested:
+        // 用户明确要求时不再等待退避时间，账号密码错误也再试一次；
+        // WiFi未连接、还没有地址或正在登录时忽略
+        if (!IsLinkUp(context.state) ||
+            context.state == ConnectionState::AwaitingAddress ||
+            context.state == ConnectionState::LoggingIn ||
+            !context.hasCredentials) {
+            break;
+        }
+        next.loginFailures = 0;
+        next.loginNotBefore = 0;
+        next.loginBlocked = false;
+        enter(ConnectionState::LoggingIn, 0);
+        transition.action = ConnectionAction::Login;
+        break;
+
+    case ConnectionEventType::TimerExpired:
+        // 忽略已被取消或尚未到期的定时器
+        if (context.deadline == 0 || now < context.deadline) {
+            break;
+        }
+        next.deadline = 0;
+
+        switch (context.state) {
+        case ConnectionState::Disconnected:
+            enter(ConnectionState::Scanning, policy.scanTimeoutMs);
+            transition.action = ConnectionAction::Scan;
+            break;
+
+        case ConnectionState::Scanning:
+            // 扫描超时不影响连接，直接使用已有的扫描结果
+            enter(ConnectionState::Associating, policy.connectTimeoutMs);
+            transition.action = ConnectionAction::Connect;
+            break;
+
+        case ConnectionState::Associating: {
+            next.connectFailures++;
+            uint64_t delay = policy.connectBackoffStepMs * next.connectFailures;
+            enter(ConnectionState::Disconnected, delay < policy.connectBackoffMaxMs ? delay : policy.connectBackoffMaxMs);
+            break;
+        }
+
+        case ConnectionState::PortalRequired:
+            // 到了允许登录的时间就登录，否则重新探测（可能已在其他设备上完成认证）
+            if (next.hasCredentials && !next.loginBlocked && now >= next.loginNotBefore) {
+                enter(ConnectionState::LoggingIn, 0);
+                transition.action = ConnectionAction::Login;
+            } else {
+                transition.action = ConnectionAction::Probe;
+            }
+            break;
+
+        default:
+            transition.action = ConnectionAction::Probe;
+            break;
+        }
+        break;
+    }
+
+    return transition;
+}
+
+void ConnectionStateMachine::EnterPortalRequired(
+    ConnectionTransition& transition,
+    uint64_t now,
+    const ConnectionPolicy& policy) {
+    ConnectionContext& next = transition.context;
+
+    if (next.hasCredentials && !next.loginBlocked && now >= next.loginNotBefore) {
+        if (next.state != ConnectionState::LoggingIn) {
+            next.state = ConnectionState::LoggingIn;
+            next.stateSince = now;
+        }
+        next.deadline = 0;
+        transition.action = ConnectionAction::Login;
+        return;
+    }
+
+    if (next.state != ConnectionState::PortalRequired) {
+        next.state = ConnectionState::PortalRequired;
+        next.stateSince = now;
+    }
+
+    // 没有账号或已停止登录时只定期重新探测，否则等到允许登录的时间
+    if (!next.hasCredentials || next.loginBlocked) {
+        next.deadline = now + policy.healthCheckIntervalMs;
+    } else {
+        next.deadline = next.loginNotBefore;
+    }
+    transition.action = ConnectionAction::None;
+}
+
+bool ConnectionStateMachine::IsLinkUp(ConnectionState state) {
+    return state != ConnectionState::Disconnected &&
+           state != ConnectionState::Scanning &&
+           state != ConnectionState::Associating;
+}
+
+const wchar_t* ConnectionStateMachine::StateToString(ConnectionState state) {
+    switch (state) {
+    case ConnectionState::Disconnected:
+        return L"未连接";
+    case ConnectionState::Scanning:
+        return L"扫描中";
+    case ConnectionState::Associating:
+        return L"连接WiFi中";
+    case ConnectionState::AwaitingAddress:
+        return L"等待IP地址";
+    case ConnectionState::PortalRequired:
+        return L"需要认证";
+    case ConnectionState::LoggingIn:
+        return L"登录中";
+    case ConnectionState::Online:
+        return L"在线";
+    case ConnectionState::Degraded:
+        return L"网络异常";
+    default:
+        return L"未知状态";
+    }
+}
+
+const wchar_t* ConnectionStateMachine::EventToString(ConnectionEventType type) {
+    switch (type) {
+    case ConnectionEventType::LinkUp:
+        return L"WiFi已连接";
+    case ConnectionEventType::LinkDown:
+        return L"WiFi未连接";
+    case ConnectionEventType::ScanDone:
+        return L"扫描结束";
+    case ConnectionEventType::ConnectFailed:
+        return L"WiFi连接失败";
+    case ConnectionEventType::AddressReady:
+        return L"已获取IP地址";
+    case ConnectionEventType::ProbeOnline:
+        return L"网络正常";
+    case ConnectionEventType::ProbePortal:
+        return L"需要认证";
+    case ConnectionEventType::ProbeOffline:
+        return L"无法访问网络";
+    case ConnectionEventType::LoginSucceeded:
+        return L"登录成功";
+    case ConnectionEventType::LoginRejected:
+        return L"账号被占用";
+    case ConnectionEventType::LoginFailed:
+        return L"登录失败";
+    case ConnectionEventType::LoginBlocked:
+        return L"账号或密码错误";
+    case ConnectionEventType::TimerExpired:
+        return L"定时器到期";
+    case ConnectionEventType::Resume:
+        return L"系统恢复";
+    case ConnectionEventType::ReconnectRequested:
+        return L"要求重新连接";
+    case ConnectionEventType::LoginRequested:
+        return L"要求重新登录";
+    case ConnectionEventType::SessionChanged:
+        return L"用户会话变化";
+    default:
+        return L"未知事件";
+    }
+}
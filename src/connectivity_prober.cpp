@@ -0,0 +1,185 @@
+﻿#include "../include/connectivity_prober.h"
+#include "../include/metrics.h"
+#include "../include/trace.h"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+uint64_t ElapsedMs(Clock::time_point start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+} // namespace
+
+ConnectivityProber::ConnectivityProber(HttpTransport& transport) :
+    m_transport(transport),
+    m_deadlineMs(10000) {
+}
+
+void ConnectivityProber::SetTargets(const std::vector<Target>& targets) {
+    m_targets = targets;
+}
+
+void ConnectivityProber::SetPortalUrl(const std::string& portalUrl) {
+    m_portalUrl = portalUrl;
+}
+
+void ConnectivityProber::SetDeadline(uint32_t deadlineMs) {
+    m_deadlineMs = deadlineMs;
+}
+
+ConnectivityProber::Result ConnectivityProber::Probe(HttpCancel* stop) {
+    TraceSpan span("ProbeConnectivity");
+    
+    Result result;
+    
+    // 外网探测目标全部并发探测，校园网状态查询作为最后一个探测目标
+    const size_t targetCount = m_targets.size();
+    const size_t portalIndex = targetCount;
+    const size_t probeCount = m_portalUrl.empty() ? targetCount : targetCount + 1;
+    
+    // 探测竞速的共享状态
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+    size_t pending = probeCount;
+    bool decided = false;
+    bool portalReachable = false;
+    uint64_t portalElapsed = 0;
+    
+    std::vector<std::unique_ptr<HttpCancel>> cancels;
+    for (size_t i = 0; i < probeCount; i++) {
+        cancels.push_back(std::unique_ptr<HttpCancel>(new HttpCancel()));
+    }
+    
+    // 被中断时取消所有探测，探测线程随之结束；已中断时不再探测
+    if (stop != nullptr && !stop->SetInterrupter([&cancels]() {
+            for (auto& cancel : cancels) {
+                cancel->Cancel();
+            }
+        })) {
+        return result;
+    }
+    
+    Clock::time_point startTime = Clock::now();
+    
+    std::vector<std::thread> probes;
+    for (size_t i = 0; i < probeCount; i++) {
+        probes.emplace_back([&, i]() {
+            const std::string& url = (i == portalIndex) ? m_portalUrl : m_targets[i].url;
+            TraceSpan probeSpan("probe");
+            probeSpan.AddArg("target", (i == portalIndex) ? std::string("chkstatus") : url);
+            
+            HttpRequest request;
+            request.url = url;
+            request.timeoutMs = m_deadlineMs;
+            
+            HttpResponse response;
+            bool ok = false;
+            Status status = Status::Offline;
+            
+            try {
+                if (i == portalIndex) {
+                    // 校园网状态查询返回很小的JSONP，只需读取开头部分即可确认可达
+                    request.maxBodyBytes = 4096;
+                    ok = m_transport.Send(request, response, cancels[i].get()) && !response.body.empty();
+                } else {
+                    // 外网探测只读取状态码和响应头，不跟随重定向，不下载响应体
+                    request.method = m_targets[i].method;
+                    request.followRedirects = false;
+                    request.readBody = false;
+                    ok = m_transport.Send(request, response, cancels[i].get());
+                    status = ok ? Classify(m_targets[i], response) : Status::Offline;
+                }
+            } catch (...) {
+                // 忽略单个网站的访问异常
+                ok = false;
+            }
+            
+            uint64_t elapsed = ElapsedMs(startTime);
+            
+            // 按探测目标记录响应耗时，被取消或失败的探测不计入
+            if (ok) {
+                MetricsRegistry::Instance().Histogram(
+                    "wifi_probe_latency_ms", "Connectivity probe response time per target in milliseconds",
+                    "target=\"" + MetricsRegistry::EscapeLabelValue(url) + "\"").Record(elapsed);
+            }
+            
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (i == portalIndex) {
+                if (ok) {
+                    portalReachable = true;
+                    portalElapsed = elapsed;
+                }
+            } else if (ok && status != Status::Offline && !decided) {
+                // 第一个确定的结果（在线或被重定向到认证页面）胜出
+                decided = true;
+                result.status = status;
+                result.probeUrl = url;
+                result.statusCode = response.statusCode;
+                result.redirectLocation = response.location;
+                result.elapsedMs = elapsed;
+            }
+            pending--;
+            stateChanged.notify_all();
+        });
+    }
+    
+    // 等待确定的结果，或者全部探测结束，或者到达总截止时间
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        stateChanged.wait_for(lock, std::chrono::milliseconds(m_deadlineMs), [&]() {
+            return decided || pending == 0;
+        });
+    }
+    
+    // 取消仍在进行的探测并等待线程退出
+    for (auto& cancel : cancels) {
+        cancel->Cancel();
+    }
+    for (auto& probe : probes) {
+        probe.join();
+    }
+    if (stop != nullptr) {
+        stop->ClearInterrupter();
+    }
+    
+    std::lock_guard<std::mutex> lock(stateMutex);
+    span.AddArg("decided", (uint64_t)(decided ? 1 : 0));
+    if (!decided) {
+        if (portalReachable) {
+            // 外网不通但可以访问校园网登录页面，需要登录
+            result.status = Status::CaptivePortal;
+            result.probeUrl = m_portalUrl;
+            result.elapsedMs = portalElapsed;
+        } else {
+            result.elapsedMs = ElapsedMs(startTime);
+        }
+    }
+    
+    return result;
+}
+
+ConnectivityProber::Status ConnectivityProber::Classify(const Target& target, const HttpResponse& response) {
+    // 不要求特定状态码的目标（HTTPS站点）：只要收到响应就说明外网可达
+    if (target.expectedStatus == 0) {
+        return response.statusCode != 0 ? Status::Online : Status::Offline;
+    }
+    
+    if (response.statusCode == target.expectedStatus) {
+        return Status::Online;
+    }
+    
+    // 认证网关会把明文HTTP请求重定向到登录页面，或者直接返回登录页面
+    if ((response.statusCode >= 300 && response.statusCode < 400) ||
+        (response.statusCode >= 200 && response.statusCode < 300)) {
+        return Status::CaptivePortal;
+    }
+    
+    return Status::Offline;
+}
@@ -0,0 +1,250 @@
+﻿#include "../include/control_pipe.h"
+#include <iostream>
+
+ControlPipeServer::ControlPipeServer() : m_thread(NULL) {
+    m_stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+}
+
+ControlPipeServer::~ControlPipeServer() {
+    Stop();
+    
+    if (m_stopEvent != NULL) {
+        CloseHandle(m_stopEvent);
+        m_stopEvent = NULL;
+    }
+}
+
+bool ControlPipeServer::Start(const std::wstring& pipeName, Handler handler) {
+    Stop();
+    
+    if (m_stopEvent == NULL) {
+        return false;
+    }
+    
+    m_pipeName = pipeName;
+    m_handler = handler;
+    ResetEvent(m_stopEvent);
+    
+    m_thread = CreateThread(NULL, 0, ServerThread, this, 0, NULL);
+    if (m_thread == NULL) {
+        std::wcerr << L"创建控制通道线程失败，错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ControlPipeServer::Stop() {
+    if (m_thread == NULL) {
+        return;
+    }
+    
+    SetEvent(m_stopEvent);
+    WaitForSingleObject(m_thread, INFINITE);
+    CloseHandle(m_thread);
+    m_thread = NULL;
+}
+
+std::wstring ControlPipeServer::PipeNameForService(const std::wstring& serviceName) {
+    return L"\\\\.\\pipe\\" + serviceName;
+}
+
+DWORD WINAPI ControlPipeServer::ServerThread(LPVOID lpParam) {
+    static_cast<ControlPipeServer*>(lpParam)->Serve();
+    return 0;
+}
+
+void ControlPipeServer::Serve() {
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (overlapped.hEvent == NULL) {
+        std::wcerr << L"创建控制通道事件失败，错误码: " << GetLastError() << std::endl;
+        return;
+    }
+    
+    while (WaitForSingleObject(m_stopEvent, 0) != WAIT_OBJECT_0) {
+        // 每个客户端使用一个新的管道实例；FILE_FLAG_FIRST_PIPE_INSTANCE防止其他进程抢先创建同名管道
+        HANDLE hPipe = CreateNamedPipeW(
+            m_pipeName.c_str(),
+            PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            1,
+            64 * 1024,
+            kMaxRequestBytes,
+            0,
+            NULL
+        );
+        
+        if (hPipe == INVALID_HANDLE_VALUE) {
+            std::wcerr << L"创建控制通道失败，错误码: " << GetLastError() << std::endl;
+            WaitForSingleObject(m_stopEvent, 5000);
+            continue;
+        }
+        
+        // 等待客户端连接
+        ResetEvent(overlapped.hEvent);
+        bool connected = false;
+        if (ConnectNamedPipe(hPipe, &overlapped)) {
+            connected = true;
+        } else {
+            DWORD error = GetLastError();
+            DWORD bytes = 0;
+            if (error == ERROR_PIPE_CONNECTED) {
+                connected = true;
+            } else if (error == ERROR_IO_PENDING) {
+                connected = WaitIo(hPipe, overlapped, INFINITE, bytes);
+            }
+        }
+        
+        if (connected) {
+            ServeClient(hPipe, overlapped);
+        }
+        
+        DisconnectNamedPipe(hPipe);
+        CloseHandle(hPipe);
+    }
+    
+    CloseHandle(overlapped.hEvent);
+}
+
+void ControlPipeServer::ServeClient(HANDLE hPipe, OVERLAPPED& overlapped) {
+    // 读取一行请求
+    std::string request;
+    char buffer[512];
+    while (request.find('\n') == std::string::npos && request.size() < kMaxRequestBytes) {
+        DWORD bytes = 0;
+        ResetEvent(overlapped.hEvent);
+        if (!ReadFile(hPipe, buffer, sizeof(buffer), NULL, &overlapped) && GetLastError() != ERROR_IO_PENDING) {
+            return;
+        }
+        if (!WaitIo(hPipe, overlapped, kIoTimeoutMs, bytes) || bytes == 0) {
+            return;
+        }
+        request.append(buffer, bytes);
+    }
+    
+    size_t end = request.find_first_of("\r\n");
+    if (end != std::string::npos) {
+        request.resize(end);
+    }
+    
+    std::string body = m_handler ? m_handler(request) : std::string();
+    if (body.size() > kMaxResponseBytes) {
+        body.resize(kMaxResponseBytes);
+    }
+    
+    // 回复：4字节长度加正文
+    DWORD length = (DWORD)body.size();
+    std::string response;
+    response.reserve(sizeof(length) + body.size());
+    for (int i = 0; i < 4; i++) {
+        response += (char)((length >> (8 * i)) & 0xFF);
+    }
+    response += body;
+    
+    DWORD written = 0;
+    ResetEvent(overlapped.hEvent);
+    if (!WriteFile(hPipe, response.data(), (DWORD)response.size(), NULL, &overlapped) && GetLastError() != ERROR_IO_PENDING) {
+        return;
+    }
+    if (!WaitIo(hPipe, overlapped, kIoTimeoutMs, written)) {
+        return;
+    }
+    
+    // 断开连接会丢弃客户端未读取的数据，因此等客户端读完并关闭连接后再断开
+    DWORD bytes = 0;
+    ResetEvent(overlapped.hEvent);
+    if (ReadFile(hPipe, buffer, sizeof(buffer), NULL, &overlapped) || GetLastError() == ERROR_IO_PENDING) {
+        WaitIo(hPipe, overlapped, kIoTimeoutMs, bytes);
+    }
+}
+
+bool ControlPipeServer::WaitIo(HANDLE hPipe, OVERLAPPED& overlapped, DWORD timeoutMs, DWORD& bytes) {
+    HANDLE waitHandles[2] = { overlapped.hEvent, m_stopEvent };
+    DWORD waitResult = WaitForMultipleObjects(2, waitHandles, FALSE, timeoutMs);
+    
+    if (waitResult != WAIT_OBJECT_0) {
+        // 超时或服务停止：取消IO并等待取消完成，之后overlapped才能复用
+        CancelIoEx(hPipe, &overlapped);
+        GetOverlappedResult(hPipe, &overlapped, &bytes, TRUE);
+        return false;
+    }
+    
+    return GetOverlappedResult(hPipe, &overlapped, &bytes, FALSE) != FALSE;
+}
+
+bool ControlPipeServer::Query(const std::wstring& pipeName, const std::string& request, std::string& response, DWORD timeoutMs) {
+    response.clear();
+    
+    // 服务端正在处理其他客户端时等待管道空闲
+    HANDLE hPipe = INVALID_HANDLE_VALUE;
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    int notFoundRetries = 3;
+    while (true) {
+        hPipe = CreateFileW(pipeName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (hPipe != INVALID_HANDLE_VALUE) {
+            break;
+        }
+        
+        DWORD error = GetLastError();
+        ULONGLONG now = GetTickCount64();
+        
+        // 服务端处理完上一个客户端、创建下一个管道实例之前，管道会短暂不存在
+        if (error == ERROR_FILE_NOT_FOUND && notFoundRetries-- > 0 && now < deadline) {
+            Sleep(20);
+            continue;
+        }
+        if (error != ERROR_PIPE_BUSY || now >= deadline) {
+            if (error == ERROR_FILE_NOT_FOUND) {
+                std::wcerr << L"服务未运行或未开启控制通道" << std::endl;
+            } else if (error == ERROR_ACCESS_DENIED) {
+                std::wcerr << L"没有权限访问控制通道，请以管理员身份运行" << std::endl;
+            } else {
+                std::wcerr << L"连接控制通道失败，错误码: " << error << std::endl;
+            }
+            return false;
+        }
+        WaitNamedPipeW(pipeName.c_str(), (DWORD)(deadline - now));
+    }
+    
+    // 发送请求
+    std::string line = request + "\n";
+    DWORD written = 0;
+    if (!WriteFile(hPipe, line.data(), (DWORD)line.size(), &written, NULL)) {
+        std::wcerr << L"发送请求失败，错误码: " << GetLastError() << std::endl;
+        CloseHandle(hPipe);
+        return false;
+    }
+    
+    // 读取回复：先读4字节长度，再读正文
+    auto readExact = [hPipe](char* data, DWORD size) {
+        DWORD total = 0;
+        while (total < size) {
+            DWORD bytes = 0;
+            if (!ReadFile(hPipe, data + total, size - total, &bytes, NULL) || bytes == 0) {
+                return false;
+            }
+            total += bytes;
+        }
+        return true;
+    };
+    
+    unsigned char header[4];
+    bool ok = readExact((char*)header, sizeof(header));
+    if (ok) {
+        DWORD length = header[0] | (header[1] << 8) | (header[2] << 16) | ((DWORD)header[3] << 24);
+        if (length > kMaxResponseBytes) {
+            ok = false;
+        } else {
+            response.resize(length);
+            ok = (length == 0) || readExact(&response[0], length);
+        }
+    }
+    
+    if (!ok) {
+        std::wcerr << L"读取回复失败，错误码: " << GetLastError() << std::endl;
+        response.clear();
+    }
+    
+    CloseHandle(hPipe);
+    return ok;
+}
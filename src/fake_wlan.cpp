@@ -0,0 +1,525 @@
+﻿#include "../include/fake_wlan.h"
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+
+// 模拟API返回的内存用进程堆分配，与WlanFreeMemory/FreeMibTable配对，不计入operator new的统计
+namespace {
+
+void* AllocateApiMemory(size_t size) {
+    return HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, size);
+}
+
+void FreeApiMemory(void* memory) {
+    if (memory != NULL) {
+        HeapFree(GetProcessHeap(), 0, memory);
+    }
+}
+
+// 模拟的客户端句柄和通知句柄（只用于判断是否为空）
+HANDLE const kClientHandle = (HANDLE)(ULONG_PTR)0x5741;
+HANDLE const kAddressNotificationHandle = (HANDLE)(ULONG_PTR)0x4950;
+
+} // namespace
+
+const GUID FakeWlan::kInterfaceGuid = { 0x7a1d5e3c, 0x2b4f, 0x4c8a, { 0x9e, 0x61, 0x3d, 0x52, 0x8f, 0x10, 0xb7, 0x24 } };
+
+FakeWlan& FakeWlan::Instance() {
+    static FakeWlan instance;
+    return instance;
+}
+
+FakeWlan::FakeWlan() :
+    m_ssid(),
+    m_connected(false),
+    m_hasAddress(false),
+    m_stopping(false),
+    m_wlanCallback(NULL),
+    m_wlanContext(NULL),
+    m_addressCallback(NULL),
+    m_addressContext(NULL),
+    m_apiCalls(0) {
+    SetOptions(FakeWlanOptions());
+    m_pending.reserve(16);
+    m_driver = std::thread(&FakeWlan::DriverLoop, this);
+}
+
+FakeWlan::~FakeWlan() {
+    Shutdown();
+}
+
+void FakeWlan::SetOptions(const FakeWlanOptions& options) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_options = options;
+    
+    // SSID按UTF-8编码为原始字节
+    char bytes[DOT11_SSID_MAX_LENGTH * 2] = {};
+    int length = WideCharToMultiByte(CP_UTF8, 0, options.ssid.c_str(), (int)options.ssid.size(),
+                                     bytes, (int)sizeof(bytes), NULL, NULL);
+    m_ssid.uSSIDLength = (ULONG)std::min(length > 0 ? length : 0, (int)DOT11_SSID_MAX_LENGTH);
+    memcpy(m_ssid.ucSSID, bytes, m_ssid.uSSIDLength);
+}
+
+void FakeWlan::Reset(const FakeWlanOptions& options) {
+    SetOptions(options);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_connected = false;
+    m_hasAddress = false;
+    m_pending.clear();
+}
+
+void FakeWlan::SetConnected() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_connected = true;
+    m_hasAddress = true;
+}
+
+void FakeWlan::DropLink() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_connected) {
+        return;
+    }
+    m_connected = false;
+    m_hasAddress = false;
+    
+    // 断开后尚未完成的关联、DHCP和信号强度变化不再有效，扫描照常完成
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [](const PendingAction& pending) {
+        return pending.action != Action::ScanComplete && pending.action != Action::ScanFailed;
+    }), m_pending.end());
+    Schedule(Action::Disconnected, 0);
+}
+
+void FakeWlan::ChangeSignalQuality(ULONG signalQuality) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_options.signalQuality = signalQuality;
+    Schedule(Action::SignalChanged, 0, signalQuality);
+}
+
+bool FakeWlan::IsConnected() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_connected;
+}
+
+void FakeWlan::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeup.notify_all();
+    if (m_driver.joinable()) {
+        m_driver.join();
+    }
+}
+
+DWORD FakeWlan::OpenHandle(PHANDLE phClientHandle) {
+    *phClientHandle = kClientHandle;
+    return ERROR_SUCCESS;
+}
+
+void FakeWlan::CloseHandle() {
+    // 与真实的WlanCloseHandle一样注销通知，并等待正在执行的回调结束
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    m_wlanCallback = NULL;
+    m_wlanContext = NULL;
+}
+
+DWORD FakeWlan::EnumInterfaces(PWLAN_INTERFACE_INFO_LIST* ppInterfaceList) {
+    PWLAN_INTERFACE_INFO_LIST list = (PWLAN_INTERFACE_INFO_LIST)AllocateApiMemory(sizeof(WLAN_INTERFACE_INFO_LIST));
+    if (list == NULL) {
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+    list->dwNumberOfItems = 1;
+    list->InterfaceInfo[0].InterfaceGuid = kInterfaceGuid;
+    wcscpy_s(list->InterfaceInfo[0].strInterfaceDescription, L"Fake WLAN Adapter");
+    list->InterfaceInfo[0].isState = IsConnected() ? wlan_interface_state_connected : wlan_interface_state_disconnected;
+    *ppInterfaceList = list;
+    return ERROR_SUCCESS;
+}
+
+DWORD FakeWlan::RegisterNotification(DWORD source, WLAN_NOTIFICATION_CALLBACK callback, PVOID context) {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    if (source == WLAN_NOTIFICATION_SOURCE_NONE) {
+        m_wlanCallback = NULL;
+        m_wlanContext = NULL;
+    } else {
+        m_wlanCallback = callback;
+        m_wlanContext = context;
+    }
+    return ERROR_SUCCESS;
+}
+
+DWORD FakeWlan::QueryCurrentConnection(PDWORD pdwDataSize, PVOID* ppData) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    // 与真实系统一样，未连接时查询当前连接失败
+    if (!m_connected) {
+        return ERROR_INVALID_STATE;
+    }
+    
+    PWLAN_CONNECTION_ATTRIBUTES attributes = (PWLAN_CONNECTION_ATTRIBUTES)AllocateApiMemory(sizeof(WLAN_CONNECTION_ATTRIBUTES));
+    if (attributes == NULL) {
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+    attributes->isState = wlan_interface_state_connected;
+    attributes->wlanConnectionMode = wlan_connection_mode_profile;
+    wcsncpy_s(attributes->strProfileName, m_options.ssid.c_str(), _TRUNCATE);
+    
+    WLAN_ASSOCIATION_ATTRIBUTES& association = attributes->wlanAssociationAttributes;
+    association.dot11Ssid = m_ssid;
+    association.dot11BssType = dot11_BSS_type_infrastructure;
+    const UCHAR bssid[6] = { 0x02, 0x00, 0x5e, 0x10, 0x00, 0x01 };
+    memcpy(association.dot11Bssid, bssid, sizeof(bssid));
+    association.dot11PhyType = dot11_phy_type_ht;
+    association.wlanSignalQuality = m_options.signalQuality;
+    association.ulRxRate = 144000;
+    association.ulTxRate = 144000;
+    
+    attributes->wlanSecurityAttributes.bSecurityEnabled = FALSE;
+    attributes->wlanSecurityAttributes.dot11AuthAlgorithm = DOT11_AUTH_ALGO_80211_OPEN;
+    attributes->wlanSecurityAttributes.dot11CipherAlgorithm = DOT11_CIPHER_ALGO_NONE;
+    
+    *pdwDataSize = sizeof(WLAN_CONNECTION_ATTRIBUTES);
+    *ppData = attributes;
+    return ERROR_SUCCESS;
+}
+
+DWORD FakeWlan::Scan() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_options.scanFailReason != 0) {
+        Schedule(Action::ScanFailed, m_options.scanMs, m_options.scanFailReason);
+    } else {
+        Schedule(Action::ScanComplete, m_options.scanMs);
+    }
+    return ERROR_SUCCESS;
+}
+
+DWORD FakeWlan::GetAvailableNetworkList(PWLAN_AVAILABLE_NETWORK_LIST* ppAvailableNetworkList) {
+    PWLAN_AVAILABLE_NETWORK_LIST list = (PWLAN_AVAILABLE_NETWORK_LIST)AllocateApiMemory(sizeof(WLAN_AVAILABLE_NETWORK_LIST));
+    if (list == NULL) {
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    list->dwNumberOfItems = 1;
+    WLAN_AVAILABLE_NETWORK& network = list->Network[0];
+    network.dot11Ssid = m_ssid;
+    network.dot11BssType = dot11_BSS_type_infrastructure;
+    network.uNumberOfBssids = 1;
+    network.bNetworkConnectable = TRUE;
+    network.uNumberOfPhyTypes = 1;
+    network.dot11PhyTypes[0] = dot11_phy_type_ht;
+    network.wlanSignalQuality = m_options.signalQuality;
+    network.bSecurityEnabled = FALSE;
+    network.dot11DefaultAuthAlgorithm = DOT11_AUTH_ALGO_80211_OPEN;
+    network.dot11DefaultCipherAlgorithm = DOT11_CIPHER_ALGO_NONE;
+    if (m_connected) {
+        network.dwFlags = WLAN_AVAILABLE_NETWORK_CONNECTED;
+    }
+    
+    *ppAvailableNetworkList = list;
+    return ERROR_SUCCESS;
+}
+
+DWORD FakeWlan::Connect(const WLAN_CONNECTION_PARAMETERS* pParameters) {
+    if (pParameters == NULL || pParameters->strProfile == NULL) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    
+    // 配置文件名称与SSID相同；只有一个网络，其他名称都连接失败
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_options.ssid != pParameters->strProfile) {
+        Schedule(Action::ConnectFailed, m_options.associateMs, WLAN_REASON_CODE_NETWORK_NOT_AVAILABLE);
+    } else if (m_options.connectFailReason != 0) {
+        Schedule(Action::ConnectFailed, m_options.associateMs, m_options.connectFailReason);
+    } else {
+        Schedule(Action::ConnectComplete, m_options.associateMs);
+    }
+    return ERROR_SUCCESS;
+}
+
+DWORD FakeWlan::NotifyAddressChange(PUNICAST_IPADDRESS_CHANGE_CALLBACK callback, PVOID context, HANDLE* pHandle) {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    m_addressCallback = callback;
+    m_addressContext = context;
+    *pHandle = kAddressNotificationHandle;
+    return NO_ERROR;
+}
+
+void FakeWlan::CancelAddressNotification() {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    m_addressCallback = NULL;
+    m_addressContext = NULL;
+}
+
+DWORD FakeWlan::GetAddressEntry(PMIB_UNICASTIPADDRESS_ROW row) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_hasAddress || row->InterfaceLuid.Value != kInterfaceLuid || row->Address.si_family != AF_INET) {
+        return ERROR_NOT_FOUND;
+    }
+    FillAddressRow(*row);
+    return NO_ERROR;
+}
+
+DWORD FakeWlan::GetAddressTable(PMIB_UNICASTIPADDRESS_TABLE* ppTable) {
+    PMIB_UNICASTIPADDRESS_TABLE table = (PMIB_UNICASTIPADDRESS_TABLE)AllocateApiMemory(sizeof(MIB_UNICASTIPADDRESS_TABLE));
+    if (table == NULL) {
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_hasAddress) {
+        table->NumEntries = 1;
+        FillAddressRow(table->Table[0]);
+    }
+    *ppTable = table;
+    return NO_ERROR;
+}
+
+void FakeWlan::FillAddressRow(MIB_UNICASTIPADDRESS_ROW& row) const {
+    // DHCP分配的10.71.0.2/16
+    memset(&row, 0, sizeof(row));
+    row.Address.Ipv4.sin_family = AF_INET;
+    const UCHAR address[4] = { 10, 71, 0, 2 };
+    memcpy(&row.Address.Ipv4.sin_addr, address, sizeof(address));
+    row.InterfaceLuid.Value = kInterfaceLuid;
+    row.PrefixOrigin = IpPrefixOriginDhcp;
+    row.SuffixOrigin = IpSuffixOriginDhcp;
+    row.OnLinkPrefixLength = 16;
+    row.DadState = IpDadStatePreferred;
+    row.ValidLifetime = 86400;
+    row.PreferredLifetime = 86400;
+}
+
+void FakeWlan::Schedule(Action action, DWORD delayMs, DWORD value) {
+    m_pending.push_back({ GetTickCount64() + delayMs, action, value });
+    m_wakeup.notify_one();
+}
+
+void FakeWlan::DriverLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        if (m_pending.empty()) {
+            m_wakeup.wait(lock);
+            continue;
+        }
+        
+        // 取出最早到期的操作
+        auto next = std::min_element(m_pending.begin(), m_pending.end(), [](const PendingAction& a, const PendingAction& b) {
+            return a.due < b.due;
+        });
+        ULONGLONG now = GetTickCount64();
+        if (next->due > now) {
+            m_wakeup.wait_for(lock, std::chrono::milliseconds(next->due - now));
+            continue;
+        }
+        PendingAction pending = *next;
+        m_pending.erase(next);
+        
+        // 更新接口状态，然后在锁外发出通知（回调会查询接口状态）
+        switch (pending.action) {
+        case Action::ConnectComplete:
+            m_connected = true;
+            Schedule(Action::AddressAssigned, m_options.addressMs);
+            break;
+        case Action::AddressAssigned:
+            m_hasAddress = m_connected;
+            if (!m_hasAddress) {
+                continue;
+            }
+            break;
+        default:
+            break;
+        }
+        
+        lock.unlock();
+        Complete(pending);
+        lock.lock();
+    }
+}
+
+void FakeWlan::Complete(const PendingAction& pending) {
+    switch (pending.action) {
+    case Action::ScanComplete:
+        NotifyWlan(wlan_notification_acm_scan_complete, WLAN_REASON_CODE_SUCCESS);
+        break;
+    case Action::ScanFailed:
+        NotifyWlan(wlan_notification_acm_scan_fail, pending.value);
+        break;
+    case Action::ConnectComplete:
+        NotifyWlan(wlan_notification_acm_connection_complete, WLAN_REASON_CODE_SUCCESS);
+        break;
+    case Action::ConnectFailed:
+        NotifyWlan(wlan_notification_acm_connection_complete, pending.value);
+        break;
+    case Action::Disconnected:
+        NotifyWlan(wlan_notification_acm_disconnected, WLAN_REASON_CODE_SUCCESS);
+        break;
+    case Action::SignalChanged:
+        NotifySignalQuality(pending.value);
+        break;
+    case Action::AddressAssigned: {
+        std::lock_guard<std::mutex> lock(m_callbackMutex);
+        if (m_addressCallback != NULL) {
+            MIB_UNICASTIPADDRESS_ROW row;
+            FillAddressRow(row);
+            m_addressCallback(m_addressContext, &row, MibAddInstance);
+        }
+        break;
+    }
+    }
+}
+
+void FakeWlan::NotifyWlan(DWORD code, DWORD reasonCode) {
+    // 连接通知带有SSID和原因码，扫描失败通知只带原因码，扫描完成通知不带数据
+    WLAN_CONNECTION_NOTIFICATION_DATA connection = {};
+    connection.wlanConnectionMode = wlan_connection_mode_profile;
+    wcsncpy_s(connection.strProfileName, m_options.ssid.c_str(), _TRUNCATE);
+    connection.dot11Ssid = m_ssid;
+    connection.dot11BssType = dot11_BSS_type_infrastructure;
+    connection.wlanReasonCode = reasonCode;
+    
+    WLAN_NOTIFICATION_DATA data = {};
+    data.NotificationSource = WLAN_NOTIFICATION_SOURCE_ACM;
+    data.NotificationCode = code;
+    data.InterfaceGuid = kInterfaceGuid;
+    WLAN_REASON_CODE scanReason = reasonCode;
+    if (code == wlan_notification_acm_scan_fail) {
+        data.dwDataSize = sizeof(scanReason);
+        data.pData = &scanReason;
+    } else if (code != wlan_notification_acm_scan_complete) {
+        data.dwDataSize = sizeof(connection);
+        data.pData = &connection;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    if (m_wlanCallback != NULL) {
+        m_wlanCallback(&data, m_wlanContext);
+    }
+}
+
+void FakeWlan::NotifySignalQuality(ULONG signalQuality) {
+    // 与真实系统一样，信号强度变化是MSM通知，数据为新的信号强度
+    WLAN_NOTIFICATION_DATA data = {};
+    data.NotificationSource = WLAN_NOTIFICATION_SOURCE_MSM;
+    data.NotificationCode = wlan_notification_msm_signal_quality_change;
+    data.InterfaceGuid = kInterfaceGuid;
+    data.dwDataSize = sizeof(signalQuality);
+    data.pData = &signalQuality;
+    
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    if (m_wlanCallback != NULL) {
+        m_wlanCallback(&data, m_wlanContext);
+    }
+}
+
+// 模拟的WLAN API：基准测试目标的编译选项把WlanXxx重命名为FakeWlanXxx，
+// 这里的定义和被测代码中的调用都使用重命名后的名字，不会链接到系统的wlanapi.dll
+DWORD WINAPI WlanOpenHandle(DWORD dwClientVersion, PVOID pReserved, PDWORD pdwNegotiatedVersion, PHANDLE phClientHandle) {
+    FakeWlan::Instance().CountCall();
+    *pdwNegotiatedVersion = 2;
+    return FakeWlan::Instance().OpenHandle(phClientHandle);
+}
+
+DWORD WINAPI WlanCloseHandle(HANDLE hClientHandle, PVOID pReserved) {
+    FakeWlan::Instance().CountCall();
+    FakeWlan::Instance().CloseHandle();
+    return ERROR_SUCCESS;
+}
+
+DWORD WINAPI WlanEnumInterfaces(HANDLE hClientHandle, PVOID pReserved, PWLAN_INTERFACE_INFO_LIST* ppInterfaceList) {
+    FakeWlan::Instance().CountCall();
+    return FakeWlan::Instance().EnumInterfaces(ppInterfaceList);
+}
+
+DWORD WINAPI WlanRegisterNotification(HANDLE hClientHandle, DWORD dwNotifSource, BOOL bIgnoreDuplicate,
+                                      WLAN_NOTIFICATION_CALLBACK funcCallback, PVOID pCallbackContext,
+                                      PVOID pReserved, PDWORD pdwPrevNotifSource) {
+    FakeWlan::Instance().CountCall();
+    if (pdwPrevNotifSource != NULL) {
+        *pdwPrevNotifSource = WLAN_NOTIFICATION_SOURCE_NONE;
+    }
+    return FakeWlan::Instance().RegisterNotification(dwNotifSource, funcCallback, pCallbackContext);
+}
+
+DWORD WINAPI WlanQueryInterface(HANDLE hClientHandle, const GUID* pInterfaceGuid, WLAN_INTF_OPCODE OpCode,
+                                PVOID pReserved, PDWORD pdwDataSize, PVOID* ppData,
+                                PWLAN_OPCODE_VALUE_TYPE pWlanOpcodeValueType) {
+    FakeWlan::Instance().CountCall();
+    if (OpCode != wlan_intf_opcode_current_connection) {
+        return ERROR_NOT_SUPPORTED;
+    }
+    if (pWlanOpcodeValueType != NULL) {
+        *pWlanOpcodeValueType = wlan_opcode_value_type_query_only;
+    }
+    return FakeWlan::Instance().QueryCurrentConnection(pdwDataSize, ppData);
+}
+
+DWORD WINAPI WlanScan(HANDLE hClientHandle, const GUID* pInterfaceGuid, const PDOT11_SSID pDot11Ssid,
+                      const PWLAN_RAW_DATA pIeData, PVOID pReserved) {
+    FakeWlan::Instance().CountCall();
+    return FakeWlan::Instance().Scan();
+}
+
+DWORD WINAPI WlanGetAvailableNetworkList(HANDLE hClientHandle, const GUID* pInterfaceGuid, DWORD dwFlags,
+                                         PVOID pReserved, PWLAN_AVAILABLE_NETWORK_LIST* ppAvailableNetworkList) {
+    FakeWlan::Instance().CountCall();
+    return FakeWlan::Instance().GetAvailableNetworkList(ppAvailableNetworkList);
+}
+
+DWORD WINAPI WlanSetProfile(HANDLE hClientHandle, const GUID* pInterfaceGuid, DWORD dwFlags, LPCWSTR strProfileXml,
+                            LPCWSTR strAllUserProfileSecurity, BOOL bOverwrite, PVOID pReserved, DWORD* pdwReasonCode) {
+    FakeWlan::Instance().CountCall();
+    *pdwReasonCode = WLAN_REASON_CODE_SUCCESS;
+    return (strProfileXml != NULL && strProfileXml[0] != L'\0') ? ERROR_SUCCESS : ERROR_BAD_PROFILE;
+}
+
+DWORD WINAPI WlanConnect(HANDLE hClientHandle, const GUID* pInterfaceGuid,
+                         const PWLAN_CONNECTION_PARAMETERS pConnectionParameters, PVOID pReserved) {
+    FakeWlan::Instance().CountCall();
+    return FakeWlan::Instance().Connect(pConnectionParameters);
+}
+
+VOID WINAPI WlanFreeMemory(PVOID pMemory) {
+    FreeApiMemory(pMemory);
+}
+
+DWORD WINAPI WlanReasonCodeToString(DWORD dwReasonCode, DWORD dwBufferSize, PWCHAR pStringBuffer, PVOID pReserved) {
+    swprintf(pStringBuffer, dwBufferSize, L"模拟原因码%lu", dwReasonCode);
+    return ERROR_SUCCESS;
+}
+
+// 模拟的IP Helper API（同样被重命名）
+NETIOAPI_API ConvertInterfaceGuidToLuid(const GUID* InterfaceGuid, PNET_LUID InterfaceLuid) {
+    FakeWlan::Instance().CountCall();
+    if (memcmp(InterfaceGuid, &FakeWlan::kInterfaceGuid, sizeof(GUID)) != 0) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+    InterfaceLuid->Value = FakeWlan::kInterfaceLuid;
+    return NO_ERROR;
+}
+
+NETIOAPI_API NotifyUnicastIpAddressChange(ADDRESS_FAMILY Family, PUNICAST_IPADDRESS_CHANGE_CALLBACK Callback,
+                                          PVOID CallerContext, BOOLEAN InitialNotification, HANDLE* NotificationHandle) {
+    FakeWlan::Instance().CountCall();
+    return FakeWlan::Instance().NotifyAddressChange(Callback, CallerContext, NotificationHandle);
+}
+
+NETIOAPI_API CancelMibChangeNotify2(HANDLE NotificationHandle) {
+    FakeWlan::Instance().CountCall();
+    FakeWlan::Instance().CancelAddressNotification();
+    return NO_ERROR;
+}
+
+NETIOAPI_API GetUnicastIpAddressTable(ADDRESS_FAMILY Family, PMIB_UNICASTIPADDRESS_TABLE* Table) {
+    FakeWlan::Instance().CountCall();
+    return FakeWlan::Instance().GetAddressTable(Table);
+}
+
+NETIOAPI_API GetUnicastIpAddressEntry(PMIB_UNICASTIPADDRESS_ROW Row) {
+    FakeWlan::Instance().CountCall();
+    return FakeWlan::Instance().GetAddressEntry(Row);
+}
+
+VOID NETIOAPI_API_ FreeMibTable(PVOID Memory) {
+    FreeApiMemory(Memory);
+}
@@ -0,0 +1,237 @@
+﻿#include "../include/gateway_login.h"
+#include "../include/parallel_for.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cwctype>
+
+namespace {
+
+// 去掉首尾空白
+std::wstring Trim(const std::wstring& text) {
+    size_t begin = text.find_first_not_of(L" \t\r");
+    if (begin == std::wstring::npos) {
+        return L"";
+    }
+    size_t end = text.find_last_not_of(L" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+// 已排序耗时的百分位数
+ULONGLONG Percentile(const std::vector<ULONGLONG>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = (size_t)(q * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+} // namespace
+
+GatewayLoginEngine::GatewayLoginEngine(NetworkRequester& requester) : m_requester(requester) {
+}
+
+void GatewayLoginEngine::SetOptions(const GatewayLoginOptions& options) {
+    m_options = options;
+    if (m_options.parallelism == 0) {
+        m_options.parallelism = 1;
+    }
+    if (m_options.maxAttempts == 0) {
+        m_options.maxAttempts = 1;
+    }
+}
+
+GatewayLoginReport GatewayLoginEngine::Run(const std::vector<GatewayClient>& clients, CancellationToken* token) {
+    GatewayLoginReport report;
+    report.outcomes.resize(clients.size());
+    if (clients.empty()) {
+        return report;
+    }
+    
+    ULONGLONG start = GetTickCount64();
+    
+    // 连接池的单主机上限与并发数一致，否则多出的线程只能排队等待连接
+    DWORD threadCount = (DWORD)min((size_t)m_options.parallelism, clients.size());
+    m_requester.SetMaxConnectionsPerHost(threadCount);
+    
+    ParallelFor(clients.size(), threadCount, token, [&](size_t index) {
+        report.outcomes[index] = LoginClient(clients[index], token);
+    });
+    
+    report.elapsedMs = GetTickCount64() - start;
+    report.cancelled = (token != nullptr && token->IsCancelled());
+    return report;
+}
+
+GatewayLoginOutcome GatewayLoginEngine::LoginClient(const GatewayClient& client, CancellationToken* token) {
+    GatewayLoginOutcome outcome;
+    ULONGLONG start = GetTickCount64();
+    DWORD delay = m_options.retryDelayMs;
+    
+    for (;;) {
+        outcome.attempts++;
+        outcome.result = m_requester.SubmitLogin(client.account, client.password, client.ip, client.mac);
+        if (!IsRetryable(outcome.result) || outcome.attempts >= m_options.maxAttempts) {
+            break;
+        }
+        
+        // 等待期间被取消时保留最后一次的结果
+        if (token != nullptr) {
+            if (token->WaitForCancellation(delay)) {
+                break;
+            }
+        } else {
+            Sleep(delay);
+        }
+        delay = min(delay * 2, (DWORD)60000);
+    }
+    
+    outcome.elapsedMs = GetTickCount64() - start;
+    return outcome;
+}
+
+bool GatewayLoginEngine::IsRetryable(NetworkRequester::LoginResult result) {
+    // 账号或密码错误、账号被占用短时间内重试也不会成功
+    return result == NetworkRequester::LoginResult::TransportError ||
+           result == NetworkRequester::LoginResult::PortalError;
+}
+
+bool GatewayLoginEngine::NormalizeMac(const std::wstring& mac, std::wstring& normalized) {
+    normalized.clear();
+    for (wchar_t ch : mac) {
+        if (ch == L':' || ch == L'-' || ch == L'.') {
+            continue;
+        }
+        if (!iswxdigit(ch)) {
+            return false;
+        }
+        normalized += (wchar_t)towlower(ch);
+    }
+    return normalized.size() == 12;
+}
+
+bool GatewayLoginEngine::LoadClients(
+    const std::wstring& filePath,
+    const std::wstring& defaultAccount,
+    const std::wstring& defaultPassword,
+    std::vector<GatewayClient>& clients,
+    bool requireAccount) {
+    std::ifstream file(std::filesystem::path(filePath), std::ios::binary);
+    if (!file) {
+        std::wcerr << L"无法打开客户端列表: " << filePath << std::endl;
+        return false;
+    }
+    
+    clients.clear();
+    std::string rawLine;
+    int lineNumber = 0;
+    while (std::getline(file, rawLine)) {
+        lineNumber++;
+        
+        // 跳过UTF-8 BOM
+        if (lineNumber == 1 && rawLine.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            rawLine.erase(0, 3);
+        }
+        
+        std::wstring line = Trim(NetworkRequester::Utf8ToWide(rawLine));
+        if (line.empty() || line[0] == L'#') {
+            continue;
+        }
+        
+        std::vector<std::wstring> fields;
+        size_t begin = 0;
+        for (;;) {
+            size_t comma = line.find(L',', begin);
+            fields.push_back(Trim(line.substr(begin, comma == std::wstring::npos ? std::wstring::npos : comma - begin)));
+            if (comma == std::wstring::npos) {
+                break;
+            }
+            begin = comma + 1;
+        }
+        
+        GatewayClient client;
+        client.ip = fields[0];
+        if (client.ip.empty() || fields.size() < 2 || !NormalizeMac(fields[1], client.mac)) {
+            std::wcerr << L"客户端列表第" << lineNumber << L"行格式错误，应为: IP,MAC[,账号[,密码]]" << std::endl;
+            return false;
+        }
+        client.account = (fields.size() >= 3 && !fields[2].empty()) ? fields[2] : defaultAccount;
+        client.password = (fields.size() >= 4 && !fields[3].empty()) ? fields[3] : defaultPassword;
+        if (requireAccount && client.account.empty()) {
+            std::wcerr << L"客户端列表第" << lineNumber << L"行没有账号，也没有指定默认账号" << std::endl;
+            return false;
+        }
+        clients.push_back(client);
+    }
+    
+    return true;
+}
+
+std::vector<std::wstring> GatewayLoginEngine::ClientIPs(const std::vector<GatewayClient>& clients) {
+    std::vector<std::wstring> ips;
+    ips.reserve(clients.size());
+    for (const GatewayClient& client : clients) {
+        ips.push_back(client.ip);
+    }
+    return ips;
+}
+
+std::vector<GatewayClient> GatewayLoginEngine::SelectForLogin(const std::vector<GatewayClient>& clients, const SessionSweepReport& sweep) {
+    std::vector<GatewayClient> selected;
+    for (size_t i = 0; i < clients.size(); i++) {
+        // 被取消而没有查询的客户端也按状态未知处理
+        if (i >= sweep.statuses.size() || sweep.statuses[i].state != NetworkRequester::SessionState::Online) {
+            selected.push_back(clients[i]);
+        }
+    }
+    return selected;
+}
+
+void GatewayLoginEngine::PrintReport(const std::vector<GatewayClient>& clients, const GatewayLoginReport& report, std::wostream& out) {
+    // 按结果统计，并列出未能登录的客户端
+    const int resultCount = (int)NetworkRequester::LoginResult::TransportError + 1;
+    size_t counts[resultCount] = {};
+    size_t skipped = 0;
+    uint64_t attempts = 0;
+    std::vector<ULONGLONG> latencies;
+    latencies.reserve(report.outcomes.size());
+    
+    for (size_t i = 0; i < report.outcomes.size(); i++) {
+        const GatewayLoginOutcome& outcome = report.outcomes[i];
+        if (outcome.attempts == 0) {
+            skipped++;
+            continue;
+        }
+        counts[(int)outcome.result]++;
+        attempts += outcome.attempts;
+        latencies.push_back(outcome.elapsedMs);
+        
+        if (outcome.result != NetworkRequester::LoginResult::Success &&
+            outcome.result != NetworkRequester::LoginResult::AlreadyOnline) {
+            out << L"  " << clients[i].ip << L" (" << clients[i].mac << L"): "
+                << NetworkRequester::LoginResultToString(outcome.result)
+                << L"，尝试" << outcome.attempts << L"次\n";
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    
+    size_t finished = report.outcomes.size() - skipped;
+    double seconds = report.elapsedMs / 1000.0;
+    out << L"共" << report.outcomes.size() << L"个客户端，完成" << finished << L"个";
+    if (report.cancelled) {
+        out << L"（已取消，" << skipped << L"个未登录）";
+    }
+    out << L"，耗时" << seconds << L"秒，每秒" << (seconds > 0 ? finished / seconds : 0.0) << L"个\n";
+    
+    for (int result = 0; result < resultCount; result++) {
+        if (counts[result] > 0) {
+            out << L"  " << NetworkRequester::LoginResultToString((NetworkRequester::LoginResult)result)
+                << L": " << counts[result] << L"\n";
+        }
+    }
+    out << L"登录请求" << attempts << L"次（重试" << (attempts - finished) << L"次），每个客户端耗时 p50="
+        << Percentile(latencies, 0.50) << L"ms p90=" << Percentile(latencies, 0.90)
+        << L"ms p99=" << Percentile(latencies, 0.99) << L"ms max="
+        << (latencies.empty() ? 0 : latencies.back()) << L"ms\n";
+}
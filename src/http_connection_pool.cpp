@@ -0,0 +1,158 @@
+﻿#include "../include/http_connection_pool.h"
+#include <algorithm>
+
+// 默认每个主机最多4个并发请求，连接句柄空闲60秒后回收
+HttpConnectionPool::HttpConnectionPool() :
+    m_hSession(NULL),
+    m_maxPerHost(4),
+    m_idleTimeoutMs(60000) {
+}
+
+HttpConnectionPool::~HttpConnectionPool() {
+    Clear();
+}
+
+void HttpConnectionPool::SetSession(HINTERNET hSession) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hSession = hSession;
+}
+
+void HttpConnectionPool::SetLimits(DWORD maxPerHost, ULONGLONG idleTimeoutMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxPerHost = maxPerHost > 0 ? maxPerHost : 1;
+    m_idleTimeoutMs = idleTimeoutMs;
+}
+
+HINTERNET HttpConnectionPool::Acquire(const std::wstring& hostName, INTERNET_PORT port, INTERNET_SCHEME scheme,
+                                       HttpCancel* cancel) {
+    // 取消时唤醒等待中的请求（在加锁前登记，中断函数需要获取连接池的锁）
+    if (cancel != NULL && !cancel->SetInterrupter([this]() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_released.notify_all();
+    })) {
+        return NULL;
+    }
+
+    HINTERNET hConnect = WaitAndAcquire(hostName, port, scheme, cancel);
+
+    // 在锁外注销：Cancel持有取消信号的锁执行中断函数，中断函数又要获取连接池的锁
+    if (cancel != NULL) {
+        cancel->ClearInterrupter();
+    }
+    return hConnect;
+}
+
+HINTERNET HttpConnectionPool::WaitAndAcquire(const std::wstring& hostName, INTERNET_PORT port, INTERNET_SCHEME scheme,
+                                              HttpCancel* cancel) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_hSession == NULL) {
+        return NULL;
+    }
+
+    EvictIdleLocked(GetTickCount64());
+
+    // 达到单主机上限时等待其他请求归还；请求本身有超时，归还总会发生，所以不再另设等待上限
+    m_released.wait(lock, [&]() {
+        return (cancel != NULL && cancel->IsCancelled()) ||
+               CountInFlightLocked(hostName, port, scheme) < m_maxPerHost;
+    });
+
+    if (cancel != NULL && cancel->IsCancelled()) {
+        return NULL;
+    }
+
+    // 复用已有的连接句柄
+    for (auto& entry : m_entries) {
+        if (entry.port == port && entry.scheme == scheme && entry.hostName == hostName) {
+            entry.inFlight++;
+            entry.lastUsed = GetTickCount64();
+            return entry.hConnect;
+        }
+    }
+
+    // 没有可复用的连接，新建一个
+    HINTERNET hConnect = WinHttpConnect(
+        m_hSession,
+        hostName.c_str(),
+        port,
+        0
+    );
+
+    // 失败时由调用方通过GetLastError获取错误码并记录
+    if (!hConnect) {
+        return NULL;
+    }
+
+    Entry entry;
+    entry.hostName = hostName;
+    entry.port = port;
+    entry.scheme = scheme;
+    entry.hConnect = hConnect;
+    entry.inFlight = 1;
+    entry.lastUsed = GetTickCount64();
+    m_entries.push_back(entry);
+
+    return hConnect;
+}
+
+void HttpConnectionPool::Release(HINTERNET hConnect) {
+    if (hConnect == NULL) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = std::find_if(m_entries.begin(), m_entries.end(), [hConnect](const Entry& entry) {
+            return entry.hConnect == hConnect;
+        });
+
+        if (it == m_entries.end()) {
+            // 不属于连接池的句柄直接关闭
+            WinHttpCloseHandle(hConnect);
+        } else {
+            if (it->inFlight > 0) {
+                it->inFlight--;
+            }
+            it->lastUsed = GetTickCount64();
+        }
+    }
+
+    m_released.notify_all();
+}
+
+void HttpConnectionPool::EvictIdle() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EvictIdleLocked(GetTickCount64());
+}
+
+void HttpConnectionPool::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& entry : m_entries) {
+        WinHttpCloseHandle(entry.hConnect);
+    }
+    m_entries.clear();
+}
+
+void HttpConnectionPool::EvictIdleLocked(ULONGLONG now) {
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->inFlight == 0 && now - it->lastUsed > m_idleTimeoutMs) {
+            WinHttpCloseHandle(it->hConnect);
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+DWORD HttpConnectionPool::CountInFlightLocked(const std::wstring& hostName, INTERNET_PORT port, INTERNET_SCHEME scheme) const {
+    DWORD count = 0;
+    for (const auto& entry : m_entries) {
+        if (entry.port == port && entry.scheme == scheme && entry.hostName == hostName) {
+            count += entry.inFlight;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,33 @@
+﻿#include "../include/http_transport.h"
+#include "../include/binary_log.h"
+
+void HttpCancel::Cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_cancelled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    m_cancelled.store(true, std::memory_order_release);
+
+    if (m_interrupter) {
+        m_interrupter();
+    }
+}
+
+bool HttpCancel::SetInterrupter(const std::function<void()>& interrupter) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_cancelled.load(std::memory_order_relaxed)) {
+        m_interrupter = nullptr;
+        return false;
+    }
+    m_interrupter = interrupter;
+    return true;
+}
+
+void HttpCancel::ClearInterrupter() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_interrupter = nullptr;
+}
+
+void HttpTransport::RecordFailure(HttpStage stage, uint32_t error) {
+    BinaryLog::Instance().Log(LogLevel::Warning, LogEvent::HttpFailed, stage, error);
+}
@@ -10,6 +10,13 @@
 #include "../include/wifi_service.h"
 #include "../include/service_installer.h"
 #include "../include/network_requester.h"
+#include "../include/binary_log.h"
+#include "../include/status_page_mapping.h"
+#include "../include/gateway_login.h"
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
 
 // 服务名称
 const std::wstring SERVICE_NAME = L"WifiAutoConnectService";
@@ -24,7 +31,8 @@ bool ReadServiceConfig(
     std::wstring& targetSsid,
     std::wstring& targetPassword,
     std::wstring& campusAccount,
-    std::wstring& campusPassword
+    std::wstring& campusPassword,
+    std::wstring& portalBaseUrl
 ) {
     // 构建注册表路径
     std::wstring registryPath = L"SYSTEM\\CurrentControlSet\\Services\\" + serviceName + L"\\Parameters";
@@ -111,6 +119,21 @@ bool ReadServiceConfig(
         campusPassword = buffer;
     }
     
+    // 读取认证服务器地址（如果有）
+    bufferSize = sizeof(buffer);
+    result = RegQueryValueExW(
+        hKey,
+        L"PortalBaseUrl",
+        NULL,
+        &type,
+        (BYTE*)buffer,
+        &bufferSize
+    );
+    
+    if (result == ERROR_SUCCESS && type == REG_SZ) {
+        portalBaseUrl = buffer;
+    }
+    
     // 关闭注册表项
     RegCloseKey(hKey);
     
@@ -123,7 +146,8 @@ void ParseCommandLineArgs(
     wchar_t* argv[], 
     std::wstring& password, 
     std::wstring& campusAccount, 
-    std::wstring& campusPassword
+    std::wstring& campusPassword,
+    std::wstring& portalBaseUrl
 ) {
     for (int i = 1; i < argc; i++) {
         std::wstring arg = argv[i];
@@ -137,6 +161,9 @@ void ParseCommandLineArgs(
         else if (arg == L"--cp" && i + 1 < argc) {
             campusPassword = argv[++i];
         }
+        else if (arg == L"--portal" && i + 1 < argc) {
+            portalBaseUrl = argv[++i];
+        }
     }
 }
 
@@ -149,7 +176,23 @@ void PrintHelp() {
     std::wcout << L"  start\n";
     std::wcout << L"  stop\n";
     std::wcout << L"  status\n";
+    std::wcout << L"  metrics             - 输出运行中服务的指标（Prometheus文本格式）\n";
+    std::wcout << L"  events [条数]       - 输出运行中服务最近的事件\n";
+    std::wcout << L"  reconnect           - 让运行中的服务立即重新连接WiFi\n";
+    std::wcout << L"  relogin             - 让运行中的服务立即重新登录校园网\n";
+    std::wcout << L"  trace [文件]        - 导出运行中服务最近的重连周期（Chrome trace JSON）\n";
+    std::wcout << L"  decodelog [文件]    - 把二进制日志转换为文字，默认读取服务的日志文件\n";
+    std::wcout << L"  logbench [次数]     - 测量写一条二进制日志的耗时（纳秒）\n";
+    std::wcout << L"  statuspage          - 读取服务的共享状态页（不唤醒服务）\n";
+    std::wcout << L"  statusbench [秒数] [线程数] - 测量多个线程读取共享状态页的吞吐量\n";
     std::wcout << L"  run <SSID> [--password=<密码>] [--account=<校园网账号>] [--password=<校园网密码>]\n";
+    std::wcout << L"  gateway <客户端列表> [--ca <账号>] [--cp <密码>] [--parallel <并发数>] [--attempts <次数>] [--sweep]\n";
+    std::wcout << L"          [--portal <地址>] [--login-url <地址>] [--chkstatus-url <地址>]\n";
+    std::wcout << L"                      - 网关模式：为列表中的客户端（IP,MAC[,账号[,密码]]）批量登录校园网，\n";
+    std::wcout << L"                        指定--sweep时先查询会话状态，跳过确认已在线的客户端，离线和状态未知的都登录；\n";
+    std::wcout << L"                        真实的认证服务器只返回请求来源地址的状态，从网关查询时其他客户端都是状态未知\n";
+    std::wcout << L"  sweep <客户端列表> [--parallel <并发数>] [--portal <地址>] [--chkstatus-url <地址>]\n";
+    std::wcout << L"                      - 批量查询客户端在认证服务器上的会话状态\n";
     std::wcout << L"  autostart [on|off]  - 设置或查询开机自启动状态\n";
     std::wcout << L"  service             - 作为服务运行（内部使用）\n";
     std::wcout << L"\n";
@@ -157,6 +200,8 @@ void PrintHelp() {
     std::wcout << L"  --password <密码>   - 设置WiFi密码\n";
     std::wcout << L"  --ca <账号>         - 设置校园网账号\n";
     std::wcout << L"  --cp <密码>         - 设置校园网密码\n";
+    std::wcout << L"  --portal <地址>     - 使用指定的认证服务器（如模拟认证服务器 http://127.0.0.1:8080），\n";
+    std::wcout << L"                        状态查询、登录和网络探测都发到该服务器\n";
 }
 
 // 获取当前可执行文件路径
@@ -166,16 +211,163 @@ std::wstring GetExecutablePath() {
     return std::wstring(path);
 }
 
+// 通过控制通道向运行中的服务发送请求并输出回复
+int QueryService(const std::string& request) {
+    std::string response;
+    if (!ControlPipeServer::Query(ControlPipeServer::PipeNameForService(SERVICE_NAME), request, response)) {
+        return 1;
+    }
+    std::wcout << NetworkRequester::Utf8ToWide(response);
+    return (response.compare(0, 6, "error:") == 0) ? 1 : 0;
+}
+
+// 把UTF-8文本写入文件，覆盖原有内容
+bool WriteTextFile(const std::wstring& filePath, const std::string& text) {
+    HANDLE hFile = CreateFileW(filePath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                               CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        std::wcerr << L"无法创建文件: " << filePath << L"，错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+    
+    DWORD written = 0;
+    BOOL ok = WriteFile(hFile, text.data(), (DWORD)text.size(), &written, NULL);
+    CloseHandle(hFile);
+    
+    if (!ok || written != text.size()) {
+        std::wcerr << L"写入文件失败: " << filePath << L"，错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 网关和批量查询命令的选项
+struct GatewayCommandOptions {
+    GatewayLoginOptions login;
+    SessionSweepOptions sweep;
+    bool sweepFirst = false;        // 登录前先查询会话状态，跳过已在线的客户端
+    std::wstring portalBaseUrl;     // 认证服务器地址，为空时使用默认地址
+    std::wstring loginUrl;          // 登录接口地址，为空时使用默认地址
+    std::wstring chkstatusUrl;      // 状态查询地址，为空时使用默认地址
+};
+
+// 解析网关和批量查询命令的选项（从第3个参数开始）
+void ParseGatewayOptions(int argc, wchar_t* argv[], GatewayCommandOptions& options) {
+    for (int i = 3; i < argc; i++) {
+        std::wstring arg = argv[i];
+        if (arg == L"--parallel" && i + 1 < argc) {
+            options.login.parallelism = (DWORD)_wtoi(argv[++i]);
+            options.sweep.parallelism = options.login.parallelism;
+        } else if (arg == L"--attempts" && i + 1 < argc) {
+            options.login.maxAttempts = (DWORD)_wtoi(argv[++i]);
+        } else if (arg == L"--sweep") {
+            options.sweepFirst = true;
+        } else if (arg == L"--portal" && i + 1 < argc) {
+            options.portalBaseUrl = argv[++i];
+        } else if (arg == L"--login-url" && i + 1 < argc) {
+            options.loginUrl = argv[++i];
+        } else if (arg == L"--chkstatus-url" && i + 1 < argc) {
+            options.chkstatusUrl = argv[++i];
+        }
+    }
+}
+
+// 网关和批量查询命令的停止令牌，按Ctrl+C时取消
+CancellationToken& ConsoleStopToken() {
+    static CancellationToken token;
+    static bool installed = false;
+    if (!installed) {
+        installed = true;
+        SetConsoleCtrlHandler([](DWORD ctrlType) -> BOOL {
+            ConsoleStopToken().Cancel();
+            return TRUE;
+        }, TRUE);
+    }
+    return token;
+}
+
+// 按命令选项初始化网络请求器
+bool InitializeGatewayRequester(NetworkRequester& requester, const GatewayCommandOptions& options) {
+    if (!requester.Initialize()) {
+        std::wcout << L"网络请求器初始化失败\n";
+        return false;
+    }
+    // 先设置认证服务器地址，单独指定的接口地址优先
+    if (!options.portalBaseUrl.empty()) {
+        requester.SetPortalBaseUrl(options.portalBaseUrl);
+    }
+    if (!options.loginUrl.empty()) {
+        requester.SetLoginUrl(options.loginUrl);
+    }
+    if (!options.chkstatusUrl.empty()) {
+        requester.SetChkstatusUrl(options.chkstatusUrl);
+    }
+    
+    // 按Ctrl+C时中断正在进行的请求，不再处理剩余的客户端
+    requester.SetCancellationToken(&ConsoleStopToken());
+    return true;
+}
+
+// 输出共享状态页的内容
+void PrintStatusPage(const StatusPageData& data) {
+    uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto secondsAgo = [now](uint64_t timeMs) { return timeMs < now ? (now - timeMs) / 1000 : 0; };
+    
+    std::wcout << L"服务: " << (data.serviceRunning ? L"运行中" : L"已停止")
+               << L"（" << secondsAgo(data.publishTimeMs) << L"秒前更新）\n";
+    std::wcout << L"连接状态: " << ConnectionStateMachine::StateToString((ConnectionState)data.state);
+    if (data.stateSinceMs != 0) {
+        std::wcout << L"（已持续" << secondsAgo(data.stateSinceMs) << L"秒）";
+    }
+    std::wcout << L"\n";
+    
+    if (data.wifiConnected) {
+        std::wcout << L"当前WiFi: " << NetworkRequester::Utf8ToWide(StatusPage::Ssid(data))
+                   << L"，信号" << data.signalQuality << L"%（" << data.rssi << L" dBm）\n";
+    } else {
+        std::wcout << L"当前WiFi: 未连接\n";
+    }
+    
+    std::string address = StatusPage::FormatAddress(data);
+    std::wcout << L"IP地址: " << (address.empty() ? std::wstring(L"未获取") : NetworkRequester::Utf8ToWide(address)) << L"\n";
+    
+    if (data.lastProbeTimeMs != 0) {
+        const wchar_t* probeText = L"离线";
+        if (data.lastProbeStatus == (uint32_t)NetworkRequester::ConnectivityStatus::Online) {
+            probeText = L"在线";
+        } else if (data.lastProbeStatus == (uint32_t)NetworkRequester::ConnectivityStatus::CaptivePortal) {
+            probeText = L"需要认证";
+        }
+        std::wcout << L"最近探测: " << secondsAgo(data.lastProbeTimeMs) << L"秒前，" << probeText
+                   << L"，耗时" << data.lastProbeElapsedMs << L"毫秒\n";
+    } else {
+        std::wcout << L"最近探测: 无\n";
+    }
+    
+    if (data.lastLoginTimeMs != 0) {
+        std::wcout << L"最近登录: " << secondsAgo(data.lastLoginTimeMs) << L"秒前，"
+                   << NetworkRequester::LoginResultToString((NetworkRequester::LoginResult)data.lastLoginResult) << L"\n";
+    } else {
+        std::wcout << L"最近登录: 无\n";
+    }
+    
+    std::wcout << L"统计: 连接" << data.connectCount << L"次，断开" << data.disconnectCount
+               << L"次，登录" << data.loginCount << L"次（失败" << data.loginFailureCount
+               << L"次），工作线程唤醒" << data.wakeupCount << L"次\n";
+}
+
 // 服务入口点
 void WINAPI ServiceMain(DWORD argc, LPWSTR* argv) {
     // 从注册表读取配置
-    std::wstring targetSsid, targetPassword, campusAccount, campusPassword;
-    if (ReadServiceConfig(SERVICE_NAME, targetSsid, targetPassword, campusAccount, campusPassword)) {
+    std::wstring targetSsid, targetPassword, campusAccount, campusPassword, portalBaseUrl;
+    if (ReadServiceConfig(SERVICE_NAME, targetSsid, targetPassword, campusAccount, campusPassword, portalBaseUrl)) {
         // 创建服务实例
         WifiService service;
         service.SetServiceName(SERVICE_NAME);
         service.SetTargetWifi(targetSsid, targetPassword);
         service.SetCampusNetworkCredentials(campusAccount, campusPassword);
+        service.SetPortalBaseUrl(portalBaseUrl);
         
         // 启动服务
         WifiService::ServiceMain(argc, argv);
@@ -264,10 +456,10 @@ int wmain(int argc, wchar_t* argv[]) {
             }
 
             std::wstring ssid = argv[2];
-            std::wstring password, campusAccount, campusPassword;
+            std::wstring password, campusAccount, campusPassword, portalBaseUrl;
             
             // 解析命令行参数
-            ParseCommandLineArgs(argc, argv, password, campusAccount, campusPassword);
+            ParseCommandLineArgs(argc, argv, password, campusAccount, campusPassword, portalBaseUrl);
 
             if (ServiceInstaller::Install(
                 SERVICE_NAME, 
@@ -277,7 +469,8 @@ int wmain(int argc, wchar_t* argv[]) {
                 ssid,
                 password,
                 campusAccount,
-                campusPassword)) {
+                campusPassword,
+                portalBaseUrl)) {
                 std::wcout << L"服务安装成功\n";
                 return 0;
             } else {
@@ -338,6 +531,198 @@ int wmain(int argc, wchar_t* argv[]) {
                     std::wcout << L"服务状态: 未知\n";
                     break;
             }
+            
+            // 服务运行中时通过控制通道查询连接状态
+            if (status == SERVICE_RUNNING) {
+                QueryService("status");
+            }
+            return 0;
+        }
+        // 输出服务指标
+        else if (command == L"metrics") {
+            return QueryService("metrics");
+        }
+        // 查看最近的事件
+        else if (command == L"events") {
+            std::string request = "events";
+            if (argc >= 3) {
+                request += " " + std::to_string(_wtoi(argv[2]));
+            }
+            return QueryService(request);
+        }
+        // 立即重新连接
+        else if (command == L"reconnect") {
+            return QueryService("reconnect");
+        }
+        // 立即重新登录
+        else if (command == L"relogin") {
+            return QueryService("relogin");
+        }
+        // 通过控制通道取得重连周期追踪，写入文件
+        else if (command == L"trace") {
+            std::wstring tracePath = (argc >= 3) ? std::wstring(argv[2]) : WifiService::GetTraceFilePath();
+            std::string trace;
+            if (!ControlPipeServer::Query(ControlPipeServer::PipeNameForService(SERVICE_NAME), "trace", trace) ||
+                trace.compare(0, 6, "error:") == 0) {
+                std::wcout << L"导出追踪失败\n";
+                return 1;
+            }
+            if (!WriteTextFile(tracePath, trace)) {
+                return 1;
+            }
+            std::wcout << L"已导出到: " << tracePath << L"\n";
+            std::wcout << L"可以在chrome://tracing或https://ui.perfetto.dev中打开\n";
+            return 0;
+        }
+        // 把二进制日志转换为文字
+        else if (command == L"decodelog") {
+            std::wstring logPath = (argc >= 3) ? std::wstring(argv[2]) : WifiService::GetLogFilePath();
+            if (!BinaryLog::Decode(logPath, std::wcout)) {
+                std::wcout << L"无法读取日志文件: " << logPath << L"\n";
+                return 1;
+            }
+            return 0;
+        }
+        // 测量写日志的耗时
+        else if (command == L"logbench") {
+            int count = (argc >= 3) ? _wtoi(argv[2]) : 50000;
+            if (count <= 0) {
+                count = 50000;
+            }
+            
+            wchar_t tempPath[MAX_PATH];
+            GetTempPathW(MAX_PATH, tempPath);
+            std::wstring benchPath = std::wstring(tempPath) + L"wifi_logbench.blog";
+            
+            BinaryLog& log = BinaryLog::Instance();
+            if (!log.Start(benchPath)) {
+                std::wcout << L"无法创建日志文件: " << benchPath << L"\n";
+                return 1;
+            }
+            
+            // 每批写半个缓冲区，批次之间等待后台线程写出，只统计写日志本身的耗时
+            const int batchSize = (int)(BinaryLog::kCapacity / 2);
+            std::chrono::nanoseconds total(0);
+            for (int written = 0; written < count; written += batchSize) {
+                int batch = (count - written < batchSize) ? count - written : batchSize;
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < batch; i++) {
+                    log.Log(LogLevel::Info, LogEvent::ProbeResult, 0, 204, written + i);
+                }
+                total += std::chrono::steady_clock::now() - start;
+                std::this_thread::sleep_for(std::chrono::milliseconds(150));
+            }
+            uint64_t dropped = log.DroppedCount();
+            log.Stop();
+            DeleteFileW(benchPath.c_str());
+            
+            std::wcout << L"写入" << count << L"条日志，平均每条" << (double)total.count() / count
+                       << L"纳秒，丢弃" << dropped << L"条\n";
+            return 0;
+        }
+        // 读取共享状态页
+        else if (command == L"statuspage") {
+            StatusPageReader reader;
+            if (!reader.Open(SERVICE_NAME)) {
+                std::wcout << L"无法打开共享状态页，服务可能没有运行\n";
+                return 1;
+            }
+            
+            StatusPageData data;
+            if (!reader.Read(data)) {
+                std::wcout << L"共享状态页尚未就绪或版本不兼容\n";
+                return 1;
+            }
+            PrintStatusPage(data);
+            return 0;
+        }
+        // 测量读取共享状态页的吞吐量
+        else if (command == L"statusbench") {
+            int seconds = (argc >= 3) ? _wtoi(argv[2]) : 3;
+            if (seconds <= 0) {
+                seconds = 3;
+            }
+            int threadCount = (argc >= 4) ? _wtoi(argv[3]) : 4;
+            if (threadCount <= 0 || threadCount > 64) {
+                threadCount = 4;
+            }
+            
+            // 服务在运行时读取服务的状态页；否则在进程内创建状态页，由模拟的写者每毫秒发布一次
+            std::atomic<bool> stopped(false);
+            StatusPageReader reader;
+            std::unique_ptr<StatusPage::Layout> localPage;
+            std::thread writer;
+            const StatusPage::Layout* page = nullptr;
+            if (reader.Open(SERVICE_NAME)) {
+                page = reader.GetLayout();
+                std::wcout << L"读取服务的状态页: " << threadCount << L"个线程，" << seconds << L"秒\n";
+            } else {
+                localPage.reset(new StatusPage::Layout());
+                StatusPage::Initialize(localPage.get());
+                page = localPage.get();
+                writer = std::thread([&stopped, page = localPage.get()]() {
+                    StatusPageData data = {};
+                    while (!stopped.load(std::memory_order_relaxed)) {
+                        data.wakeupCount++;
+                        data.publishTimeMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+                        StatusPage::Publish(page, data);
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                });
+                std::wcout << L"服务未运行，读取进程内的状态页（每毫秒发布一次）: "
+                           << threadCount << L"个线程，" << seconds << L"秒\n";
+            }
+            
+            // 每个线程只在结束时写入自己的计数，避免计数器之间的伪共享
+            std::vector<uint64_t> reads(threadCount, 0);
+            std::vector<uint64_t> retries(threadCount, 0);
+            std::vector<uint64_t> failures(threadCount, 0);
+            std::vector<std::thread> readers;
+            for (int t = 0; t < threadCount; t++) {
+                readers.emplace_back([&, t]() {
+                    uint64_t readCount = 0;
+                    uint64_t retryCount = 0;
+                    uint64_t failureCount = 0;
+                    StatusPageData data;
+                    while (!stopped.load(std::memory_order_relaxed)) {
+                        uint32_t attemptRetries = 0;
+                        if (StatusPage::Read(page, data, 1000, &attemptRetries)) {
+                            readCount++;
+                        } else {
+                            failureCount++;
+                        }
+                        retryCount += attemptRetries;
+                    }
+                    reads[t] = readCount;
+                    retries[t] = retryCount;
+                    failures[t] = failureCount;
+                });
+            }
+            
+            auto start = std::chrono::steady_clock::now();
+            std::this_thread::sleep_for(std::chrono::seconds(seconds));
+            stopped.store(true);
+            for (auto& thread : readers) {
+                thread.join();
+            }
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (writer.joinable()) {
+                writer.join();
+            }
+            
+            uint64_t totalReads = 0;
+            uint64_t totalRetries = 0;
+            uint64_t totalFailures = 0;
+            for (int t = 0; t < threadCount; t++) {
+                totalReads += reads[t];
+                totalRetries += retries[t];
+                totalFailures += failures[t];
+            }
+            
+            std::wcout << L"共读取" << totalReads << L"次，每秒" << (uint64_t)(totalReads / elapsed)
+                       << L"次，每个线程每次" << (totalReads > 0 ? elapsed * threadCount * 1e9 / totalReads : 0.0)
+                       << L"纳秒，遇到写入重试" << totalRetries << L"次，失败" << totalFailures << L"次\n";
             return 0;
         }
         // 设置或查询开机自启动状态
@@ -387,37 +772,133 @@ int wmain(int argc, wchar_t* argv[]) {
             }
 
             std::wstring ssid = argv[2];
-            std::wstring password, campusAccount, campusPassword;
+            std::wstring password, campusAccount, campusPassword, portalBaseUrl;
             
             // 解析命令行参数
-            ParseCommandLineArgs(argc, argv, password, campusAccount, campusPassword);
+            ParseCommandLineArgs(argc, argv, password, campusAccount, campusPassword, portalBaseUrl);
 
             std::wcout << L"SSID: " << ssid << std::endl;
             std::wcout << L"Password: " << (password.empty() ? L"<未设置>" : L"******") << std::endl;
             std::wcout << L"CampusAccount: " << campusAccount << std::endl;
             std::wcout << L"CampusPassword: " << (campusPassword.empty() ? L"<未设置>" : L"******") << std::endl;
+            if (!portalBaseUrl.empty()) {
+                std::wcout << L"Portal: " << portalBaseUrl << std::endl;
+            }
 
             WifiService service;
             service.SetServiceName(SERVICE_NAME);
             service.SetTargetWifi(ssid, password);
             service.SetCampusNetworkCredentials(campusAccount, campusPassword);
+            service.SetPortalBaseUrl(portalBaseUrl);
             
             if (service.Start()) {
                 std::wcout << L"服务已启动，按Ctrl+C停止...\n";
                 
                 // 等待用户中断
+                static HANDLE consoleStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
                 SetConsoleCtrlHandler([](DWORD ctrlType) -> BOOL {
+                    SetEvent(consoleStopEvent);
                     return TRUE;
                 }, TRUE);
                 
-                // 阻塞主线程
-                Sleep(INFINITE);
+                // 阻塞主线程，直到用户按下Ctrl+C
+                WaitForSingleObject(consoleStopEvent, INFINITE);
+                service.Stop();
                 return 0;
             } else {
                 std::wcout << L"服务启动失败\n";
                 return 1;
             }
         }
+        // 网关模式：代多台设备登录校园网
+        else if (command == L"gateway") {
+            if (argc < 3) {
+                std::wcout << L"错误: 需要指定客户端列表文件\n";
+                PrintHelp();
+                return 1;
+            }
+            
+            std::wstring wifiPassword, campusAccount, campusPassword, portalBaseUrl;
+            ParseCommandLineArgs(argc, argv, wifiPassword, campusAccount, campusPassword, portalBaseUrl);
+            
+            GatewayCommandOptions options;
+            ParseGatewayOptions(argc, argv, options);
+            
+            std::vector<GatewayClient> clients;
+            if (!GatewayLoginEngine::LoadClients(argv[2], campusAccount, campusPassword, clients)) {
+                return 1;
+            }
+            
+            NetworkRequester requester;
+            if (!InitializeGatewayRequester(requester, options)) {
+                return 1;
+            }
+            
+            // 先查询会话状态，确认已在线的客户端不再登录；状态未知的客户端照常登录，
+            // 真实的认证服务器按请求的来源地址返回状态，从网关查询时除网关自己以外都是未知
+            if (options.sweepFirst) {
+                SessionSweeper sweeper(requester);
+                sweeper.SetOptions(options.sweep);
+                SessionSweepReport sweep = sweeper.Run(GatewayLoginEngine::ClientIPs(clients), &ConsoleStopToken());
+                
+                size_t total = clients.size();
+                clients = GatewayLoginEngine::SelectForLogin(clients, sweep);
+                std::wcout << L"查询" << total << L"个客户端的会话状态，耗时" << sweep.elapsedMs
+                           << L"毫秒，" << (total - clients.size()) << L"个已在线，其余" << clients.size() << L"个需要登录\n";
+                size_t mismatched = SessionSweeper::CountMismatched(sweep);
+                if (mismatched > 0) {
+                    std::wcout << L"其中" << mismatched << L"个客户端的查询结果是其他地址的状态（认证服务器按请求的来源地址返回状态），"
+                               << L"按状态未知登录\n";
+                }
+                if (sweep.cancelled) {
+                    return 1;
+                }
+            }
+            
+            GatewayLoginEngine engine(requester);
+            engine.SetOptions(options.login);
+            std::wcout << L"为" << clients.size() << L"个客户端登录，并发数" << options.login.parallelism
+                       << L"，每个客户端最多尝试" << options.login.maxAttempts << L"次\n";
+            
+            GatewayLoginReport report = engine.Run(clients, &ConsoleStopToken());
+            GatewayLoginEngine::PrintReport(clients, report, std::wcout);
+            
+            for (const GatewayLoginOutcome& outcome : report.outcomes) {
+                if (outcome.result != NetworkRequester::LoginResult::Success &&
+                    outcome.result != NetworkRequester::LoginResult::AlreadyOnline) {
+                    return 1;
+                }
+            }
+            return 0;
+        }
+        // 批量查询会话状态
+        else if (command == L"sweep") {
+            if (argc < 3) {
+                std::wcout << L"错误: 需要指定客户端列表文件\n";
+                PrintHelp();
+                return 1;
+            }
+            
+            GatewayCommandOptions options;
+            ParseGatewayOptions(argc, argv, options);
+            
+            std::vector<GatewayClient> clients;
+            if (!GatewayLoginEngine::LoadClients(argv[2], L"", L"", clients, false)) {
+                return 1;
+            }
+            
+            NetworkRequester requester;
+            if (!InitializeGatewayRequester(requester, options)) {
+                return 1;
+            }
+            
+            SessionSweeper sweeper(requester);
+            sweeper.SetOptions(options.sweep);
+            std::vector<std::wstring> ips = GatewayLoginEngine::ClientIPs(clients);
+            SessionSweepReport report = sweeper.Run(ips, &ConsoleStopToken());
+            SessionSweeper::PrintTable(ips, report, std::wcout);
+            return report.cancelled ? 1 : 0;
+        }
         // 作为服务运行
         else if (command == L"service") {
             SERVICE_TABLE_ENTRYW serviceTable[] = {
@@ -0,0 +1,204 @@
+﻿#include "../include/metrics.h"
+#include <sstream>
+
+namespace {
+
+// 最高有效位的位置（value不为0）
+int HighestBit(uint64_t value) {
+    int bit = 0;
+    for (int step = 32; step > 0; step >>= 1) {
+        if (value >> step) {
+            value >>= step;
+            bit += step;
+        }
+    }
+    return bit;
+}
+
+// 拼接标签，两者都可以为空
+std::string JoinLabels(const std::string& labels, const std::string& extra) {
+    if (labels.empty() && extra.empty()) {
+        return "";
+    }
+    if (labels.empty()) {
+        return "{" + extra + "}";
+    }
+    if (extra.empty()) {
+        return "{" + labels + "}";
+    }
+    return "{" + labels + "," + extra + "}";
+}
+
+} // namespace
+
+MetricHistogram::MetricHistogram() : m_count(0), m_sum(0), m_max(0) {
+    for (size_t i = 0; i < kBucketCount; i++) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t MetricHistogram::BucketIndex(uint64_t value) {
+    if (value < kLinearBuckets) {
+        return static_cast<size_t>(value);
+    }
+    
+    // 取最高位之后的3位作为桶内序号
+    int msb = HighestBit(value);
+    int shift = msb - kSubBucketBits;
+    size_t sub = static_cast<size_t>((value >> shift) & (kSubBuckets - 1));
+    return kLinearBuckets + static_cast<size_t>(msb - kLinearBits) * kSubBuckets + sub;
+}
+
+uint64_t MetricHistogram::BucketUpperBound(size_t index) {
+    if (index < kLinearBuckets) {
+        return index;
+    }
+    
+    size_t offset = index - kLinearBuckets;
+    int msb = static_cast<int>(offset / kSubBuckets) + kLinearBits;
+    uint64_t sub = offset % kSubBuckets;
+    int shift = msb - kSubBucketBits;
+    
+    // 最高的桶上界为2^64-1，无符号回绕正好得到这个值
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void MetricHistogram::Record(uint64_t value) {
+    m_buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    
+    uint64_t current = m_max.load(std::memory_order_relaxed);
+    while (value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t MetricHistogram::Percentile(double quantile) const {
+    // 先复制各桶的计数，总数以复制结果为准，避免与并发记录不一致
+    uint64_t counts[kBucketCount];
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    
+    if (total == 0) {
+        return 0;
+    }
+    
+    if (quantile < 0.0) {
+        quantile = 0.0;
+    } else if (quantile > 1.0) {
+        quantile = 1.0;
+    }
+    
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    
+    uint64_t maxValue = Max();
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t upper = BucketUpperBound(i);
+            return upper < maxValue ? upper : maxValue;
+        }
+    }
+    
+    return maxValue;
+}
+
+MetricsRegistry& MetricsRegistry::Instance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+MetricCounter& MetricsRegistry::Counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    Family& family = m_families[name];
+    if (family.help.empty()) {
+        family.help = help;
+    }
+    
+    std::unique_ptr<MetricCounter>& counter = family.counters[labels];
+    if (!counter) {
+        counter.reset(new MetricCounter());
+    }
+    return *counter;
+}
+
+MetricHistogram& MetricsRegistry::Histogram(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    Family& family = m_families[name];
+    if (family.help.empty()) {
+        family.help = help;
+    }
+    family.isHistogram = true;
+    
+    std::unique_ptr<MetricHistogram>& histogram = family.histograms[labels];
+    if (!histogram) {
+        histogram.reset(new MetricHistogram());
+    }
+    return *histogram;
+}
+
+std::string MetricsRegistry::ExportPrometheus() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    std::ostringstream out;
+    for (const auto& entry : m_families) {
+        const std::string& name = entry.first;
+        const Family& family = entry.second;
+        
+        if (!family.isHistogram) {
+            out << "# HELP " << name << " " << family.help << "\n";
+            out << "# TYPE " << name << " counter\n";
+            for (const auto& counter : family.counters) {
+                out << name << JoinLabels(counter.first, "") << " " << counter.second->Value() << "\n";
+            }
+            continue;
+        }
+        
+        out << "# HELP " << name << " " << family.help << "\n";
+        out << "# TYPE " << name << " summary\n";
+        for (const auto& histogram : family.histograms) {
+            const std::string& labels = histogram.first;
+            const MetricHistogram& h = *histogram.second;
+            out << name << JoinLabels(labels, "quantile=\"0.5\"") << " " << h.Percentile(0.5) << "\n";
+            out << name << JoinLabels(labels, "quantile=\"0.9\"") << " " << h.Percentile(0.9) << "\n";
+            out << name << JoinLabels(labels, "quantile=\"0.99\"") << " " << h.Percentile(0.99) << "\n";
+            out << name << "_sum" << JoinLabels(labels, "") << " " << h.Sum() << "\n";
+            out << name << "_count" << JoinLabels(labels, "") << " " << h.Count() << "\n";
+        }
+        
+        // 最大值单独作为gauge导出，summary本身没有最大值
+        out << "# HELP " << name << "_max Largest observed value of " << name << "\n";
+        out << "# TYPE " << name << "_max gauge\n";
+        for (const auto& histogram : family.histograms) {
+            out << name << "_max" << JoinLabels(histogram.first, "") << " " << histogram.second->Max() << "\n";
+        }
+    }
+    
+    return out.str();
+}
+
+std::string MetricsRegistry::EscapeLabelValue(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\') {
+            escaped += "\\\\";
+        } else if (c == '"') {
+            escaped += "\\\"";
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
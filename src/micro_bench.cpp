@@ -0,0 +1,500 @@
+﻿#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <regex>
+#include <atomic>
+#include <new>
+#include <cstring>
+#include <cwchar>
+#include <clocale>
+#include <cstdlib>
+#include "../include/portal_response.h"
+#include "../include/connection_state_machine.h"
+#include "../include/response_body_reader.h"
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include "../include/network_requester.h"
+#include "../include/wifi_manager.h"
+#endif
+
+// 热点辅助函数的微基准测试
+// 每个重连周期都会执行的辅助函数（解析URL、构建登录地址、读取响应体和提取用户IP（同时测量之前的实现作为对比）、生成WiFi配置文件、
+// 转换SSID和响应体编码、状态机转换）分别测量每次调用的耗时和内存分配次数，耗时可以保存为基线并在修改后检查是否变慢。
+// 依赖Windows API的测试只在Windows上运行，解析器、响应体读取和状态机的测试在任何平台上都可以运行
+
+// 统计全局内存分配次数
+namespace {
+std::atomic<size_t> g_allocations{ 0 };
+}
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+// 防止被测调用的结果被优化掉
+volatile size_t g_sink = 0;
+
+// 一个基准测试：body执行iterations次被测调用
+struct Benchmark {
+    const char* name;
+    std::function<void(int iterations)> body;
+};
+
+// 一个基准测试的结果（纳秒/次，分配次数/次）
+struct BenchResult {
+    double medianNs;
+    double minNs;
+    double allocations;
+};
+
+// 基准测试选项
+struct BenchOptions {
+    int samples = 15;                   // 每个基准测试的采样次数
+    int sampleMs = 20;                  // 每次采样的最短时间
+    std::wstring filter;                // 只运行名称包含该字符串的测试
+    std::wstring savePath;              // 保存基线的文件
+    std::wstring checkPath;             // 用于检查的基线文件
+    double maxRegressionPercent = 10.0; // 比基线慢超过该比例视为退化
+};
+
+// 测试数据：与真实认证服务器的地址和响应一致
+const wchar_t kLoginUrl[] = L"https://login.csust.edu.cn:802/eportal/portal/login";
+
+const char kChkstatusBody[] =
+    "dr1002({\"result\":1,\"aolno\":0,\"m46\":0,\"v46ip\":\"10.71.32.118\",\"myv6ip\":\"\","
+    "\"sms\":0,\"NID\":\"\",\"olmac\":\"a4b1c1d2e3f4\",\"ollm\":0,"
+    "\"olm1\":\"00000800\",\"olm2\":\"0000\",\"olm3\":0,\"olmm\":2,\"olm5\":0,\"gid\":1,\"ispid\":0,"
+    "\"opip\":\"0.0.0.0\",\"oltime\":4294967295,\"olflow\":4294967295,\"lip\":\"10.71.32.118\","
+    "\"uid\":\"202301010101\",\"v4ip\":\"10.71.32.118\"})";
+
+// 带中文提示信息的登录响应，用于测量响应体的编码转换
+const char kLoginBody[] =
+    u8"dr1003({\"result\":0,\"msg\":\"账号或密码错误，请重新输入。如忘记密码请联系网络中心\","
+    u8"\"ret_code\":1,\"uid\":\"202301010101\",\"v46ip\":\"10.71.32.118\",\"NID\":\"长沙理工大学\"})";
+
+// 读取响应体的测试：约16KB的响应体按以太网报文的大小（1460字节）分块到达
+const size_t kResponseChunkSize = 1460;
+
+std::string CreateResponseBody() {
+    std::string body;
+    while (body.size() < 16 * 1024) {
+        body += kLoginBody;
+    }
+    return body;
+}
+
+void PrintUsage() {
+    std::wcout << L"用法: micro_bench [选项]\n"
+               << L"  --filter <名称>           只运行名称包含该字符串的测试\n"
+               << L"  --samples <次数>          每个测试的采样次数，默认15\n"
+               << L"  --sample-ms <毫秒>        每次采样的最短时间，默认20\n"
+               << L"  --save <文件>             把结果保存为基线\n"
+               << L"  --check <文件>            与基线比较，有测试变慢超过阈值或没有基线时返回1\n"
+               << L"  --max-regression <百分比> 允许比基线慢的比例，默认10\n";
+}
+
+// 把UTF-8转换为宽字符串：Windows上与服务一样使用Utf8ToWide，其他平台使用解析器的解码函数
+std::wstring ToWide(const std::string& utf8) {
+#ifdef _WIN32
+    return NetworkRequester::Utf8ToWide(utf8);
+#else
+    return PortalResponseParser::DecodeString(utf8);
+#endif
+}
+
+bool ParseOptions(const std::vector<std::wstring>& args, BenchOptions& options) {
+    for (size_t i = 1; i < args.size(); i++) {
+        const std::wstring& arg = args[i];
+        if (i + 1 >= args.size()) {
+            return false;
+        }
+        const std::wstring& value = args[++i];
+        if (arg == L"--filter") {
+            options.filter = value;
+        } else if (arg == L"--samples") {
+            options.samples = (int)wcstol(value.c_str(), nullptr, 10);
+        } else if (arg == L"--sample-ms") {
+            options.sampleMs = (int)wcstol(value.c_str(), nullptr, 10);
+        } else if (arg == L"--save") {
+            options.savePath = value;
+        } else if (arg == L"--check") {
+            options.checkPath = value;
+        } else if (arg == L"--max-regression") {
+            options.maxRegressionPercent = wcstod(value.c_str(), nullptr);
+        } else {
+            return false;
+        }
+    }
+    return options.samples > 0 && options.sampleMs > 0 && options.maxRegressionPercent >= 0;
+}
+
+// 所有基准测试
+std::vector<Benchmark> CreateBenchmarks() {
+    std::vector<Benchmark> benchmarks;
+    
+#ifdef _WIN32
+    benchmarks.push_back({ "ParseUrl", [](int iterations) {
+        std::wstring url = NetworkRequester::BuildLoginUrl(kLoginUrl, L"202301010101", L"Passw0rd!",
+                                                           L"10.71.32.118", L"000000000000");
+        std::wstring hostName;
+        std::wstring urlPath;
+        INTERNET_SCHEME scheme;
+        INTERNET_PORT port;
+        for (int i = 0; i < iterations; i++) {
+            WinHttpTransport::ParseUrl(url, hostName, urlPath, scheme, port);
+            g_sink += urlPath.size();
+        }
+    } });
+    
+    benchmarks.push_back({ "BuildLoginUrl", [](int iterations) {
+        std::wstring loginUrl = kLoginUrl;
+        std::wstring account = L"202301010101";
+        std::wstring password = L"Passw0rd!";
+        std::wstring userIP = L"10.71.32.118";
+        std::wstring userMac = L"000000000000";
+        for (int i = 0; i < iterations; i++) {
+            g_sink += NetworkRequester::BuildLoginUrl(loginUrl, account, password, userIP, userMac).size();
+        }
+    } });
+    
+#endif
+    
+    // 与SendHttpRequest相同：按Content-Length预留响应体空间，每块数据读入复用的接收缓冲区后追加，最后整体转换编码
+    benchmarks.push_back({ "ResponseBody.Read", [](int iterations) {
+        std::string data = CreateResponseBody();
+        ResponseBodyReader::Consumer consumer;
+        for (int i = 0; i < iterations; i++) {
+            std::string body;
+            ResponseBodyReader reader(1024 * 1024, consumer, body);
+            reader.Reserve(data.size());
+            size_t offset = 0;
+            char* buffer = nullptr;
+            size_t capacity = 0;
+            while (reader.NextBuffer(buffer, capacity)) {
+                size_t length = std::min(std::min(capacity, kResponseChunkSize), data.size() - offset);
+                memcpy(buffer, data.data() + offset, length);
+                offset += length;
+                if (!reader.Commit(length)) {
+                    break;
+                }
+            }
+            g_sink += ToWide(body).size();
+        }
+    } });
+    
+    // 之前的读取循环：每块数据分配并清零一块缓冲区，单独转换编码后追加到不断增长的宽字符串，用于对比
+    benchmarks.push_back({ "ResponseBody.PerChunk", [](int iterations) {
+        std::string data = CreateResponseBody();
+        for (int i = 0; i < iterations; i++) {
+            std::wstring response;
+            size_t offset = 0;
+            while (offset < data.size()) {
+                size_t length = std::min(kResponseChunkSize, data.size() - offset);
+                char* chunk = new char[length + 1];
+                memset(chunk, 0, length + 1);
+                memcpy(chunk, data.data() + offset, length);
+                offset += length;
+                response += ToWide(std::string(chunk, length));
+                delete[] chunk;
+            }
+            g_sink += response.size();
+        }
+    } });
+    
+    // 与GetUserIP相同：解析dr1002响应后把v46ip转换为宽字符串
+    benchmarks.push_back({ "GetUserIP.v46ip", [](int iterations) {
+        std::string body = kChkstatusBody;
+        for (int i = 0; i < iterations; i++) {
+            PortalResponse status;
+            if (PortalResponseParser::Parse(body, status) && !status.v46ip.empty()) {
+                g_sink += ToWide(std::string(status.v46ip)).size();
+            }
+        }
+    } });
+    
+    // 解析器之前的实现：把整个响应体转换为宽字符串后用正则表达式提取v46ip，用于对比
+    benchmarks.push_back({ "GetUserIP.regex", [](int iterations) {
+        std::string body = kChkstatusBody;
+        for (int i = 0; i < iterations; i++) {
+            std::wstring response = ToWide(body);
+            std::wregex ipRegex(L"\"v46ip\":\\s*\"([^\"]+)\"");
+            std::wsmatch matches;
+            if (std::regex_search(response, matches, ipRegex) && matches.size() > 1) {
+                g_sink += matches[1].str().size();
+            }
+        }
+    } });
+    
+#ifdef _WIN32
+    benchmarks.push_back({ "CreateProfileXml", [](int iterations) {
+        WLAN_AVAILABLE_NETWORK network = {};
+        network.dot11BssType = dot11_BSS_type_infrastructure;
+        network.dot11DefaultAuthAlgorithm = DOT11_AUTH_ALGO_RSNA_PSK;
+        network.dot11DefaultCipherAlgorithm = DOT11_CIPHER_ALGO_CCMP;
+        std::wstring ssid = L"CSUST-Student";
+        std::wstring password = L"Passw0rd!";
+        for (int i = 0; i < iterations; i++) {
+            g_sink += WifiManager::CreateProfileXml(ssid, password, network).size();
+        }
+    } });
+    
+    benchmarks.push_back({ "ConvertSSIDToString", [](int iterations) {
+        DOT11_SSID ssid = {};
+        const char name[] = "CSUST-Student";
+        ssid.uSSIDLength = sizeof(name) - 1;
+        memcpy(ssid.ucSSID, name, ssid.uSSIDLength);
+        for (int i = 0; i < iterations; i++) {
+            g_sink += WifiManager::ConvertSSIDToString(ssid).size();
+        }
+    } });
+    
+    benchmarks.push_back({ "Utf8ToWide", [](int iterations) {
+        std::string body = kLoginBody;
+        for (int i = 0; i < iterations; i++) {
+            g_sink += NetworkRequester::Utf8ToWide(body).size();
+        }
+    } });
+    
+    benchmarks.push_back({ "WideToUtf8", [](int iterations) {
+        std::wstring text = NetworkRequester::Utf8ToWide(kLoginBody);
+        for (int i = 0; i < iterations; i++) {
+            g_sink += NetworkRequester::WideToUtf8(text).size();
+        }
+    } });
+    
+#endif
+    
+    // 一个完整的重连周期：断开、扫描、连接、获取地址、探测到需要认证、登录成功，每次调用一步
+    benchmarks.push_back({ "StateMachine.Step", [](int iterations) {
+        const ConnectionEventType cycle[] = {
+            ConnectionEventType::LinkDown,
+            ConnectionEventType::ScanDone,
+            ConnectionEventType::LinkUp,
+            ConnectionEventType::AddressReady,
+            ConnectionEventType::ProbePortal,
+            ConnectionEventType::LoginSucceeded
+        };
+        const int cycleLength = (int)(sizeof(cycle) / sizeof(cycle[0]));
+        ConnectionPolicy policy;
+        ConnectionContext context;
+        context.state = ConnectionState::Online;
+        context.hasCredentials = true;
+        uint64_t now = 0;
+        for (int i = 0; i < iterations; i++) {
+            // 每步推进超过登录保持时间，探测到需要认证时总是立即登录
+            now += policy.loginHoldMs + 1;
+            ConnectionEvent event = { cycle[i % cycleLength], now };
+            ConnectionTransition transition = ConnectionStateMachine::Step(context, event, policy);
+            context = transition.context;
+            g_sink += (size_t)transition.action;
+        }
+    } });
+    
+    return benchmarks;
+}
+
+// 运行一次采样，返回每次调用的纳秒数
+double RunSample(const Benchmark& benchmark, int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    benchmark.body(iterations);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations;
+}
+
+// 先确定每次采样的调用次数（使一次采样至少持续sampleMs），再多次采样取中位数和最小值
+BenchResult RunBenchmark(const Benchmark& benchmark, const BenchOptions& options) {
+    const double targetNs = options.sampleMs * 1e6;
+    const double maxIterations = (double)(1 << 30);
+    int iterations = 1;
+    while (iterations < (1 << 30)) {
+        double ns = RunSample(benchmark, iterations) * iterations;
+        if (ns >= targetNs) {
+            break;
+        }
+        // 按已测得的耗时估算，每轮最多放大10倍
+        double scale = ns > 0 ? targetNs / ns * 1.2 : 10.0;
+        iterations = (int)std::min(iterations * std::min(std::max(scale, 2.0), 10.0), maxIterations);
+    }
+    
+    std::vector<double> samples;
+    size_t allocationsBefore = g_allocations.load();
+    for (int i = 0; i < options.samples; i++) {
+        samples.push_back(RunSample(benchmark, iterations));
+    }
+    size_t allocations = g_allocations.load() - allocationsBefore;
+    std::sort(samples.begin(), samples.end());
+    
+    // 分配次数包括测试准备数据的分配，按总调用次数平均后可以忽略
+    BenchResult result;
+    result.medianNs = samples[samples.size() / 2];
+    result.minNs = samples.front();
+    result.allocations = (double)allocations / ((double)iterations * options.samples);
+    return result;
+}
+
+// 读取基线文件：每行为“名称 纳秒”，#开头的行为注释
+bool LoadBaseline(const std::wstring& path, std::map<std::string, double>& baseline) {
+    std::ifstream file(std::filesystem::path(path), std::ios::in);
+    if (!file) {
+        return false;
+    }
+    
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string name;
+        double ns = 0;
+        if (fields >> name >> ns) {
+            baseline[name] = ns;
+        }
+    }
+    return true;
+}
+
+// 保存基线文件
+bool SaveBaseline(const std::wstring& path, const std::vector<std::pair<std::string, BenchResult>>& results) {
+    std::ofstream file(std::filesystem::path(path), std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    
+    file << u8"# micro_bench基线：每次调用的耗时中位数（纳秒），由 micro_bench --save 生成\n";
+    file << u8"# 只与同一台机器上Release构建的结果比较才有意义\n";
+    for (const auto& entry : results) {
+        file << entry.first << " " << std::fixed << std::setprecision(1) << entry.second.medianNs << "\n";
+    }
+    return file.good();
+}
+
+} // namespace
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[]) {
+    _setmode(_fileno(stdout), _O_U8TEXT);
+    _setmode(_fileno(stderr), _O_U8TEXT);
+    std::vector<std::wstring> args(argv, argv + argc);
+#else
+int main(int argc, char* argv[]) {
+    setlocale(LC_ALL, "");
+    std::vector<std::wstring> args;
+    for (int i = 0; i < argc; i++) {
+        std::wstring arg(strlen(argv[i]), L'\0');
+        size_t length = mbstowcs(&arg[0], argv[i], arg.size());
+        arg.resize(length == (size_t)-1 ? 0 : length);
+        args.push_back(arg);
+    }
+#endif
+    
+    BenchOptions options;
+    if (!ParseOptions(args, options)) {
+        PrintUsage();
+        return 2;
+    }
+    
+    std::map<std::string, double> baseline;
+    if (!options.checkPath.empty() && !LoadBaseline(options.checkPath, baseline)) {
+        std::wcerr << L"无法读取基线文件: " << options.checkPath << std::endl;
+        return 2;
+    }
+    
+#ifdef _WIN32
+    // 固定在一个处理器上运行，减少线程迁移带来的波动
+    SetThreadAffinityMask(GetCurrentThread(), 1);
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+#endif
+    
+    std::wcout << std::left << std::setw(24) << L"测试" << std::right
+               << std::setw(12) << L"中位数(ns)" << std::setw(12) << L"最小值(ns)" << std::setw(10) << L"分配(次)";
+    if (!options.checkPath.empty()) {
+        std::wcout << std::setw(12) << L"基线(ns)" << std::setw(10) << L"变化";
+    }
+    std::wcout << L"\n";
+    
+    std::vector<std::pair<std::string, BenchResult>> results;
+    int regressions = 0;
+    int missingBaselines = 0;
+    for (const Benchmark& benchmark : CreateBenchmarks()) {
+        std::wstring name(benchmark.name, benchmark.name + strlen(benchmark.name));
+        if (!options.filter.empty() && name.find(options.filter) == std::wstring::npos) {
+            continue;
+        }
+        
+        BenchResult result = RunBenchmark(benchmark, options);
+        
+        std::wcout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+                   << std::setw(12) << result.medianNs << std::setw(12) << result.minNs
+                   << std::setw(10) << result.allocations;
+        
+        if (!options.checkPath.empty()) {
+            auto it = baseline.find(benchmark.name);
+            if (it == baseline.end() || it->second <= 0) {
+                // 没有基线时无法判断是否退化，检查不能算通过
+                std::wcout << std::setw(12) << L"-" << std::setw(10) << L"无基线";
+                missingBaselines++;
+            } else {
+                // 超过阈值时重新测量一次，两次都超过才算退化，避免偶发的干扰导致误报
+                double limit = it->second * (1.0 + options.maxRegressionPercent / 100.0);
+                if (result.medianNs > limit) {
+                    BenchResult retry = RunBenchmark(benchmark, options);
+                    if (retry.medianNs < result.medianNs) {
+                        result = retry;
+                    }
+                }
+                double change = (result.medianNs / it->second - 1.0) * 100.0;
+                std::wcout << std::setw(12) << it->second << std::setw(9) << std::showpos << change
+                           << std::noshowpos << L"%";
+                if (result.medianNs > limit) {
+                    std::wcout << L"  退化";
+                    regressions++;
+                }
+            }
+        }
+        std::wcout << std::endl;
+        results.emplace_back(benchmark.name, result);
+    }
+    
+    if (!options.savePath.empty()) {
+        if (!SaveBaseline(options.savePath, results)) {
+            std::wcerr << L"无法写入基线文件: " << options.savePath << std::endl;
+            return 2;
+        }
+        std::wcout << L"基线已保存到 " << options.savePath << std::endl;
+    }
+    
+    if (missingBaselines > 0) {
+        std::wcout << missingBaselines << L"个测试在基线文件中没有记录或记录为0，先在参考机器上用 --save 记录" << std::endl;
+    }
+    if (regressions > 0) {
+        std::wcout << regressions << L"个测试比基线慢" << options.maxRegressionPercent << L"%以上" << std::endl;
+    }
+    return (regressions > 0 || missingBaselines > 0) ? 1 : 0;
+}
@@ -0,0 +1,720 @@
+﻿#include "../include/mock_portal.h"
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+typedef SOCKET NativeSocket;
+const int kSendFlags = 0;
+
+void CloseSocket(NativeSocket socket) {
+    closesocket(socket);
+}
+
+// 每个进程初始化一次Winsock
+bool InitializeSockets() {
+    static bool initialized = []() {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return initialized;
+}
+#else
+typedef int NativeSocket;
+const NativeSocket INVALID_SOCKET = -1;
+const int kSendFlags = MSG_NOSIGNAL;
+
+void CloseSocket(NativeSocket socket) {
+    close(socket);
+}
+
+bool InitializeSockets() {
+    return true;
+}
+#endif
+
+const uintptr_t kNoSocket = (uintptr_t)INVALID_SOCKET;
+
+// 等待套接字可读，超时返回false
+bool WaitReadable(NativeSocket socket, uint32_t timeoutMs) {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(socket, &readSet);
+    timeval timeout;
+    timeout.tv_sec = (long)(timeoutMs / 1000);
+    timeout.tv_usec = (long)((timeoutMs % 1000) * 1000);
+    return select((int)socket + 1, &readSet, NULL, NULL, &timeout) > 0;
+}
+
+// 发送全部数据
+bool SendAll(NativeSocket socket, const char* data, size_t length) {
+    while (length > 0) {
+        int sent = send(socket, data, (int)length, kSendFlags);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+// 不区分大小写比较HTTP头名称
+bool HeaderNameEquals(const std::string& a, const char* b) {
+    size_t length = strlen(b);
+    if (a.size() != length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* ReasonPhrase(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 302: return "Found";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+// 把JSON字符串中需要转义的字符转义
+std::string JsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned char)c);
+            escaped += buffer;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// 请求头最大长度
+const size_t kMaxHeaderBytes = 16 * 1024;
+
+// 空闲的长连接保持时间
+const uint32_t kIdleTimeoutMs = 30000;
+
+// 当前线程是否属于模拟认证服务器
+thread_local bool t_serverThread = false;
+
+} // namespace
+
+MockPortal::MockPortal() :
+    m_listenSocket(kNoSocket),
+    m_port(0),
+    m_stopping(false),
+    m_maxSessionsPerAccount(0),
+    m_chkstatusByParam(false),
+    m_connectionCount(0),
+    m_requestCount(0),
+    m_chkstatusCount(0),
+    m_loginCount(0),
+    m_loginSucceededCount(0),
+    m_probeCount(0),
+    m_faultCount(0),
+    m_bytesReceived(0),
+    m_bytesSent(0) {
+}
+
+MockPortal::~MockPortal() {
+    Stop();
+}
+
+bool MockPortal::Start(uint16_t port, const std::string& bindAddress) {
+    Stop();
+    
+    if (!InitializeSockets()) {
+        std::cerr << "初始化套接字失败" << std::endl;
+        return false;
+    }
+    
+    NativeSocket listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        std::cerr << "创建套接字失败" << std::endl;
+        return false;
+    }
+    
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, bindAddress.c_str(), &address.sin_addr) != 1) {
+        std::cerr << "无效的监听地址: " << bindAddress << std::endl;
+        CloseSocket(listenSocket);
+        return false;
+    }
+    
+    if (bind(listenSocket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 256) != 0) {
+        std::cerr << "无法监听 " << bindAddress << ":" << port << std::endl;
+        CloseSocket(listenSocket);
+        return false;
+    }
+    
+    // 端口为0时取得系统分配的端口
+    socklen_t addressLength = sizeof(address);
+    getsockname(listenSocket, (sockaddr*)&address, &addressLength);
+    
+    m_listenSocket = (uintptr_t)listenSocket;
+    m_bindAddress = bindAddress;
+    m_port = ntohs(address.sin_port);
+    m_stopping = false;
+    m_acceptThread = std::thread(&MockPortal::AcceptLoop, this);
+    return true;
+}
+
+void MockPortal::Stop() {
+    if (!m_acceptThread.joinable()) {
+        return;
+    }
+    
+    // 接受线程和连接线程都以短超时轮询，看到停止标志后自行退出
+    m_stopping = true;
+    m_acceptThread.join();
+    ReapConnections(true);
+    
+    CloseSocket((NativeSocket)m_listenSocket);
+    m_listenSocket = kNoSocket;
+}
+
+std::string MockPortal::GetBaseUrl() const {
+    return "http://" + m_bindAddress + ":" + std::to_string(m_port);
+}
+
+void MockPortal::SetFaults(MockEndpoint endpoint, const MockPortalFaults& faults) {
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    m_faults[(int)endpoint] = faults;
+}
+
+void MockPortal::AddAccount(const std::string& account, const std::string& password) {
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    m_accounts[account] = password;
+}
+
+void MockPortal::SetMaxSessionsPerAccount(uint32_t maxSessions) {
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    m_maxSessionsPerAccount = maxSessions;
+}
+
+void MockPortal::SetChkstatusByParam(bool enabled) {
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    m_chkstatusByParam = enabled;
+}
+
+void MockPortal::ClearSessions() {
+    std::lock_guard<std::mutex> lock(m_sessionsMutex);
+    m_sessions.clear();
+}
+
+bool MockPortal::IsOnline(const std::string& ip) const {
+    std::lock_guard<std::mutex> lock(m_sessionsMutex);
+    return m_sessions.find(ip) != m_sessions.end();
+}
+
+MockPortalStats MockPortal::GetStats() const {
+    MockPortalStats stats;
+    stats.connections = m_connectionCount.load();
+    stats.requests = m_requestCount.load();
+    stats.chkstatusRequests = m_chkstatusCount.load();
+    stats.loginRequests = m_loginCount.load();
+    stats.loginSucceeded = m_loginSucceededCount.load();
+    stats.probeRequests = m_probeCount.load();
+    stats.faultsInjected = m_faultCount.load();
+    stats.bytesReceived = m_bytesReceived.load();
+    stats.bytesSent = m_bytesSent.load();
+    {
+        std::lock_guard<std::mutex> lock(m_sessionsMutex);
+        stats.sessions = m_sessions.size();
+    }
+    return stats;
+}
+
+std::string MockPortal::UrlDecode(const std::string& text) {
+    std::string decoded;
+    decoded.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c == '+') {
+            decoded += ' ';
+        } else if (c == '%' && i + 2 < text.size() && isxdigit((unsigned char)text[i + 1]) && isxdigit((unsigned char)text[i + 2])) {
+            decoded += (char)std::stoi(text.substr(i + 1, 2), nullptr, 16);
+            i += 2;
+        } else {
+            decoded += c;
+        }
+    }
+    return decoded;
+}
+
+std::string MockPortal::QueryParam(const std::string& query, const std::string& name) {
+    size_t begin = 0;
+    while (begin <= query.size()) {
+        size_t end = query.find('&', begin);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        size_t equals = query.find('=', begin);
+        if (equals != std::string::npos && equals < end && query.compare(begin, equals - begin, name) == 0 &&
+            equals - begin == name.size()) {
+            return UrlDecode(query.substr(equals + 1, end - equals - 1));
+        }
+        begin = end + 1;
+    }
+    return std::string();
+}
+
+bool MockPortal::IsServerThread() {
+    return t_serverThread;
+}
+
+void MockPortal::AcceptLoop() {
+    t_serverThread = true;
+    NativeSocket listenSocket = (NativeSocket)m_listenSocket;
+    uint32_t seed = std::random_device()();
+    
+    while (!m_stopping) {
+        ReapConnections(false);
+        if (!WaitReadable(listenSocket, 100)) {
+            continue;
+        }
+        
+        sockaddr_in peer;
+        socklen_t peerLength = sizeof(peer);
+        NativeSocket client = accept(listenSocket, (sockaddr*)&peer, &peerLength);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        
+        int noDelay = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+        
+        char peerText[INET_ADDRSTRLEN] = "";
+        inet_ntop(AF_INET, &peer.sin_addr, peerText, sizeof(peerText));
+        
+        m_connectionCount++;
+        std::unique_ptr<Connection> connection(new Connection());
+        Connection* raw = connection.get();
+        uint32_t connectionSeed = seed + (uint32_t)m_connectionCount.load();
+        raw->thread = std::thread([this, raw, client, peerIp = std::string(peerText), connectionSeed]() {
+            t_serverThread = true;
+            ServeConnection((uintptr_t)client, peerIp, connectionSeed);
+            raw->done = true;
+        });
+        
+        std::lock_guard<std::mutex> lock(m_connectionsMutex);
+        m_connections.push_back(std::move(connection));
+    }
+}
+
+void MockPortal::ReapConnections(bool all) {
+    std::list<std::unique_ptr<Connection>> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_connectionsMutex);
+        for (auto it = m_connections.begin(); it != m_connections.end();) {
+            if (all || (*it)->done) {
+                finished.push_back(std::move(*it));
+                it = m_connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    // 在锁外等待线程结束
+    for (auto& connection : finished) {
+        connection->thread.join();
+    }
+}
+
+void MockPortal::ServeConnection(uintptr_t socketValue, std::string peerIp, uint32_t seed) {
+    NativeSocket socket = (NativeSocket)socketValue;
+    std::mt19937 random(seed);
+    std::string buffer;
+    uint32_t idleMs = 0;
+    bool keepAlive = true;
+    
+    while (keepAlive && !m_stopping) {
+        // 读取完整的请求头（同一连接上可能已经收到了下一个请求）
+        size_t headerEnd = buffer.find("\r\n\r\n");
+        if (headerEnd == std::string::npos) {
+            if (buffer.size() > kMaxHeaderBytes || idleMs >= kIdleTimeoutMs) {
+                break;
+            }
+            if (!WaitReadable(socket, 100)) {
+                idleMs += 100;
+                continue;
+            }
+            char chunk[4096];
+            int received = recv(socket, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                break;
+            }
+            m_bytesReceived += (uint64_t)received;
+            buffer.append(chunk, (size_t)received);
+            idleMs = 0;
+            continue;
+        }
+        
+        // 解析请求行和请求头
+        Request request;
+        request.peerIp = peerIp;
+        std::istringstream lines(buffer.substr(0, headerEnd));
+        std::string line;
+        std::getline(lines, line);
+        std::istringstream requestLine(line);
+        std::string target, version;
+        requestLine >> request.method >> target >> version;
+        size_t question = target.find('?');
+        request.path = target.substr(0, question);
+        request.query = (question == std::string::npos) ? std::string() : target.substr(question + 1);
+        keepAlive = (version == "HTTP/1.1");
+        
+        size_t contentLength = 0;
+        while (std::getline(lines, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            std::string name = line.substr(0, colon);
+            std::string value = line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(' '));
+            if (HeaderNameEquals(name, "Host")) {
+                request.host = value;
+            } else if (HeaderNameEquals(name, "Content-Length")) {
+                contentLength = (size_t)strtoul(value.c_str(), nullptr, 10);
+            } else if (HeaderNameEquals(name, "Connection")) {
+                keepAlive = (value != "close" && value != "Close");
+            }
+        }
+        
+        // 丢弃请求体（认证接口都使用GET）
+        buffer.erase(0, headerEnd + 4);
+        while (buffer.size() < contentLength && !m_stopping) {
+            if (!WaitReadable(socket, 100)) {
+                continue;
+            }
+            char chunk[4096];
+            int received = recv(socket, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                keepAlive = false;
+                break;
+            }
+            m_bytesReceived += (uint64_t)received;
+            buffer.append(chunk, (size_t)received);
+        }
+        buffer.erase(0, contentLength < buffer.size() ? contentLength : buffer.size());
+        
+        m_requestCount++;
+        Response response = Handle(request, random);
+        
+        if (response.drop) {
+            break;
+        }
+        
+        if (response.withhold) {
+            // 直到客户端断开或服务器停止都不回复
+            while (!m_stopping) {
+                if (WaitReadable(socket, 100)) {
+                    char chunk[4096];
+                    if (recv(socket, chunk, sizeof(chunk), 0) <= 0) {
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+        
+        std::ostringstream head;
+        head << "HTTP/1.1 " << response.status << " " << ReasonPhrase(response.status) << "\r\n"
+             << "Server: MockPortal\r\n"
+             << "Content-Type: " << response.contentType << "\r\n"
+             << "Content-Length: " << response.body.size() << "\r\n";
+        if (!response.location.empty()) {
+            head << "Location: " << response.location << "\r\n";
+        }
+        if (!keepAlive || response.truncate) {
+            head << "Connection: close\r\n";
+        }
+        head << "\r\n";
+        
+        std::string data = head.str();
+        if (request.method != "HEAD") {
+            data.append(response.body, 0, response.truncate ? response.body.size() / 2 : response.body.size());
+        }
+        if (!SendAll(socket, data.data(), data.size())) {
+            break;
+        }
+        m_bytesSent += data.size();
+        
+        if (response.truncate) {
+            break;
+        }
+    }
+    
+    CloseSocket(socket);
+}
+
+MockPortal::Response MockPortal::Handle(const Request& request, std::mt19937& random) {
+    MockEndpoint endpoint;
+    if (request.path == "/drcom/chkstatus") {
+        endpoint = MockEndpoint::Chkstatus;
+        m_chkstatusCount++;
+    } else if (request.path == "/eportal/portal/login") {
+        endpoint = MockEndpoint::Login;
+        m_loginCount++;
+    } else if (request.path == "/generate_204" || request.path == "/" || request.path.compare(0, 7, "/probe/") == 0) {
+        endpoint = MockEndpoint::Probe;
+        m_probeCount++;
+    } else {
+        Response notFound;
+        notFound.status = 404;
+        notFound.body = "Not Found";
+        return notFound;
+    }
+    
+    MockPortalFaults faults;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        faults = m_faults[(int)endpoint];
+    }
+    auto roll = [&random](uint32_t percent) {
+        return percent > 0 && random() % 100 < percent;
+    };
+    
+    // 先延迟，再按顺序抽取超时、503、截断和账号密码错误
+    uint32_t delay = faults.latencyMs + (faults.jitterMs > 0 ? random() % (faults.jitterMs + 1) : 0);
+    if (delay > 0 && !Delay(delay)) {
+        Response stopped;
+        stopped.drop = true;
+        return stopped;
+    }
+    
+    if (roll(faults.timeoutPercent)) {
+        m_faultCount++;
+        Response timeout;
+        timeout.withhold = true;
+        return timeout;
+    }
+    
+    if (roll(faults.serverErrorPercent)) {
+        m_faultCount++;
+        Response error;
+        error.status = 503;
+        error.body = "Service Unavailable";
+        return error;
+    }
+    
+    bool truncate = roll(faults.truncatePercent);
+    bool badCredential = (endpoint == MockEndpoint::Login) && roll(faults.badCredentialPercent);
+    if (truncate || badCredential) {
+        m_faultCount++;
+    }
+    
+    Response response;
+    switch (endpoint) {
+    case MockEndpoint::Chkstatus:
+        response = HandleChkstatus(request);
+        break;
+    case MockEndpoint::Login: {
+        // 与真实服务器一样，登录时用wlan_user_ip指定客户端（网关模式），否则按连接的来源地址
+        std::string clientIp = QueryParam(request.query, "wlan_user_ip");
+        if (clientIp.empty()) {
+            clientIp = request.peerIp;
+        }
+        response = HandleLogin(request, clientIp, badCredential);
+        break;
+    }
+    default:
+        response = HandleProbe(request);
+        break;
+    }
+    response.truncate = response.truncate || truncate;
+    return response;
+}
+
+MockPortal::Response MockPortal::HandleChkstatus(const Request& request) {
+    std::string callback = QueryParam(request.query, "callback");
+    if (callback.empty()) {
+        callback = "dr1002";
+    }
+    
+    // 真实服务器忽略wlan_user_ip，总是返回请求来源地址的状态
+    bool byParam;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        byParam = m_chkstatusByParam;
+    }
+    std::string clientIp = byParam ? QueryParam(request.query, "wlan_user_ip") : std::string();
+    if (clientIp.empty()) {
+        clientIp = request.peerIp;
+    }
+    
+    bool online = false;
+    Session session;
+    {
+        std::lock_guard<std::mutex> lock(m_sessionsMutex);
+        auto it = m_sessions.find(clientIp);
+        if (it != m_sessions.end()) {
+            online = true;
+            session = it->second;
+        }
+    }
+    
+    std::string ip = JsonEscape(clientIp);
+    std::ostringstream body;
+    if (online) {
+        body << callback << "({\"result\":1,\"aolno\":0,\"m46\":0,\"v46ip\":\"" << ip << "\",\"myv6ip\":\"\","
+             << "\"sms\":0,\"NID\":\"\",\"olmac\":\"" << JsonEscape(session.mac) << "\",\"ollm\":0,"
+             << "\"olm1\":\"00000800\",\"olm2\":\"0000\",\"olm3\":0,\"olmm\":2,\"olm5\":0,\"gid\":1,\"ispid\":0,"
+             << "\"opip\":\"0.0.0.0\",\"oltime\":4294967295,\"olflow\":4294967295,\"lip\":\"" << ip << "\","
+             << "\"uid\":\"" << JsonEscape(session.account) << "\",\"v4ip\":\"" << ip << "\"})";
+    } else {
+        body << callback << "({\"result\":0,\"wopt\":0,\"msg\":\"\",\"ss5\":\"" << ip << "\",\"ss6\":\"\",\"vid\":0,"
+             << "\"ss1\":\"000000000000\",\"ss4\":\"000000000000\",\"cvid\":0,\"pvid\":0,\"hotel\":0,\"aolno\":0,"
+             << "\"eport\":0,\"eclass\":1,\"v46ip\":\"" << ip << "\",\"myv6ip\":\"\",\"sms\":0,\"NID\":\"\"})";
+    }
+    
+    Response response;
+    response.contentType = "text/javascript; charset=utf-8";
+    response.body = body.str();
+    return response;
+}
+
+MockPortal::Response MockPortal::HandleLogin(const Request& request, const std::string& clientIp, bool forceBadCredential) {
+    std::string callback = QueryParam(request.query, "callback");
+    if (callback.empty()) {
+        callback = "dr1003";
+    }
+    
+    // 账号格式为 ",0,账号"
+    std::string account = QueryParam(request.query, "user_account");
+    if (account.compare(0, 3, ",0,") == 0) {
+        account.erase(0, 3);
+    }
+    std::string password = QueryParam(request.query, "user_password");
+    std::string mac = QueryParam(request.query, "wlan_user_mac");
+    
+    Response response;
+    response.contentType = "text/javascript; charset=utf-8";
+    
+    bool credentialsOk = !account.empty() && !forceBadCredential;
+    uint32_t maxSessions = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        if (credentialsOk && !m_accounts.empty()) {
+            auto it = m_accounts.find(account);
+            credentialsOk = (it != m_accounts.end() && it->second == password);
+        }
+        maxSessions = m_maxSessionsPerAccount;
+    }
+    
+    if (!credentialsOk) {
+        // 真实服务器的错误信息是Base64编码的"ldap auth error"
+        response.body = callback + "({\"result\":0,\"msg\":\"bGRhcCBhdXRoIGVycm9y\",\"ret_code\":1})";
+        return response;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_sessionsMutex);
+    if (m_sessions.find(clientIp) != m_sessions.end()) {
+        response.body = callback + "({\"result\":0,\"msg\":\"IP: " + JsonEscape(clientIp) + " 已经在线！\",\"ret_code\":2})";
+        return response;
+    }
+    
+    if (maxSessions > 0) {
+        uint32_t count = 0;
+        for (const auto& entry : m_sessions) {
+            if (entry.second.account == account) {
+                count++;
+            }
+        }
+        if (count >= maxSessions) {
+            // Base64编码的"inuse user"
+            response.body = callback + "({\"result\":0,\"msg\":\"aW51c2UgdXNlcg==\",\"ret_code\":1})";
+            return response;
+        }
+    }
+    
+    Session session;
+    session.account = account;
+    session.mac = mac;
+    session.loginTime = std::chrono::steady_clock::now();
+    m_sessions[clientIp] = session;
+    m_loginSucceededCount++;
+    
+    response.body = callback + "({\"result\":1,\"msg\":\"Portal协议认证成功！\"})";
+    return response;
+}
+
+MockPortal::Response MockPortal::HandleProbe(const Request& request) {
+    // 探测请求来自客户端本身，按连接的来源地址判断是否已认证
+    bool online = IsOnline(request.peerIp);
+    Response response;
+    
+    if (request.path == "/generate_204") {
+        if (online) {
+            response.status = 204;
+        } else {
+            // 未认证时认证网关把明文HTTP请求重定向到登录页面
+            response.status = 302;
+            response.location = "http://" + (request.host.empty() ? GetBaseUrl().substr(7) : request.host) +
+                                "/a79.htm?wlanuserip=" + request.peerIp;
+        }
+        return response;
+    }
+    
+    // 代替HTTPS站点：未认证时无法建立连接
+    if (!online) {
+        response.drop = true;
+        return response;
+    }
+    response.body = "<html><body>ok</body></html>";
+    return response;
+}
+
+bool MockPortal::Delay(uint32_t ms) const {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (!m_stopping) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return true;
+        }
+        auto slice = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+        std::this_thread::sleep_for(slice < std::chrono::milliseconds(50) ? slice : std::chrono::milliseconds(50));
+    }
+    return false;
+}
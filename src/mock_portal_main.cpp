@@ -0,0 +1,160 @@
+﻿#include "../include/mock_portal.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace {
+
+// 收到Ctrl+C后置位
+volatile std::sig_atomic_t g_stopRequested = 0;
+
+void OnSignal(int) {
+    g_stopRequested = 1;
+}
+
+void PrintUsage() {
+    std::cout << "模拟校园网认证服务器（drcom/eportal）\n"
+              << "用法: mock_portal [选项]\n"
+              << "  --port <端口>                 监听端口，默认8080，0表示由系统分配\n"
+              << "  --bind <地址>                 监听地址，默认127.0.0.1\n"
+              << "  --account <账号:密码>         添加账号，可重复；不添加时接受任何账号\n"
+              << "  --max-sessions <数量>         每个账号最多同时在线的客户端数，默认不限制\n"
+              << "  --chkstatus-by-param          状态查询按wlan_user_ip参数返回指定客户端的状态\n"
+              << "                                （真实服务器不支持，只按来源地址返回，仅用于模拟大量客户端）\n"
+              << "  --latency <毫秒>              每个请求的固定延迟\n"
+              << "  --jitter <毫秒>               额外的随机延迟\n"
+              << "  --timeout-rate <百分比>       不回复的请求比例\n"
+              << "  --error-rate <百分比>         返回503的请求比例\n"
+              << "  --truncate-rate <百分比>      响应被截断的请求比例\n"
+              << "  --bad-credential-rate <百分比> 登录返回账号或密码错误的比例\n"
+              << "  --faults-on <接口>            故障注入的接口：all、chkstatus、login、probe，默认all\n"
+              << "  --stats-interval <秒>         定期输出统计，默认10，0表示不输出\n"
+              << "\n"
+              << "服务端用 --portal http://127.0.0.1:8080 把认证和探测请求发到这里。" << std::endl;
+}
+
+void PrintStats(const MockPortalStats& stats) {
+    std::cout << "连接 " << stats.connections
+              << "  请求 " << stats.requests
+              << "  状态查询 " << stats.chkstatusRequests
+              << "  登录 " << stats.loginRequests << "（成功 " << stats.loginSucceeded << "）"
+              << "  探测 " << stats.probeRequests
+              << "  注入故障 " << stats.faultsInjected
+              << "  在线 " << stats.sessions
+              << "  收/发 " << stats.bytesReceived << "/" << stats.bytesSent << " 字节" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+
+    MockPortal portal;
+    MockPortalFaults faults;
+    std::string faultsOn = "all";
+    std::string bindAddress = "127.0.0.1";
+    unsigned long port = 8080;
+    unsigned long statsInterval = 10;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--help" || option == "-h") {
+            PrintUsage();
+            return 0;
+        }
+        if (option == "--chkstatus-by-param") {
+            portal.SetChkstatusByParam(true);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "未知选项或缺少参数: " << option << std::endl;
+            PrintUsage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        unsigned long number = strtoul(value.c_str(), nullptr, 10);
+
+        if (option == "--port") {
+            port = number;
+        } else if (option == "--bind") {
+            bindAddress = value;
+        } else if (option == "--account") {
+            size_t colon = value.find(':');
+            if (colon == std::string::npos) {
+                std::cerr << "账号格式应为 账号:密码" << std::endl;
+                return 1;
+            }
+            portal.AddAccount(value.substr(0, colon), value.substr(colon + 1));
+        } else if (option == "--max-sessions") {
+            portal.SetMaxSessionsPerAccount((uint32_t)number);
+        } else if (option == "--latency") {
+            faults.latencyMs = (uint32_t)number;
+        } else if (option == "--jitter") {
+            faults.jitterMs = (uint32_t)number;
+        } else if (option == "--timeout-rate") {
+            faults.timeoutPercent = (uint32_t)number;
+        } else if (option == "--error-rate") {
+            faults.serverErrorPercent = (uint32_t)number;
+        } else if (option == "--truncate-rate") {
+            faults.truncatePercent = (uint32_t)number;
+        } else if (option == "--bad-credential-rate") {
+            faults.badCredentialPercent = (uint32_t)number;
+        } else if (option == "--faults-on") {
+            faultsOn = value;
+        } else if (option == "--stats-interval") {
+            statsInterval = number;
+        } else {
+            std::cerr << "未知选项: " << option << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (port > 65535) {
+        std::cerr << "无效的端口: " << port << std::endl;
+        return 1;
+    }
+
+    if (faultsOn == "all" || faultsOn == "chkstatus") {
+        portal.SetFaults(MockEndpoint::Chkstatus, faults);
+    }
+    if (faultsOn == "all" || faultsOn == "login") {
+        portal.SetFaults(MockEndpoint::Login, faults);
+    }
+    if (faultsOn == "all" || faultsOn == "probe") {
+        portal.SetFaults(MockEndpoint::Probe, faults);
+    }
+    if (faultsOn != "all" && faultsOn != "chkstatus" && faultsOn != "login" && faultsOn != "probe") {
+        std::cerr << "未知的接口: " << faultsOn << std::endl;
+        return 1;
+    }
+
+    if (!portal.Start((uint16_t)port, bindAddress)) {
+        return 1;
+    }
+    std::cout << "模拟认证服务器已启动: " << portal.GetBaseUrl() << "（按Ctrl+C停止）" << std::endl;
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    unsigned long elapsedMs = 0;
+    while (!g_stopRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        elapsedMs += 100;
+        if (statsInterval > 0 && elapsedMs >= statsInterval * 1000) {
+            elapsedMs = 0;
+            PrintStats(portal.GetStats());
+        }
+    }
+
+    portal.Stop();
+    PrintStats(portal.GetStats());
+    return 0;
+}
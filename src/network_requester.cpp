@@ -1,55 +1,86 @@
 ﻿#include "../include/network_requester.h"
+#include "../include/portal_response.h"
+#include "../include/metrics.h"
+#include "../include/trace.h"
 #include <iostream>
-#include <regex>
 #include <sstream>
 
-NetworkRequester::NetworkRequester() : m_hSession(NULL) {
+namespace {
+
+// 校园网状态查询耗时
+MetricHistogram& g_chkstatusDurationMs = MetricsRegistry::Instance().Histogram(
+    "wifi_chkstatus_duration_ms", "Time to query the portal chkstatus endpoint in milliseconds");
+
+// 登录请求耗时
+MetricHistogram& g_loginDurationMs = MetricsRegistry::Instance().Histogram(
+    "wifi_login_duration_ms", "Time to send a portal login request and read the reply in milliseconds");
+
+// 登录失败原因的指标标签
+const char* LoginFailureLabel(NetworkRequester::LoginResult result) {
+    switch (result) {
+    case NetworkRequester::LoginResult::BadCredentials:
+        return "reason=\"bad_credentials\"";
+    case NetworkRequester::LoginResult::AccountLimit:
+        return "reason=\"account_limit\"";
+    case NetworkRequester::LoginResult::PortalError:
+        return "reason=\"portal_error\"";
+    default:
+        return "reason=\"transport_error\"";
+    }
+}
+
+// 记录一次登录失败
+void RecordLoginFailure(NetworkRequester::LoginResult result) {
+    MetricsRegistry::Instance().Counter(
+        "wifi_login_failures_total", "Portal login attempts that did not bring the client online",
+        LoginFailureLabel(result)).Add();
+}
+
+} // namespace
+
+NetworkRequester::NetworkRequester() :
+    m_cancelToken(nullptr),
+    m_chkstatusUrl(L"https://login.csust.edu.cn/drcom/chkstatus?callback=dr1002&jsVersion=4.X&v=1611&lang=zh"),
+    m_loginUrl(L"https://login.csust.edu.cn:802/eportal/portal/login"),
+    m_probeDeadlineMs(10000) {
+    
+    // 默认的探测目标：明文HTTP的204探测地址用于识别认证网关的重定向，
+    // HTTPS站点只发送HEAD请求，不再下载完整首页
+    m_probeTargets.push_back({ L"http://connect.rom.miui.com/generate_204", L"GET", 204 });
+    m_probeTargets.push_back({ L"https://www.baidu.com", L"HEAD", 0 });
+    m_probeTargets.push_back({ L"https://www.qq.com", L"HEAD", 0 });
+    m_probeTargets.push_back({ L"https://www.bing.com", L"HEAD", 0 });
 }
 
 NetworkRequester::~NetworkRequester() {
-    Cleanup();
 }
 
 bool NetworkRequester::Initialize() {
-    // 清理之前的资源
-    Cleanup();
-    
-    // 初始化WinHTTP
-    m_hSession = WinHttpOpen(
-        L"WifiAutoConnectService/1.0",
-        WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-        WINHTTP_NO_PROXY_NAME,
-        WINHTTP_NO_PROXY_BYPASS,
-        0
-    );
-    
-    if (!m_hSession) {
-        std::wcerr << L"WinHttpOpen失败，错误码: " << GetLastError() << std::endl;
-        return false;
-    }
-    
-    return true;
+    return m_transport.Initialize();
 }
 
 std::wstring NetworkRequester::GetUserIP() {
+    TraceSpan span("GetUserIP");
     std::wcout << L"正在获取用户IP地址..." << std::endl;
     
     try {
         // 发送请求获取IP地址
-        std::wstring url = L"https://login.csust.edu.cn/drcom/chkstatus?callback=dr1002&jsVersion=4.X&v=1611&lang=zh";
-        std::wstring response = SendHttpGetRequest(url);
+        HttpRequest request;
+        request.url = WideToUtf8(m_chkstatusUrl);
+        HttpResponse response;
+        ULONGLONG requestStart = GetTickCount64();
+        SendHttpRequest(request, response);
+        g_chkstatusDurationMs.Record(GetTickCount64() - requestStart);
         
-        if (response.empty()) {
+        if (response.body.empty()) {
             std::wcerr << L"获取IP地址失败：响应为空" << std::endl;
             return L"";
         }
         
-        // 使用正则表达式提取v46ip字段
-        std::wregex ipRegex(L"\"v46ip\":\\s*\"([^\"]+)\"");
-        std::wsmatch matches;
-        
-        if (std::regex_search(response, matches, ipRegex) && matches.size() > 1) {
-            std::wstring userIP = matches[1].str();
+        // 解析dr1002响应，提取v46ip字段
+        PortalResponse status;
+        if (PortalResponseParser::Parse(response.body, status) && !status.v46ip.empty()) {
+            std::wstring userIP = Utf8ToWide(std::string(status.v46ip));
             std::wcout << L"获取到用户IP: " << userIP << std::endl;
             return userIP;
         } else {
@@ -62,10 +93,13 @@ std::wstring NetworkRequester::GetUserIP() {
     }
 }
 
-bool NetworkRequester::LoginCampusNetwork(const std::wstring& account, const std::wstring& password, const std::wstring& userIP) {
+NetworkRequester::LoginResult NetworkRequester::LoginCampusNetwork(const std::wstring& account, const std::wstring& password, const std::wstring& userIP) {
+    TraceSpan span("LoginCampusNetwork");
+    
     if (userIP.empty()) {
         std::wcerr << L"无法获取用户IP，请检查网络连接" << std::endl;
-        return false;
+        RecordLoginFailure(LoginResult::TransportError);
+        return LoginResult::TransportError;
     }
     
     std::wcout << L"\n====================================" << std::endl;
@@ -73,390 +107,341 @@ bool NetworkRequester::LoginCampusNetwork(const std::wstring& account, const std
     std::wcout << L"====================================" << std::endl;
     
     std::wcout << L"开始尝试登录..." << std::endl;
+    std::wcout << L"使用账号: " << account << std::endl;
     
+    // 本机登录不上报MAC地址
+    std::wstring message;
+    LoginResult result = SubmitLogin(account, password, userIP, L"000000000000", &message);
+    span.AddArg("result", std::wstring(LoginResultToString(result)));
+    
+    if (!message.empty() && result != LoginResult::Success) {
+        std::wcerr << L"认证服务器返回: " << message << std::endl;
+    }
+    
+    if (result == LoginResult::Success || result == LoginResult::AlreadyOnline) {
+        std::wcout << L"\n==============" << std::endl;
+        std::wcout << L"     登录成功" << std::endl;
+        std::wcout << L"==============" << std::endl;
+    } else if (result == LoginResult::TransportError) {
+        std::wcerr << L"登录请求失败，认证服务器无响应，请检查网络连接" << std::endl;
+    } else {
+        std::wcerr << L"登录失败: " << LoginResultToString(result) << std::endl;
+    }
+    
+    return result;
+}
+
+NetworkRequester::LoginResult NetworkRequester::SubmitLogin(
+    const std::wstring& account,
+    const std::wstring& password,
+    const std::wstring& userIP,
+    const std::wstring& userMac,
+    std::wstring* message) {
     try {
-        // 构建登录URL
-        std::wstringstream loginUrlStream;
-        loginUrlStream << L"https://login.csust.edu.cn:802/eportal/portal/login?callback=dr1003"
-                      << L"&login_method=1"
-                      << L"&user_account=%2C0%2C" << account
-                      << L"&user_password=" << password
-                      << L"&wlan_user_ip=" << userIP
-                      << L"&wlan_user_ipv6="
-                      << L"&wlan_user_mac=000000000000"
-                      << L"&wlan_ac_ip="
-                      << L"&wlan_ac_name="
-                      << L"&jsVersion=4.2.1"
-                      << L"&terminal_type=1"
-                      << L"&lang=zh-cn"
-                      << L"&v=1250"
-                      << L"&lang=zh";
-        
-        std::wstring loginUrl = loginUrlStream.str();
+        HttpRequest request;
+        request.url = WideToUtf8(BuildLoginUrl(m_loginUrl, account, password, userIP, userMac));
         
-        std::wcout << L"使用账号: " << account << std::endl;
-        std::wstring response = SendHttpGetRequest(loginUrl);
+        HttpResponse response;
+        ULONGLONG requestStart = GetTickCount64();
+        bool sent = SendHttpRequest(request, response);
+        g_loginDurationMs.Record(GetTickCount64() - requestStart);
+        if (!sent || response.body.empty()) {
+            RecordLoginFailure(LoginResult::TransportError);
+            return LoginResult::TransportError;
+        }
         
-        // 检查登录结果
-        if (response.find(L"success") != std::wstring::npos) {
-            std::wcout << L"登录请求发送成功" << std::endl;
-            
-            // 检查网络连接状态
-            if (CheckNetworkConnection()) {
-                std::wcout << L"\n==============" << std::endl;
-                std::wcout << L"     登录成功" << std::endl;
-                std::wcout << L"==============" << std::endl;
-                return true;
-            }
-        } else {
-            std::wcerr << L"登录请求可能未成功，正在检查网络连接..." << std::endl;
-            return CheckNetworkConnection();
+        // 根据dr1003响应判断登录结果
+        LoginResult result = ClassifyLoginResponse(response.body, message);
+        if (result != LoginResult::Success && result != LoginResult::AlreadyOnline) {
+            RecordLoginFailure(result);
         }
-    } catch (const std::exception& e) {
-        std::wcerr << L"登录过程中出错: " << e.what() << std::endl;
-        std::wcerr << L"请检查网络连接" << std::endl;
-        return false;
+        return result;
+    } catch (const std::exception&) {
+        RecordLoginFailure(LoginResult::TransportError);
+        return LoginResult::TransportError;
     }
-    
-    return false;
 }
 
-bool NetworkRequester::CheckNetworkConnection() {
-    std::wcout << L"检查网络中，请稍后..." << std::endl;
-    
-    // 定义多个测试网站，提高检测可靠性
-    const std::wstring testUrls[] = {
-        L"https://www.baidu.com",
-        L"https://www.qq.com",
-        L"https://www.bing.com"
-    };
-    
-    for (const auto& url : testUrls) {
-        try {
-            std::wcout << L"尝试访问: " << url << std::endl;
-            std::wstring response = SendHttpGetRequest(url);
-            if (!response.empty()) {
-                std::wcout << L"网络连接正常，可以访问: " << url << std::endl;
-                return true;
-            }
-        } catch (...) {
-            // 忽略单个网站的访问异常，继续尝试其他网站
-            std::wcout << L"无法访问: " << url << std::endl;
-        }
-    }
+std::wstring NetworkRequester::BuildLoginUrl(
+    const std::wstring& loginUrl,
+    const std::wstring& account,
+    const std::wstring& password,
+    const std::wstring& userIP,
+    const std::wstring& userMac) {
+    std::wstringstream loginUrlStream;
+    loginUrlStream << loginUrl << L"?callback=dr1003"
+                   << L"&login_method=1"
+                   << L"&user_account=%2C0%2C" << account
+                   << L"&user_password=" << password
+                   << L"&wlan_user_ip=" << userIP
+                   << L"&wlan_user_ipv6="
+                   << L"&wlan_user_mac=" << userMac
+                   << L"&wlan_ac_ip="
+                   << L"&wlan_ac_name="
+                   << L"&jsVersion=4.2.1"
+                   << L"&terminal_type=1"
+                   << L"&lang=zh-cn"
+                   << L"&v=1250"
+                   << L"&lang=zh";
+    return loginUrlStream.str();
+}
+
+void NetworkRequester::SetLoginUrl(const std::wstring& loginUrl) {
+    m_loginUrl = loginUrl;
+}
+
+NetworkRequester::SessionStatus NetworkRequester::QuerySessionStatus(const std::wstring& clientIP, DWORD timeoutMs) {
+    SessionStatus status;
     
-    // 尝试访问校园网登录页面
     try {
-        std::wstring loginPageUrl = L"https://login.csust.edu.cn/drcom/chkstatus?callback=dr1002&jsVersion=4.X&v=1611&lang=zh";
-        std::wstring response = SendHttpGetRequest(loginPageUrl);
-        if (!response.empty()) {
-            std::wcout << L"可以访问校园网登录页面，但可能需要登录" << std::endl;
-            return false; // 可以访问登录页面但不能访问外网，需要登录
+        // 与登录请求一样带上wlan_user_ip，但真实的chkstatus接口忽略该参数，总是返回请求来源地址的状态，
+        // 所以只有响应中的v46ip与clientIP相同时结果才属于该客户端（从网关查询其他客户端时一般得到Unknown）
+        HttpRequest request;
+        request.url = WideToUtf8(m_chkstatusUrl + L"&wlan_user_ip=" + clientIP);
+        request.timeoutMs = timeoutMs;
+        request.maxBodyBytes = 64 * 1024;
+        
+        HttpResponse response;
+        ULONGLONG requestStart = GetTickCount64();
+        bool sent = SendHttpRequest(request, response);
+        g_chkstatusDurationMs.Record(GetTickCount64() - requestStart);
+        if (!sent || response.body.empty()) {
+            return status;
+        }
+        
+        // dr1002响应中result为1表示已认证，此时还带有账号和流量
+        PortalResponse parsed;
+        if (!PortalResponseParser::Parse(response.body, parsed) || !parsed.hasResult) {
+            return status;
         }
-    } catch (...) {
-        // 忽略异常
+        status.reportedIP = PortalResponseParser::DecodeString(parsed.v46ip);
+        if (!PortalResponseParser::IsSameAddress(parsed.v46ip, WideToUtf8(clientIP))) {
+            status.addressMismatch = !parsed.v46ip.empty();
+            return status;
+        }
+        if (parsed.result != 1) {
+            status.state = SessionState::Offline;
+            return status;
+        }
+        
+        status.state = SessionState::Online;
+        status.uid = PortalResponseParser::DecodeString(parsed.uid);
+        status.flux = parsed.hasFlux ? parsed.flux : 0;
+        status.onlineTime = parsed.hasTime ? parsed.time : 0;
+    } catch (const std::exception&) {
+        status.state = SessionState::Unknown;
     }
     
-    std::wcerr << L"断网或者连接失败，无法访问任何测试网站" << std::endl;
-    return false;
+    return status;
 }
 
-std::wstring NetworkRequester::SendHttpGetRequest(const std::wstring& url, bool isSecure) {
-    if (m_hSession == NULL) {
-        if (!Initialize()) {
-            return L"";
-        }
+void NetworkRequester::SetChkstatusUrl(const std::wstring& chkstatusUrl) {
+    m_chkstatusUrl = chkstatusUrl;
+}
+
+void NetworkRequester::SetPortalBaseUrl(const std::wstring& baseUrl) {
+    std::wstring base = baseUrl;
+    while (!base.empty() && base.back() == L'/') {
+        base.pop_back();
     }
     
-    std::wstring hostName, urlPath;
-    INTERNET_SCHEME scheme;
-    INTERNET_PORT port;
+    m_chkstatusUrl = base + L"/drcom/chkstatus?callback=dr1002&jsVersion=4.X&v=1611&lang=zh";
+    m_loginUrl = base + L"/eportal/portal/login";
     
-    if (!ParseUrl(url, hostName, urlPath, scheme, port)) {
-        return L"";
+    // 外网探测目标也由该服务器代替：已认证时返回204或200，未认证时重定向或断开
+    m_probeTargets.clear();
+    m_probeTargets.push_back({ base + L"/generate_204", L"GET", 204 });
+    m_probeTargets.push_back({ base + L"/probe/baidu", L"HEAD", 0 });
+    m_probeTargets.push_back({ base + L"/probe/qq", L"HEAD", 0 });
+    m_probeTargets.push_back({ base + L"/probe/bing", L"HEAD", 0 });
+}
+
+NetworkRequester::LoginResult NetworkRequester::ClassifyLoginResponse(const std::string& body, std::wstring* message) {
+    PortalResponse loginResponse;
+    if (!PortalResponseParser::Parse(body, loginResponse) || !loginResponse.hasResult) {
+        return LoginResult::PortalError;
     }
     
-    // 连接到服务器
-    HINTERNET hConnect = WinHttpConnect(
-        m_hSession,
-        hostName.c_str(),
-        port,
-        0
-    );
-    
-    if (!hConnect) {
-        std::wcerr << L"WinHttpConnect失败，错误码: " << GetLastError() << std::endl;
-        return L"";
+    // result为1表示认证成功
+    if (loginResponse.result == 1) {
+        return LoginResult::Success;
     }
     
-    // 创建请求
-    HINTERNET hRequest = WinHttpOpenRequest(
-        hConnect,
-        L"GET",
-        urlPath.c_str(),
-        NULL,
-        WINHTTP_NO_REFERER,
-        WINHTTP_DEFAULT_ACCEPT_TYPES,
-        (scheme == INTERNET_SCHEME_HTTPS) ? WINHTTP_FLAG_SECURE : 0
-    );
-    
-    if (!hRequest) {
-        std::wcerr << L"WinHttpOpenRequest失败，错误码: " << GetLastError() << std::endl;
-        WinHttpCloseHandle(hConnect);
-        return L"";
+    // ret_code为2表示该IP已经在线
+    if (loginResponse.hasRetCode && loginResponse.retCode == 2) {
+        return LoginResult::AlreadyOnline;
     }
     
-    // 发送请求
-    if (!WinHttpSendRequest(
-        hRequest,
-        WINHTTP_NO_ADDITIONAL_HEADERS,
-        0,
-        WINHTTP_NO_REQUEST_DATA,
-        0,
-        0,
-        0
-    )) {
-        std::wcerr << L"WinHttpSendRequest失败，错误码: " << GetLastError() << std::endl;
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        return L"";
+    // 其余失败原因只能从提示信息判断；部分认证服务器的提示信息是Base64编码的英文
+    std::wstring msg = PortalResponseParser::DecodeString(loginResponse.msg);
+    if (message != nullptr) {
+        *message = msg;
     }
     
-    // 接收响应
-    if (!WinHttpReceiveResponse(hRequest, NULL)) {
-        std::wcerr << L"WinHttpReceiveResponse失败，错误码: " << GetLastError() << std::endl;
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        return L"";
+    auto contains = [&msg](const wchar_t* keyword) {
+        return msg.find(keyword) != std::wstring::npos;
+    };
+    
+    if (contains(L"已经在线") || contains(L"已在线")) {
+        return LoginResult::AlreadyOnline;
     }
     
-    // 读取响应数据
-    std::wstring responseData;
-    DWORD dwSize = 0;
-    DWORD dwDownloaded = 0;
-    LPSTR pszOutBuffer;
-    
-    do {
-        // 检查可用数据大小
-        dwSize = 0;
-        if (!WinHttpQueryDataAvailable(hRequest, &dwSize)) {
-            std::wcerr << L"WinHttpQueryDataAvailable失败，错误码: " << GetLastError() << std::endl;
-            break;
-        }
-        
-        // 分配内存
-        pszOutBuffer = new char[dwSize + 1];
-        if (!pszOutBuffer) {
-            std::wcerr << L"内存分配失败" << std::endl;
-            break;
-        }
-        
-        // 读取数据
-        ZeroMemory(pszOutBuffer, dwSize + 1);
-        if (!WinHttpReadData(hRequest, pszOutBuffer, dwSize, &dwDownloaded)) {
-            std::wcerr << L"WinHttpReadData失败，错误码: " << GetLastError() << std::endl;
-            delete[] pszOutBuffer;
-            break;
-        }
-        
-        // 转换为宽字符串并追加到响应数据
-        int bufferSize = MultiByteToWideChar(CP_UTF8, 0, pszOutBuffer, dwDownloaded, NULL, 0);
-        if (bufferSize > 0) {
-            std::wstring wideBuffer(bufferSize, 0);
-            MultiByteToWideChar(CP_UTF8, 0, pszOutBuffer, dwDownloaded, &wideBuffer[0], bufferSize);
-            responseData += wideBuffer;
-        }
-        
-        // 释放内存
-        delete[] pszOutBuffer;
-        
-    } while (dwSize > 0);
+    if (contains(L"密码") || contains(L"账号不存在") || contains(L"用户不存在") ||
+        contains(L"bGRhcCBhdXRoIGVycm9y") ||    // ldap auth error
+        contains(L"dXNlcmlkIGVycm9y")) {        // userid error
+        return LoginResult::BadCredentials;
+    }
     
-    // 关闭句柄
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
+    if (contains(L"在线") || contains(L"上限") || contains(L"超限") || contains(L"占用") ||
+        contains(L"aW51c2Ug")) {                // inuse
+        return LoginResult::AccountLimit;
+    }
     
-    return responseData;
+    return LoginResult::PortalError;
 }
 
-std::wstring NetworkRequester::SendHttpPostRequest(
-    const std::wstring& url, 
-    const std::wstring& postData, 
-    const std::wstring& contentType,
-    bool isSecure
-) {
-    if (m_hSession == NULL) {
-        if (!Initialize()) {
-            return L"";
-        }
+bool NetworkRequester::IsPermanentLoginFailure(LoginResult result) {
+    // 账号或密码错误时重试没有意义，只有修改配置后才可能成功
+    return result == LoginResult::BadCredentials;
+}
+
+const wchar_t* NetworkRequester::LoginResultToString(LoginResult result) {
+    switch (result) {
+    case LoginResult::Success:
+        return L"登录成功";
+    case LoginResult::AlreadyOnline:
+        return L"已经在线";
+    case LoginResult::BadCredentials:
+        return L"账号或密码错误";
+    case LoginResult::AccountLimit:
+        return L"账号在线数量超限或账号被占用";
+    case LoginResult::PortalError:
+        return L"认证服务器返回错误";
+    case LoginResult::TransportError:
+        return L"无法连接认证服务器";
+    default:
+        return L"未知结果";
     }
+}
+
+bool NetworkRequester::CheckNetworkConnection() {
+    TraceSpan span("CheckNetworkConnection");
+    std::wcout << L"检查网络中，请稍后..." << std::endl;
     
-    std::wstring hostName, urlPath;
-    INTERNET_SCHEME scheme;
-    INTERNET_PORT port;
+    ConnectivityResult result = ProbeConnectivity();
     
-    if (!ParseUrl(url, hostName, urlPath, scheme, port)) {
-        return L"";
+    switch (result.status) {
+    case ConnectivityStatus::Online:
+        std::wcout << L"网络连接正常，可以访问: " << result.probeUrl
+                   << L"（耗时" << result.elapsedMs << L"毫秒）" << std::endl;
+        return true;
+        
+    case ConnectivityStatus::CaptivePortal:
+        std::wcout << L"被重定向到认证页面或只能访问校园网登录页面，需要登录（" << result.probeUrl
+                   << L"，耗时" << result.elapsedMs << L"毫秒）" << std::endl;
+        return false;
+        
+    default:
+        std::wcerr << L"断网或者连接失败，无法访问任何测试网站（耗时" << result.elapsedMs << L"毫秒）" << std::endl;
+        return false;
     }
-    
-    // 连接到服务器
-    HINTERNET hConnect = WinHttpConnect(
-        m_hSession,
-        hostName.c_str(),
-        port,
-        0
-    );
-    
-    if (!hConnect) {
-        std::wcerr << L"WinHttpConnect失败，错误码: " << GetLastError() << std::endl;
-        return L"";
+}
+
+NetworkRequester::ConnectivityResult NetworkRequester::ProbeConnectivity() {
+    ConnectivityResult result;
+    result.status = ConnectivityStatus::Offline;
+    result.statusCode = 0;
+    result.elapsedMs = 0;
+    
+    // 在启动探测线程前完成初始化，避免多个线程同时等待打开会话
+    if (!Initialize()) {
+        return result;
     }
     
-    // 创建请求
-    HINTERNET hRequest = WinHttpOpenRequest(
-        hConnect,
-        L"POST",
-        urlPath.c_str(),
-        NULL,
-        WINHTTP_NO_REFERER,
-        WINHTTP_DEFAULT_ACCEPT_TYPES,
-        (scheme == INTERNET_SCHEME_HTTPS) ? WINHTTP_FLAG_SECURE : 0
-    );
-    
-    if (!hRequest) {
-        std::wcerr << L"WinHttpOpenRequest失败，错误码: " << GetLastError() << std::endl;
-        WinHttpCloseHandle(hConnect);
-        return L"";
+    ConnectivityProber prober(m_transport);
+    std::vector<ConnectivityProber::Target> targets;
+    for (const ProbeTarget& target : m_probeTargets) {
+        targets.push_back({ WideToUtf8(target.url), WideToUtf8(target.verb), target.expectedStatus });
     }
+    prober.SetTargets(targets);
+    prober.SetPortalUrl(WideToUtf8(m_chkstatusUrl));
+    prober.SetDeadline(m_probeDeadlineMs);
+    
+    // 服务停止时中断所有探测
+    HttpCancel stop;
+    CancellationToken::Registration cancelRegistration(m_cancelToken, [&stop]() {
+        stop.Cancel();
+    });
+    
+    ConnectivityProber::Result probed = prober.Probe(&stop);
+    result.status = probed.status;
+    result.probeUrl = Utf8ToWide(probed.probeUrl);
+    result.statusCode = probed.statusCode;
+    result.redirectLocation = Utf8ToWide(probed.redirectLocation);
+    result.elapsedMs = probed.elapsedMs;
+    return result;
+}
+
+void NetworkRequester::SetProbeTargets(const std::vector<ProbeTarget>& targets) {
+    m_probeTargets = targets;
+}
+
+void NetworkRequester::SetProbeDeadline(DWORD deadlineMs) {
+    m_probeDeadlineMs = deadlineMs;
+}
+
+void NetworkRequester::SetCancellationToken(CancellationToken* token) {
+    m_cancelToken = token;
+}
+
+void NetworkRequester::SetMaxConnectionsPerHost(DWORD maxPerHost) {
+    m_transport.SetLimits(maxPerHost, 60000);
+}
+
+void NetworkRequester::ReleaseIdleConnections() {
+    m_transport.ReleaseIdleConnections();
+}
+
+bool NetworkRequester::SendHttpRequest(const HttpRequest& request, HttpResponse& response, HttpCancel* cancel) {
+    // 没有指定取消信号时使用局部的取消信号，使服务停止时也能取消该请求
+    HttpCancel localCancel;
+    if (cancel == nullptr) {
+        cancel = &localCancel;
+    }
+    CancellationToken::Registration cancelRegistration(m_cancelToken, [cancel]() {
+        cancel->Cancel();
+    });
     
-    // 构建请求头
-    std::wstring headers = L"Content-Type: " + contentType;
-    
-    // 将宽字符串转换为UTF-8
-    int postDataSize = WideCharToMultiByte(CP_UTF8, 0, postData.c_str(), -1, NULL, 0, NULL, NULL);
-    char* postDataUtf8 = new char[postDataSize];
-    WideCharToMultiByte(CP_UTF8, 0, postData.c_str(), -1, postDataUtf8, postDataSize, NULL, NULL);
-    
-    // 发送请求
-    if (!WinHttpSendRequest(
-        hRequest,
-        headers.c_str(),
-        -1,
-        (LPVOID)postDataUtf8,
-        postDataSize - 1, // 不包括结尾的空字符
-        postDataSize - 1,
-        0
-    )) {
-        std::wcerr << L"WinHttpSendRequest失败，错误码: " << GetLastError() << std::endl;
-        delete[] postDataUtf8;
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
+    return m_transport.Send(request, response, cancel);
+}
+
+std::wstring NetworkRequester::Utf8ToWide(const std::string& utf8) {
+    if (utf8.empty()) {
         return L"";
     }
     
-    // 释放POST数据内存
-    delete[] postDataUtf8;
-    
-    // 接收响应
-    if (!WinHttpReceiveResponse(hRequest, NULL)) {
-        std::wcerr << L"WinHttpReceiveResponse失败，错误码: " << GetLastError() << std::endl;
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
+    // 一次性转换整个响应体，避免多字节字符被分块截断
+    int wideSize = MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), NULL, 0);
+    if (wideSize <= 0) {
         return L"";
     }
     
-    // 读取响应数据
-    std::wstring responseData;
-    DWORD dwSize = 0;
-    DWORD dwDownloaded = 0;
-    LPSTR pszOutBuffer;
-    
-    do {
-        // 检查可用数据大小
-        dwSize = 0;
-        if (!WinHttpQueryDataAvailable(hRequest, &dwSize)) {
-            std::wcerr << L"WinHttpQueryDataAvailable失败，错误码: " << GetLastError() << std::endl;
-            break;
-        }
-        
-        // 分配内存
-        pszOutBuffer = new char[dwSize + 1];
-        if (!pszOutBuffer) {
-            std::wcerr << L"内存分配失败" << std::endl;
-            break;
-        }
-        
-        // 读取数据
-        ZeroMemory(pszOutBuffer, dwSize + 1);
-        if (!WinHttpReadData(hRequest, pszOutBuffer, dwSize, &dwDownloaded)) {
-            std::wcerr << L"WinHttpReadData失败，错误码: " << GetLastError() << std::endl;
-            delete[] pszOutBuffer;
-            break;
-        }
-        
-        // 转换为宽字符串并追加到响应数据
-        int bufferSize = MultiByteToWideChar(CP_UTF8, 0, pszOutBuffer, dwDownloaded, NULL, 0);
-        if (bufferSize > 0) {
-            std::wstring wideBuffer(bufferSize, 0);
-            MultiByteToWideChar(CP_UTF8, 0, pszOutBuffer, dwDownloaded, &wideBuffer[0], bufferSize);
-            responseData += wideBuffer;
-        }
-        
-        // 释放内存
-        delete[] pszOutBuffer;
-        
-    } while (dwSize > 0);
-    
-    // 关闭句柄
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    
-    return responseData;
+    std::wstring wide(wideSize, 0);
+    MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), &wide[0], wideSize);
+    return wide;
 }
 
-bool NetworkRequester::ParseUrl(
-    const std::wstring& url, 
-    std::wstring& hostName, 
-    std::wstring& urlPath, 
-    INTERNET_SCHEME& scheme, 
-    INTERNET_PORT& port
-) {
-    URL_COMPONENTS urlComp = {0};
-    urlComp.dwStructSize = sizeof(urlComp);
-    
-    // 设置要获取的URL组件
-    wchar_t hostNameBuffer[256] = {0};
-    wchar_t urlPathBuffer[2048] = {0};
-    
-    urlComp.lpszHostName = hostNameBuffer;
-    urlComp.dwHostNameLength = sizeof(hostNameBuffer) / sizeof(hostNameBuffer[0]);
-    urlComp.lpszUrlPath = urlPathBuffer;
-    urlComp.dwUrlPathLength = sizeof(urlPathBuffer) / sizeof(urlPathBuffer[0]);
-    urlComp.dwSchemeLength = (DWORD)-1;
-    urlComp.dwUserNameLength = (DWORD)-1;
-    urlComp.dwPasswordLength = (DWORD)-1;
-    urlComp.dwUrlPathLength = (DWORD)-1;
-    urlComp.dwExtraInfoLength = (DWORD)-1;
-    
-    if (!WinHttpCrackUrl(url.c_str(), (DWORD)url.length(), 0, &urlComp)) {
-        std::wcerr << L"WinHttpCrackUrl失败，错误码: " << GetLastError() << std::endl;
-        return false;
+std::string NetworkRequester::WideToUtf8(const std::wstring& wide) {
+    if (wide.empty()) {
+        return "";
     }
     
-    hostName = urlComp.lpszHostName;
-    urlPath = urlComp.lpszUrlPath;
-    if (urlComp.lpszExtraInfo) {
-        urlPath += urlComp.lpszExtraInfo;
+    int utf8Size = WideCharToMultiByte(CP_UTF8, 0, wide.data(), (int)wide.size(), NULL, 0, NULL, NULL);
+    if (utf8Size <= 0) {
+        return "";
     }
-    scheme = urlComp.nScheme;
-    port = urlComp.nPort;
     
-    return true;
+    std::string utf8(utf8Size, 0);
+    WideCharToMultiByte(CP_UTF8, 0, wide.data(), (int)wide.size(), &utf8[0], utf8Size, NULL, NULL);
+    return utf8;
 }
-
-void NetworkRequester::Cleanup() {
-    if (m_hSession != NULL) {
-        WinHttpCloseHandle(m_hSession);
-        m_hSession = NULL;
-    }
-} 
\ No newline at end of file
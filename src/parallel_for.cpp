@@ -0,0 +1,39 @@
+﻿#include "../include/parallel_for.h"
+#include <thread>
+#include <vector>
+#include <atomic>
+
+void ParallelFor(size_t count, DWORD parallelism, CancellationToken* token, const std::function<void(size_t index)>& body) {
+    if (count == 0) {
+        return;
+    }
+    
+    size_t threadCount = parallelism > 0 ? parallelism : 1;
+    if (threadCount > count) {
+        threadCount = count;
+    }
+    
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (;;) {
+            if (token != nullptr && token->IsCancelled()) {
+                return;
+            }
+            size_t index = next.fetch_add(1);
+            if (index >= count) {
+                return;
+            }
+            body(index);
+        }
+    };
+    
+    // 当前线程也处理任务，只需要另外创建threadCount-1个线程
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+}
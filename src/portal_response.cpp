@@ -0,0 +1,298 @@
+﻿#include "../include/portal_response.h"
+#include <climits>
+
+bool PortalResponseParser::Parse(const std::string& body, PortalResponse& response) {
+    return Parse(body.data(), body.size(), response);
+}
+
+bool PortalResponseParser::Parse(const char* data, size_t length, PortalResponse& response) {
+    response = PortalResponse();
+
+    const char* p = data;
+    const char* end = data + length;
+
+    p = SkipWhitespace(p, end);
+
+    // 读取回调名称，如 dr1002(
+    const char* nameStart = p;
+    while (p < end && ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+                       (*p >= '0' && *p <= '9') || *p == '_' || *p == '$')) {
+        p++;
+    }
+
+    if (p > nameStart) {
+        response.callback = std::string_view(nameStart, p - nameStart);
+        p = SkipWhitespace(p, end);
+        if (p >= end || *p != '(') {
+            return false;
+        }
+        p = SkipWhitespace(p + 1, end);
+    }
+
+    if (p >= end || *p != '{') {
+        return false;
+    }
+    p++;
+
+    // 逐个读取键值对
+    while (true) {
+        p = SkipWhitespace(p, end);
+        if (p >= end) {
+            return false;
+        }
+        if (*p == '}') {
+            return true;
+        }
+
+        // 读取键
+        std::string_view key;
+        if (*p != '"' || (p = ReadString(p, end, key)) == nullptr) {
+            return false;
+        }
+
+        p = SkipWhitespace(p, end);
+        if (p >= end || *p != ':') {
+            return false;
+        }
+        p = SkipWhitespace(p + 1, end);
+        if (p >= end) {
+            return false;
+        }
+
+        // 读取值：字符串、嵌套结构或标量
+        std::string_view value;
+        bool isString = false;
+        if (*p == '"') {
+            if ((p = ReadString(p, end, value)) == nullptr) {
+                return false;
+            }
+            isString = true;
+        } else if (*p == '{' || *p == '[') {
+            if ((p = SkipNested(p, end)) == nullptr) {
+                return false;
+            }
+        } else {
+            const char* valueStart = p;
+            while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+                p++;
+            }
+            value = std::string_view(valueStart, p - valueStart);
+        }
+
+        // 只保留需要的字段
+        if (key == "result") {
+            response.hasResult = ToInteger(value, response.result);
+        } else if (key == "ret_code") {
+            response.hasRetCode = ToInteger(value, response.retCode);
+        } else if (key == "msg") {
+            response.msg = isString ? value : std::string_view();
+        } else if (key == "uid") {
+            response.uid = isString ? value : std::string_view();
+        } else if (key == "v46ip") {
+            response.v46ip = isString ? value : std::string_view();
+        } else if (key == "olflow") {
+            response.hasFlux = ToInteger(value, response.flux);
+        } else if (key == "oltime") {
+            response.hasTime = ToInteger(value, response.time);
+        }
+
+        p = SkipWhitespace(p, end);
+        if (p >= end) {
+            return false;
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '}') {
+            return false;
+        }
+    }
+}
+
+std::wstring PortalResponseParser::DecodeString(std::string_view raw) {
+    std::wstring result;
+    result.reserve(raw.size());
+
+    // 追加一个Unicode码点（超出BMP时按UTF-16代理对追加）
+    auto appendCodePoint = [&result](unsigned long codePoint) {
+        if (sizeof(wchar_t) == 2 && codePoint > 0xFFFF) {
+            codePoint -= 0x10000;
+            result += static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+            result += static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        } else {
+            result += static_cast<wchar_t>(codePoint);
+        }
+    };
+
+    size_t i = 0;
+    while (i < raw.size()) {
+        unsigned char c = static_cast<unsigned char>(raw[i]);
+
+        // 转义字符
+        if (c == '\\' && i + 1 < raw.size()) {
+            char escape = raw[i + 1];
+            i += 2;
+            switch (escape) {
+            case 'n': result += L'\n'; break;
+            case 't': result += L'\t'; break;
+            case 'r': result += L'\r'; break;
+            case 'b': result += L'\b'; break;
+            case 'f': result += L'\f'; break;
+            case 'u': {
+                unsigned long codeUnit = 0;
+                size_t digits = 0;
+                while (digits < 4 && i < raw.size()) {
+                    char h = raw[i];
+                    unsigned long nibble;
+                    if (h >= '0' && h <= '9') nibble = h - '0';
+                    else if (h >= 'a' && h <= 'f') nibble = h - 'a' + 10;
+                    else if (h >= 'A' && h <= 'F') nibble = h - 'A' + 10;
+                    else break;
+                    codeUnit = (codeUnit << 4) | nibble;
+                    digits++;
+                    i++;
+                }
+                // \uXXXX本身就是UTF-16码元，直接追加
+                result += static_cast<wchar_t>(codeUnit);
+                break;
+            }
+            default:
+                result += static_cast<wchar_t>(escape);
+                break;
+            }
+            continue;
+        }
+
+        // UTF-8解码
+        unsigned long codePoint;
+        size_t extra;
+        if (c < 0x80) {
+            codePoint = c;
+            extra = 0;
+        } else if ((c & 0xE0) == 0xC0) {
+            codePoint = c & 0x1F;
+            extra = 1;
+        } else if ((c & 0xF0) == 0xE0) {
+            codePoint = c & 0x0F;
+            extra = 2;
+        } else if ((c & 0xF8) == 0xF0) {
+            codePoint = c & 0x07;
+            extra = 3;
+        } else {
+            // 非法字节，使用替换字符
+            result += static_cast<wchar_t>(0xFFFD);
+            i++;
+            continue;
+        }
+
+        // 字符被截断
+        if (i + extra >= raw.size()) {
+            result += static_cast<wchar_t>(0xFFFD);
+            break;
+        }
+
+        for (size_t k = 1; k <= extra; k++) {
+            codePoint = (codePoint << 6) | (static_cast<unsigned char>(raw[i + k]) & 0x3F);
+        }
+        appendCodePoint(codePoint);
+        i += extra + 1;
+    }
+
+    return result;
+}
+
+bool PortalResponseParser::IsSameAddress(std::string_view reported, std::string_view address) {
+    if (reported.empty() || reported.size() != address.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < reported.size(); i++) {
+        char a = reported[i];
+        char b = address[i];
+        if (a >= 'A' && a <= 'Z') a = a - 'A' + 'a';
+        if (b >= 'A' && b <= 'Z') b = b - 'A' + 'a';
+        if (a != b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* PortalResponseParser::SkipWhitespace(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+        p++;
+    }
+    return p;
+}
+
+const char* PortalResponseParser::ReadString(const char* p, const char* end, std::string_view& value) {
+    const char* start = ++p;
+    while (p < end) {
+        if (*p == '\\') {
+            if (end - p < 2) {
+                return nullptr;
+            }
+            p += 2;
+            continue;
+        }
+        if (*p == '"') {
+            value = std::string_view(start, p - start);
+            return p + 1;
+        }
+        p++;
+    }
+    return nullptr;
+}
+
+const char* PortalResponseParser::SkipNested(const char* p, const char* end) {
+    int depth = 0;
+    while (p < end) {
+        if (*p == '"') {
+            std::string_view ignored;
+            if ((p = ReadString(p, end, ignored)) == nullptr) {
+                return nullptr;
+            }
+            continue;
+        }
+        if (*p == '{' || *p == '[') {
+            depth++;
+        } else if (*p == '}' || *p == ']') {
+            depth--;
+            if (depth == 0) {
+                return p + 1;
+            }
+        }
+        p++;
+    }
+    return nullptr;
+}
+
+bool PortalResponseParser::ToInteger(std::string_view text, long long& value) {
+    if (text.empty()) {
+        return false;
+    }
+
+    size_t i = 0;
+    bool negative = false;
+    if (text[0] == '-') {
+        negative = true;
+        i = 1;
+    }
+
+    // 只取整数部分，小数部分忽略；超出long long范围时视为无法解析
+    long long number = 0;
+    size_t digits = 0;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+        int digit = text[i] - '0';
+        if (number > (LLONG_MAX - digit) / 10) {
+            return false;
+        }
+        number = number * 10 + digit;
+        digits++;
+    }
+
+    if (digits == 0) {
+        return false;
+    }
+
+    value = negative ? -number : number;
+    return true;
+}
@@ -0,0 +1,61 @@
+﻿#include "../include/response_body_reader.h"
+
+namespace {
+
+// 每个线程复用同一块接收缓冲区：一个连接句柄可能同时服务多个请求，所以不按连接分配
+char* GetReceiveBuffer() {
+    thread_local char buffer[ResponseBodyReader::kBufferSize];
+    return buffer;
+}
+
+} // namespace
+
+ResponseBodyReader::ResponseBodyReader(size_t maxBytes, const Consumer& consumer, std::string& body)
+    : m_maxBytes(maxBytes),
+      m_consumer(consumer),
+      m_body(body),
+      m_buffer(GetReceiveBuffer()),
+      m_totalRead(0),
+      m_truncated(false) {
+}
+
+void ResponseBodyReader::Reserve(size_t contentLength) {
+    if (m_consumer) {
+        return;
+    }
+    if (m_maxBytes > 0 && contentLength > m_maxBytes) {
+        contentLength = m_maxBytes;
+    }
+    m_body.reserve(contentLength);
+}
+
+bool ResponseBodyReader::NextBuffer(char*& buffer, size_t& capacity) {
+    capacity = kBufferSize;
+    if (m_maxBytes > 0) {
+        // 达到响应体上限后停止读取
+        if (m_totalRead >= m_maxBytes) {
+            m_truncated = true;
+            return false;
+        }
+        if (m_maxBytes - m_totalRead < capacity) {
+            capacity = m_maxBytes - m_totalRead;
+        }
+    }
+    buffer = m_buffer;
+    return true;
+}
+
+bool ResponseBodyReader::Commit(size_t length) {
+    // 读到0字节表示响应体已结束
+    if (length == 0) {
+        return false;
+    }
+    m_totalRead += length;
+
+    // 交给调用方处理，调用方已拿到所需数据时可以提前结束
+    if (m_consumer) {
+        return m_consumer(m_buffer, length);
+    }
+    m_body.append(m_buffer, length);
+    return true;
+}
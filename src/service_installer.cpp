@@ -14,7 +14,8 @@ bool ServiceInstaller::Install(
     const std::wstring& targetSsid,
     const std::wstring& targetPassword,
     const std::wstring& campusAccount,
-    const std::wstring& campusPassword
+    const std::wstring& campusPassword,
+    const std::wstring& portalBaseUrl
 ) {
     // 检查服务是否已安装
     if (IsServiceInstalled(serviceName)) {
@@ -122,7 +123,8 @@ bool ServiceInstaller::Install(
         targetSsid,
         targetPassword,
         campusAccount,
-        campusPassword
+        campusPassword,
+        portalBaseUrl
     )) {
         std::wcerr << L"创建服务配置注册表项失败" << std::endl;
         // 尝试卸载服务
@@ -425,7 +427,8 @@ bool ServiceInstaller::CreateServiceConfigRegistry(
     const std::wstring& targetSsid,
     const std::wstring& targetPassword,
     const std::wstring& campusAccount,
-    const std::wstring& campusPassword
+    const std::wstring& campusPassword,
+    const std::wstring& portalBaseUrl
 ) {
     // 构建注册表路径
     std::wstring registryPath = L"SYSTEM\\CurrentControlSet\\Services\\" + serviceName + L"\\Parameters";
@@ -520,6 +523,24 @@ bool ServiceInstaller::CreateServiceConfigRegistry(
         }
     }
     
+    // 设置认证服务器地址（如果有）
+    if (!portalBaseUrl.empty()) {
+        result = RegSetValueExW(
+            hKey,
+            L"PortalBaseUrl",
+            0,
+            REG_SZ,
+            (BYTE*)portalBaseUrl.c_str(),
+            (DWORD)((portalBaseUrl.length() + 1) * sizeof(wchar_t))
+        );
+        
+        if (result != ERROR_SUCCESS) {
+            std::wcerr << L"RegSetValueEx (PortalBaseUrl) 失败，错误码: " << result << std::endl;
+            RegCloseKey(hKey);
+            return false;
+        }
+    }
+    
     // 关闭注册表句柄
     RegCloseKey(hKey);
     
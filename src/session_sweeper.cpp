@@ -0,0 +1,97 @@
+﻿#include "../include/session_sweeper.h"
+#include "../include/parallel_for.h"
+#include <iomanip>
+
+SessionSweeper::SessionSweeper(NetworkRequester& requester) : m_requester(requester) {
+}
+
+void SessionSweeper::SetOptions(const SessionSweepOptions& options) {
+    m_options = options;
+    if (m_options.parallelism == 0) {
+        m_options.parallelism = 1;
+    }
+}
+
+SessionSweepReport SessionSweeper::Run(const std::vector<std::wstring>& clientIPs, CancellationToken* token) {
+    SessionSweepReport report;
+    report.statuses.resize(clientIPs.size());
+    if (clientIPs.empty()) {
+        return report;
+    }
+    
+    ULONGLONG start = GetTickCount64();
+    
+    // 每个工作线程一条长连接：连接池的单主机上限与并发数一致
+    DWORD threadCount = (DWORD)min((size_t)m_options.parallelism, clientIPs.size());
+    m_requester.SetMaxConnectionsPerHost(threadCount);
+    
+    ParallelFor(clientIPs.size(), threadCount, token, [&](size_t index) {
+        report.statuses[index] = m_requester.QuerySessionStatus(clientIPs[index], m_options.timeoutMs);
+    });
+    
+    report.elapsedMs = GetTickCount64() - start;
+    report.cancelled = (token != nullptr && token->IsCancelled());
+    return report;
+}
+
+const wchar_t* SessionSweeper::StateToString(NetworkRequester::SessionState state) {
+    switch (state) {
+    case NetworkRequester::SessionState::Online:
+        return L"online";
+    case NetworkRequester::SessionState::Offline:
+        return L"offline";
+    default:
+        return L"unknown";
+    }
+}
+
+void SessionSweeper::PrintTable(const std::vector<std::wstring>& clientIPs, const SessionSweepReport& report, std::wostream& out) {
+    size_t online = 0;
+    size_t offline = 0;
+    size_t unknown = 0;
+    size_t mismatched = 0;
+    std::wstring reportedIP;
+    
+    out << std::left << std::setw(40) << L"IP" << std::setw(9) << L"STATE"
+        << std::setw(16) << L"UID" << std::setw(14) << L"FLUX" << L"TIME\n";
+    for (size_t i = 0; i < report.statuses.size(); i++) {
+        const NetworkRequester::SessionStatus& status = report.statuses[i];
+        out << std::left << std::setw(40) << clientIPs[i] << std::setw(9) << StateToString(status.state);
+        if (status.state == NetworkRequester::SessionState::Online) {
+            out << std::setw(16) << status.uid << std::setw(14) << status.flux << status.onlineTime;
+            online++;
+        } else {
+            out << std::setw(16) << L"-" << std::setw(14) << L"-" << L"-";
+            (status.state == NetworkRequester::SessionState::Offline ? offline : unknown)++;
+        }
+        if (status.addressMismatch) {
+            mismatched++;
+            reportedIP = status.reportedIP;
+        }
+        out << L"\n";
+    }
+    out << std::right;
+    
+    double seconds = report.elapsedMs / 1000.0;
+    out << L"共" << report.statuses.size() << L"个IP：在线" << online << L"，离线" << offline
+        << L"，未知" << unknown << L"；耗时" << seconds << L"秒，每秒"
+        << (seconds > 0 ? report.statuses.size() / seconds : 0.0) << L"个";
+    if (report.cancelled) {
+        out << L"（已取消）";
+    }
+    out << L"\n";
+    if (mismatched > 0) {
+        out << L"其中" << mismatched << L"个IP的查询结果是其他地址（如" << reportedIP
+            << L"）的状态：认证服务器按请求的来源地址返回状态，不能代替其他客户端查询，这些IP记为未知\n";
+    }
+}
+
+size_t SessionSweeper::CountMismatched(const SessionSweepReport& report) {
+    size_t mismatched = 0;
+    for (const NetworkRequester::SessionStatus& status : report.statuses) {
+        if (status.addressMismatch) {
+            mismatched++;
+        }
+    }
+    return mismatched;
+}
@@ -0,0 +1,678 @@
+﻿#include "../include/socket_http_transport.h"
+#include "../include/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+typedef SOCKET NativeSocket;
+const int kSendFlags = 0;
+
+void CloseSocket(NativeSocket socket) {
+    closesocket(socket);
+}
+
+void ShutdownSocket(NativeSocket socket) {
+    shutdown(socket, SD_BOTH);
+}
+
+uint32_t LastSocketError() {
+    return (uint32_t)WSAGetLastError();
+}
+
+bool SetNonBlocking(NativeSocket socket) {
+    u_long mode = 1;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+}
+
+bool IsConnectPending(uint32_t error) {
+    return error == WSAEWOULDBLOCK;
+}
+
+int PollSocket(pollfd* fd, int timeoutMs) {
+    return WSAPoll(fd, 1, timeoutMs);
+}
+
+// 每个进程初始化一次Winsock
+bool InitializeSockets() {
+    static bool initialized = []() {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return initialized;
+}
+#else
+typedef int NativeSocket;
+const NativeSocket INVALID_SOCKET = -1;
+const int kSendFlags = MSG_NOSIGNAL;
+
+void CloseSocket(NativeSocket socket) {
+    close(socket);
+}
+
+void ShutdownSocket(NativeSocket socket) {
+    shutdown(socket, SHUT_RDWR);
+}
+
+uint32_t LastSocketError() {
+    return (uint32_t)errno;
+}
+
+bool SetNonBlocking(NativeSocket socket) {
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool IsConnectPending(uint32_t error) {
+    return error == EINPROGRESS;
+}
+
+int PollSocket(pollfd* fd, int timeoutMs) {
+    return poll(fd, 1, timeoutMs);
+}
+
+bool InitializeSockets() {
+    return true;
+}
+#endif
+
+const uintptr_t kNoSocket = (uintptr_t)INVALID_SOCKET;
+
+// 响应头的上限
+const size_t kMaxHeaderBytes = 64 * 1024;
+
+uint64_t NowMs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 等待套接字可读（writable为true时等待可写），超时返回false；
+// 对方关闭或本方取消（shutdown）时也视为就绪，由随后的读写返回结果
+bool WaitSocket(NativeSocket socket, bool writable, uint32_t timeoutMs) {
+    pollfd fd = {};
+    fd.fd = socket;
+    fd.events = writable ? POLLOUT : POLLIN;
+    return PollSocket(&fd, (int)timeoutMs) > 0;
+}
+
+// 发送全部数据（套接字为非阻塞模式）
+bool SendAll(NativeSocket socket, const char* data, size_t length, uint32_t timeoutMs) {
+    while (length > 0) {
+        if (!WaitSocket(socket, true, timeoutMs)) {
+            return false;
+        }
+        int sent = send(socket, data, (int)length, kSendFlags);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+// 接收一段数据：返回接收的字节数，对方关闭返回0，超时或出错返回-1
+int ReceiveSome(NativeSocket socket, char* buffer, size_t capacity, uint32_t timeoutMs) {
+    if (!WaitSocket(socket, false, timeoutMs)) {
+        return -1;
+    }
+    int received = recv(socket, buffer, (int)capacity, 0);
+    return received < 0 ? -1 : received;
+}
+
+// 空闲连接是否仍然可用：空闲期间收到数据或对方已关闭都不能再发送请求
+bool IsIdleConnectionAlive(NativeSocket socket) {
+    pollfd fd = {};
+    fd.fd = socket;
+    fd.events = POLLIN;
+    return PollSocket(&fd, 0) == 0;
+}
+
+// 不区分大小写比较HTTP头名称
+bool HeaderNameEquals(const std::string& a, const char* b) {
+    size_t length = strlen(b);
+    if (a.size() != length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 重定向地址：绝对地址直接使用，以/开头的路径接在原地址的主机之后
+std::string ResolveLocation(const std::string& url, const std::string& location) {
+    if (location.compare(0, 7, "http://") == 0 || location.compare(0, 8, "https://") == 0) {
+        return location;
+    }
+    if (location.empty() || location[0] != '/') {
+        return std::string();
+    }
+    size_t hostEnd = url.find('/', 7);
+    return url.substr(0, hostEnd) + location;
+}
+
+} // namespace
+
+// 默认每个主机最多4个并发请求，连接空闲60秒后关闭（与WinHttpTransport一致）
+SocketHttpTransport::SocketHttpTransport() :
+    m_maxPerHost(4),
+    m_idleTimeoutMs(60000) {
+}
+
+SocketHttpTransport::~SocketHttpTransport() {
+    Clear();
+}
+
+void SocketHttpTransport::SetLimits(uint32_t maxPerHost, uint64_t idleTimeoutMs) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_maxPerHost = maxPerHost > 0 ? maxPerHost : 1;
+        m_idleTimeoutMs = idleTimeoutMs;
+    }
+    m_released.notify_all();
+}
+
+void SocketHttpTransport::ReleaseIdleConnections() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EvictIdleLocked(NowMs());
+}
+
+void SocketHttpTransport::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& host : m_hosts) {
+        for (const IdleConnection& connection : host.second.idle) {
+            CloseSocket((NativeSocket)connection.socket);
+        }
+        host.second.idle.clear();
+    }
+}
+
+bool SocketHttpTransport::ParseUrl(const std::string& url, std::string& host, uint16_t& port, std::string& path) {
+    const char kScheme[] = "http://";
+    if (url.compare(0, sizeof(kScheme) - 1, kScheme) != 0) {
+        return false;
+    }
+
+    size_t hostBegin = sizeof(kScheme) - 1;
+    size_t pathBegin = url.find_first_of("/?", hostBegin);
+    std::string authority = url.substr(hostBegin, pathBegin == std::string::npos ? std::string::npos : pathBegin - hostBegin);
+    path = (pathBegin == std::string::npos) ? "/" : url.substr(pathBegin);
+    if (path[0] == '?') {
+        path.insert(0, "/");
+    }
+
+    // IPv6地址写在方括号中
+    size_t portColon;
+    if (!authority.empty() && authority[0] == '[') {
+        size_t close = authority.find(']');
+        if (close == std::string::npos) {
+            return false;
+        }
+        host = authority.substr(1, close - 1);
+        portColon = (close + 1 < authority.size() && authority[close + 1] == ':') ? close + 1 : std::string::npos;
+    } else {
+        portColon = authority.find(':');
+        host = authority.substr(0, portColon);
+    }
+    if (host.empty()) {
+        return false;
+    }
+
+    port = 80;
+    if (portColon != std::string::npos) {
+        const char* digits = authority.c_str() + portColon + 1;
+        char* end = nullptr;
+        unsigned long value = strtoul(digits, &end, 10);
+        if (end == digits || *end != '\0' || value == 0 || value > 65535) {
+            return false;
+        }
+        port = (uint16_t)value;
+    }
+    return true;
+}
+
+bool SocketHttpTransport::Send(const HttpRequest& request, HttpResponse& response, HttpCancel* cancel) {
+    // 没有指定取消信号时使用局部的取消信号，使各步骤的代码不必区分
+    HttpCancel localCancel;
+    if (cancel == nullptr) {
+        cancel = &localCancel;
+    }
+
+    // 跟随重定向：301、302、303改为不带请求体的GET（与WinHTTP一致），307、308保持原方法
+    std::string method = request.method;
+    std::string url = request.url;
+    for (int redirects = 0;; redirects++) {
+        if (!SendOnce(request, method, url, cancel, response)) {
+            return false;
+        }
+        uint32_t status = response.statusCode;
+        if (!request.followRedirects || redirects >= kMaxRedirects ||
+            status < 300 || status >= 400 || status == 304 || response.location.empty()) {
+            return true;
+        }
+        std::string next = ResolveLocation(url, response.location);
+        if (next.empty() || next.compare(0, 7, "http://") != 0) {
+            return true;
+        }
+        if (status != 307 && status != 308 && method != "HEAD") {
+            method = "GET";
+        }
+        url = next;
+    }
+}
+
+bool SocketHttpTransport::SendOnce(const HttpRequest& request, const std::string& method, const std::string& url,
+                                   HttpCancel* cancel, HttpResponse& response) {
+    response.statusCode = 0;
+    response.location.clear();
+    response.body.clear();
+    response.truncated = false;
+
+    std::string host, path;
+    uint16_t port = 0;
+    if (!ParseUrl(url, host, port, path)) {
+        RecordFailure(HttpStage::ParseUrl, 0);
+        return false;
+    }
+    if (!InitializeSockets()) {
+        RecordFailure(HttpStage::Connect, LastSocketError());
+        return false;
+    }
+
+    // 只记录主机和路径，查询参数中可能有账号密码
+    TraceSpan span("http", "socket");
+    span.AddArg("verb", method);
+    span.AddArg("host", host);
+    span.AddArg("path", path.substr(0, path.find('?')));
+
+    uint32_t timeoutMs = request.timeoutMs > 0 ? request.timeoutMs : kDefaultTimeoutMs;
+    std::string key = host + ":" + std::to_string(port);
+
+    // 占用该主机的一个名额，有空闲的长连接时直接复用
+    uintptr_t socket = kNoSocket;
+    if (!AcquireConnection(key, cancel, socket)) {
+        return false;
+    }
+    bool reused = (socket != kNoSocket);
+
+    for (;;) {
+        if (socket == kNoSocket && !Connect(host, port, timeoutMs, cancel, socket)) {
+            ReleaseConnection(key, kNoSocket, false);
+            return false;
+        }
+
+        // 取消时只关闭套接字的读写，阻塞中的读写立即返回；套接字由本线程在注销中断函数后关闭
+        NativeSocket native = (NativeSocket)socket;
+        if (!cancel->SetInterrupter([native]() { ShutdownSocket(native); })) {
+            ReleaseConnection(key, socket, false);
+            return false;
+        }
+
+        bool reusable = false;
+        ExchangeResult result = Exchange(socket, request, method, host, port, path, timeoutMs, reused, response, reusable);
+        cancel->ClearInterrupter();
+
+        if (cancel->IsCancelled()) {
+            ReleaseConnection(key, socket, false);
+            return false;
+        }
+
+        // 服务器已关闭复用的空闲连接，换一个新连接重发（请求还没有被处理）
+        if (result == ExchangeResult::Stale) {
+            CloseSocket(native);
+            socket = kNoSocket;
+            reused = false;
+            continue;
+        }
+
+        ReleaseConnection(key, socket, result == ExchangeResult::Completed && reusable);
+        if (result == ExchangeResult::Completed) {
+            span.AddArg("status", (uint64_t)response.statusCode);
+            span.AddArg("reused", (uint64_t)(reused ? 1 : 0));
+        }
+        return result == ExchangeResult::Completed;
+    }
+}
+
+bool SocketHttpTransport::AcquireConnection(const std::string& key, HttpCancel* cancel, uintptr_t& socket) {
+    socket = kNoSocket;
+
+    // 取消时唤醒等待中的请求（在加锁前登记，中断函数需要获取连接池的锁）
+    if (!cancel->SetInterrupter([this]() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_released.notify_all();
+    })) {
+        return false;
+    }
+
+    bool acquired = false;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        uint64_t now = NowMs();
+        EvictIdleLocked(now);
+
+        // 达到单主机上限时等待其他请求归还；请求本身有超时，归还总会发生，所以不再另设等待上限
+        HostState& state = m_hosts[key];
+        m_released.wait(lock, [&]() {
+            return cancel->IsCancelled() || state.inFlight < m_maxPerHost;
+        });
+
+        if (!cancel->IsCancelled()) {
+            state.inFlight++;
+            acquired = true;
+
+            // 优先使用最近用过的连接，空闲期间已被对方关闭的连接直接丢弃
+            while (!state.idle.empty()) {
+                IdleConnection connection = state.idle.back();
+                state.idle.pop_back();
+                if (IsIdleConnectionAlive((NativeSocket)connection.socket)) {
+                    socket = connection.socket;
+                    break;
+                }
+                CloseSocket((NativeSocket)connection.socket);
+            }
+        }
+    }
+
+    // 在锁外注销：Cancel持有取消信号的锁执行中断函数，中断函数又要获取连接池的锁
+    cancel->ClearInterrupter();
+    return acquired;
+}
+
+void SocketHttpTransport::ReleaseConnection(const std::string& key, uintptr_t socket, bool reusable) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        HostState& state = m_hosts[key];
+        if (state.inFlight > 0) {
+            state.inFlight--;
+        }
+        if (socket != kNoSocket) {
+            if (reusable) {
+                state.idle.push_back({ socket, NowMs() });
+            } else {
+                CloseSocket((NativeSocket)socket);
+            }
+        }
+    }
+    m_released.notify_one();
+}
+
+bool SocketHttpTransport::Connect(const std::string& host, uint16_t port, uint32_t timeoutMs, HttpCancel* cancel,
+                                  uintptr_t& socket) {
+    socket = kNoSocket;
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    addrinfo* addresses = nullptr;
+    std::string service = std::to_string(port);
+    int resolveError = getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses);
+    if (resolveError != 0 || addresses == nullptr) {
+        RecordFailure(HttpStage::Connect, (uint32_t)resolveError);
+        return false;
+    }
+
+    uint32_t error = 0;
+    for (addrinfo* address = addresses; address != nullptr && socket == kNoSocket; address = address->ai_next) {
+        NativeSocket candidate = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (candidate == INVALID_SOCKET) {
+            error = LastSocketError();
+            continue;
+        }
+        int noDelay = 1;
+        setsockopt(candidate, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+        // 连接期间被取消时关闭套接字的读写，等待立即结束
+        if (!SetNonBlocking(candidate) || !cancel->SetInterrupter([candidate]() { ShutdownSocket(candidate); })) {
+            error = LastSocketError();
+            CloseSocket(candidate);
+            break;
+        }
+
+        bool connected = false;
+        if (connect(candidate, address->ai_addr, (int)address->ai_addrlen) == 0) {
+            connected = true;
+        } else if (IsConnectPending(LastSocketError()) && WaitSocket(candidate, true, timeoutMs)) {
+            int socketError = 0;
+            socklen_t length = sizeof(socketError);
+            getsockopt(candidate, SOL_SOCKET, SO_ERROR, (char*)&socketError, &length);
+            connected = (socketError == 0);
+            error = (uint32_t)socketError;
+        } else {
+            error = LastSocketError();
+        }
+        cancel->ClearInterrupter();
+
+        if (connected && !cancel->IsCancelled()) {
+            socket = (uintptr_t)candidate;
+        } else {
+            CloseSocket(candidate);
+            if (cancel->IsCancelled()) {
+                break;
+            }
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (socket == kNoSocket && !cancel->IsCancelled()) {
+        RecordFailure(HttpStage::Connect, error);
+    }
+    return socket != kNoSocket;
+}
+
+SocketHttpTransport::ExchangeResult SocketHttpTransport::Exchange(
+    uintptr_t socketValue, const HttpRequest& request, const std::string& method,
+    const std::string& host, uint16_t port, const std::string& path,
+    uint32_t timeoutMs, bool reused, HttpResponse& response, bool& reusable) {
+    NativeSocket socket = (NativeSocket)socketValue;
+    reusable = false;
+
+    // 请求行和请求头
+    bool withBody = (method != "GET" && method != "HEAD") || !request.body.empty();
+    std::string head;
+    head.reserve(256 + path.size() + request.headers.size());
+    head += method;
+    head += ' ';
+    head += path;
+    head += " HTTP/1.1\r\nHost: ";
+    head += (host.find(':') != std::string::npos) ? "[" + host + "]" : host;
+    if (port != 80) {
+        head += ':';
+        head += std::to_string(port);
+    }
+    head += "\r\nConnection: keep-alive\r\n";
+    head += request.headers;
+    if (withBody) {
+        head += "Content-Length: ";
+        head += std::to_string(request.body.size());
+        head += "\r\n";
+    }
+    head += "\r\n";
+    if (withBody) {
+        head += request.body;
+    }
+
+    if (!SendAll(socket, head.data(), head.size(), timeoutMs)) {
+        if (reused) {
+            return ExchangeResult::Stale;
+        }
+        RecordFailure(HttpStage::Send, LastSocketError());
+        return ExchangeResult::Failed;
+    }
+
+    // 接收响应头
+    std::string received;
+    size_t headerEnd = std::string::npos;
+    while (headerEnd == std::string::npos) {
+        if (received.size() > kMaxHeaderBytes) {
+            RecordFailure(HttpStage::Receive, 0);
+            return ExchangeResult::Failed;
+        }
+        char chunk[4096];
+        int length = ReceiveSome(socket, chunk, sizeof(chunk), timeoutMs);
+        if (length <= 0) {
+            // 复用的连接在收到任何响应之前被关闭，说明服务器已经关闭了这个空闲连接
+            if (reused && received.empty() && length == 0) {
+                return ExchangeResult::Stale;
+            }
+            RecordFailure(HttpStage::Receive, length == 0 ? 0 : LastSocketError());
+            return ExchangeResult::Failed;
+        }
+        received.append(chunk, (size_t)length);
+        headerEnd = received.find("\r\n\r\n");
+    }
+
+    // 状态行：HTTP/1.x 状态码 原因
+    size_t lineEnd = received.find("\r\n");
+    size_t statusBegin = received.find(' ');
+    if (received.compare(0, 5, "HTTP/") != 0 || statusBegin == std::string::npos || statusBegin > lineEnd) {
+        RecordFailure(HttpStage::Receive, 0);
+        return ExchangeResult::Failed;
+    }
+    response.statusCode = (uint32_t)strtoul(received.c_str() + statusBegin + 1, nullptr, 10);
+    bool keepAlive = received.compare(0, 8, "HTTP/1.1") == 0;
+
+    bool hasLength = false;
+    uint64_t contentLength = 0;
+    bool chunked = false;
+    for (size_t begin = lineEnd + 2; begin < headerEnd;) {
+        size_t end = received.find("\r\n", begin);
+        size_t colon = received.find(':', begin);
+        if (colon != std::string::npos && colon < end) {
+            std::string name = received.substr(begin, colon - begin);
+            size_t valueBegin = received.find_first_not_of(" \t", colon + 1);
+            std::string value = (valueBegin == std::string::npos || valueBegin >= end) ?
+                std::string() : received.substr(valueBegin, end - valueBegin);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+                value.pop_back();
+            }
+            if (HeaderNameEquals(name, "Content-Length")) {
+                hasLength = true;
+                contentLength = strtoull(value.c_str(), nullptr, 10);
+            } else if (HeaderNameEquals(name, "Location")) {
+                response.location = value;
+            } else if (HeaderNameEquals(name, "Connection")) {
+                if (HeaderNameEquals(value, "close")) {
+                    keepAlive = false;
+                } else if (HeaderNameEquals(value, "keep-alive")) {
+                    keepAlive = true;
+                }
+            } else if (HeaderNameEquals(name, "Transfer-Encoding")) {
+                chunked = !HeaderNameEquals(value, "identity");
+            }
+        }
+        begin = end + 2;
+    }
+
+    // HEAD请求和1xx、204、304响应没有响应体
+    uint32_t status = response.statusCode;
+    bool noBody = method == "HEAD" || status < 200 || status == 204 || status == 304;
+    if (noBody) {
+        hasLength = true;
+        contentLength = 0;
+        chunked = false;
+    }
+
+    // 与响应头一起收到的响应体数据
+    const char* pending = received.data() + headerEnd + 4;
+    size_t pendingLength = received.size() - (headerEnd + 4);
+
+    // 不需要响应体、或者无法解析响应体时，连接只有在没有剩余数据时才能复用
+    if (!request.readBody || chunked) {
+        if (chunked && request.readBody) {
+            RecordFailure(HttpStage::Read, 0);
+        }
+        reusable = keepAlive && hasLength && contentLength == 0 && pendingLength == 0;
+        return ExchangeResult::Completed;
+    }
+
+    ResponseBodyReader reader(request.maxBodyBytes, request.consumer, response.body);
+    if (!request.consumer && hasLength) {
+        reader.Reserve((size_t)contentLength);
+    }
+
+    // 数据读入复用的接收缓冲区；先交出已收到的部分，再从套接字读取。
+    // 有Content-Length时读到该长度为止，没有时读到对方关闭连接为止
+    uint64_t remaining = contentLength;
+    bool complete = hasLength && remaining == 0;
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    while (!complete && reader.NextBuffer(buffer, capacity)) {
+        size_t want = capacity;
+        if (hasLength && remaining < want) {
+            want = (size_t)remaining;
+        }
+
+        size_t length;
+        if (pendingLength > 0) {
+            length = std::min(want, pendingLength);
+            memcpy(buffer, pending, length);
+            pending += length;
+            pendingLength -= length;
+        } else {
+            int got = ReceiveSome(socket, buffer, want, timeoutMs);
+            if (got == 0 && !hasLength) {
+                complete = true;
+                break;
+            }
+            if (got <= 0) {
+                RecordFailure(HttpStage::Read, got == 0 ? 0 : LastSocketError());
+                break;
+            }
+            length = (size_t)got;
+        }
+
+        if (hasLength) {
+            remaining -= length;
+        }
+        bool more = reader.Commit(length);
+        if (hasLength && remaining == 0) {
+            complete = true;
+        }
+
+        // 达到上限或调用方已拿到所需数据时结束读取，未读的数据随连接一起丢弃
+        if (!more) {
+            break;
+        }
+    }
+    response.truncated = reader.IsTruncated();
+
+    reusable = keepAlive && hasLength && complete && pendingLength == 0;
+    return ExchangeResult::Completed;
+}
+
+void SocketHttpTransport::EvictIdleLocked(uint64_t nowMs) {
+    for (auto& host : m_hosts) {
+        std::vector<IdleConnection>& idle = host.second.idle;
+        for (auto it = idle.begin(); it != idle.end();) {
+            if (nowMs - it->lastUsedMs >= m_idleTimeoutMs) {
+                CloseSocket((NativeSocket)it->socket);
+                it = idle.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
@@ -0,0 +1,138 @@
+﻿#include "../include/status_page.h"
+#include <cstring>
+#include <cstdio>
+
+void StatusPage::Initialize(Layout* page) {
+    page->magic.store(0, std::memory_order_relaxed);
+    page->version.store(kVersion, std::memory_order_relaxed);
+    page->sequence.store(0, std::memory_order_relaxed);
+    page->reserved = 0;
+    for (size_t i = 0; i < kDataWords; i++) {
+        page->words[i].store(0, std::memory_order_relaxed);
+    }
+    // 页头最后写入，读者看到kMagic时其余字段都已初始化
+    page->magic.store(kMagic, std::memory_order_release);
+}
+
+void StatusPage::Publish(Layout* page, const StatusPageData& data) {
+    uint64_t words[kDataWords] = {};
+    memcpy(words, &data, sizeof(data));
+
+    // 序号变为奇数后再写数据，写完后变为偶数；
+    // release屏障保证读者看到新数据时一定也看到了奇数序号
+    uint32_t sequence = page->sequence.load(std::memory_order_relaxed);
+    page->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < kDataWords; i++) {
+        page->words[i].store(words[i], std::memory_order_relaxed);
+    }
+
+    page->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool StatusPage::TryRead(const Layout* page, StatusPageData& data) {
+    if (!IsCompatible(page)) {
+        return false;
+    }
+
+    uint32_t before = page->sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+        return false;
+    }
+
+    uint64_t words[kDataWords];
+    for (size_t i = 0; i < kDataWords; i++) {
+        words[i] = page->words[i].load(std::memory_order_relaxed);
+    }
+
+    // acquire屏障保证数据读取完成后才重新读取序号
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (page->sequence.load(std::memory_order_relaxed) != before) {
+        return false;
+    }
+
+    memcpy(&data, words, sizeof(data));
+    return true;
+}
+
+bool StatusPage::Read(const Layout* page, StatusPageData& data, uint32_t maxAttempts, uint32_t* pRetries) {
+    if (pRetries != nullptr) {
+        *pRetries = 0;
+    }
+    if (!IsCompatible(page)) {
+        return false;
+    }
+
+    for (uint32_t attempt = 0; attempt < maxAttempts; attempt++) {
+        if (TryRead(page, data)) {
+            return true;
+        }
+        if (pRetries != nullptr) {
+            (*pRetries)++;
+        }
+    }
+    return false;
+}
+
+bool StatusPage::IsCompatible(const Layout* page) {
+    return page->magic.load(std::memory_order_acquire) == kMagic &&
+           page->version.load(std::memory_order_relaxed) == kVersion;
+}
+
+std::string StatusPage::FormatAddress(const StatusPageData& data) {
+    char text[48];
+
+    if (data.addressFamily == 4) {
+        snprintf(text, sizeof(text), "%u.%u.%u.%u",
+                 data.address[0], data.address[1], data.address[2], data.address[3]);
+        return text;
+    }
+
+    if (data.addressFamily != 6) {
+        return std::string();
+    }
+
+    uint16_t groups[8];
+    for (int i = 0; i < 8; i++) {
+        groups[i] = (uint16_t)((data.address[i * 2] << 8) | data.address[i * 2 + 1]);
+    }
+
+    // 找出最长的连续零组（至少两组才压缩）
+    int bestStart = -1;
+    int bestLength = 1;
+    for (int i = 0; i < 8;) {
+        if (groups[i] != 0) {
+            i++;
+            continue;
+        }
+        int start = i;
+        while (i < 8 && groups[i] == 0) {
+            i++;
+        }
+        if (i - start > bestLength) {
+            bestStart = start;
+            bestLength = i - start;
+        }
+    }
+
+    std::string result;
+    for (int i = 0; i < 8; i++) {
+        if (i == bestStart) {
+            result += "::";
+            i += bestLength - 1;
+            continue;
+        }
+        if (!result.empty() && result.back() != ':') {
+            result += ':';
+        }
+        snprintf(text, sizeof(text), "%x", groups[i]);
+        result += text;
+    }
+    return result;
+}
+
+std::string StatusPage::Ssid(const StatusPageData& data) {
+    uint32_t length = data.ssidLength < sizeof(data.ssid) ? data.ssidLength : (uint32_t)sizeof(data.ssid);
+    return std::string(reinterpret_cast<const char*>(data.ssid), length);
+}
@@ -0,0 +1,151 @@
+﻿#include "../include/status_page_mapping.h"
+#include <sddl.h>
+#include <iostream>
+
+#pragma comment(lib, "advapi32.lib")
+
+namespace {
+
+// 状态页的访问权限：系统和管理员完全控制，已登录的用户只读（托盘程序和监控程序不需要管理员权限）
+const wchar_t* const kStatusPageSddl = L"D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;GR;;;AU)";
+
+} // namespace
+
+StatusPageWriter::StatusPageWriter() : m_hMapping(NULL), m_page(nullptr) {
+}
+
+StatusPageWriter::~StatusPageWriter() {
+    Close();
+}
+
+std::wstring StatusPageWriter::NameForService(const std::wstring& serviceName) {
+    return serviceName + L".Status";
+}
+
+bool StatusPageWriter::Create(const std::wstring& serviceName) {
+    Close();
+
+    std::wstring name = NameForService(serviceName);
+    if (CreateMapping(L"Global\\" + name)) {
+        return true;
+    }
+    if (GetLastError() != ERROR_ACCESS_DENIED) {
+        return false;
+    }
+    return CreateMapping(L"Local\\" + name);
+}
+
+bool StatusPageWriter::CreateMapping(const std::wstring& mappingName) {
+    PSECURITY_DESCRIPTOR pDescriptor = NULL;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(kStatusPageSddl, SDDL_REVISION_1, &pDescriptor, NULL)) {
+        std::wcerr << L"创建状态页安全描述符失败，错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+
+    SECURITY_ATTRIBUTES attributes = { sizeof(SECURITY_ATTRIBUTES), pDescriptor, FALSE };
+    HANDLE hMapping = CreateFileMappingW(INVALID_HANDLE_VALUE, &attributes, PAGE_READWRITE,
+                                         0, (DWORD)sizeof(StatusPage::Layout), mappingName.c_str());
+    DWORD error = GetLastError();
+    LocalFree(pDescriptor);
+
+    if (hMapping == NULL) {
+        // 没有创建全局对象的权限时由调用者退回到会话内的名称，不输出错误
+        if (error != ERROR_ACCESS_DENIED) {
+            std::wcerr << L"创建状态页失败: " << mappingName << L"，错误码: " << error << std::endl;
+        }
+        SetLastError(error);
+        return false;
+    }
+
+    if (error == ERROR_ALREADY_EXISTS) {
+        // 另一个实例正在发布，不能有两个写者
+        std::wcerr << L"状态页已被其他实例使用: " << mappingName << std::endl;
+        CloseHandle(hMapping);
+        SetLastError(ERROR_ALREADY_EXISTS);
+        return false;
+    }
+
+    void* pView = MapViewOfFile(hMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(StatusPage::Layout));
+    if (pView == NULL) {
+        error = GetLastError();
+        std::wcerr << L"映射状态页失败，错误码: " << error << std::endl;
+        CloseHandle(hMapping);
+        SetLastError(error);
+        return false;
+    }
+
+    m_hMapping = hMapping;
+    m_page = static_cast<StatusPage::Layout*>(pView);
+    m_mappingName = mappingName;
+    StatusPage::Initialize(m_page);
+    return true;
+}
+
+void StatusPageWriter::Close() {
+    if (m_page != nullptr) {
+        UnmapViewOfFile(m_page);
+        m_page = nullptr;
+    }
+    if (m_hMapping != NULL) {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+    }
+    m_mappingName.clear();
+}
+
+void StatusPageWriter::Publish(const StatusPageData& data) {
+    if (m_page != nullptr) {
+        StatusPage::Publish(m_page, data);
+    }
+}
+
+StatusPageReader::StatusPageReader() : m_hMapping(NULL), m_page(nullptr) {
+}
+
+StatusPageReader::~StatusPageReader() {
+    Close();
+}
+
+bool StatusPageReader::Open(const std::wstring& serviceName) {
+    Close();
+
+    std::wstring name = StatusPageWriter::NameForService(serviceName);
+    HANDLE hMapping = OpenFileMappingW(FILE_MAP_READ, FALSE, (L"Global\\" + name).c_str());
+    if (hMapping == NULL) {
+        hMapping = OpenFileMappingW(FILE_MAP_READ, FALSE, (L"Local\\" + name).c_str());
+    }
+    if (hMapping == NULL) {
+        return false;
+    }
+
+    void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, sizeof(StatusPage::Layout));
+    if (pView == NULL) {
+        CloseHandle(hMapping);
+        return false;
+    }
+
+    m_hMapping = hMapping;
+    m_page = static_cast<const StatusPage::Layout*>(pView);
+    return true;
+}
+
+void StatusPageReader::Close() {
+    if (m_page != nullptr) {
+        UnmapViewOfFile(m_page);
+        m_page = nullptr;
+    }
+    if (m_hMapping != NULL) {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+    }
+}
+
+bool StatusPageReader::Read(StatusPageData& data, uint32_t* pRetries) const {
+    if (m_page == nullptr) {
+        if (pRetries != nullptr) {
+            *pRetries = 0;
+        }
+        return false;
+    }
+    return StatusPage::Read(m_page, data, 1000, pRetries);
+}
@@ -0,0 +1,191 @@
+﻿#include "../include/timer_wheel.h"
+#include <chrono>
+
+TimerWheel::TimerWheel(Clock clock, uint64_t tickMs) :
+    m_clock(clock),
+    m_tickMs(tickMs > 0 ? tickMs : 1),
+    m_currentTick(0),
+    m_nextId(1) {
+    // 默认使用单调时钟
+    if (!m_clock) {
+        m_clock = []() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        };
+    }
+
+    m_currentTick = m_clock() / m_tickMs;
+}
+
+TimerWheel::TimerId TimerWheel::Schedule(uint64_t delayMs, Callback callback, uint64_t periodMs) {
+    TimerId id = m_nextId++;
+
+    Timer& timer = m_timers[id];
+    timer.expires = ExpiryTick(delayMs);
+    timer.periodTicks = periodMs > 0 ? ToTicks(periodMs) : 0;
+    timer.callback = std::move(callback);
+    Place(id, timer);
+
+    return id;
+}
+
+bool TimerWheel::Reschedule(TimerId id, uint64_t delayMs) {
+    auto it = m_timers.find(id);
+    if (it == m_timers.end()) {
+        return false;
+    }
+
+    Unlink(it->second);
+    it->second.expires = ExpiryTick(delayMs);
+    Place(id, it->second);
+    return true;
+}
+
+bool TimerWheel::Cancel(TimerId id) {
+    auto it = m_timers.find(id);
+    if (it == m_timers.end()) {
+        return false;
+    }
+
+    Unlink(it->second);
+    m_timers.erase(it);
+    return true;
+}
+
+bool TimerWheel::IsScheduled(TimerId id) const {
+    return m_timers.find(id) != m_timers.end();
+}
+
+uint64_t TimerWheel::NextDeadline() const {
+    if (m_timers.empty()) {
+        return kNoDeadline;
+    }
+
+    // 每层从下一个槽开始找第一个非空的槽，取其中最早的到期时间。
+    // 最高层还暂存着超出时间轮范围的定时器，它们所在的槽早于实际到期时间，不能只看第一个非空的槽
+    uint64_t earliest = UINT64_MAX;
+    for (int level = 0; level < kLevels; level++) {
+        uint64_t start = (m_currentTick >> (level * kSlotBits)) + 1;
+        for (uint64_t i = 0; i < kSlots; i++) {
+            const std::list<TimerId>& slot = m_slots[level][(start + i) & kSlotMask];
+            if (slot.empty()) {
+                continue;
+            }
+            for (TimerId id : slot) {
+                uint64_t expires = m_timers.find(id)->second.expires;
+                if (expires < earliest) {
+                    earliest = expires;
+                }
+            }
+            if (level < kLevels - 1) {
+                break;
+            }
+        }
+    }
+
+    // 已过期但还没处理的定时器
+    if (earliest <= m_currentTick) {
+        earliest = m_currentTick + 1;
+    }
+
+    return earliest * m_tickMs;
+}
+
+size_t TimerWheel::Advance() {
+    uint64_t nowTick = Now() / m_tickMs;
+    size_t fired = 0;
+
+    while (m_currentTick < nowTick) {
+        // 没有定时器时直接跳到当前时间
+        if (m_timers.empty()) {
+            m_currentTick = nowTick;
+            break;
+        }
+
+        uint64_t tick = ++m_currentTick;
+
+        // 先处理高层，使从高层下移的定时器能继续下移到第0层
+        for (int level = kLevels - 1; level > 0; level--) {
+            uint64_t mask = (1ULL << (level * kSlotBits)) - 1;
+            if ((tick & mask) == 0) {
+                Cascade(level, (tick >> (level * kSlotBits)) & kSlotMask);
+            }
+        }
+
+        fired += Expire(tick & kSlotMask);
+    }
+
+    return fired;
+}
+
+uint64_t TimerWheel::Now() const {
+    return m_clock();
+}
+
+uint64_t TimerWheel::ExpiryTick(uint64_t delayMs) const {
+    // 当前tick已经处理过，已到期的定时器放到下一个tick执行
+    uint64_t expires = ToTicks(Now() + delayMs);
+    return expires > m_currentTick ? expires : m_currentTick + 1;
+}
+
+void TimerWheel::Place(TimerId id, Timer& timer) {
+    // 从上层下移时到期时间可能正好是当前tick，此时放入第0层的当前槽，紧接着在本tick执行
+    uint64_t delta = timer.expires - m_currentTick;
+    uint64_t target = timer.expires;
+
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (1ULL << ((level + 1) * kSlotBits))) {
+        level++;
+    }
+
+    // 超出时间轮范围的定时器先放在最高层的最远处，下移时再重新计算
+    uint64_t range = 1ULL << (kLevels * kSlotBits);
+    if (delta >= range) {
+        target = m_currentTick + range - 1;
+    }
+
+    timer.level = level;
+    timer.slot = (target >> (level * kSlotBits)) & kSlotMask;
+
+    std::list<TimerId>& slot = m_slots[level][timer.slot];
+    timer.position = slot.insert(slot.end(), id);
+}
+
+void TimerWheel::Unlink(Timer& timer) {
+    m_slots[timer.level][timer.slot].erase(timer.position);
+}
+
+void TimerWheel::Cascade(int level, uint64_t slot) {
+    std::list<TimerId> pending;
+    pending.swap(m_slots[level][slot]);
+
+    for (TimerId id : pending) {
+        Place(id, m_timers.find(id)->second);
+    }
+}
+
+size_t TimerWheel::Expire(uint64_t slot) {
+    std::list<TimerId>& timers = m_slots[0][slot];
+    size_t fired = 0;
+
+    // 逐个取出执行，回调中可以安全地添加、修改或取消定时器
+    while (!timers.empty()) {
+        TimerId id = timers.front();
+        timers.pop_front();
+
+        auto it = m_timers.find(id);
+        Callback callback = it->second.callback;
+
+        if (it->second.periodTicks > 0) {
+            it->second.expires = m_currentTick + it->second.periodTicks;
+            Place(id, it->second);
+        } else {
+            m_timers.erase(it);
+        }
+
+        callback();
+        fired++;
+    }
+
+    return fired;
+}
@@ -0,0 +1,211 @@
+﻿#include "../include/trace.h"
+#include <chrono>
+
+Tracer& Tracer::Instance() {
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::Tracer() : m_inCycle(false), m_nextCycleId(1), m_maxCycles(16) {
+    m_current.id = 0;
+    m_current.startUs = 0;
+    m_current.endUs = 0;
+}
+
+uint64_t Tracer::NowUs() {
+    // 以第一次调用的时间为0点，导出的时间戳较小，便于阅读
+    static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - origin).count());
+}
+
+uint32_t Tracer::CurrentThreadId() {
+    static std::atomic<uint32_t> nextId(1);
+    thread_local uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+std::string Tracer::ToUtf8(const std::wstring& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        uint32_t code = static_cast<uint32_t>(text[i]);
+        
+        // UTF-16代理对（wchar_t为16位时）
+        if (code >= 0xD800 && code <= 0xDBFF && i + 1 < text.size()) {
+            uint32_t low = static_cast<uint32_t>(text[i + 1]);
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+        
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+    return out;
+}
+
+void Tracer::BeginCycle(const std::string& reason) {
+    if (InCycle()) {
+        EndCycle();
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_current.id = m_nextCycleId++;
+    m_current.reason = reason;
+    m_current.startUs = NowUs();
+    m_current.endUs = 0;
+    m_current.spans.clear();
+    m_inCycle.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::EndCycle(bool keep) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_inCycle.load(std::memory_order_relaxed)) {
+        return;
+    }
+    m_inCycle.store(false, std::memory_order_relaxed);
+    
+    if (!keep) {
+        m_current.spans.clear();
+        return;
+    }
+    
+    m_current.endUs = NowUs();
+    m_cycles.push_back(std::move(m_current));
+    while (m_cycles.size() > m_maxCycles) {
+        m_cycles.pop_front();
+    }
+    m_current = Cycle();
+}
+
+void Tracer::AddSpan(Span span) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_inCycle.load(std::memory_order_relaxed)) {
+        m_current.spans.push_back(std::move(span));
+    }
+}
+
+void Tracer::SetMaxCycles(size_t maxCycles) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxCycles = maxCycles > 0 ? maxCycles : 1;
+    while (m_cycles.size() > m_maxCycles) {
+        m_cycles.pop_front();
+    }
+}
+
+size_t Tracer::CycleCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cycles.size();
+}
+
+void Tracer::AppendJsonString(std::string& out, const std::string& text) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20) {
+            out += "\\u00";
+            out += hex[u >> 4];
+            out += hex[u & 0xF];
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+std::string Tracer::ExportChromeTrace() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    
+    // 周期本身画在0号线程上，各步骤画在执行它的线程上
+    out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"cycles\"}}";
+    
+    for (const Cycle& cycle : m_cycles) {
+        out += ",{\"name\":";
+        AppendJsonString(out, "cycle " + std::to_string(cycle.id));
+        out += ",\"cat\":\"cycle\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" + std::to_string(cycle.startUs);
+        out += ",\"dur\":" + std::to_string(cycle.endUs - cycle.startUs);
+        out += ",\"args\":{\"reason\":";
+        AppendJsonString(out, cycle.reason);
+        out += "}}";
+        
+        for (const Span& span : cycle.spans) {
+            out += ",{\"name\":";
+            AppendJsonString(out, span.name);
+            out += ",\"cat\":";
+            AppendJsonString(out, span.category);
+            out += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(span.threadId);
+            out += ",\"ts\":" + std::to_string(span.startUs);
+            out += ",\"dur\":" + std::to_string(span.durationUs);
+            out += ",\"args\":{";
+            for (size_t i = 0; i < span.args.size(); i++) {
+                if (i > 0) {
+                    out += ",";
+                }
+                AppendJsonString(out, span.args[i].first);
+                out += ":";
+                AppendJsonString(out, span.args[i].second);
+            }
+            out += "}}";
+        }
+    }
+    
+    out += "]}";
+    return out;
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category) : m_active(Tracer::Instance().InCycle()) {
+    // 不在周期中时不做任何记录
+    if (m_active) {
+        m_span.name = name;
+        m_span.category = category;
+        m_span.startUs = Tracer::NowUs();
+        m_span.durationUs = 0;
+        m_span.threadId = Tracer::CurrentThreadId();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (m_active) {
+        m_span.durationUs = Tracer::NowUs() - m_span.startUs;
+        Tracer::Instance().AddSpan(std::move(m_span));
+    }
+}
+
+void TraceSpan::AddArg(const char* key, const std::string& value) {
+    if (m_active) {
+        m_span.args.emplace_back(key, value);
+    }
+}
+
+void TraceSpan::AddArg(const char* key, const std::wstring& value) {
+    if (m_active) {
+        m_span.args.emplace_back(key, Tracer::ToUtf8(value));
+    }
+}
+
+void TraceSpan::AddArg(const char* key, uint64_t value) {
+    if (m_active) {
+        m_span.args.emplace_back(key, std::to_string(value));
+    }
+}
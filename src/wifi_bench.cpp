@@ -0,0 +1,332 @@
+﻿#include <windows.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <new>
+#include <cstdlib>
+#include <fcntl.h>
+#include <io.h>
+#include "../include/wifi_service.h"
+#include "../include/status_page_mapping.h"
+#include "../include/mock_portal.h"
+#include "../include/fake_wlan.h"
+
+#pragma comment(lib, "winmm.lib")
+
+// 端到端重连基准测试
+// 在同一进程中运行完整的WifiService、模拟的无线网卡（FakeWlan）和模拟认证服务器（MockPortal）：
+// 每个周期断开WiFi并清除认证服务器上的会话，测量服务重新连接、等待地址、探测、查询状态、登录直到
+// 共享状态页显示在线的耗时，以及每个周期的网络字节数、内存分配次数和工作线程唤醒次数
+
+namespace {
+
+// 被测代码的内存分配统计（排除模拟认证服务器的线程）
+std::atomic<uint64_t> g_allocations(0);
+std::atomic<uint64_t> g_allocatedBytes(0);
+
+void CountAllocation(size_t size) {
+    if (!MockPortal::IsServerThread()) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+// 基准测试选项
+struct BenchOptions {
+    int cycles = 50;                    // 计入结果的周期数
+    int warmup = 3;                     // 预热周期数
+    DWORD timeoutMs = 30000;            // 单个周期的超时时间
+    FakeWlanOptions wlan;               // 模拟无线网卡的扫描、关联和DHCP耗时
+    MockPortalFaults portalFaults;      // 认证服务器的延迟
+    DWORD maxStopMs = 0;                // 大于0时在HTTP请求进行中停止服务，停止耗时超过该值则失败
+    bool verbose = false;               // 显示服务的输出
+};
+
+// 一个周期的测量结果
+struct CycleSample {
+    double timeToOnlineMs;
+    uint64_t bytes;
+    uint64_t requests;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    uint64_t wakeups;
+    uint64_t apiCalls;
+};
+
+void PrintUsage() {
+    std::wcout << L"用法: wifi_bench [选项]\n"
+               << L"  --cycles <次数>         计入结果的重连周期数，默认50\n"
+               << L"  --warmup <次数>         预热周期数，默认3\n"
+               << L"  --scan-ms <毫秒>        模拟扫描耗时，默认0\n"
+               << L"  --associate-ms <毫秒>   模拟关联耗时，默认30\n"
+               << L"  --address-ms <毫秒>     模拟DHCP耗时，默认50\n"
+               << L"  --portal-latency <毫秒> 认证服务器每个请求的延迟，默认0\n"
+               << L"  --portal-jitter <毫秒>  认证服务器的随机延迟，默认0\n"
+               << L"  --max-stop-ms <毫秒>    最后在HTTP请求进行中停止服务，停止耗时超过该值时返回1\n"
+               << L"  --verbose               显示服务的输出\n";
+}
+
+bool ParseOptions(int argc, wchar_t* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::wstring arg = argv[i];
+        if (arg == L"--verbose") {
+            options.verbose = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        int value = _wtoi(argv[++i]);
+        if (value < 0) {
+            return false;
+        }
+        if (arg == L"--cycles" && value > 0) {
+            options.cycles = value;
+        } else if (arg == L"--warmup") {
+            options.warmup = value;
+        } else if (arg == L"--scan-ms") {
+            options.wlan.scanMs = (DWORD)value;
+        } else if (arg == L"--associate-ms") {
+            options.wlan.associateMs = (DWORD)value;
+        } else if (arg == L"--address-ms") {
+            options.wlan.addressMs = (DWORD)value;
+        } else if (arg == L"--portal-latency") {
+            options.portalFaults.latencyMs = (uint32_t)value;
+        } else if (arg == L"--portal-jitter") {
+            options.portalFaults.jitterMs = (uint32_t)value;
+        } else if (arg == L"--max-stop-ms" && value > 0) {
+            options.maxStopMs = (DWORD)value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 等待状态页显示服务在线，且登录次数达到expectedLogins（确认是本周期的登录）
+bool WaitForOnline(StatusPageReader& reader, uint64_t expectedLogins, DWORD timeoutMs, StatusPageData& data) {
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    while (GetTickCount64() < deadline) {
+        if (reader.Read(data) &&
+            data.state == (uint32_t)ConnectionState::Online &&
+            data.loginCount >= expectedLogins) {
+            return true;
+        }
+        Sleep(1);
+    }
+    return false;
+}
+
+// 让认证服务器挂起所有请求后断开WiFi，等服务的HTTP请求到达认证服务器（工作线程正阻塞在请求中）时停止服务，
+// 返回停止耗时；停止必须靠取消正在进行的请求完成，而不是等请求超时
+bool MeasureStopDuringRequest(WifiService& service, MockPortal& portal, FakeWlan& wlan, DWORD timeoutMs, ULONGLONG& stopMs) {
+    MockPortalFaults hang;
+    hang.latencyMs = 60000;
+    portal.SetFaults(MockEndpoint::Chkstatus, hang);
+    portal.SetFaults(MockEndpoint::Login, hang);
+    portal.SetFaults(MockEndpoint::Probe, hang);
+    
+    uint64_t requestsBefore = portal.GetStats().requests;
+    wlan.DropLink();
+    
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    while (portal.GetStats().requests == requestsBefore) {
+        if (GetTickCount64() >= deadline) {
+            return false;
+        }
+        Sleep(1);
+    }
+    
+    service.Stop();
+    stopMs = service.GetLastStopLatency();
+    return true;
+}
+
+template <typename T>
+T Percentile(std::vector<T> values, double p) {
+    if (values.empty()) {
+        return T();
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+template <typename T>
+double Average(const std::vector<CycleSample>& samples, T CycleSample::*field) {
+    double sum = 0;
+    for (const CycleSample& sample : samples) {
+        sum += (double)(sample.*field);
+    }
+    return samples.empty() ? 0 : sum / samples.size();
+}
+
+void PrintReport(const BenchOptions& options, const std::vector<CycleSample>& samples) {
+    std::vector<double> times;
+    for (const CycleSample& sample : samples) {
+        times.push_back(sample.timeToOnlineMs);
+    }
+    
+    std::wcout << L"重连周期: " << samples.size() << L"（预热" << options.warmup << L"）"
+               << L"，模拟扫描" << options.wlan.scanMs << L"ms、关联" << options.wlan.associateMs
+               << L"ms、DHCP" << options.wlan.addressMs << L"ms，认证服务器延迟" << options.portalFaults.latencyMs << L"ms\n";
+    std::wcout << L"上线耗时: p50=" << Percentile(times, 0.50) << L"ms p90=" << Percentile(times, 0.90)
+               << L"ms p99=" << Percentile(times, 0.99) << L"ms min=" << Percentile(times, 0.0)
+               << L"ms max=" << Percentile(times, 1.0) << L"ms\n";
+    std::wcout << L"每个周期: 网络" << Average(samples, &CycleSample::bytes) << L"字节（"
+               << Average(samples, &CycleSample::requests) << L"个HTTP请求），内存分配"
+               << Average(samples, &CycleSample::allocations) << L"次（"
+               << Average(samples, &CycleSample::allocatedBytes) << L"字节），工作线程唤醒"
+               << Average(samples, &CycleSample::wakeups) << L"次，WLAN/IP Helper调用"
+               << Average(samples, &CycleSample::apiCalls) << L"次\n";
+}
+
+} // namespace
+
+// 统计进程内所有operator new（数组和对齐版本以外的形式都会转到这里）
+void* operator new(size_t size) {
+    CountAllocation(size);
+    void* memory = malloc(size > 0 ? size : 1);
+    if (memory == NULL) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    CountAllocation(size);
+    return malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    free(memory);
+}
+
+int wmain(int argc, wchar_t* argv[]) {
+    SetConsoleOutputCP(CP_UTF8);
+    _setmode(_fileno(stdout), _O_U8TEXT);
+    _setmode(_fileno(stderr), _O_U8TEXT);
+    
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    
+    // 状态页用Sleep(1)轮询，提高计时器精度使测量误差在1毫秒左右
+    timeBeginPeriod(1);
+    
+    MockPortal portal;
+    portal.SetFaults(MockEndpoint::Chkstatus, options.portalFaults);
+    portal.SetFaults(MockEndpoint::Login, options.portalFaults);
+    portal.SetFaults(MockEndpoint::Probe, options.portalFaults);
+    if (!portal.Start()) {
+        std::wcerr << L"启动模拟认证服务器失败" << std::endl;
+        return 1;
+    }
+    
+    // 启动时WiFi已连接并有地址，服务探测后登录
+    FakeWlan& wlan = FakeWlan::Instance();
+    wlan.SetOptions(options.wlan);
+    wlan.SetConnected();
+    
+    // 服务的逐步输出会影响计时，默认关闭
+    if (!options.verbose) {
+        std::wcout.setstate(std::ios::badbit);
+        std::wcerr.setstate(std::ios::badbit);
+    }
+    
+    const std::wstring serviceName = L"WifiBench";
+    std::string baseUrl = portal.GetBaseUrl();
+    
+    int exitCode = 0;
+    std::vector<CycleSample> samples;
+    {
+        WifiService service;
+        service.SetServiceName(serviceName);
+        service.SetTargetWifi(options.wlan.ssid, L"");
+        service.SetCampusNetworkCredentials(L"bench", L"bench");
+        service.SetPortalBaseUrl(std::wstring(baseUrl.begin(), baseUrl.end()));
+        
+        StatusPageReader reader;
+        StatusPageData data;
+        if (!service.Start() || !reader.Open(serviceName) || !WaitForOnline(reader, 1, options.timeoutMs, data)) {
+            std::wcout.clear();
+            std::wcerr.clear();
+            std::wcerr << L"服务未能上线" << std::endl;
+            service.Stop();
+            portal.Stop();
+            return 1;
+        }
+        
+        for (int cycle = 0; cycle < options.warmup + options.cycles; cycle++) {
+            MockPortalStats portalBefore = portal.GetStats();
+            uint64_t wakeupsBefore = data.wakeupCount;
+            uint64_t loginsBefore = data.loginCount;
+            uint64_t allocationsBefore = g_allocations.load();
+            uint64_t bytesBefore = g_allocatedBytes.load();
+            uint64_t apiCallsBefore = wlan.GetApiCallCount();
+            
+            // 认证服务器上的会话被清除，重新连接后需要重新登录
+            portal.ClearSessions();
+            auto start = std::chrono::steady_clock::now();
+            wlan.DropLink();
+            
+            if (!WaitForOnline(reader, loginsBefore + 1, options.timeoutMs, data)) {
+                std::wcout.clear();
+                std::wcerr.clear();
+                std::wcerr << L"第" << (cycle + 1) << L"个周期未能在" << options.timeoutMs << L"毫秒内上线" << std::endl;
+                exitCode = 1;
+                break;
+            }
+            
+            CycleSample sample;
+            sample.timeToOnlineMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            MockPortalStats portalAfter = portal.GetStats();
+            sample.bytes = (portalAfter.bytesReceived + portalAfter.bytesSent) - (portalBefore.bytesReceived + portalBefore.bytesSent);
+            sample.requests = portalAfter.requests - portalBefore.requests;
+            sample.allocations = g_allocations.load() - allocationsBefore;
+            sample.allocatedBytes = g_allocatedBytes.load() - bytesBefore;
+            sample.wakeups = data.wakeupCount - wakeupsBefore;
+            sample.apiCalls = wlan.GetApiCallCount() - apiCallsBefore;
+            if (cycle >= options.warmup) {
+                samples.push_back(sample);
+            }
+        }
+        
+        if (exitCode == 0 && options.maxStopMs > 0) {
+            ULONGLONG stopMs = 0;
+            bool measured = MeasureStopDuringRequest(service, portal, wlan, options.timeoutMs, stopMs);
+            std::wcout.clear();
+            std::wcerr.clear();
+            if (!measured) {
+                std::wcerr << L"服务未能在" << options.timeoutMs << L"毫秒内向认证服务器发出请求" << std::endl;
+                exitCode = 1;
+            } else if (stopMs > options.maxStopMs) {
+                std::wcerr << L"HTTP请求进行中停止服务耗时" << stopMs << L"毫秒，超过上限" << options.maxStopMs << L"毫秒" << std::endl;
+                exitCode = 1;
+            } else {
+                std::wcout << L"HTTP请求进行中停止服务耗时" << stopMs << L"毫秒（上限" << options.maxStopMs << L"毫秒）\n";
+            }
+        }
+        
+        service.Stop();
+    }
+    portal.Stop();
+    timeEndPeriod(1);
+    
+    std::wcout.clear();
+    std::wcerr.clear();
+    if (!samples.empty()) {
+        PrintReport(options, samples);
+    }
+    return exitCode;
+}
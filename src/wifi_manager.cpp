@@ -9,16 +9,58 @@
 #include <winhttp.h>
 #include <fcntl.h>
 #include <io.h>
+#include "../include/metrics.h"
+#include "../include/binary_log.h"
+#include "../include/trace.h"
 
 #pragma comment(lib, "wlanapi.lib")
 #pragma comment(lib, "ole32.lib")
 #pragma comment(lib, "winhttp.lib")
 
+namespace {
+
+// 扫描耗时
+MetricHistogram& g_scanDurationMs = MetricsRegistry::Instance().Histogram(
+    "wifi_scan_duration_ms", "Time from WlanScan to scan completion in milliseconds");
+
+// 从发起连接到关联成功的耗时
+MetricHistogram& g_associateDurationMs = MetricsRegistry::Instance().Histogram(
+    "wifi_associate_duration_ms", "Time from WlanConnect to connection completion in milliseconds");
+
+// 连接断开次数
+MetricCounter& g_disconnects = MetricsRegistry::Instance().Counter(
+    "wifi_disconnects_total", "WLAN disconnect notifications");
+
+} // namespace
+
 WifiManager::WifiManager() : m_hClient(NULL) {
+    // 自动重置事件：每次有新事件时触发，消费者被唤醒后取空队列
+    m_hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    
+    // 手动重置事件：连接完成或失败时触发
+    m_hConnectEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    
+    // 手动重置事件：扫描完成或失败时触发，同时唤醒所有等待同一次扫描的调用方
+    m_hScanEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
 }
 
 WifiManager::~WifiManager() {
     Cleanup();
+    
+    if (m_hEvent != NULL) {
+        CloseHandle(m_hEvent);
+        m_hEvent = NULL;
+    }
+    
+    if (m_hConnectEvent != NULL) {
+        CloseHandle(m_hConnectEvent);
+        m_hConnectEvent = NULL;
+    }
+    
+    if (m_hScanEvent != NULL) {
+        CloseHandle(m_hScanEvent);
+        m_hScanEvent = NULL;
+    }
 }
 
 bool WifiManager::Initialize() {
@@ -43,7 +85,176 @@ bool WifiManager::Initialize() {
     }
     
     // 获取接口信息
-    return GetInterfaceInfo();
+    if (!GetInterfaceInfo()) {
+        return false;
+    }
+    
+    // 注册WLAN通知，失败时退回到定期轮询
+    if (!RegisterNotifications()) {
+        std::wcerr << L"注册WLAN通知失败，将使用定期轮询检测连接状态" << std::endl;
+    }
+    
+    return true;
+}
+
+bool WifiManager::RegisterNotifications() {
+    DWORD dwPrevSource = 0;
+    DWORD dwResult = WlanRegisterNotification(
+        m_hClient,
+        WLAN_NOTIFICATION_SOURCE_ACM | WLAN_NOTIFICATION_SOURCE_MSM,
+        TRUE,
+        NotificationCallback,
+        this,
+        NULL,
+        &dwPrevSource
+    );
+    
+    if (dwResult != ERROR_SUCCESS) {
+        std::wcerr << L"WlanRegisterNotification失败，错误码: " << dwResult << std::endl;
+        return false;
+    }
+    
+    m_notificationsRegistered = true;
+    return true;
+}
+
+VOID WINAPI WifiManager::NotificationCallback(PWLAN_NOTIFICATION_DATA pData, PVOID pContext) {
+    WifiManager* manager = static_cast<WifiManager*>(pContext);
+    if (manager != nullptr && pData != NULL) {
+        manager->OnNotification(pData);
+    }
+}
+
+void WifiManager::OnNotification(PWLAN_NOTIFICATION_DATA pData) {
+    // 只处理当前使用的无线接口的通知
+    if (memcmp(&pData->InterfaceGuid, &m_interfaceGuid, sizeof(GUID)) != 0) {
+        return;
+    }
+    
+    WifiEvent event;
+    event.reasonCode = 0;
+    event.signalQuality = 0;
+    event.timestamp = GetTickCount64();
+    
+    if (pData->NotificationSource == WLAN_NOTIFICATION_SOURCE_ACM) {
+        PWLAN_CONNECTION_NOTIFICATION_DATA pConnData = NULL;
+        if (pData->dwDataSize >= sizeof(WLAN_CONNECTION_NOTIFICATION_DATA) && pData->pData != NULL) {
+            pConnData = static_cast<PWLAN_CONNECTION_NOTIFICATION_DATA>(pData->pData);
+        }
+        
+        switch (pData->NotificationCode) {
+        case wlan_notification_acm_scan_complete:
+            event.type = WifiEventType::ScanComplete;
+            break;
+            
+        case wlan_notification_acm_scan_fail:
+            event.type = WifiEventType::ScanFailed;
+            if (pData->dwDataSize >= sizeof(WLAN_REASON_CODE) && pData->pData != NULL) {
+                event.reasonCode = *static_cast<PWLAN_REASON_CODE>(pData->pData);
+            }
+            break;
+            
+        case wlan_notification_acm_connection_complete:
+            if (pConnData == NULL) {
+                return;
+            }
+            event.type = (pConnData->wlanReasonCode == WLAN_REASON_CODE_SUCCESS)
+                ? WifiEventType::ConnectComplete
+                : WifiEventType::ConnectFailed;
+            event.ssid = ConvertSSIDToString(pConnData->dot11Ssid);
+            event.reasonCode = pConnData->wlanReasonCode;
+            break;
+            
+        case wlan_notification_acm_connection_attempt_fail:
+            if (pConnData == NULL) {
+                return;
+            }
+            event.type = WifiEventType::ConnectFailed;
+            event.ssid = ConvertSSIDToString(pConnData->dot11Ssid);
+            event.reasonCode = pConnData->wlanReasonCode;
+            break;
+            
+        case wlan_notification_acm_disconnected:
+            event.type = WifiEventType::Disconnected;
+            if (pConnData != NULL) {
+                event.ssid = ConvertSSIDToString(pConnData->dot11Ssid);
+                event.reasonCode = pConnData->wlanReasonCode;
+            }
+            break;
+            
+        default:
+            return;
+        }
+    } else if (pData->NotificationSource == WLAN_NOTIFICATION_SOURCE_MSM) {
+        if (pData->NotificationCode != wlan_notification_msm_signal_quality_change) {
+            return;
+        }
+        
+        event.type = WifiEventType::SignalChanged;
+        if (pData->dwDataSize >= sizeof(ULONG) && pData->pData != NULL) {
+            event.signalQuality = *static_cast<PULONG>(pData->pData);
+        }
+    } else {
+        return;
+    }
+    
+    PushEvent(event);
+}
+
+void WifiManager::PushEvent(const WifiEvent& event) {
+    if (event.type == WifiEventType::Disconnected) {
+        g_disconnects.Add();
+    }
+    
+    // 连接状态或信号强度变化后，缓存的连接快照不再有效
+    if (event.type != WifiEventType::ScanComplete && event.type != WifiEventType::ScanFailed) {
+        InvalidateSnapshot();
+    }
+    
+    // 扫描结束，唤醒等待扫描结果的调用方
+    if (event.type == WifiEventType::ScanComplete || event.type == WifiEventType::ScanFailed) {
+        std::lock_guard<std::mutex> lock(m_scanMutex);
+        m_scanInProgress = false;
+        if (event.type == WifiEventType::ScanComplete) {
+            m_lastScanTime = event.timestamp;
+        }
+        SetEvent(m_hScanEvent);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_eventMutex);
+        
+        // 唤醒正在等待该SSID连接结果的ConnectToNetwork
+        if ((event.type == WifiEventType::ConnectComplete || event.type == WifiEventType::ConnectFailed) &&
+            !m_pendingConnectSsid.empty() && event.ssid == m_pendingConnectSsid) {
+            m_connectSucceeded = (event.type == WifiEventType::ConnectComplete);
+            m_connectReasonCode = event.reasonCode;
+            m_pendingConnectSsid.clear();
+            SetEvent(m_hConnectEvent);
+        }
+        
+        // 消费者长时间未处理时丢弃最旧的事件，避免队列无限增长
+        if (m_events.size() >= 64) {
+            m_events.pop_front();
+        }
+        m_events.push_back(event);
+    }
+    
+    if (m_hEvent != NULL) {
+        SetEvent(m_hEvent);
+    }
+}
+
+bool WifiManager::PopEvent(WifiEvent& event) {
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    
+    if (m_events.empty()) {
+        return false;
+    }
+    
+    event = m_events.front();
+    m_events.pop_front();
+    return true;
 }
 
 bool WifiManager::GetInterfaceInfo() {
@@ -75,90 +286,206 @@ bool WifiManager::GetInterfaceInfo() {
     return true;
 }
 
-bool WifiManager::IsConnected() {
-    if (m_hClient == NULL) {
-        return false;
-    }
-    
-    // 获取连接信息
-    PWLAN_CONNECTION_ATTRIBUTES pConnInfo = NULL;
-    DWORD dwSize = 0;
-    DWORD dwResult = WlanQueryInterface(
-        m_hClient,
-        &m_interfaceGuid,
-        wlan_intf_opcode_current_connection,
-        NULL,
-        &dwSize,
-        (PVOID*)&pConnInfo,
-        NULL
-    );
+std::shared_ptr<const WifiSnapshot> WifiManager::Snapshot(bool refresh) {
+    ULONGLONG now = GetTickCount64();
     
-    if (dwResult != ERROR_SUCCESS) {
-        // 如果查询失败，可能是因为没有连接
-        return false;
+    if (!refresh) {
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        if (m_snapshot && now - m_snapshot->timestamp < m_snapshotTtlMs) {
+            return m_snapshot;
+        }
     }
     
-    // 检查连接状态
-    bool isConnected = (pConnInfo->isState == wlan_interface_state_connected);
+    auto snapshot = std::make_shared<WifiSnapshot>();
+    snapshot->timestamp = now;
     
-    // 释放连接信息内存
-    WlanFreeMemory(pConnInfo);
+    if (m_hClient != NULL) {
+        // 获取连接信息
+        PWLAN_CONNECTION_ATTRIBUTES pConnInfo = NULL;
+        DWORD dwSize = 0;
+        DWORD dwResult = WlanQueryInterface(
+            m_hClient,
+            &m_interfaceGuid,
+            wlan_intf_opcode_current_connection,
+            NULL,
+            &dwSize,
+            (PVOID*)&pConnInfo,
+            NULL
+        );
+        
+        // 查询失败通常是因为没有连接
+        if (dwResult == ERROR_SUCCESS) {
+            const WLAN_ASSOCIATION_ATTRIBUTES& assoc = pConnInfo->wlanAssociationAttributes;
+            const WLAN_SECURITY_ATTRIBUTES& security = pConnInfo->wlanSecurityAttributes;
+            
+            snapshot->state = pConnInfo->isState;
+            snapshot->connected = (pConnInfo->isState == wlan_interface_state_connected);
+            snapshot->ssidBytes = assoc.dot11Ssid;
+            snapshot->ssid = ConvertSSIDToString(assoc.dot11Ssid);
+            snapshot->profileName = pConnInfo->strProfileName;
+            memcpy(snapshot->bssid, assoc.dot11Bssid, sizeof(DOT11_MAC_ADDRESS));
+            snapshot->signalQuality = assoc.wlanSignalQuality;
+            // 信号强度0-100线性对应-100到-50dBm
+            snapshot->rssi = (LONG)(assoc.wlanSignalQuality / 2) - 100;
+            snapshot->phyType = assoc.dot11PhyType;
+            snapshot->rxRate = assoc.ulRxRate;
+            snapshot->txRate = assoc.ulTxRate;
+            snapshot->securityEnabled = (security.bSecurityEnabled != FALSE);
+            snapshot->authAlgorithm = security.dot11AuthAlgorithm;
+            snapshot->cipherAlgorithm = security.dot11CipherAlgorithm;
+            
+            // 释放连接信息内存
+            WlanFreeMemory(pConnInfo);
+        }
+    }
     
-    return isConnected;
+    std::lock_guard<std::mutex> lock(m_snapshotMutex);
+    m_snapshot = snapshot;
+    return snapshot;
+}
+
+void WifiManager::InvalidateSnapshot() {
+    std::lock_guard<std::mutex> lock(m_snapshotMutex);
+    m_snapshot.reset();
+}
+
+bool WifiManager::IsConnected() {
+    return Snapshot()->connected;
 }
 
 std::wstring WifiManager::GetCurrentSSID() {
+    return Snapshot()->ssid;
+}
+
+std::vector<std::wstring> WifiManager::GetAvailableNetworks(HANDLE hCancelEvent) {
+    std::vector<std::wstring> networks;
+    
     if (m_hClient == NULL) {
-        return L"";
+        return networks;
     }
     
-    // 获取连接信息
-    PWLAN_CONNECTION_ATTRIBUTES pConnInfo = NULL;
-    DWORD dwSize = 0;
-    DWORD dwResult = WlanQueryInterface(
-        m_hClient,
-        &m_interfaceGuid,
-        wlan_intf_opcode_current_connection,
-        NULL,
-        &dwSize,
-        (PVOID*)&pConnInfo,
-        NULL
-    );
+    std::vector<WLAN_AVAILABLE_NETWORK> scanResults;
+    if (!GetScanResults(m_scanCacheMaxAgeMs, hCancelEvent, scanResults)) {
+        return networks;
+    }
     
-    if (dwResult != ERROR_SUCCESS) {
-        // 如果查询失败，可能是因为没有连接
-        return L"";
+    // 遍历网络列表
+    for (const WLAN_AVAILABLE_NETWORK& network : scanResults) {
+        std::wstring ssid = ConvertSSIDToString(network.dot11Ssid);
+        
+        // 避免重复添加相同的SSID
+        if (std::find(networks.begin(), networks.end(), ssid) == networks.end()) {
+            networks.push_back(ssid);
+        }
     }
     
-    // 获取SSID
-    std::wstring ssid = ConvertSSIDToString(pConnInfo->wlanAssociationAttributes.dot11Ssid);
+    return networks;
+}
+
+bool WifiManager::Scan(HANDLE hCancelEvent) {
+    // 系统要求驱动在4秒内完成扫描
+    const ULONGLONG scanTimeoutMs = 4000;
+    
+    TraceSpan span("scan");
+    
+    bool startScan = false;
+    ULONGLONG scanStartTime = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_scanMutex);
+        ULONGLONG now = GetTickCount64();
+        
+        // 已有扫描在进行时合并到该次扫描，不重复发起
+        if (!m_scanInProgress || now - m_scanStartTime > scanTimeoutMs) {
+            m_scanInProgress = true;
+            m_scanStartTime = now;
+            ResetEvent(m_hScanEvent);
+            startScan = true;
+        }
+        scanStartTime = m_scanStartTime;
+    }
+    
+    // 合并到已在进行的扫描时只记录等待时间
+    span.AddArg("merged", (uint64_t)(startScan ? 0 : 1));
+    
+    if (startScan) {
+        std::wcout << L"扫描可用WiFi网络..." << std::endl;
+        DWORD dwResult = WlanScan(m_hClient, &m_interfaceGuid, NULL, NULL, NULL);
+        if (dwResult != ERROR_SUCCESS) {
+            std::wcerr << L"WlanScan失败，错误码: " << dwResult << std::endl;
+            std::lock_guard<std::mutex> lock(m_scanMutex);
+            m_scanInProgress = false;
+            SetEvent(m_hScanEvent);
+            return false;
+        }
+    }
+    
+    // 等待扫描完成通知；没有注册通知时只能等待到超时
+    ULONGLONG now = GetTickCount64();
+    DWORD waitTime = (now - scanStartTime < scanTimeoutMs) ? (DWORD)(scanStartTime + scanTimeoutMs - now) : 0;
+    if (!m_notificationsRegistered && waitTime > 3000) {
+        waitTime = 3000;
+    }
+    
+    HANDLE waitHandles[2] = { m_hScanEvent, hCancelEvent };
+    DWORD waitCount = (hCancelEvent != NULL) ? 2 : 1;
+    DWORD waitResult = WaitForMultipleObjects(waitCount, waitHandles, FALSE, waitTime);
+    
+    if (waitResult == WAIT_OBJECT_0 + 1) {
+        return false;
+    }
+    
+    if (waitResult == WAIT_TIMEOUT) {
+        std::lock_guard<std::mutex> lock(m_scanMutex);
+        if (m_scanInProgress && m_scanStartTime == scanStartTime) {
+            m_scanInProgress = false;
+            m_lastScanTime = GetTickCount64();
+            SetEvent(m_hScanEvent);
+        }
+    }
     
-    // 释放连接信息内存
-    WlanFreeMemory(pConnInfo);
+    // 合并到其他调用方发起的扫描时不重复记录
+    if (startScan) {
+        ULONGLONG scanTime = GetTickCount64() - scanStartTime;
+        g_scanDurationMs.Record(scanTime);
+        BinaryLog::Instance().Log(LogLevel::Info, LogEvent::ScanCompleted, scanTime);
+    }
     
-    return ssid;
+    return true;
 }
 
-std::vector<std::wstring> WifiManager::GetAvailableNetworks() {
-    std::vector<std::wstring> networks;
-    
-    if (m_hClient == NULL) {
-        return networks;
+bool WifiManager::GetScanResults(ULONGLONG maxAgeMs, HANDLE hCancelEvent, std::vector<WLAN_AVAILABLE_NETWORK>& networks, bool* pFromCache) {
+    if (pFromCache != NULL) {
+        *pFromCache = false;
     }
     
-    // 扫描无线网络
-    DWORD dwResult = WlanScan(m_hClient, &m_interfaceGuid, NULL, NULL, NULL);
-    if (dwResult != ERROR_SUCCESS) {
-        std::wcerr << L"WlanScan失败，错误码: " << dwResult << std::endl;
-        return networks;
+    ULONGLONG now = GetTickCount64();
+    bool needScan = false;
+    {
+        std::lock_guard<std::mutex> lock(m_scanMutex);
+        
+        // 缓存在最近一次扫描之后获取且未过期，直接使用（maxAgeMs为0时强制扫描）
+        if (maxAgeMs > 0 && m_scanCacheTime != 0 && m_scanCacheTime >= m_lastScanTime && now - m_scanCacheTime <= maxAgeMs) {
+            networks = m_scanCache;
+            if (pFromCache != NULL) {
+                *pFromCache = true;
+            }
+            return true;
+        }
+        
+        // 系统最近已经扫描过时只需重新获取列表
+        needScan = (maxAgeMs == 0 || m_lastScanTime == 0 || now - m_lastScanTime > maxAgeMs);
     }
     
-    // 等待扫描完成
-    Sleep(2000);
+    if (needScan && !Scan(hCancelEvent)) {
+        // 被取消时直接返回，扫描失败时仍使用系统已有的网络列表
+        if (hCancelEvent != NULL && WaitForSingleObject(hCancelEvent, 0) == WAIT_OBJECT_0) {
+            return false;
+        }
+    }
     
     // 获取可用网络列表
     PWLAN_AVAILABLE_NETWORK_LIST pNetworkList = NULL;
-    dwResult = WlanGetAvailableNetworkList(
+    DWORD dwResult = WlanGetAvailableNetworkList(
         m_hClient,
         &m_interfaceGuid,
         WLAN_AVAILABLE_NETWORK_INCLUDE_ALL_ADHOC_PROFILES |
@@ -169,68 +496,88 @@ std::vector<std::wstring> WifiManager::GetAvailableNetworks() {
     
     if (dwResult != ERROR_SUCCESS) {
         std::wcerr << L"WlanGetAvailableNetworkList失败，错误码: " << dwResult << std::endl;
-        return networks;
+        return false;
     }
     
-    // 遍历网络列表
-    for (DWORD i = 0; i < pNetworkList->dwNumberOfItems; i++) {
-        WLAN_AVAILABLE_NETWORK& network = pNetworkList->Network[i];
-        std::wstring ssid = ConvertSSIDToString(network.dot11Ssid);
-        
-        // 避免重复添加相同的SSID
-        if (std::find(networks.begin(), networks.end(), ssid) == networks.end()) {
-            networks.push_back(ssid);
-        }
-    }
+    networks.assign(pNetworkList->Network, pNetworkList->Network + pNetworkList->dwNumberOfItems);
     
     // 释放网络列表内存
     WlanFreeMemory(pNetworkList);
     
-    return networks;
+    std::lock_guard<std::mutex> lock(m_scanMutex);
+    m_scanCache = networks;
+    m_scanCacheTime = GetTickCount64();
+    return true;
 }
 
-bool WifiManager::ConnectToNetwork(const std::wstring& ssid, const std::wstring& password) {
+bool WifiManager::ConnectToNetwork(const std::wstring& ssid, const std::wstring& password, HANDLE hCancelEvent, DWORD* pReasonCode) {
+    if (pReasonCode != NULL) {
+        *pReasonCode = 0;
+    }
+    
     if (m_hClient == NULL) {
         return false;
     }
     
+    TraceSpan span("ConnectToNetwork");
+    span.AddArg("ssid", ssid);
+    
     // 检查当前连接状态
-    if (IsConnected() && GetCurrentSSID() == ssid) {
+    auto snapshot = Snapshot(true);
+    if (snapshot->connected && snapshot->ssid == ssid) {
         std::wcout << L"已经连接到网络: " << ssid << std::endl;
+        span.AddArg("result", std::string("already_connected"));
         return true;
     }
     
-    // 先执行WiFi扫描，确保能发现目标网络
-    std::wcout << L"扫描可用WiFi网络..." << std::endl;
-    DWORD scanResult = WlanScan(m_hClient, &m_interfaceGuid, NULL, NULL, NULL);
-    if (scanResult != ERROR_SUCCESS) {
-        std::wcerr << L"WiFi扫描失败，错误码: " << scanResult << std::endl;
-        // 即使扫描失败，也尝试继续连接
-    } else {
-        // 等待扫描完成
-        Sleep(3000);
+    // 优先使用缓存的扫描结果，失败时重新扫描后再试一次
+    DWORD reasonCode = 0;
+    bool fromCache = false;
+    bool connected = ConnectWithScanResults(ssid, password, hCancelEvent, m_scanCacheMaxAgeMs, fromCache, reasonCode);
+    
+    if (!connected && fromCache && reasonCode != ERROR_CANCELLED && reasonCode != ERROR_TIMEOUT) {
+        std::wcout << L"使用缓存的扫描结果连接失败，重新扫描后重试" << std::endl;
+        connected = ConnectWithScanResults(ssid, password, hCancelEvent, 0, fromCache, reasonCode);
     }
     
-    // 获取指定SSID的网络信息
-    PWLAN_AVAILABLE_NETWORK_LIST pNetworkList = NULL;
-    DWORD dwResult = WlanGetAvailableNetworkList(
-        m_hClient,
-        &m_interfaceGuid,
-        WLAN_AVAILABLE_NETWORK_INCLUDE_ALL_ADHOC_PROFILES |
-        WLAN_AVAILABLE_NETWORK_INCLUDE_ALL_MANUAL_HIDDEN_PROFILES,
-        NULL,
-        &pNetworkList
-    );
+    if (pReasonCode != NULL) {
+        *pReasonCode = reasonCode;
+    }
     
-    if (dwResult != ERROR_SUCCESS) {
-        std::wcerr << L"WlanGetAvailableNetworkList失败，错误码: " << dwResult << std::endl;
+    span.AddArg("result", std::string(connected ? "connected" : "failed"));
+    span.AddArg("reason_code", (uint64_t)reasonCode);
+    return connected;
+}
+
+bool WifiManager::ConnectWithScanResults(
+    const std::wstring& ssid,
+    const std::wstring& password,
+    HANDLE hCancelEvent,
+    ULONGLONG maxScanAgeMs,
+    bool& fromCache,
+    DWORD& reasonCode) {
+    reasonCode = 0;
+    
+    // 重新连接上次成功连接的网络时直接使用当时的网络信息，不需要扫描
+    std::vector<WLAN_AVAILABLE_NETWORK> networks;
+    {
+        std::lock_guard<std::mutex> lock(m_scanMutex);
+        if (maxScanAgeMs > 0 && m_hasLastGoodNetwork && ConvertSSIDToString(m_lastGoodNetwork.dot11Ssid) == ssid) {
+            networks.push_back(m_lastGoodNetwork);
+            fromCache = true;
+        }
+    }
+    
+    if (networks.empty() && !GetScanResults(maxScanAgeMs, hCancelEvent, networks, &fromCache)) {
+        if (hCancelEvent != NULL && WaitForSingleObject(hCancelEvent, 0) == WAIT_OBJECT_0) {
+            reasonCode = ERROR_CANCELLED;
+        }
         return false;
     }
     
     // 查找目标SSID的网络
-    PWLAN_AVAILABLE_NETWORK pTargetNetwork = NULL;
-    for (DWORD i = 0; i < pNetworkList->dwNumberOfItems; i++) {
-        WLAN_AVAILABLE_NETWORK& network = pNetworkList->Network[i];
+    const WLAN_AVAILABLE_NETWORK* pTargetNetwork = NULL;
+    for (const WLAN_AVAILABLE_NETWORK& network : networks) {
         std::wstring currentSsid = ConvertSSIDToString(network.dot11Ssid);
         
         if (currentSsid == ssid) {
@@ -240,9 +587,16 @@ bool WifiManager::ConnectToNetwork(const std::wstring& ssid, const std::wstring&
         }
     }
     
+    DWORD dwResult = ERROR_SUCCESS;
+    
+    if (pTargetNetwork == NULL && fromCache) {
+        // 缓存中没有目标网络，交给调用方重新扫描
+        reasonCode = ERROR_NOT_FOUND;
+        return false;
+    }
+    
     if (pTargetNetwork == NULL) {
         std::wcerr << L"无法找到SSID为" << ssid << L"的网络，尝试使用通用配置文件" << std::endl;
-        WlanFreeMemory(pNetworkList);
         
         // 即使找不到网络，也尝试使用通用配置文件连接
         std::wstring profileXml = CreateProfileXml(ssid, password);
@@ -262,15 +616,13 @@ bool WifiManager::ConnectToNetwork(const std::wstring& ssid, const std::wstring&
         
         if (dwResult != ERROR_SUCCESS) {
             std::wcerr << L"WlanSetProfile失败，错误码: " << dwResult << L"，原因码: " << dwReasonCode << std::endl;
+            reasonCode = dwReasonCode;
             return false;
         }
     } else {
         // 创建WiFi配置文件
         std::wstring profileXml = CreateProfileXml(ssid, password, *pTargetNetwork);
         
-        // 释放网络列表内存
-        WlanFreeMemory(pNetworkList);
-        
         // 设置WiFi配置文件
         DWORD dwReasonCode = 0;
         dwResult = WlanSetProfile(
@@ -286,6 +638,7 @@ bool WifiManager::ConnectToNetwork(const std::wstring& ssid, const std::wstring&
         
         if (dwResult != ERROR_SUCCESS) {
             std::wcerr << L"WlanSetProfile失败，错误码: " << dwResult << L"，原因码: " << dwReasonCode << std::endl;
+            reasonCode = dwReasonCode;
             return false;
         }
     }
@@ -300,6 +653,18 @@ bool WifiManager::ConnectToNetwork(const std::wstring& ssid, const std::wstring&
     params.pDesiredBssidList = NULL;
     params.dot11BssType = dot11_BSS_type_infrastructure;
     
+    // 在发起连接前登记等待状态，避免错过很快到达的通知
+    {
+        std::lock_guard<std::mutex> lock(m_eventMutex);
+        m_pendingConnectSsid = ssid;
+        m_connectSucceeded = false;
+        m_connectReasonCode = 0;
+        ResetEvent(m_hConnectEvent);
+    }
+    
+    ULONGLONG connectStart = GetTickCount64();
+    TraceSpan associateSpan("associate");
+    
     std::wcout << L"尝试连接到WiFi: " << ssid << std::endl;
     dwResult = WlanConnect(
         m_hClient,
@@ -310,33 +675,105 @@ bool WifiManager::ConnectToNetwork(const std::wstring& ssid, const std::wstring&
     
     if (dwResult != ERROR_SUCCESS) {
         std::wcerr << L"WlanConnect失败，错误码: " << dwResult << std::endl;
+        std::lock_guard<std::mutex> lock(m_eventMutex);
+        m_pendingConnectSsid.clear();
+        reasonCode = dwResult;
         return false;
     }
     
     // 等待连接完成，最多等待45秒
     std::wcout << L"等待WiFi连接完成..." << std::endl;
-    for (int i = 0; i < 45; i++) {
-        Sleep(1000);
-        if (IsConnected() && GetCurrentSSID() == ssid) {
-            std::wcout << L"成功连接到WiFi: " << ssid << std::endl;
-            return true;
-        }
+    bool connected = WaitForConnection(ssid, hCancelEvent, 45000, reasonCode);
+    associateSpan.AddArg("reason_code", (uint64_t)reasonCode);
+    
+    if (connected) {
+        m_lastAssociateTimeMs = GetTickCount64() - connectStart;
+        g_associateDurationMs.Record(m_lastAssociateTimeMs);
         
-        // 每5秒显示一次等待状态
-        if (i % 5 == 0 && i > 0) {
-            std::wcout << L"仍在等待WiFi连接，已等待" << i << L"秒..." << std::endl;
+        // 记录成功连接的网络，下次重新连接时跳过扫描
+        if (pTargetNetwork != NULL) {
+            std::lock_guard<std::mutex> lock(m_scanMutex);
+            m_lastGoodNetwork = *pTargetNetwork;
+            m_hasLastGoodNetwork = true;
         }
+        std::wcout << L"成功连接到WiFi: " << ssid << L"，耗时" << m_lastAssociateTimeMs << L"毫秒" << std::endl;
+        return true;
     }
     
-    std::wcerr << L"WiFi连接超时" << std::endl;
+    if (reasonCode == ERROR_CANCELLED) {
+        std::wcout << L"WiFi连接已取消" << std::endl;
+    } else if (reasonCode == ERROR_TIMEOUT) {
+        std::wcerr << L"WiFi连接超时" << std::endl;
+    } else {
+        // 将WLAN原因码转换为可读的说明
+        wchar_t reasonText[256] = {0};
+        WlanReasonCodeToString(reasonCode, 256, reasonText, NULL);
+        std::wcerr << L"WiFi连接失败，原因码: " << reasonCode << L" " << reasonText << std::endl;
+    }
     return false;
 }
 
+bool WifiManager::WaitForConnection(const std::wstring& ssid, HANDLE hCancelEvent, DWORD timeoutMs, DWORD& reasonCode) {
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    bool result = false;
+    reasonCode = ERROR_TIMEOUT;
+    
+    while (true) {
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline) {
+            break;
+        }
+        
+        // 没有注册通知时退回到每500毫秒检查一次连接状态
+        DWORD waitTime = (DWORD)(deadline - now);
+        if (!m_notificationsRegistered && waitTime > 500) {
+            waitTime = 500;
+        }
+        
+        HANDLE waitHandles[2] = { m_hConnectEvent, hCancelEvent };
+        DWORD waitCount = (hCancelEvent != NULL) ? 2 : 1;
+        DWORD waitResult = WaitForMultipleObjects(waitCount, waitHandles, FALSE, waitTime);
+        
+        if (waitResult == WAIT_OBJECT_0) {
+            std::lock_guard<std::mutex> lock(m_eventMutex);
+            result = m_connectSucceeded;
+            reasonCode = m_connectReasonCode;
+            break;
+        }
+        
+        if (waitResult == WAIT_OBJECT_0 + 1) {
+            reasonCode = ERROR_CANCELLED;
+            break;
+        }
+        
+        if (!m_notificationsRegistered) {
+            auto snapshot = Snapshot(true);
+            if (!snapshot->connected || snapshot->ssid != ssid) {
+                continue;
+            }
+            result = true;
+            reasonCode = 0;
+            break;
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    m_pendingConnectSsid.clear();
+    return result;
+}
+
 void WifiManager::Cleanup() {
     if (m_hClient != NULL) {
+        // 关闭句柄会注销通知，并等待正在执行的回调结束
         WlanCloseHandle(m_hClient, NULL);
         m_hClient = NULL;
     }
+    
+    m_notificationsRegistered = false;
+    InvalidateSnapshot();
+    
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    m_events.clear();
 }
 
 std::wstring WifiManager::ConvertSSIDToString(const DOT11_SSID& ssid) {
@@ -2,29 +2,81 @@
 #define _UNICODE
 
 #include "../include/wifi_service.h"
+#include "../include/metrics.h"
+#include "../include/binary_log.h"
+#include "../include/trace.h"
 #include <windows.h>
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// 从进入等待地址状态到获得可用地址的耗时
+MetricHistogram& g_addressDurationMs = MetricsRegistry::Instance().Histogram(
+    "wifi_address_duration_ms", "Time from association to a usable IP address in milliseconds");
+
+// 可执行文件所在目录（以路径分隔符结尾）
+std::wstring GetModuleDirectory() {
+    wchar_t path[MAX_PATH];
+    DWORD length = GetModuleFileNameW(NULL, path, MAX_PATH);
+    std::wstring directory(path, length);
+    
+    size_t slash = directory.find_last_of(L"\\/");
+    return (slash == std::wstring::npos) ? L"" : directory.substr(0, slash + 1);
+}
+
+
+// 工作线程被唤醒的次数（按唤醒原因）
+MetricCounter& WakeupCounter(const char* source) {
+    return MetricsRegistry::Instance().Counter(
+        "wifi_worker_wakeups_total", "Worker thread wakeups by source",
+        std::string("source=\"") + source + "\"");
+}
+
+} // namespace
 
 // 静态实例指针初始化
 WifiService* WifiService::s_serviceInstance = nullptr;
 
 WifiService::WifiService() : 
     m_serviceStatusHandle(NULL),
-    m_serviceStopEvent(NULL),
-    m_serviceName(L"WifiAutoConnectService") {
+    m_workerThread(NULL),
+    m_resumeEvent(NULL),
+    m_sessionEvent(NULL),
+    m_reconnectEvent(NULL),
+    m_reloginEvent(NULL),
+    m_lastStopLatencyMs(0),
+    m_serviceName(L"WifiAutoConnectService"),
+    m_timers([]() { return (uint64_t)GetTickCount64(); }),
+    m_stateTimer(0),
+    m_linkCheckTimer(0),
+    m_stateTimerDeadline(0),
+    m_traceCycleFromOnline(false),
+    m_wakeupCount(0) {
     
     // 初始化服务状态
     ZeroMemory(&m_serviceStatus, sizeof(SERVICE_STATUS));
     m_serviceStatus.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
     m_serviceStatus.dwCurrentState = SERVICE_STOPPED;
-    m_serviceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_SHUTDOWN;
+    m_serviceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_SHUTDOWN |
+                                         SERVICE_ACCEPT_POWEREVENT | SERVICE_ACCEPT_SESSIONCHANGE;
     m_serviceStatus.dwWin32ExitCode = NO_ERROR;
     m_serviceStatus.dwServiceSpecificExitCode = 0;
     m_serviceStatus.dwCheckPoint = 0;
     m_serviceStatus.dwWaitHint = 0;
     
+    // 创建恢复事件和会话事件
+    m_resumeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_sessionEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    
+    // 创建控制通道命令事件
+    m_reconnectEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_reloginEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    
     // 设置静态实例指针
     s_serviceInstance = this;
 }
@@ -38,10 +90,24 @@ WifiService::~WifiService() {
         s_serviceInstance = nullptr;
     }
     
-    // 确保所有资源都被释放
-    if (m_serviceStopEvent != NULL) {
-        CloseHandle(m_serviceStopEvent);
-        m_serviceStopEvent = NULL;
+    if (m_resumeEvent != NULL) {
+        CloseHandle(m_resumeEvent);
+        m_resumeEvent = NULL;
+    }
+    
+    if (m_sessionEvent != NULL) {
+        CloseHandle(m_sessionEvent);
+        m_sessionEvent = NULL;
+    }
+    
+    if (m_reconnectEvent != NULL) {
+        CloseHandle(m_reconnectEvent);
+        m_reconnectEvent = NULL;
+    }
+    
+    if (m_reloginEvent != NULL) {
+        CloseHandle(m_reloginEvent);
+        m_reloginEvent = NULL;
     }
 }
 
@@ -61,40 +127,95 @@ bool WifiService::Start() {
         return false;
     }
     
-    // 创建服务停止事件
-    m_serviceStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (m_serviceStopEvent == NULL) {
-        std::wcerr << L"创建服务停止事件失败，错误码: " << GetLastError() << std::endl;
+    // 监视无线接口的地址变化，获得IPv4地址后立即开始探测和登录（只有IPv6地址时认证服务器还不可达）；
+    // 监视失败时退回到连接后固定等待3秒
+    if (m_addressMonitor.Start(m_wifiManager.GetInterfaceGuid(), AddressFamily::IPv4)) {
+        m_connectionPolicy.addressWaitMs = 15000;
+    } else {
+        std::wcerr << L"监视IP地址变化失败，连接后将固定等待3秒" << std::endl;
+        m_connectionPolicy.addressWaitMs = 3000;
+    }
+    
+    // 检查停止令牌的事件句柄
+    if (m_stopToken.GetEventHandle() == NULL) {
+        std::wcerr << L"创建服务停止事件失败" << std::endl;
         return false;
     }
     
+    // 网络请求在停止服务时立即中断
+    m_stopToken.Reset();
+    m_networkRequester.SetCancellationToken(&m_stopToken);
+    
+    // 服务模式下控制台输出不可见，关键事件同时写入二进制日志
+    if (!BinaryLog::Instance().Start(GetLogFilePath())) {
+        std::wcerr << L"无法打开日志文件: " << GetLogFilePath() << std::endl;
+    }
+    
+    // 状态页只是方便查询，创建失败不影响服务运行
+    if (!m_statusPage.Create(m_serviceName)) {
+        std::wcerr << L"创建共享状态页失败" << std::endl;
+    }
+    
     // 创建工作线程
-    HANDLE hThread = CreateThread(NULL, 0, ServiceWorkerThread, this, 0, NULL);
-    if (hThread == NULL) {
+    m_workerThread = CreateThread(NULL, 0, ServiceWorkerThread, this, 0, NULL);
+    if (m_workerThread == NULL) {
         std::wcerr << L"创建工作线程失败，错误码: " << GetLastError() << std::endl;
-        CloseHandle(m_serviceStopEvent);
-        m_serviceStopEvent = NULL;
+        m_statusPage.Close();
+        BinaryLog::Instance().Stop();
         return false;
     }
     
-    // 关闭线程句柄（线程会继续运行）
-    CloseHandle(hThread);
+    // 控制通道在独立线程中应答，工作线程正在连接或登录时也能立即返回状态
+    if (!m_controlServer.Start(ControlPipeServer::PipeNameForService(m_serviceName),
+                               [this](const std::string& request) { return HandleControlRequest(request); })) {
+        std::wcerr << L"启动控制通道失败" << std::endl;
+    }
     
+    BinaryLog::Instance().Log(LogLevel::Info, LogEvent::ServiceStarted);
     return true;
 }
 
 void WifiService::Stop() {
-    if (m_serviceStopEvent != NULL) {
-        // 设置停止事件
-        SetEvent(m_serviceStopEvent);
-        
-        // 等待工作线程退出，但设置超时以避免无限等待
-        Sleep(1000);
+    if (m_workerThread == NULL) {
+        return;
+    }
+    
+    ULONGLONG stopStart = GetTickCount64();
+    
+    // 先关闭控制通道，停止过程中不再接受命令
+    m_controlServer.Stop();
+    
+    // 取消所有阻塞操作：工作线程的等待、WiFi连接和扫描的等待、正在进行的HTTP请求
+    m_stopToken.Cancel();
+    
+    // 等待工作线程退出。所有阻塞操作都已被取消，工作线程总会退出；超过5秒时只记录警告并继续等待，
+    // 同时向服务控制管理器报告进度。确认退出之前不能关闭状态页和线程句柄，否则工作线程会写入已取消映射的内存
+    DWORD waitResult = WaitForSingleObject(m_workerThread, 5000);
+    if (waitResult == WAIT_TIMEOUT) {
+        std::wcerr << L"工作线程未能在5秒内退出，继续等待" << std::endl;
+        while ((waitResult = WaitForSingleObject(m_workerThread, 1000)) == WAIT_TIMEOUT) {
+            ReportServiceStatus(SERVICE_STOP_PENDING, NO_ERROR, 5000);
+        }
+    }
+    
+    if (waitResult != WAIT_OBJECT_0) {
+        // 无法确认工作线程已退出：保留状态页和线程句柄（泄漏），不能冒险释放工作线程仍在使用的资源
+        std::wcerr << L"等待工作线程退出失败，错误码: " << GetLastError() << std::endl;
+        m_workerThread = NULL;
+    } else {
+        // 工作线程已退出，告诉仍打开状态页的读者服务已停止
+        PublishStatus(false);
+        m_statusPage.Close();
         
-        // 关闭事件句柄
-        CloseHandle(m_serviceStopEvent);
-        m_serviceStopEvent = NULL;
+        CloseHandle(m_workerThread);
+        m_workerThread = NULL;
     }
+    
+    m_lastStopLatencyMs = GetTickCount64() - stopStart;
+    std::wcout << L"服务已停止，耗时" << m_lastStopLatencyMs << L"毫秒" << std::endl;
+    
+    BinaryLog::Instance().Log(LogLevel::Info, LogEvent::ServiceStopped, m_lastStopLatencyMs);
+    BinaryLog::Instance().Stop();
 }
 
 void WifiService::SetServiceName(const std::wstring& name) {
@@ -107,8 +228,22 @@ void WifiService::SetTargetWifi(const std::wstring& ssid, const std::wstring& pa
 }
 
 void WifiService::SetCampusNetworkCredentials(const std::wstring& account, const std::wstring& password) {
+    // 账号密码变化后解除因永久错误而停止的登录
+    if (account != m_campusNetworkAccount || password != m_campusNetworkPassword) {
+        m_connection.loginBlocked = false;
+        m_connection.loginFailures = 0;
+        m_connection.loginNotBefore = 0;
+    }
+    
     m_campusNetworkAccount = account;
     m_campusNetworkPassword = password;
+    m_connection.hasCredentials = !account.empty() && !password.empty();
+}
+
+void WifiService::SetPortalBaseUrl(const std::wstring& baseUrl) {
+    if (!baseUrl.empty()) {
+        m_networkRequester.SetPortalBaseUrl(baseUrl);
+    }
 }
 
 VOID WINAPI WifiService::ServiceMain(DWORD dwArgc, LPWSTR* lpszArgv) {
@@ -118,9 +253,10 @@ VOID WINAPI WifiService::ServiceMain(DWORD dwArgc, LPWSTR* lpszArgv) {
     }
     
     // 注册服务控制处理函数
-    s_serviceInstance->m_serviceStatusHandle = RegisterServiceCtrlHandlerW(
+    s_serviceInstance->m_serviceStatusHandle = RegisterServiceCtrlHandlerExW(
         (LPCWSTR)s_serviceInstance->m_serviceName.c_str(),
-        ServiceCtrlHandler
+        ServiceCtrlHandlerEx,
+        s_serviceInstance
     );
     
     if (s_serviceInstance->m_serviceStatusHandle == NULL) {
@@ -153,36 +289,163 @@ VOID WINAPI WifiService::ServiceMain(DWORD dwArgc, LPWSTR* lpszArgv) {
     }
 }
 
-VOID WINAPI WifiService::ServiceCtrlHandler(DWORD dwControl) {
-    // 检查静态实例是否存在
-    if (s_serviceInstance == nullptr) {
-        return;
+DWORD WINAPI WifiService::ServiceCtrlHandlerEx(DWORD dwControl, DWORD dwEventType, LPVOID lpEventData, LPVOID lpContext) {
+    WifiService* service = static_cast<WifiService*>(lpContext);
+    
+    // 检查实例是否存在
+    if (service == nullptr) {
+        return ERROR_CALL_NOT_IMPLEMENTED;
     }
     
+    return service->HandleControl(dwControl, dwEventType, lpEventData);
+}
+
+DWORD WifiService::HandleControl(DWORD dwControl, DWORD dwEventType, LPVOID lpEventData) {
     switch (dwControl) {
     case SERVICE_CONTROL_STOP:
     case SERVICE_CONTROL_SHUTDOWN:
-        // 更新服务状态为停止中
-        s_serviceInstance->ReportServiceStatus(
+        // 更新服务状态为停止中（工作线程超过5秒未退出时Stop会继续报告进度）
+        ReportServiceStatus(
             SERVICE_STOP_PENDING,
             NO_ERROR,
-            0
+            5000
         );
         
         // 停止服务
-        s_serviceInstance->Stop();
+        Stop();
         
         // 更新服务状态为已停止
-        s_serviceInstance->ReportServiceStatus(
+        ReportServiceStatus(
             SERVICE_STOPPED,
             NO_ERROR,
             0
         );
-        break;
+        return NO_ERROR;
+        
+    case SERVICE_CONTROL_POWEREVENT:
+        // 从睡眠中恢复后网络连接通常已经断开，立即重新连接而不是等到下次检查
+        if (dwEventType == PBT_APMRESUMEAUTOMATIC || dwEventType == PBT_APMRESUMESUSPEND) {
+            std::wcout << L"系统从睡眠中恢复，立即检查网络连接" << std::endl;
+            BinaryLog::Instance().Log(LogLevel::Info, LogEvent::ServiceResume, dwControl, dwEventType);
+            SetEvent(m_resumeEvent);
+        } else if (dwEventType == PBT_APMSUSPEND) {
+            std::wcout << L"系统即将进入睡眠" << std::endl;
+        }
+        return NO_ERROR;
+        
+    case SERVICE_CONTROL_SESSIONCHANGE:
+        // 用户登录或解锁时很可能马上要用网，提前探测确认连接和认证状态；
+        // 会话变化不代表网络断开，网络正常时不重新连接
+        if (dwEventType == WTS_SESSION_LOGON || dwEventType == WTS_SESSION_UNLOCK || dwEventType == WTS_CONSOLE_CONNECT) {
+            std::wcout << L"用户会话变化，立即检查网络连接" << std::endl;
+            BinaryLog::Instance().Log(LogLevel::Info, LogEvent::ServiceResume, dwControl, dwEventType);
+            SetEvent(m_sessionEvent);
+        }
+        return NO_ERROR;
+        
+    case SERVICE_CONTROL_INTERROGATE:
+        return NO_ERROR;
         
     default:
-        break;
+        return ERROR_CALL_NOT_IMPLEMENTED;
+    }
+}
+
+std::wstring WifiService::GetLogFilePath() {
+    return GetModuleDirectory() + L"wifi_service.blog";
+}
+
+std::wstring WifiService::GetTraceFilePath() {
+    return GetModuleDirectory() + L"trace.json";
+}
+
+std::string WifiService::HandleControlRequest(const std::string& request) {
+    // 请求格式：命令 [参数]
+    size_t space = request.find(' ');
+    std::string command = request.substr(0, space);
+    std::string argument = (space == std::string::npos) ? std::string() : request.substr(space + 1);
+    
+    if (command == "status") {
+        RuntimeStatus runtime;
+        {
+            std::lock_guard<std::mutex> lock(m_runtimeMutex);
+            runtime = m_runtime;
+        }
+        ULONGLONG now = GetTickCount64();
+        auto snapshot = m_wifiManager.Snapshot();
+        
+        std::wostringstream text;
+        text << L"连接状态: " << ConnectionStateMachine::StateToString(runtime.state);
+        if (runtime.stateSince != 0) {
+            text << L"（已持续" << (now - runtime.stateSince) / 1000 << L"秒）";
+        }
+        text << L"\n";
+        
+        text << L"目标WiFi: " << m_targetSsid << L"\n";
+        if (snapshot->connected) {
+            text << L"当前WiFi: " << snapshot->ssid << L"，信号" << snapshot->signalQuality << L"%（"
+                 << snapshot->rssi << L" dBm），速率" << snapshot->rxRate / 1000 << L"/" << snapshot->txRate / 1000 << L" Mbps\n";
+        } else {
+            text << L"当前WiFi: 未连接\n";
+        }
+        
+        if (m_addressMonitor.IsRunning()) {
+            text << L"IP地址: " << (m_addressMonitor.HasUsableAddress() ? L"已获取" : L"未获取") << L"\n";
+        }
+        
+        if (runtime.hasProbe) {
+            const wchar_t* probeText = L"离线";
+            if (runtime.lastProbeStatus == NetworkRequester::ConnectivityStatus::Online) {
+                probeText = L"在线";
+            } else if (runtime.lastProbeStatus == NetworkRequester::ConnectivityStatus::CaptivePortal) {
+                probeText = L"需要认证";
+            }
+            text << L"最近探测: " << (now - runtime.lastProbeTime) / 1000 << L"秒前，" << probeText
+                 << L"，耗时" << runtime.lastProbeElapsedMs << L"毫秒\n";
+        } else {
+            text << L"最近探测: 无\n";
+        }
+        
+        if (runtime.hasLogin) {
+            text << L"最近登录: " << (now - runtime.lastLoginTime) / 1000 << L"秒前，"
+                 << NetworkRequester::LoginResultToString(runtime.lastLoginResult) << L"\n";
+        } else {
+            text << L"最近登录: 无\n";
+        }
+        
+        return Tracer::ToUtf8(text.str());
+    }
+    
+    if (command == "metrics") {
+        return MetricsRegistry::Instance().ExportPrometheus();
+    }
+    
+    if (command == "events") {
+        size_t count = argument.empty() ? 20 : (size_t)strtoul(argument.c_str(), NULL, 10);
+        std::wostringstream text;
+        for (const LogRecord& record : BinaryLog::Instance().RecentRecords(count)) {
+            BinaryLog::FormatRecord(record, text);
+            text << L"\n";
+        }
+        return Tracer::ToUtf8(text.str());
     }
+    
+    if (command == "trace") {
+        return Tracer::Instance().ExportChromeTrace();
+    }
+    
+    // 命令只通知工作线程，不等待执行完成
+    if (command == "reconnect") {
+        SetEvent(m_reconnectEvent);
+        return "ok\n";
+    }
+    
+    if (command == "relogin") {
+        SetEvent(m_reloginEvent);
+        return "ok\n";
+    }
+    
+    return "error: unknown command\n";
 }
 
 void WifiService::ReportServiceStatus(DWORD dwCurrentState, DWORD dwWin32ExitCode, DWORD dwWaitHint) {
@@ -200,7 +463,8 @@ void WifiService::ReportServiceStatus(DWORD dwCurrentState, DWORD dwWin32ExitCod
     if (dwCurrentState == SERVICE_START_PENDING) {
         m_serviceStatus.dwControlsAccepted = 0;
     } else {
-        m_serviceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_SHUTDOWN;
+        m_serviceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_SHUTDOWN |
+                                             SERVICE_ACCEPT_POWEREVENT | SERVICE_ACCEPT_SESSIONCHANGE;
     }
     
     if (dwCurrentState == SERVICE_RUNNING || dwCurrentState == SERVICE_STOPPED) {
@@ -213,24 +477,26 @@ void WifiService::ReportServiceStatus(DWORD dwCurrentState, DWORD dwWin32ExitCod
     SetServiceStatus(m_serviceStatusHandle, &m_serviceStatus);
 }
 
-bool WifiService::PerformCampusNetworkLogin() {
+NetworkRequester::LoginResult WifiService::PerformCampusNetworkLogin() {
+    TraceSpan span("PerformCampusNetworkLogin");
+    
     // 检查是否已连接到WiFi
-    if (!m_wifiManager.IsConnected()) {
+    auto snapshot = m_wifiManager.Snapshot();
+    if (!snapshot->connected) {
         std::wcerr << L"未连接到WiFi，无法执行校园网登录" << std::endl;
-        return false;
+        return NetworkRequester::LoginResult::TransportError;
     }
     
     // 检查当前连接的SSID是否为目标SSID
-    std::wstring currentSsid = m_wifiManager.GetCurrentSSID();
-    if (currentSsid != m_targetSsid) {
+    if (snapshot->ssid != m_targetSsid) {
         std::wcerr << L"当前连接的WiFi不是目标WiFi，无法执行校园网登录" << std::endl;
-        return false;
+        return NetworkRequester::LoginResult::TransportError;
     }
     
     // 检查校园网账号和密码是否已设置
     if (m_campusNetworkAccount.empty() || m_campusNetworkPassword.empty()) {
         std::wcerr << L"校园网账号或密码未设置,无法执行校园网登录" << std::endl;
-        return false;
+        return NetworkRequester::LoginResult::BadCredentials;
     }
     
     std::wcout << L"开始执行校园网登录流程..." << std::endl;
@@ -239,142 +505,455 @@ bool WifiService::PerformCampusNetworkLogin() {
     std::wstring userIP = m_networkRequester.GetUserIP();
     if (userIP.empty()) {
         std::wcerr << L"获取用户IP地址失败，无法执行校园网登录" << std::endl;
-        return false;
+        return NetworkRequester::LoginResult::TransportError;
     }
     
     // 执行校园网登录
-    bool loginResult = m_networkRequester.LoginCampusNetwork(
+    NetworkRequester::LoginResult loginResult = m_networkRequester.LoginCampusNetwork(
         m_campusNetworkAccount,
         m_campusNetworkPassword,
         userIP
     );
     
-    if (loginResult) {
+    if (loginResult == NetworkRequester::LoginResult::Success ||
+        loginResult == NetworkRequester::LoginResult::AlreadyOnline) {
         std::wcout << L"校园网登录成功" << std::endl;
     } else {
-        std::wcerr << L"校园网登录失败" << std::endl;
+        std::wcerr << L"校园网登录失败: " << NetworkRequester::LoginResultToString(loginResult) << std::endl;
     }
     
     return loginResult;
 }
 
+bool WifiService::CheckLink(ConnectionEventType& eventType) {
+    auto snapshot = m_wifiManager.Snapshot();
+    
+    if (!snapshot->connected) {
+        eventType = ConnectionEventType::LinkDown;
+        return true;
+    }
+    
+    if (snapshot->ssid == m_targetSsid) {
+        eventType = ConnectionEventType::LinkUp;
+        return true;
+    }
+    
+    // 用户手动连接到其他WiFi时不做处理
+    return false;
+}
+
+void WifiService::HandleConnectionEvent(ConnectionEventType eventType) {
+    // 服务停止后不再执行后续动作
+    while (!m_stopToken.IsCancelled()) {
+        ConnectionState fromState = m_connection.state;
+        ConnectionTransition transition = ConnectionStateMachine::Step(
+            m_connection,
+            ConnectionEvent{ eventType, m_timers.Now() },
+            m_connectionPolicy
+        );
+        
+        if (transition.context.state != m_connection.state) {
+            std::wcout << L"连接状态: " << ConnectionStateMachine::StateToString(m_connection.state)
+                       << L" -> " << ConnectionStateMachine::StateToString(transition.context.state)
+                       << L"（" << ConnectionStateMachine::EventToString(eventType) << L"）" << std::endl;
+            BinaryLog::Instance().Log(LogLevel::Info, LogEvent::StateChanged,
+                                      m_connection.state, transition.context.state, eventType);
+        }
+        if (transition.context.state != m_connection.state) {
+            std::lock_guard<std::mutex> lock(m_runtimeMutex);
+            m_runtime.state = transition.context.state;
+            m_runtime.stateSince = GetTickCount64();
+        }
+        bool enteredAwaitingAddress = (transition.context.state == ConnectionState::AwaitingAddress &&
+                                       m_connection.state != ConnectionState::AwaitingAddress);
+        if (eventType == ConnectionEventType::AddressReady &&
+            m_connection.state == ConnectionState::AwaitingAddress &&
+            transition.context.state != ConnectionState::AwaitingAddress) {
+            uint64_t addressTime = m_timers.Now() - m_connection.stateSince;
+            g_addressDurationMs.Record(addressTime);
+            
+            Tracer::Span addressSpan;
+            addressSpan.name = "address_wait";
+            addressSpan.category = "wifi";
+            addressSpan.durationUs = addressTime * 1000;
+            addressSpan.startUs = Tracer::NowUs() - addressSpan.durationUs;
+            addressSpan.threadId = Tracer::CurrentThreadId();
+            Tracer::Instance().AddSpan(std::move(addressSpan));
+            BinaryLog::Instance().Log(LogLevel::Info, LogEvent::AddressReady, addressTime);
+        }
+        m_connection = transition.context;
+        
+        // 重新连接时可能已经有地址（例如DHCP租约仍有效），不必等待地址通知
+        if (enteredAwaitingAddress && m_addressMonitor.IsRunning() && m_addressMonitor.HasUsableAddress()) {
+            eventType = ConnectionEventType::AddressReady;
+            continue;
+        }
+        
+        // 开始执行动作时开始新的追踪周期
+        if (transition.action != ConnectionAction::None && !Tracer::Instance().InCycle()) {
+            Tracer::Instance().BeginCycle(
+                Tracer::ToUtf8(ConnectionStateMachine::StateToString(fromState)) + " / " +
+                Tracer::ToUtf8(ConnectionStateMachine::EventToString(eventType)));
+            m_traceCycleFromOnline = (fromState == ConnectionState::Online);
+        }
+        
+        if (transition.action == ConnectionAction::None ||
+            !RunConnectionAction(transition.action, eventType)) {
+            // 除了等待IP地址，其余状态都要等到定时器或外部事件才会继续，当前周期到此结束
+            if (Tracer::Instance().InCycle() && m_connection.state != ConnectionState::AwaitingAddress) {
+                Tracer::Instance().EndCycle(!(m_traceCycleFromOnline && m_connection.state == ConnectionState::Online));
+            }
+            SyncStateTimer();
+            return;
+        }
+    }
+}
+
+void WifiService::SyncStateTimer() {
+    if (m_connection.deadline == m_stateTimerDeadline) {
+        return;
+    }
+    m_stateTimerDeadline = m_connection.deadline;
+    
+    if (m_connection.deadline == 0) {
+        m_timers.Cancel(m_stateTimer);
+        m_stateTimer = 0;
+        return;
+    }
+    
+    uint64_t now = m_timers.Now();
+    uint64_t delay = m_connection.deadline > now ? m_connection.deadline - now : 0;
+    
+    if (!m_timers.Reschedule(m_stateTimer, delay)) {
+        m_stateTimer = m_timers.Schedule(delay, [this]() {
+            m_stateTimerDeadline = 0;
+            HandleConnectionEvent(ConnectionEventType::TimerExpired);
+        });
+    }
+}
+
+void WifiService::PublishStatus(bool running) {
+    if (!m_statusPage.IsOpen()) {
+        return;
+    }
+    
+    RuntimeStatus runtime;
+    {
+        std::lock_guard<std::mutex> lock(m_runtimeMutex);
+        runtime = m_runtime;
+    }
+    
+    // 运行状态记录的是GetTickCount64，读者在其他进程中，换算成Unix时间
+    ULONGLONG now = GetTickCount64();
+    uint64_t unixNow = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto toUnixTime = [now, unixNow](ULONGLONG tick) -> uint64_t {
+        return tick == 0 ? 0 : unixNow - (now - tick);
+    };
+    
+    StatusPageData data = {};
+    data.publishTimeMs = unixNow;
+    data.serviceRunning = running ? 1 : 0;
+    data.state = (uint32_t)runtime.state;
+    data.stateSinceMs = toUnixTime(runtime.stateSince);
+    data.connectCount = runtime.connectCount;
+    data.disconnectCount = runtime.disconnectCount;
+    data.loginCount = runtime.loginCount;
+    data.loginFailureCount = runtime.loginFailureCount;
+    data.wakeupCount = m_wakeupCount;
+    
+    if (runtime.hasProbe) {
+        data.lastProbeTimeMs = toUnixTime(runtime.lastProbeTime);
+        data.lastProbeStatus = (uint32_t)runtime.lastProbeStatus;
+        data.lastProbeElapsedMs = (uint32_t)runtime.lastProbeElapsedMs;
+    }
+    if (runtime.hasLogin) {
+        data.lastLoginTimeMs = toUnixTime(runtime.lastLoginTime);
+        data.lastLoginResult = (uint32_t)runtime.lastLoginResult;
+    }
+    
+    // 快照在缓存有效期内不重新查询WLAN
+    auto snapshot = m_wifiManager.Snapshot();
+    if (snapshot->connected) {
+        data.wifiConnected = 1;
+        data.signalQuality = snapshot->signalQuality;
+        data.rssi = snapshot->rssi;
+        data.ssidLength = min(snapshot->ssidBytes.uSSIDLength, (ULONG)sizeof(data.ssid));
+        memcpy(data.ssid, snapshot->ssidBytes.ucSSID, data.ssidLength);
+        
+        InterfaceAddress address;
+        if (running && m_addressMonitor.IsRunning() && m_addressMonitor.GetUsableAddress(address)) {
+            data.addressFamily = address.ipv6 ? 6 : 4;
+            memcpy(data.address, address.bytes, sizeof(data.address));
+        }
+    }
+    
+    m_statusPage.Publish(data);
+}
+
+bool WifiService::RunConnectionAction(ConnectionAction action, ConnectionEventType& resultEvent) {
+    switch (action) {
+    case ConnectionAction::Scan:
+        // 扫描缓存足够新时直接返回
+        m_wifiManager.GetAvailableNetworks(m_stopToken.GetEventHandle());
+        resultEvent = ConnectionEventType::ScanDone;
+        return true;
+        
+    case ConnectionAction::Connect: {
+        std::wcout << L"尝试连接到: " << m_targetSsid << std::endl;
+        
+        // 停止服务时立即取消等待
+        DWORD reasonCode = 0;
+        if (m_wifiManager.ConnectToNetwork(m_targetSsid, m_targetPassword, m_stopToken.GetEventHandle(), &reasonCode)) {
+            std::wcout << L"WiFi连接成功，关联耗时" << m_wifiManager.GetLastAssociateTime() << L"毫秒" << std::endl;
+            BinaryLog::Instance().Log(LogLevel::Info, LogEvent::WifiConnected, m_wifiManager.GetLastAssociateTime());
+            {
+                std::lock_guard<std::mutex> lock(m_runtimeMutex);
+                m_runtime.connectCount++;
+            }
+            resultEvent = ConnectionEventType::LinkUp;
+            return true;
+        }
+        
+        if (reasonCode == ERROR_CANCELLED) {
+            return false;
+        }
+        
+        std::wcerr << L"WiFi连接失败，原因码: " << reasonCode << std::endl;
+        BinaryLog::Instance().Log(LogLevel::Warning, LogEvent::WifiConnectFailed, reasonCode);
+        resultEvent = ConnectionEventType::ConnectFailed;
+        return true;
+    }
+    
+    case ConnectionAction::Probe: {
+        NetworkRequester::ConnectivityResult result = m_networkRequester.ProbeConnectivity();
+        BinaryLog::Instance().Log(LogLevel::Info, LogEvent::ProbeResult, result.status, result.statusCode, result.elapsedMs);
+        {
+            std::lock_guard<std::mutex> lock(m_runtimeMutex);
+            m_runtime.hasProbe = true;
+            m_runtime.lastProbeTime = GetTickCount64();
+            m_runtime.lastProbeStatus = result.status;
+            m_runtime.lastProbeElapsedMs = result.elapsedMs;
+        }
+        switch (result.status) {
+        case NetworkRequester::ConnectivityStatus::Online:
+            resultEvent = ConnectionEventType::ProbeOnline;
+            break;
+        case NetworkRequester::ConnectivityStatus::CaptivePortal:
+            resultEvent = ConnectionEventType::ProbePortal;
+            break;
+        default:
+            resultEvent = ConnectionEventType::ProbeOffline;
+            break;
+        }
+        return true;
+    }
+    
+    case ConnectionAction::Login: {
+        ULONGLONG loginStart = GetTickCount64();
+        NetworkRequester::LoginResult result = PerformCampusNetworkLogin();
+        LogLevel loginLevel = LogLevel::Warning;
+        if (result == NetworkRequester::LoginResult::Success || result == NetworkRequester::LoginResult::AlreadyOnline) {
+            loginLevel = LogLevel::Info;
+        } else if (NetworkRequester::IsPermanentLoginFailure(result)) {
+            loginLevel = LogLevel::Error;
+        }
+        BinaryLog::Instance().Log(loginLevel, LogEvent::LoginResult, result, GetTickCount64() - loginStart);
+        {
+            std::lock_guard<std::mutex> lock(m_runtimeMutex);
+            m_runtime.hasLogin = true;
+            m_runtime.lastLoginTime = GetTickCount64();
+            m_runtime.lastLoginResult = result;
+            m_runtime.loginCount++;
+            if (result != NetworkRequester::LoginResult::Success && result != NetworkRequester::LoginResult::AlreadyOnline) {
+                m_runtime.loginFailureCount++;
+            }
+        }
+        switch (result) {
+        case NetworkRequester::LoginResult::Success:
+        case NetworkRequester::LoginResult::AlreadyOnline:
+            resultEvent = ConnectionEventType::LoginSucceeded;
+            break;
+        case NetworkRequester::LoginResult::BadCredentials:
+            std::wcerr << L"校园网账号或密码错误，停止自动登录，请修改配置后重新启动服务" << std::endl;
+            resultEvent = ConnectionEventType::LoginBlocked;
+            break;
+        case NetworkRequester::LoginResult::AccountLimit:
+            resultEvent = ConnectionEventType::LoginRejected;
+            break;
+        default:
+            resultEvent = ConnectionEventType::LoginFailed;
+            break;
+        }
+        return true;
+    }
+    
+    default:
+        return false;
+    }
+}
+
 DWORD WINAPI WifiService::ServiceWorkerThread(LPVOID lpParam) {
     WifiService* service = static_cast<WifiService*>(lpParam);
     
     // 检查参数是否有效
-    if (service == nullptr || service->m_serviceStopEvent == NULL) {
+    if (service == nullptr) {
         return ERROR_INVALID_PARAMETER;
     }
     
-    // 记录上次连接状态，避免重复操作
-    bool lastConnected = false;
-    std::wstring lastSsid;
-    
-    // 记录上次校园网登录时间
-    ULONGLONG lastLoginAttempt = 0;
-    
-    // 记录连续失败次数
-    DWORD consecutiveFailures = 0;
-    
-    // 记录上次WiFi状态检查时间
-    ULONGLONG lastWifiCheckTime = 0;
+    // 已注册WLAN通知时，定期轮询只作为兜底（每60秒），否则每10秒轮询；启动时立即检查一次
+    const uint64_t wifiCheckInterval = service->m_wifiManager.HasNotifications() ? 60000 : 10000;
+    service->m_linkCheckTimer = service->m_timers.Schedule(0, [service]() {
+        ConnectionEventType linkEvent;
+        if (service->CheckLink(linkEvent)) {
+            service->HandleConnectionEvent(linkEvent);
+        }
+    }, wifiCheckInterval);
+    
+    // 定期关闭空闲的HTTP连接句柄
+    TimerWheel::TimerId idleConnectionTimer = service->m_timers.Schedule(60000, [service]() {
+        service->m_networkRequester.ReleaseIdleConnections();
+    }, 60000);
+    
+    // 等待停止事件、恢复事件、会话事件、控制通道命令、WiFi事件和地址事件
+    // 多个事件同时触发时WaitForMultipleObjects返回最靠前的一个，因此恢复事件和命令排在WiFi事件之前
+    HANDLE waitHandles[7] = { service->m_stopToken.GetEventHandle(), NULL, NULL, NULL, NULL, NULL, NULL };
+    DWORD waitCount = 1;
+    DWORD resumeEventIndex = MAXIMUM_WAIT_OBJECTS;
+    DWORD sessionEventIndex = MAXIMUM_WAIT_OBJECTS;
+    DWORD reconnectEventIndex = MAXIMUM_WAIT_OBJECTS;
+    DWORD reloginEventIndex = MAXIMUM_WAIT_OBJECTS;
+    DWORD wifiEventIndex = MAXIMUM_WAIT_OBJECTS;
+    DWORD addressEventIndex = MAXIMUM_WAIT_OBJECTS;
+    if (service->m_resumeEvent != NULL) {
+        resumeEventIndex = waitCount;
+        waitHandles[waitCount++] = service->m_resumeEvent;
+    }
+    if (service->m_sessionEvent != NULL) {
+        sessionEventIndex = waitCount;
+        waitHandles[waitCount++] = service->m_sessionEvent;
+    }
+    if (service->m_reconnectEvent != NULL) {
+        reconnectEventIndex = waitCount;
+        waitHandles[waitCount++] = service->m_reconnectEvent;
+    }
+    if (service->m_reloginEvent != NULL) {
+        reloginEventIndex = waitCount;
+        waitHandles[waitCount++] = service->m_reloginEvent;
+    }
+    if (service->m_wifiManager.GetEventHandle() != NULL) {
+        wifiEventIndex = waitCount;
+        waitHandles[waitCount++] = service->m_wifiManager.GetEventHandle();
+    }
+    if (service->m_addressMonitor.IsRunning()) {
+        addressEventIndex = waitCount;
+        waitHandles[waitCount++] = service->m_addressMonitor.GetEventHandle();
+    }
     
-    // 记录上次网络连接检查时间
-    ULONGLONG lastNetworkCheckTime = 0;
+    // 各唤醒原因的计数器
+    MetricCounter& stopWakeups = WakeupCounter("stop");
+    MetricCounter& resumeWakeups = WakeupCounter("resume");
+    MetricCounter& sessionWakeups = WakeupCounter("session");
+    MetricCounter& commandWakeups = WakeupCounter("command");
+    MetricCounter& addressWakeups = WakeupCounter("address");
+    MetricCounter& wlanWakeups = WakeupCounter("wlan");
+    MetricCounter& timerWakeups = WakeupCounter("timer");
     
     // 工作循环
-    while (WaitForSingleObject(service->m_serviceStopEvent, 0) != WAIT_OBJECT_0) {
+    while (!service->m_stopToken.IsCancelled()) {
         try {
-            // 获取当前时间
-            ULONGLONG currentTime = GetTickCount64();
+            // 执行到期的定时任务
+            service->m_timers.Advance();
             
-            // 定期检查WiFi连接状态（每10秒）
-            if (currentTime - lastWifiCheckTime > 10000) {
-                lastWifiCheckTime = currentTime;
-                
-                // 检查WiFi连接状态
-                bool isConnected = service->m_wifiManager.IsConnected();
-                std::wstring currentSsid = isConnected ? service->m_wifiManager.GetCurrentSSID() : L"";
-                
-                // 如果WiFi断开，尝试重新连接
-                if (!isConnected) {
-                    std::wcout << L"检测到WiFi未连接，尝试连接到: " << service->m_targetSsid << std::endl;
-                    
-                    // 尝试连接到目标WiFi
-                    if (service->m_wifiManager.ConnectToNetwork(service->m_targetSsid, service->m_targetPassword)) {
-                        std::wcout << L"WiFi连接成功" << std::endl;
-                        
-                        // 重置失败计数
-                        consecutiveFailures = 0;
-                        
-                        // 连接成功后等待一段时间再执行校园网登录
-                        Sleep(3000);
-                        
-                        // 执行校园网登录
-                        if (!service->m_campusNetworkAccount.empty() && !service->m_campusNetworkPassword.empty()) {
-                            std::wcout << L"尝试校园网登录..." << std::endl;
-                            lastLoginAttempt = currentTime;
-                            service->PerformCampusNetworkLogin();
-                        }
-                    } else {
-                        std::wcerr << L"WiFi连接失败" << std::endl;
-                        consecutiveFailures++;
-                        
-                        // 根据连续失败次数调整等待时间
-                        Sleep(min(consecutiveFailures * 5000, (DWORD)60000)); // 最多等待60秒
-                    }
-                } 
-                // 如果已连接到目标WiFi，但连接状态或SSID发生变化
-                else if (currentSsid == service->m_targetSsid && 
-                        (isConnected != lastConnected || currentSsid != lastSsid)) {
-                    std::wcout << L"已连接到目标WiFi: " << currentSsid << std::endl;
-                    
-                    // 检查网络连接状态
-                    if (!service->m_networkRequester.CheckNetworkConnection()) {
-                        std::wcout << L"网络连接异常，尝试校园网登录..." << std::endl;
-                        lastLoginAttempt = currentTime;
-                        service->PerformCampusNetworkLogin();
-                    } else {
-                        std::wcout << L"网络连接正常" << std::endl;
-                        consecutiveFailures = 0;
-                    }
-                }
-                
-                // 更新上次状态
-                lastConnected = isConnected;
-                lastSsid = currentSsid;
+            // 休眠前发布最新状态，读者随时读取都不会唤醒工作线程
+            service->PublishStatus(true);
+            
+            // 只在下一个定时任务到期时醒来，期间响应停止事件和WiFi事件
+            uint64_t nextDeadline = service->m_timers.NextDeadline();
+            uint64_t now = service->m_timers.Now();
+            DWORD sleepTime = INFINITE;
+            if (nextDeadline != TimerWheel::kNoDeadline) {
+                sleepTime = nextDeadline > now ? (DWORD)min(nextDeadline - now, (uint64_t)0x7FFFFFFF) : 0;
             }
+            DWORD waitResult = WaitForMultipleObjects(waitCount, waitHandles, FALSE, sleepTime);
+            service->m_wakeupCount++;
             
-            // 如果已连接到目标WiFi，定期检查网络连接状态（每30秒）
-            if (lastConnected && lastSsid == service->m_targetSsid && 
-                currentTime - lastNetworkCheckTime > 30000) {
-                lastNetworkCheckTime = currentTime;
+            if (waitResult == WAIT_OBJECT_0) {
+                stopWakeups.Add();
+            } else if (waitResult == WAIT_TIMEOUT) {
+                timerWakeups.Add();
+            } else if (waitResult == WAIT_OBJECT_0 + resumeEventIndex) {
+                resumeWakeups.Add();
+                // 跳过空闲等待，立即用上次成功的网络重新连接并登录
+                service->HandleConnectionEvent(ConnectionEventType::Resume);
+                service->m_timers.Reschedule(service->m_linkCheckTimer, wifiCheckInterval);
+            } else if (waitResult == WAIT_OBJECT_0 + sessionEventIndex) {
+                sessionWakeups.Add();
+                // 先探测，由探测结果决定是否需要重新登录
+                service->HandleConnectionEvent(ConnectionEventType::SessionChanged);
+            } else if (waitResult == WAIT_OBJECT_0 + reconnectEventIndex) {
+                commandWakeups.Add();
+                std::wcout << L"收到重新连接命令" << std::endl;
+                service->HandleConnectionEvent(ConnectionEventType::ReconnectRequested);
+                service->m_timers.Reschedule(service->m_linkCheckTimer, wifiCheckInterval);
+            } else if (waitResult == WAIT_OBJECT_0 + reloginEventIndex) {
+                commandWakeups.Add();
+                std::wcout << L"收到重新登录命令" << std::endl;
+                service->HandleConnectionEvent(ConnectionEventType::LoginRequested);
+            } else if (waitResult == WAIT_OBJECT_0 + addressEventIndex) {
+                // 接口获得了可用的IP地址
+                addressWakeups.Add();
+                std::wcout << L"已获取IP地址" << std::endl;
+                service->HandleConnectionEvent(ConnectionEventType::AddressReady);
+            } else if (waitResult == WAIT_OBJECT_0 + wifiEventIndex) {
+                wlanWakeups.Add();
                 
-                // 检查网络连接状态
-                if (!service->m_networkRequester.CheckNetworkConnection()) {
-                    // 如果距离上次登录尝试超过1分钟，再次尝试登录
-                    if (currentTime - lastLoginAttempt > 60000) {
-                        std::wcout << L"定期检查：网络连接异常，尝试校园网登录..." << std::endl;
-                        lastLoginAttempt = currentTime;
-                        service->PerformCampusNetworkLogin();
+                // 处理WLAN通知：连接状态变化时立即重新检查
+                WifiEvent event;
+                while (service->m_wifiManager.PopEvent(event)) {
+                    switch (event.type) {
+                    case WifiEventType::Disconnected:
+                        std::wcout << L"收到WiFi断开通知: " << event.ssid << L"，原因码: " << event.reasonCode << std::endl;
+                        BinaryLog::Instance().Log(LogLevel::Warning, LogEvent::WifiDisconnected, event.reasonCode);
+                        {
+                            std::lock_guard<std::mutex> lock(service->m_runtimeMutex);
+                            service->m_runtime.disconnectCount++;
+                        }
+                        service->m_timers.Reschedule(service->m_linkCheckTimer, 0);
+                        break;
+                    case WifiEventType::ConnectComplete:
+                        std::wcout << L"收到WiFi连接完成通知: " << event.ssid << std::endl;
+                        service->m_timers.Reschedule(service->m_linkCheckTimer, 0);
+                        break;
+                    case WifiEventType::ConnectFailed:
+                        std::wcout << L"收到WiFi连接失败通知: " << event.ssid << L"，原因码: " << event.reasonCode << std::endl;
+                        service->m_timers.Reschedule(service->m_linkCheckTimer, 0);
+                        break;
+                    default:
+                        break;
                     }
                 }
             }
-            
-            // 使用可中断的等待，以便能够及时响应停止事件
-            // 根据连接状态调整检查频率
-            DWORD sleepTime = lastConnected ? 5000 : 3000; // 已连接时5秒，未连接时3秒
-            WaitForSingleObject(service->m_serviceStopEvent, sleepTime);
         } catch (const std::exception& e) {
             // 捕获并记录异常，防止工作线程崩溃
             std::cerr << "ServiceWorkerThread异常: " << e.what() << std::endl;
-            Sleep(10000); // 发生异常后等待10秒再继续
+            BinaryLog::Instance().Log(LogLevel::Error, LogEvent::WorkerException);
+            service->m_stopToken.WaitForCancellation(10000); // 发生异常后等待10秒再继续
         } catch (...) {
             // 捕获所有未知异常
             std::cerr << "ServiceWorkerThread未知异常" << std::endl;
-            Sleep(10000); // 发生异常后等待10秒再继续
+            BinaryLog::Instance().Log(LogLevel::Error, LogEvent::WorkerException);
+            service->m_stopToken.WaitForCancellation(10000); // 发生异常后等待10秒再继续
         }
     }
     
+    // 取消定时任务，服务重新启动时重新添加
+    service->m_timers.Cancel(idleConnectionTimer);
+    service->m_timers.Cancel(service->m_linkCheckTimer);
+    service->m_timers.Cancel(service->m_stateTimer);
+    service->m_linkCheckTimer = 0;
+    service->m_stateTimer = 0;
+    service->m_stateTimerDeadline = 0;
+    
     return NO_ERROR;
 } 
\ No newline at end of file
@@ -0,0 +1,508 @@
+﻿#include "../include/winhttp_transport.h"
+#include "../include/network_requester.h"
+#include "../include/trace.h"
+#include <iostream>
+
+namespace {
+
+// WinHTTP各阶段开始和结束的时间（微秒），由状态回调填写，0表示未发生
+// 复用长连接时不会有DNS、建立连接和TLS握手阶段
+struct HttpPhaseTimes {
+    enum Phase {
+        ResolvingName, NameResolved, Connecting, Connected,
+        SendingRequest, RequestSent, ReceivingResponse, ResponseReceived, PhaseCount
+    };
+    
+    uint64_t at[PhaseCount] = {};
+    bool secure = false;
+    
+    // 请求结束时把各阶段记录为时间段
+    ~HttpPhaseTimes() {
+        AddPhase("dns", ResolvingName, NameResolved);
+        AddPhase("connect", Connecting, Connected);
+        if (secure) {
+            // WinHTTP没有单独的TLS回调，建立TCP连接到开始发送请求之间就是TLS握手
+            AddPhase("tls", Connected, SendingRequest);
+        }
+        AddPhase("send", SendingRequest, RequestSent);
+        AddPhase("first_byte", RequestSent, ResponseReceived);
+    }
+    
+    void AddPhase(const char* name, Phase begin, Phase end) const {
+        if (at[begin] == 0 || at[end] < at[begin]) {
+            return;
+        }
+        Tracer::Span span;
+        span.name = name;
+        span.category = "winhttp";
+        span.startUs = at[begin];
+        span.durationUs = at[end] - at[begin];
+        span.threadId = Tracer::CurrentThreadId();
+        Tracer::Instance().AddSpan(std::move(span));
+    }
+    
+    // 记录状态回调对应的阶段
+    void Record(DWORD internetStatus) {
+        int phase = -1;
+        switch (internetStatus) {
+        case WINHTTP_CALLBACK_STATUS_RESOLVING_NAME:      phase = ResolvingName; break;
+        case WINHTTP_CALLBACK_STATUS_NAME_RESOLVED:       phase = NameResolved; break;
+        case WINHTTP_CALLBACK_STATUS_CONNECTING_TO_SERVER: phase = Connecting; break;
+        case WINHTTP_CALLBACK_STATUS_CONNECTED_TO_SERVER: phase = Connected; break;
+        case WINHTTP_CALLBACK_STATUS_SENDING_REQUEST:     phase = SendingRequest; break;
+        case WINHTTP_CALLBACK_STATUS_REQUEST_SENT:        phase = RequestSent; break;
+        case WINHTTP_CALLBACK_STATUS_RECEIVING_RESPONSE:  phase = ReceivingResponse; break;
+        case WINHTTP_CALLBACK_STATUS_RESPONSE_RECEIVED:   phase = ResponseReceived; break;
+        default: break;
+        }
+        
+        // 读取响应体时会多次收到同一状态，只保留第一次
+        if (phase >= 0 && at[phase] == 0) {
+            at[phase] = Tracer::NowUs();
+        }
+    }
+};
+
+// 一个异步WinHTTP请求
+// 会话以WINHTTP_FLAG_ASYNC打开，每个WinHTTP调用立即返回，操作完成时WinHTTP在自己的线程上调用状态回调，
+// 发起请求的线程同时等待完成事件和取消事件。请求句柄只由发起请求的线程关闭：取消只触发取消事件，
+// 等待中的线程醒来后自己关闭句柄，再等到WinHTTP发出HANDLE_CLOSING回调。此后不会再有回调访问本对象或接收缓冲区；
+// 句柄在任何WinHTTP调用进行期间都不会被关闭，也就不会出现句柄值被其他请求复用后被误用的情况
+class AsyncRequest {
+public:
+    explicit AsyncRequest(HttpPhaseTimes* phases) :
+        m_phases(phases),
+        m_hRequest(NULL),
+        m_completedEvent(CreateEvent(NULL, FALSE, FALSE, NULL)),
+        m_closingEvent(CreateEvent(NULL, TRUE, FALSE, NULL)),
+        m_cancelEvent(CreateEvent(NULL, TRUE, FALSE, NULL)),
+        m_callbackRegistered(false),
+        m_completion(0),
+        m_error(0),
+        m_bytesRead(0) {
+    }
+    
+    ~AsyncRequest() {
+        Close();
+        for (HANDLE event : { m_completedEvent, m_closingEvent, m_cancelEvent }) {
+            if (event != NULL) {
+                CloseHandle(event);
+            }
+        }
+    }
+    
+    AsyncRequest(const AsyncRequest&) = delete;
+    AsyncRequest& operator=(const AsyncRequest&) = delete;
+    
+    // 创建请求句柄并登记状态回调，失败时由调用方通过GetLastError获取错误码
+    bool Open(HINTERNET hConnect, const wchar_t* verb, const wchar_t* path, DWORD flags) {
+        if (m_completedEvent == NULL || m_closingEvent == NULL || m_cancelEvent == NULL) {
+            return false;
+        }
+        
+        m_hRequest = WinHttpOpenRequest(hConnect, verb, path, NULL, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
+        if (m_hRequest == NULL) {
+            return false;
+        }
+        
+        // 先设置上下文再登记回调，之后的每个回调（包括HANDLE_CLOSING）都能找到本对象
+        DWORD notifications = WINHTTP_CALLBACK_FLAG_ALL_COMPLETIONS | WINHTTP_CALLBACK_FLAG_HANDLES;
+        if (m_phases != NULL) {
+            notifications |= WINHTTP_CALLBACK_FLAG_RESOLVE_NAME | WINHTTP_CALLBACK_FLAG_CONNECT_TO_SERVER |
+                             WINHTTP_CALLBACK_FLAG_SEND_REQUEST | WINHTTP_CALLBACK_FLAG_RECEIVE_RESPONSE;
+        }
+        AsyncRequest* self = this;
+        if (!WinHttpSetOption(m_hRequest, WINHTTP_OPTION_CONTEXT_VALUE, &self, sizeof(self)) ||
+            WinHttpSetStatusCallback(m_hRequest, StatusCallback, notifications, 0) == WINHTTP_INVALID_STATUS_CALLBACK) {
+            DWORD error = GetLastError();
+            Close();
+            SetLastError(error);
+            return false;
+        }
+        m_callbackRegistered = true;
+        return true;
+    }
+    
+    HINTERNET Handle() const { return m_hRequest; }
+    
+    // 取消事件，由取消信号的中断函数触发
+    HANDLE CancelEvent() const { return m_cancelEvent; }
+    
+    // 等待当前的异步操作完成，完成的状态为expected时返回true；
+    // 失败时error为WinHTTP错误码，被取消时为ERROR_WINHTTP_OPERATION_CANCELLED
+    bool Wait(DWORD expected, DWORD& error) {
+        HANDLE handles[2] = { m_completedEvent, m_cancelEvent };
+        if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+            error = ERROR_WINHTTP_OPERATION_CANCELLED;
+            return false;
+        }
+        if (m_completion == WINHTTP_CALLBACK_STATUS_REQUEST_ERROR) {
+            error = m_error;
+            return false;
+        }
+        error = 0;
+        return m_completion == expected;
+    }
+    
+    // 最近一次读取完成的字节数
+    DWORD BytesRead() const { return m_bytesRead; }
+    
+    // 关闭请求句柄并等待HANDLE_CLOSING回调，进行中的异步操作随之取消（可重复调用）
+    void Close() {
+        if (m_hRequest == NULL) {
+            return;
+        }
+        WinHttpCloseHandle(m_hRequest);
+        m_hRequest = NULL;
+        if (m_callbackRegistered) {
+            WaitForSingleObject(m_closingEvent, INFINITE);
+            m_callbackRegistered = false;
+        }
+    }
+    
+private:
+    // 状态回调，dwContext指向AsyncRequest；结果写入成员后再触发完成事件，等待方醒来时一定能看到
+    static void CALLBACK StatusCallback(HINTERNET hInternet, DWORD_PTR dwContext, DWORD dwInternetStatus,
+                                        LPVOID lpvStatusInformation, DWORD dwStatusInformationLength) {
+        AsyncRequest* request = reinterpret_cast<AsyncRequest*>(dwContext);
+        if (request == NULL) {
+            return;
+        }
+        
+        switch (dwInternetStatus) {
+        case WINHTTP_CALLBACK_STATUS_SENDREQUEST_COMPLETE:
+        case WINHTTP_CALLBACK_STATUS_HEADERS_AVAILABLE:
+            request->Complete(dwInternetStatus, 0, 0);
+            break;
+        case WINHTTP_CALLBACK_STATUS_READ_COMPLETE:
+            request->Complete(dwInternetStatus, 0, dwStatusInformationLength);
+            break;
+        case WINHTTP_CALLBACK_STATUS_REQUEST_ERROR:
+            request->Complete(dwInternetStatus, static_cast<WINHTTP_ASYNC_RESULT*>(lpvStatusInformation)->dwError, 0);
+            break;
+        case WINHTTP_CALLBACK_STATUS_HANDLE_CLOSING:
+            // 最后一个回调：触发事件后发起请求的线程可能立即销毁本对象，之后不能再访问它
+            SetEvent(request->m_closingEvent);
+            break;
+        default:
+            if (request->m_phases != NULL) {
+                request->m_phases->Record(dwInternetStatus);
+            }
+            break;
+        }
+    }
+    
+    void Complete(DWORD completion, DWORD error, DWORD bytesRead) {
+        m_completion = completion;
+        m_error = error;
+        m_bytesRead = bytesRead;
+        SetEvent(m_completedEvent);
+    }
+    
+    HttpPhaseTimes* m_phases;
+    HINTERNET m_hRequest;
+    HANDLE m_completedEvent;    // 自动重置，每个异步操作完成或出错时触发一次
+    HANDLE m_closingEvent;      // 收到HANDLE_CLOSING回调时触发
+    HANDLE m_cancelEvent;       // 请求被取消时触发
+    bool m_callbackRegistered;
+    DWORD m_completion;         // 最近一次完成的状态
+    DWORD m_error;
+    DWORD m_bytesRead;
+};
+
+} // namespace
+
+WinHttpTransport::WinHttpTransport() :
+    m_hSession(NULL) {
+}
+
+WinHttpTransport::~WinHttpTransport() {
+    Cleanup();
+}
+
+bool WinHttpTransport::Initialize() {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    if (m_hSession != NULL) {
+        return true;
+    }
+    
+    m_hSession = WinHttpOpen(
+        L"WifiAutoConnectService/1.0",
+        WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+        WINHTTP_NO_PROXY_NAME,
+        WINHTTP_NO_PROXY_BYPASS,
+        WINHTTP_FLAG_ASYNC
+    );
+    
+    if (!m_hSession) {
+        std::wcerr << L"WinHttpOpen失败，错误码: " << GetLastError() << std::endl;
+        return false;
+    }
+    
+    // 单主机的并发由连接池限制，每个进行中的请求最多占用一个套接字；
+    // WinHTTP自己不再限制套接字数，否则连接池上限调高后（批量登录、批量查询）请求仍会在WinHTTP内部排队
+    DWORD maxConns = INFINITE;
+    WinHttpSetOption(m_hSession, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &maxConns, sizeof(maxConns));
+    WinHttpSetOption(m_hSession, WINHTTP_OPTION_MAX_CONNS_PER_1_0_SERVER, &maxConns, sizeof(maxConns));
+    
+    m_connectionPool.SetSession(m_hSession);
+    
+    return true;
+}
+
+void WinHttpTransport::SetLimits(uint32_t maxPerHost, uint64_t idleTimeoutMs) {
+    m_connectionPool.SetLimits(maxPerHost, idleTimeoutMs);
+}
+
+void WinHttpTransport::ReleaseIdleConnections() {
+    m_connectionPool.EvictIdle();
+}
+
+bool WinHttpTransport::Send(const HttpRequest& request, HttpResponse& response, HttpCancel* cancel) {
+    response.statusCode = 0;
+    response.location.clear();
+    response.body.clear();
+    response.truncated = false;
+    
+    // 没有指定取消信号时使用局部的取消信号，使各步骤的代码不必区分
+    HttpCancel localCancel;
+    if (cancel == nullptr) {
+        cancel = &localCancel;
+    }
+    
+    if (!Initialize()) {
+        return false;
+    }
+    
+    std::wstring url = NetworkRequester::Utf8ToWide(request.url);
+    std::wstring verb = NetworkRequester::Utf8ToWide(request.method);
+    std::wstring headers = NetworkRequester::Utf8ToWide(request.headers);
+    std::wstring hostName, urlPath;
+    INTERNET_SCHEME scheme;
+    INTERNET_PORT port;
+    
+    if (!ParseUrl(url, hostName, urlPath, scheme, port)) {
+        RecordFailure(HttpStage::ParseUrl, GetLastError());
+        return false;
+    }
+    
+    // 只记录主机和路径，查询参数中可能有账号密码
+    TraceSpan span("http", "winhttp");
+    span.AddArg("verb", verb);
+    span.AddArg("host", hostName);
+    span.AddArg("path", urlPath.substr(0, urlPath.find(L'?')));
+    HttpPhaseTimes phases;
+    phases.secure = (scheme == INTERNET_SCHEME_HTTPS);
+    
+    bool tracePhases = Tracer::Instance().InCycle();
+    
+    // 从连接池获取连接句柄，达到单主机上限时等待，请求被取消时放弃等待
+    HINTERNET hConnect = m_connectionPool.Acquire(hostName, port, scheme, cancel);
+    if (!hConnect) {
+        if (!cancel->IsCancelled()) {
+            RecordFailure(HttpStage::Connect, GetLastError());
+        }
+        return false;
+    }
+    
+    // 创建请求；处于追踪周期中时同时通过状态回调记录DNS、建立连接、TLS和首字节各阶段
+    AsyncRequest async(tracePhases ? &phases : nullptr);
+    if (!async.Open(hConnect, verb.c_str(), urlPath.c_str(), (scheme == INTERNET_SCHEME_HTTPS) ? WINHTTP_FLAG_SECURE : 0)) {
+        RecordFailure(HttpStage::OpenRequest, GetLastError());
+        m_connectionPool.Release(hConnect);
+        return false;
+    }
+    HINTERNET hRequest = async.Handle();
+    
+    // 限制单个请求各阶段的超时时间
+    if (request.timeoutMs > 0) {
+        int timeout = (int)request.timeoutMs;
+        WinHttpSetTimeouts(hRequest, timeout, timeout, timeout, timeout);
+    }
+    
+    // 探测请求需要看到原始的重定向响应
+    if (!request.followRedirects) {
+        DWORD feature = WINHTTP_DISABLE_REDIRECTS;
+        WinHttpSetOption(hRequest, WINHTTP_OPTION_DISABLE_FEATURE, &feature, sizeof(feature));
+    }
+    
+    // 取消时只触发取消事件，等待中的本线程醒来后自己关闭请求句柄
+    HANDLE cancelEvent = async.CancelEvent();
+    if (!cancel->SetInterrupter([cancelEvent]() { SetEvent(cancelEvent); })) {
+        async.Close();
+        m_connectionPool.Release(hConnect);
+        return false;
+    }
+    
+    // 结束请求：注销中断函数后关闭请求句柄并等待最后一个回调，连接句柄归还连接池
+    auto finish = [&](bool succeeded) {
+        cancel->ClearInterrupter();
+        async.Close();
+        m_connectionPool.Release(hConnect);
+        return succeeded;
+    };
+    
+    // 异步操作失败：被取消时不记录
+    auto fail = [&](HttpStage stage, DWORD error) {
+        if (!cancel->IsCancelled()) {
+            RecordFailure(stage, error);
+        }
+        return finish(false);
+    };
+    
+    // 发送请求
+    DWORD error = 0;
+    if (!WinHttpSendRequest(
+        hRequest,
+        headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : headers.c_str(),
+        headers.empty() ? 0 : (DWORD)-1,
+        request.body.empty() ? WINHTTP_NO_REQUEST_DATA : (LPVOID)request.body.data(),
+        (DWORD)request.body.size(),
+        (DWORD)request.body.size(),
+        (DWORD_PTR)&async
+    )) {
+        return fail(HttpStage::Send, GetLastError());
+    }
+    if (!async.Wait(WINHTTP_CALLBACK_STATUS_SENDREQUEST_COMPLETE, error)) {
+        return fail(HttpStage::Send, error);
+    }
+    
+    // 接收响应头
+    if (!WinHttpReceiveResponse(hRequest, NULL)) {
+        return fail(HttpStage::Receive, GetLastError());
+    }
+    if (!async.Wait(WINHTTP_CALLBACK_STATUS_HEADERS_AVAILABLE, error)) {
+        return fail(HttpStage::Receive, error);
+    }
+    
+    // 读取状态码（响应头已经收到，查询是同步的）
+    DWORD statusCode = 0;
+    DWORD statusSize = sizeof(statusCode);
+    if (WinHttpQueryHeaders(
+        hRequest,
+        WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+        WINHTTP_HEADER_NAME_BY_INDEX,
+        &statusCode,
+        &statusSize,
+        WINHTTP_NO_HEADER_INDEX
+    )) {
+        response.statusCode = statusCode;
+    }
+    span.AddArg("status", (uint64_t)response.statusCode);
+    
+    // 读取重定向地址
+    if (statusCode >= 300 && statusCode < 400) {
+        wchar_t locationBuffer[1024] = {0};
+        DWORD locationSize = sizeof(locationBuffer);
+        if (WinHttpQueryHeaders(
+            hRequest,
+            WINHTTP_QUERY_LOCATION,
+            WINHTTP_HEADER_NAME_BY_INDEX,
+            locationBuffer,
+            &locationSize,
+            WINHTTP_NO_HEADER_INDEX
+        )) {
+            response.location = NetworkRequester::WideToUtf8(locationBuffer);
+        }
+    }
+    
+    // 不需要响应体时直接关闭请求，未读取的数据随之丢弃
+    if (!request.readBody) {
+        return finish(true);
+    }
+    
+    // 根据Content-Length预留响应体空间，避免反复扩容
+    ResponseBodyReader reader(request.maxBodyBytes, request.consumer, response.body);
+    if (!request.consumer) {
+        DWORD contentLength = 0;
+        DWORD lengthSize = sizeof(contentLength);
+        if (WinHttpQueryHeaders(
+            hRequest,
+            WINHTTP_QUERY_CONTENT_LENGTH | WINHTTP_QUERY_FLAG_NUMBER,
+            WINHTTP_HEADER_NAME_BY_INDEX,
+            &contentLength,
+            &lengthSize,
+            WINHTTP_NO_HEADER_INDEX
+        )) {
+            reader.Reserve(contentLength);
+        }
+    }
+    
+    // 数据读入复用的接收缓冲区，读取过程中不再分配内存；达到响应体上限时停止读取。
+    // 读取被取消时先关闭句柄并等到最后一个回调，再离开本函数，WinHTTP不会在之后写入缓冲区
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    while (reader.NextBuffer(buffer, capacity)) {
+        if (!WinHttpReadData(hRequest, buffer, (DWORD)capacity, NULL)) {
+            RecordFailure(HttpStage::Read, GetLastError());
+            break;
+        }
+        if (!async.Wait(WINHTTP_CALLBACK_STATUS_READ_COMPLETE, error)) {
+            if (cancel->IsCancelled()) {
+                return finish(false);
+            }
+            RecordFailure(HttpStage::Read, error);
+            break;
+        }
+        
+        // 响应体结束或调用方已拿到所需数据时结束读取
+        if (!reader.Commit(async.BytesRead())) {
+            break;
+        }
+    }
+    response.truncated = reader.IsTruncated();
+    
+    // 关闭请求句柄，连接句柄归还连接池（未读完的数据随请求句柄一起丢弃）
+    return finish(true);
+}
+
+bool WinHttpTransport::ParseUrl(
+    const std::wstring& url, 
+    std::wstring& hostName, 
+    std::wstring& urlPath, 
+    INTERNET_SCHEME& scheme, 
+    INTERNET_PORT& port
+) {
+    URL_COMPONENTS urlComp = {0};
+    urlComp.dwStructSize = sizeof(urlComp);
+    
+    // 指针为NULL、长度非0时，各组件直接指向url中的字符（不以0结尾），按长度复制。
+    // 不要改回传入缓冲区：指针非NULL时长度表示缓冲区大小，写成-1会让路径被复制到固定大小的缓冲区时不受限制
+    urlComp.dwSchemeLength = (DWORD)-1;
+    urlComp.dwHostNameLength = (DWORD)-1;
+    urlComp.dwUserNameLength = (DWORD)-1;
+    urlComp.dwPasswordLength = (DWORD)-1;
+    urlComp.dwUrlPathLength = (DWORD)-1;
+    urlComp.dwExtraInfoLength = (DWORD)-1;
+    
+    // 失败时由调用方通过GetLastError获取错误码
+    if (!WinHttpCrackUrl(url.c_str(), (DWORD)url.length(), 0, &urlComp)) {
+        return false;
+    }
+    
+    hostName.assign(urlComp.lpszHostName, urlComp.dwHostNameLength);
+    urlPath.clear();
+    if (urlComp.lpszUrlPath) {
+        urlPath.assign(urlComp.lpszUrlPath, urlComp.dwUrlPathLength);
+    }
+    if (urlComp.lpszExtraInfo) {
+        urlPath.append(urlComp.lpszExtraInfo, urlComp.dwExtraInfoLength);
+    }
+    scheme = urlComp.nScheme;
+    port = urlComp.nPort;
+    
+    return true;
+}
+
+void WinHttpTransport::Cleanup() {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    
+    // 先关闭连接池中的连接，再关闭会话
+    m_connectionPool.Clear();
+    m_connectionPool.SetSession(NULL);
+    
+    if (m_hSession != NULL) {
+        WinHttpCloseHandle(m_hSession);
+        m_hSession = NULL;
+    }
+}
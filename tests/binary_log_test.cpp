@@ -0,0 +1,225 @@
+﻿#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/binary_log.h"
+#include "../include/connection_state_machine.h"
+#include "test_check.h"
+
+// 二进制日志的单元测试：多线程写入环形缓冲区、缓冲区满时丢弃计数、文件轮转和解码
+// BinaryLog是进程内的单例，各测试依次Start/Stop，每次使用新的文件
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// 文件头的大小（魔数 + 记录大小 + 保留字段）
+const size_t kHeaderSize = 16;
+
+fs::path TestDirectory() {
+    static fs::path directory = fs::temp_directory_path() / "binary_log_test";
+    return directory;
+}
+
+// 读出日志文件中的全部记录，文件头无效时返回false
+bool ReadRecords(const fs::path& path, std::vector<LogRecord>& records) {
+    records.clear();
+    std::ifstream file(path, std::ios::binary);
+    char header[kHeaderSize];
+    if (!file.read(header, sizeof(header)) || memcmp(header, "WFBLOG01", 8) != 0) {
+        return false;
+    }
+    LogRecord record;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        records.push_back(record);
+    }
+    return true;
+}
+
+// 未开始记录时写日志什么也不做
+void TestLogBeforeStart() {
+    BinaryLog& log = BinaryLog::Instance();
+    CHECK(!log.IsRunning());
+    log.Log(LogLevel::Info, LogEvent::ServiceStarted);
+    CHECK(log.DroppedCount() == 0);
+    CHECK(log.RecentRecords().empty());
+}
+
+// 多个线程同时写入：每条记录都写到文件中，同一线程的记录保持写入顺序
+void TestConcurrentWriters() {
+    BinaryLog& log = BinaryLog::Instance();
+    fs::path path = TestDirectory() / "writers.blog";
+    CHECK(log.Start(path));
+
+    const int threadCount = 4;
+    const uint64_t perThread = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&log, t]() {
+            for (uint64_t i = 0; i < perThread; i++) {
+                log.Log(LogLevel::Info, LogEvent::ProbeResult, t, i, t * perThread + i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    log.Stop();
+    CHECK(!log.IsRunning());
+    CHECK(log.DroppedCount() == 0);
+
+    std::vector<LogRecord> records;
+    CHECK(ReadRecords(path, records));
+    CHECK(records.size() == threadCount * perThread);
+
+    std::vector<uint64_t> next(threadCount, 0);
+    bool ordered = true;
+    for (const LogRecord& record : records) {
+        if (record.event != static_cast<uint16_t>(LogEvent::ProbeResult) || record.argCount != 3 ||
+            record.args[0] >= threadCount) {
+            ordered = false;
+            continue;
+        }
+        uint64_t t = record.args[0];
+        if (record.args[1] != next[t] || record.args[2] != t * perThread + next[t]) {
+            ordered = false;
+        }
+        next[t] = record.args[1] + 1;
+    }
+    CHECK(ordered);
+    for (int t = 0; t < threadCount; t++) {
+        CHECK(next[t] == perThread);
+    }
+
+    // 最近的记录与文件末尾一致
+    std::vector<LogRecord> recent = log.RecentRecords(8);
+    CHECK(recent.size() == 8);
+    if (recent.size() == 8 && records.size() >= 8) {
+        CHECK(memcmp(&recent.back(), &records.back(), sizeof(LogRecord)) == 0);
+        CHECK(memcmp(&recent.front(), &records[records.size() - 8], sizeof(LogRecord)) == 0);
+    }
+}
+
+// 写入速度超过后台线程写出速度时丢弃新记录而不阻塞，丢弃数作为LogDropped记录写入文件
+void TestDropCounting() {
+    BinaryLog& log = BinaryLog::Instance();
+    fs::path path = TestDirectory() / "drops.blog";
+    uint64_t droppedBefore = log.DroppedCount();
+    CHECK(log.Start(path));
+
+    // 后台线程每100毫秒才写出一次，连续写入远超缓冲区容量的记录必然发生丢弃
+    const uint64_t total = BinaryLog::kCapacity * 16;
+    for (uint64_t i = 0; i < total; i++) {
+        log.Log(LogLevel::Info, LogEvent::ScanCompleted, i);
+    }
+    log.Stop();
+
+    uint64_t dropped = log.DroppedCount() - droppedBefore;
+    CHECK(dropped > 0);
+
+    std::vector<LogRecord> records;
+    CHECK(ReadRecords(path, records));
+    uint64_t written = 0;
+    uint64_t reported = 0;
+    uint64_t last = 0;
+    bool increasing = true;
+    for (const LogRecord& record : records) {
+        if (record.event == static_cast<uint16_t>(LogEvent::LogDropped)) {
+            CHECK(record.level == static_cast<uint8_t>(LogLevel::Warning));
+            reported += record.args[0];
+        } else if (record.event == static_cast<uint16_t>(LogEvent::ScanCompleted)) {
+            if (written > 0 && record.args[0] <= last) {
+                increasing = false;
+            }
+            last = record.args[0];
+            written++;
+        }
+    }
+    CHECK(written + dropped == total);
+    CHECK(reported == dropped);
+    CHECK(increasing);
+}
+
+// 文件达到上限时轮转：path -> path.1 -> path.2，超过保留个数的最旧文件被删除
+void TestRotate() {
+    BinaryLog& log = BinaryLog::Instance();
+    fs::path path = TestDirectory() / "rotate.blog";
+    const uint64_t recordsPerFile = 10;
+    const uint64_t maxFileBytes = kHeaderSize + recordsPerFile * sizeof(LogRecord);
+    CHECK(log.Start(path, maxFileBytes, 3));
+    for (uint64_t i = 0; i < 45; i++) {
+        log.Log(LogLevel::Info, LogEvent::AddressReady, i);
+    }
+    log.Stop();
+
+    fs::path rotated1 = path;
+    rotated1 += ".1";
+    fs::path rotated2 = path;
+    rotated2 += ".2";
+    fs::path rotated3 = path;
+    rotated3 += ".3";
+    CHECK(!fs::exists(rotated3));
+
+    // 0..19被轮转删除，path.2保存20..29，path.1保存30..39，当前文件保存40..44
+    const fs::path files[] = { rotated2, rotated1, path };
+    const uint64_t firstValues[] = { 20, 30, 40 };
+    const size_t counts[] = { 10, 10, 5 };
+    for (size_t f = 0; f < 3; f++) {
+        std::vector<LogRecord> records;
+        CHECK(ReadRecords(files[f], records));
+        CHECK(records.size() == counts[f]);
+        for (size_t i = 0; i < records.size() && i < counts[f]; i++) {
+            CHECK(records[i].args[0] == firstValues[f] + i);
+        }
+    }
+}
+
+// 解码为文字：按事件表替换参数，枚举参数输出名称
+void TestDecode() {
+    BinaryLog& log = BinaryLog::Instance();
+    fs::path path = TestDirectory() / "decode.blog";
+    CHECK(log.Start(path));
+    log.Log(LogLevel::Warning, LogEvent::StateChanged, ConnectionState::AwaitingAddress, ConnectionState::Online,
+        ConnectionEventType::ProbeOnline);
+    log.Log(LogLevel::Error, LogEvent::ServiceResume, 0xD, 0x8001);
+    log.Stop();
+
+    std::wostringstream text;
+    CHECK(BinaryLog::Decode(path, text));
+    std::wstring decoded = text.str();
+    std::wstring state = std::wstring(L"连接状态: ") +
+        ConnectionStateMachine::StateToString(ConnectionState::AwaitingAddress) + L" -> " +
+        ConnectionStateMachine::StateToString(ConnectionState::Online) + L"（" +
+        ConnectionStateMachine::EventToString(ConnectionEventType::ProbeOnline) + L"）\n";
+    CHECK(decoded.find(L"[WARN] #") != std::wstring::npos);
+    CHECK(decoded.find(state) != std::wstring::npos);
+    CHECK(decoded.find(L"[ERROR] #") != std::wstring::npos);
+    CHECK(decoded.find(L"收到恢复通知，控制码0xd，事件类型0x8001\n") != std::wstring::npos);
+
+    // 不是日志文件时解码失败
+    fs::path other = TestDirectory() / "not_a_log.blog";
+    std::ofstream(other) << "hello";
+    std::wostringstream ignored;
+    CHECK(!BinaryLog::Decode(other, ignored));
+}
+
+} // namespace
+
+int main() {
+    std::error_code error;
+    fs::remove_all(TestDirectory(), error);
+    fs::create_directories(TestDirectory());
+
+    TestLogBeforeStart();
+    TestConcurrentWriters();
+    TestDropCounting();
+    TestRotate();
+    TestDecode();
+
+    fs::remove_all(TestDirectory(), error);
+    return TestCheck::Report("binary_log_test");
+}
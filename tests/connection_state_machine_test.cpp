@@ -0,0 +1,449 @@
+﻿#include <cstdint>
+#include <iostream>
+#include "../include/connection_state_machine.h"
+#include "test_check.h"
+
+// 连接状态机的单元测试：Step是纯函数，逐个检查每个状态收到每个事件后的状态和动作
+
+namespace {
+
+const ConnectionState kStates[] = {
+    ConnectionState::Disconnected,
+    ConnectionState::Scanning,
+    ConnectionState::Associating,
+    ConnectionState::AwaitingAddress,
+    ConnectionState::PortalRequired,
+    ConnectionState::LoggingIn,
+    ConnectionState::Online,
+    ConnectionState::Degraded
+};
+
+const ConnectionEventType kEvents[] = {
+    ConnectionEventType::LinkUp,
+    ConnectionEventType::LinkDown,
+    ConnectionEventType::ScanDone,
+    ConnectionEventType::ConnectFailed,
+    ConnectionEventType::AddressReady,
+    ConnectionEventType::ProbeOnline,
+    ConnectionEventType::ProbePortal,
+    ConnectionEventType::ProbeOffline,
+    ConnectionEventType::LoginSucceeded,
+    ConnectionEventType::LoginRejected,
+    ConnectionEventType::LoginFailed,
+    ConnectionEventType::LoginBlocked,
+    ConnectionEventType::TimerExpired,
+    ConnectionEventType::Resume,
+    ConnectionEventType::ReconnectRequested,
+    ConnectionEventType::LoginRequested,
+    ConnectionEventType::SessionChanged
+};
+
+const int kStateCount = (int)(sizeof(kStates) / sizeof(kStates[0]));
+const int kEventCount = (int)(sizeof(kEvents) / sizeof(kEvents[0]));
+
+const uint64_t kStateSince = 1000;
+const uint64_t kDeadline = 2000;
+const uint64_t kNow = 5000;
+
+// 转换结果中与表格比较的部分；Ignored表示上下文原样返回、没有动作
+struct Expected {
+    bool ignored;
+    ConnectionState state;
+    ConnectionAction action;
+};
+
+const Expected kIgnored = { true, ConnectionState::Disconnected, ConnectionAction::None };
+
+Expected To(ConnectionState state, ConnectionAction action = ConnectionAction::None) {
+    return { false, state, action };
+}
+
+bool SameContext(const ConnectionContext& a, const ConnectionContext& b) {
+    return a.state == b.state && a.stateSince == b.stateSince && a.deadline == b.deadline &&
+           a.connectFailures == b.connectFailures && a.probeFailures == b.probeFailures &&
+           a.loginFailures == b.loginFailures && a.loginNotBefore == b.loginNotBefore &&
+           a.loginBlocked == b.loginBlocked && a.hasCredentials == b.hasCredentials;
+}
+
+bool IsLinkUp(ConnectionState state) {
+    return state != ConnectionState::Disconnected &&
+           state != ConnectionState::Scanning &&
+           state != ConnectionState::Associating;
+}
+
+// 每个状态的典型上下文：有账号密码、允许登录、定时器已到期（登录中没有定时器）
+ConnectionContext MakeContext(ConnectionState state) {
+    ConnectionContext context;
+    context.state = state;
+    context.stateSince = kStateSince;
+    context.deadline = state == ConnectionState::LoggingIn ? 0 : kDeadline;
+    context.hasCredentials = true;
+    return context;
+}
+
+// 典型上下文收到事件后的预期结果
+Expected ExpectedTransition(ConnectionState state, ConnectionEventType event) {
+    bool linkUp = IsLinkUp(state);
+    switch (event) {
+    case ConnectionEventType::LinkUp:
+        return linkUp ? kIgnored : To(ConnectionState::AwaitingAddress);
+    case ConnectionEventType::LinkDown:
+        // 等待重连（有定时器）、扫描、连接时忽略
+        return linkUp ? To(ConnectionState::Scanning, ConnectionAction::Scan) : kIgnored;
+    case ConnectionEventType::ScanDone:
+        return state == ConnectionState::Scanning ? To(ConnectionState::Associating, ConnectionAction::Connect) : kIgnored;
+    case ConnectionEventType::ConnectFailed:
+        return state == ConnectionState::Associating ? To(ConnectionState::Disconnected) : kIgnored;
+    case ConnectionEventType::AddressReady:
+        return state == ConnectionState::AwaitingAddress ? To(ConnectionState::AwaitingAddress, ConnectionAction::Probe) : kIgnored;
+    case ConnectionEventType::ProbeOnline:
+        return linkUp ? To(ConnectionState::Online) : kIgnored;
+    case ConnectionEventType::ProbePortal:
+        // 允许登录时立即登录
+        return linkUp ? To(ConnectionState::LoggingIn, ConnectionAction::Login) : kIgnored;
+    case ConnectionEventType::ProbeOffline:
+        return linkUp ? To(ConnectionState::Degraded) : kIgnored;
+    case ConnectionEventType::LoginSucceeded:
+        return state == ConnectionState::LoggingIn ? To(ConnectionState::Online) : kIgnored;
+    case ConnectionEventType::LoginRejected:
+    case ConnectionEventType::LoginFailed:
+    case ConnectionEventType::LoginBlocked:
+        return state == ConnectionState::LoggingIn ? To(ConnectionState::PortalRequired) : kIgnored;
+    case ConnectionEventType::TimerExpired:
+        switch (state) {
+        case ConnectionState::Disconnected:
+            return To(ConnectionState::Scanning, ConnectionAction::Scan);
+        case ConnectionState::Scanning:
+            return To(ConnectionState::Associating, ConnectionAction::Connect);
+        case ConnectionState::Associating:
+            return To(ConnectionState::Disconnected);
+        case ConnectionState::PortalRequired:
+            return To(ConnectionState::LoggingIn, ConnectionAction::Login);
+        case ConnectionState::LoggingIn:
+            return kIgnored;
+        default:
+            return To(state, ConnectionAction::Probe);
+        }
+    case ConnectionEventType::Resume:
+    case ConnectionEventType::ReconnectRequested:
+        return To(ConnectionState::Associating, ConnectionAction::Connect);
+    case ConnectionEventType::LoginRequested:
+        if (!linkUp || state == ConnectionState::AwaitingAddress || state == ConnectionState::LoggingIn) {
+            return kIgnored;
+        }
+        return To(ConnectionState::LoggingIn, ConnectionAction::Login);
+    case ConnectionEventType::SessionChanged:
+        if (state == ConnectionState::Disconnected) {
+            return To(ConnectionState::Scanning, ConnectionAction::Scan);
+        }
+        if (!linkUp || state == ConnectionState::AwaitingAddress || state == ConnectionState::LoggingIn) {
+            return kIgnored;
+        }
+        return To(state, ConnectionAction::Probe);
+    }
+    return kIgnored;
+}
+
+// 所有状态和事件的组合
+void TestTransitionTable() {
+    for (int s = 0; s < kStateCount; s++) {
+        for (int e = 0; e < kEventCount; e++) {
+            ConnectionContext context = MakeContext(kStates[s]);
+            ConnectionTransition transition = ConnectionStateMachine::Step(context, { kEvents[e], kNow });
+            Expected expected = ExpectedTransition(kStates[s], kEvents[e]);
+
+            bool passed;
+            if (expected.ignored) {
+                passed = SameContext(transition.context, context) && transition.action == ConnectionAction::None;
+            } else {
+                passed = transition.context.state == expected.state && transition.action == expected.action;
+                // 状态改变时记录进入时间，不变时保留原来的时间
+                uint64_t since = expected.state == kStates[s] ? kStateSince : kNow;
+                passed = passed && transition.context.stateSince == since;
+            }
+            if (!CHECK(passed)) {
+                std::cerr << "  state " << s << ", event " << e << std::endl;
+            }
+        }
+    }
+}
+
+// 各状态的定时器
+void TestTimers() {
+    ConnectionPolicy policy;
+
+    // 定时器未到期或已取消时忽略
+    ConnectionContext context = MakeContext(ConnectionState::Online);
+    ConnectionTransition transition = ConnectionStateMachine::Step(context, { ConnectionEventType::TimerExpired, kDeadline - 1 });
+    CHECK(SameContext(transition.context, context) && transition.action == ConnectionAction::None);
+    context.deadline = 0;
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::TimerExpired, kNow });
+    CHECK(SameContext(transition.context, context) && transition.action == ConnectionAction::None);
+
+    // 进入状态时设置对应的定时器
+    transition = ConnectionStateMachine::Step(MakeContext(ConnectionState::Online), { ConnectionEventType::LinkDown, kNow }, policy);
+    CHECK(transition.context.deadline == kNow + policy.scanTimeoutMs);
+    transition = ConnectionStateMachine::Step(MakeContext(ConnectionState::Scanning), { ConnectionEventType::ScanDone, kNow }, policy);
+    CHECK(transition.context.deadline == kNow + policy.connectTimeoutMs);
+    transition = ConnectionStateMachine::Step(MakeContext(ConnectionState::Associating), { ConnectionEventType::LinkUp, kNow }, policy);
+    CHECK(transition.context.deadline == kNow + policy.addressWaitMs);
+    transition = ConnectionStateMachine::Step(MakeContext(ConnectionState::AwaitingAddress), { ConnectionEventType::AddressReady, kNow }, policy);
+    CHECK(transition.context.deadline == 0);
+    transition = ConnectionStateMachine::Step(MakeContext(ConnectionState::AwaitingAddress), { ConnectionEventType::ProbeOnline, kNow }, policy);
+    CHECK(transition.context.deadline == kNow + policy.healthCheckIntervalMs);
+
+    // 未连接且没有定时器时（服务刚启动）收到LinkDown立即扫描
+    context = MakeContext(ConnectionState::Disconnected);
+    context.deadline = 0;
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::LinkDown, kNow });
+    CHECK(transition.context.state == ConnectionState::Scanning && transition.action == ConnectionAction::Scan);
+}
+
+// 连接失败的退避时间按失败次数递增，有上限，连接成功后清零
+void TestConnectBackoff() {
+    ConnectionPolicy policy;
+    ConnectionContext context = MakeContext(ConnectionState::Associating);
+    uint64_t now = kNow;
+    for (uint32_t failures = 1; failures <= 20; failures++) {
+        context.state = ConnectionState::Associating;
+        ConnectionTransition transition = ConnectionStateMachine::Step(context, { ConnectionEventType::ConnectFailed, now }, policy);
+        uint64_t delay = policy.connectBackoffStepMs * failures;
+        if (delay > policy.connectBackoffMaxMs) {
+            delay = policy.connectBackoffMaxMs;
+        }
+        CHECK(transition.context.connectFailures == failures);
+        CHECK(transition.context.deadline == now + delay);
+        context = transition.context;
+        now += delay;
+    }
+
+    // 等待期间的LinkDown不会绕过退避时间
+    ConnectionTransition transition = ConnectionStateMachine::Step(context, { ConnectionEventType::LinkDown, now - 1 }, policy);
+    CHECK(SameContext(transition.context, context));
+
+    context.state = ConnectionState::Associating;
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::LinkUp, now }, policy);
+    CHECK(transition.context.connectFailures == 0);
+}
+
+// 网络异常时的探测间隔按失败次数递增，最多等于定期探测间隔
+void TestDegradedBackoff() {
+    ConnectionPolicy policy;
+    ConnectionContext context = MakeContext(ConnectionState::Online);
+    for (uint32_t failures = 1; failures <= 5; failures++) {
+        ConnectionTransition transition = ConnectionStateMachine::Step(context, { ConnectionEventType::ProbeOffline, kNow }, policy);
+        uint64_t delay = policy.degradedRetryMs * failures;
+        if (delay > policy.healthCheckIntervalMs) {
+            delay = policy.healthCheckIntervalMs;
+        }
+        CHECK(transition.context.state == ConnectionState::Degraded);
+        CHECK(transition.context.probeFailures == failures);
+        CHECK(transition.context.deadline == kNow + delay);
+        context = transition.context;
+    }
+
+    ConnectionTransition transition = ConnectionStateMachine::Step(context, { ConnectionEventType::ProbeOnline, kNow }, policy);
+    CHECK(transition.context.state == ConnectionState::Online && transition.context.probeFailures == 0);
+}
+
+// 登录失败后的处理
+void TestLoginFailures() {
+    ConnectionPolicy policy;
+
+    // 账号或密码错误：停止自动登录，只定期重新探测
+    ConnectionContext context = MakeContext(ConnectionState::LoggingIn);
+    ConnectionTransition transition = ConnectionStateMachine::Step(context, { ConnectionEventType::LoginBlocked, kNow }, policy);
+    CHECK(transition.context.state == ConnectionState::PortalRequired);
+    CHECK(transition.context.loginBlocked);
+    CHECK(transition.action == ConnectionAction::None);
+    CHECK(transition.context.deadline == kNow + policy.healthCheckIntervalMs);
+
+    // 停止登录后定时器到期只探测，需要认证时也不再登录
+    context = transition.context;
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::TimerExpired, context.deadline }, policy);
+    CHECK(transition.context.state == ConnectionState::PortalRequired && transition.action == ConnectionAction::Probe);
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::ProbePortal, kNow }, policy);
+    CHECK(transition.context.state == ConnectionState::PortalRequired && transition.action == ConnectionAction::None);
+
+    // 用户要求时再试一次
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::LoginRequested, kNow }, policy);
+    CHECK(transition.context.state == ConnectionState::LoggingIn && transition.action == ConnectionAction::Login);
+    CHECK(!transition.context.loginBlocked);
+
+    // 账号被占用：固定等待
+    context = MakeContext(ConnectionState::LoggingIn);
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::LoginRejected, kNow }, policy);
+    CHECK(transition.context.loginNotBefore == kNow + policy.accountLimitDelayMs);
+    CHECK(transition.context.deadline == transition.context.loginNotBefore);
+
+    // 临时错误：指数退避，有上限
+    context = MakeContext(ConnectionState::LoggingIn);
+    for (uint32_t failures = 1; failures <= 10; failures++) {
+        context.state = ConnectionState::LoggingIn;
+        transition = ConnectionStateMachine::Step(context, { ConnectionEventType::LoginFailed, kNow }, policy);
+        uint32_t shift = failures - 1 < 6 ? failures - 1 : 6;
+        uint64_t delay = policy.loginBackoffBaseMs << shift;
+        if (delay > policy.loginBackoffMaxMs) {
+            delay = policy.loginBackoffMaxMs;
+        }
+        CHECK(transition.context.loginFailures == failures);
+        CHECK(transition.context.loginNotBefore == kNow + delay);
+        CHECK(transition.context.state == ConnectionState::PortalRequired);
+        context = transition.context;
+    }
+
+    // 未到允许登录的时间时定时器到期只探测
+    context.deadline = kNow;
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::TimerExpired, kNow }, policy);
+    CHECK(transition.action == ConnectionAction::Probe);
+
+    // 登录成功后在保持时间内不再登录
+    context = MakeContext(ConnectionState::LoggingIn);
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::LoginSucceeded, kNow }, policy);
+    CHECK(transition.context.loginFailures == 0 && transition.context.loginNotBefore == kNow + policy.loginHoldMs);
+    transition = ConnectionStateMachine::Step(transition.context, { ConnectionEventType::ProbePortal, kNow + 1 }, policy);
+    CHECK(transition.context.state == ConnectionState::PortalRequired && transition.action == ConnectionAction::None);
+
+    // 没有账号密码时不登录
+    context = MakeContext(ConnectionState::Online);
+    context.hasCredentials = false;
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::ProbePortal, kNow }, policy);
+    CHECK(transition.context.state == ConnectionState::PortalRequired && transition.action == ConnectionAction::None);
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::LoginRequested, kNow }, policy);
+    CHECK(SameContext(transition.context, context));
+}
+
+// 从任何状态恢复都重新连接，清除退避状态；账号密码错误的状态保留
+void TestResume() {
+    for (int s = 0; s < kStateCount; s++) {
+        for (ConnectionEventType event : { ConnectionEventType::Resume, ConnectionEventType::ReconnectRequested }) {
+            ConnectionContext context = MakeContext(kStates[s]);
+            context.connectFailures = 3;
+            context.probeFailures = 2;
+            context.loginFailures = 4;
+            context.loginNotBefore = kNow + 100000;
+            ConnectionTransition transition = ConnectionStateMachine::Step(context, { event, kNow });
+            CHECK(transition.context.state == ConnectionState::Associating);
+            CHECK(transition.action == ConnectionAction::Connect);
+            CHECK(transition.context.connectFailures == 0 && transition.context.probeFailures == 0);
+            CHECK(transition.context.loginFailures == 0 && transition.context.loginNotBefore == 0);
+
+            context.loginBlocked = true;
+            transition = ConnectionStateMachine::Step(context, { event, kNow });
+            CHECK(transition.context.loginBlocked);
+            CHECK(transition.context.loginFailures == 4 && transition.context.loginNotBefore == kNow + 100000);
+        }
+    }
+}
+
+// 用户会话变化时先探测：在线时只探测不重新连接，需要认证时才登录；系统恢复仍然无条件重新连接
+void TestSessionChanged() {
+    ConnectionPolicy policy;
+
+    // 在线：探测确认后保持在线，不断开WiFi，也不登录
+    ConnectionContext context = MakeContext(ConnectionState::Online);
+    context.loginNotBefore = kNow + 100000;
+    ConnectionTransition transition = ConnectionStateMachine::Step(context, { ConnectionEventType::SessionChanged, kNow }, policy);
+    CHECK(transition.context.state == ConnectionState::Online && transition.action == ConnectionAction::Probe);
+    CHECK(transition.context.stateSince == kStateSince && transition.context.deadline == 0);
+    CHECK(transition.context.loginNotBefore == context.loginNotBefore);
+    transition = ConnectionStateMachine::Step(transition.context, { ConnectionEventType::ProbeOnline, kNow + 1 }, policy);
+    CHECK(transition.context.state == ConnectionState::Online && transition.action == ConnectionAction::None);
+    CHECK(transition.context.stateSince == kStateSince);
+    CHECK(transition.context.deadline == kNow + 1 + policy.healthCheckIntervalMs);
+
+    // 在线但会话已在认证服务器上失效：探测发现需要认证后登录
+    context = MakeContext(ConnectionState::Online);
+    const ConnectionEventType events[] = {
+        ConnectionEventType::SessionChanged,
+        ConnectionEventType::ProbePortal,
+        ConnectionEventType::LoginSucceeded
+    };
+    const ConnectionAction actions[] = {
+        ConnectionAction::Probe,
+        ConnectionAction::Login,
+        ConnectionAction::None
+    };
+    uint64_t now = kNow;
+    for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++) {
+        transition = ConnectionStateMachine::Step(context, { events[i], now++ }, policy);
+        CHECK(transition.action == actions[i]);
+        CHECK(transition.context.state != ConnectionState::Associating);
+        context = transition.context;
+    }
+    CHECK(context.state == ConnectionState::Online);
+
+    // 等待登录退避时只探测，不绕过退避时间
+    context = MakeContext(ConnectionState::PortalRequired);
+    context.loginFailures = 2;
+    context.loginNotBefore = kNow + 100000;
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::SessionChanged, kNow }, policy);
+    CHECK(transition.action == ConnectionAction::Probe);
+    transition = ConnectionStateMachine::Step(transition.context, { ConnectionEventType::ProbePortal, kNow }, policy);
+    CHECK(transition.context.state == ConnectionState::PortalRequired && transition.action == ConnectionAction::None);
+    CHECK(transition.context.loginFailures == 2 && transition.context.deadline == kNow + 100000);
+
+    // 等待重连时立即扫描，保留连接失败次数
+    context = MakeContext(ConnectionState::Disconnected);
+    context.connectFailures = 3;
+    transition = ConnectionStateMachine::Step(context, { ConnectionEventType::SessionChanged, kNow }, policy);
+    CHECK(transition.context.state == ConnectionState::Scanning && transition.action == ConnectionAction::Scan);
+    CHECK(transition.context.connectFailures == 3);
+
+    // 系统从睡眠中恢复时即使在线也重新连接
+    transition = ConnectionStateMachine::Step(MakeContext(ConnectionState::Online), { ConnectionEventType::Resume, kNow }, policy);
+    CHECK(transition.context.state == ConnectionState::Associating && transition.action == ConnectionAction::Connect);
+}
+
+// 完整的重连周期：断开、扫描、连接、获取地址、需要认证、登录成功
+void TestReconnectCycle() {
+    ConnectionContext context = MakeContext(ConnectionState::Online);
+    const ConnectionEventType events[] = {
+        ConnectionEventType::LinkDown,
+        ConnectionEventType::ScanDone,
+        ConnectionEventType::LinkUp,
+        ConnectionEventType::AddressReady,
+        ConnectionEventType::ProbePortal,
+        ConnectionEventType::LoginSucceeded
+    };
+    const ConnectionAction actions[] = {
+        ConnectionAction::Scan,
+        ConnectionAction::Connect,
+        ConnectionAction::None,
+        ConnectionAction::Probe,
+        ConnectionAction::Login,
+        ConnectionAction::None
+    };
+    uint64_t now = kNow;
+    for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++) {
+        ConnectionTransition transition = ConnectionStateMachine::Step(context, { events[i], now++ });
+        CHECK(transition.action == actions[i]);
+        context = transition.context;
+    }
+    CHECK(context.state == ConnectionState::Online);
+}
+
+// 状态和事件名称
+void TestNames() {
+    for (ConnectionState state : kStates) {
+        CHECK(ConnectionStateMachine::StateToString(state)[0] != L'\0');
+    }
+    for (ConnectionEventType event : kEvents) {
+        CHECK(ConnectionStateMachine::EventToString(event)[0] != L'\0');
+    }
+}
+
+} // namespace
+
+int main() {
+    TestTransitionTable();
+    TestTimers();
+    TestConnectBackoff();
+    TestDegradedBackoff();
+    TestLoginFailures();
+    TestResume();
+    TestSessionChanged();
+    TestReconnectCycle();
+    TestNames();
+    return TestCheck::Report("connection_state_machine_test");
+}
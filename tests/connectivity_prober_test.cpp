@@ -0,0 +1,219 @@
+﻿#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "../include/connectivity_prober.h"
+#include "../include/mock_portal.h"
+#include "../include/socket_http_transport.h"
+#include "test_check.h"
+
+// 连通性探测的单元测试：对本机的模拟认证服务器检查最快的确定结果胜出、落败的探测被取消、
+// 认证网关重定向、校园网状态查询的兜底、总截止时间和中断
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+uint64_t ElapsedMs(Clock::time_point start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+std::string ChkstatusUrl(const MockPortal& portal) {
+    return portal.GetBaseUrl() + "/drcom/chkstatus?callback=dr1002";
+}
+
+// 以本机地址登录模拟认证服务器，之后探测请求返回200
+bool Login(HttpTransport& transport, const MockPortal& portal) {
+    HttpRequest request;
+    request.url = portal.GetBaseUrl() + "/eportal/portal/login?callback=dr1003&user_account=test&user_password=test";
+    request.timeoutMs = 5000;
+    HttpResponse response;
+    return transport.Send(request, response, nullptr) && response.body.find("\"result\":1") != std::string::npos;
+}
+
+// 探测请求延迟或不回复
+void SetProbeFaults(MockPortal& portal, uint32_t latencyMs, uint32_t timeoutPercent) {
+    MockPortalFaults faults;
+    faults.latencyMs = latencyMs;
+    faults.timeoutPercent = timeoutPercent;
+    portal.SetFaults(MockEndpoint::Probe, faults);
+}
+
+void TestClassify() {
+    ConnectivityProber::Target anyResponse = { "https://example.com", "HEAD", 0 };
+    ConnectivityProber::Target expect204 = { "http://example.com/generate_204", "GET", 204 };
+    HttpResponse response;
+
+    response.statusCode = 0;
+    CHECK(ConnectivityProber::Classify(anyResponse, response) == ConnectivityProber::Status::Offline);
+    response.statusCode = 301;
+    CHECK(ConnectivityProber::Classify(anyResponse, response) == ConnectivityProber::Status::Online);
+    response.statusCode = 204;
+    CHECK(ConnectivityProber::Classify(expect204, response) == ConnectivityProber::Status::Online);
+    response.statusCode = 302;
+    CHECK(ConnectivityProber::Classify(expect204, response) == ConnectivityProber::Status::CaptivePortal);
+    response.statusCode = 200;
+    CHECK(ConnectivityProber::Classify(expect204, response) == ConnectivityProber::Status::CaptivePortal);
+    response.statusCode = 503;
+    CHECK(ConnectivityProber::Classify(expect204, response) == ConnectivityProber::Status::Offline);
+}
+
+// 最快的确定结果胜出，较慢的探测被取消，不必等它完成
+void TestFastestTargetWins() {
+    MockPortal slow;
+    MockPortal fast;
+    CHECK(slow.Start());
+    CHECK(fast.Start());
+    SocketHttpTransport transport;
+    CHECK(Login(transport, slow));
+    CHECK(Login(transport, fast));
+    SetProbeFaults(slow, 2000, 0);
+
+    ConnectivityProber prober(transport);
+    std::string fastUrl = fast.GetBaseUrl() + "/probe/fast";
+    prober.SetTargets({ { slow.GetBaseUrl() + "/probe/slow", "HEAD", 0 }, { fastUrl, "HEAD", 0 } });
+    prober.SetDeadline(5000);
+
+    Clock::time_point start = Clock::now();
+    ConnectivityProber::Result result = prober.Probe();
+    uint64_t elapsedMs = ElapsedMs(start);
+
+    CHECK(result.status == ConnectivityProber::Status::Online);
+    CHECK(result.probeUrl == fastUrl);
+    CHECK(result.statusCode == 200);
+    CHECK(result.elapsedMs <= elapsedMs);
+    CHECK(result.elapsedMs < 1000);
+    CHECK(elapsedMs < 1000);
+    CHECK(slow.GetStats().probeRequests == 1);
+}
+
+// 未认证时204探测被重定向到登录页面
+void TestCaptivePortalRedirect() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    SocketHttpTransport transport;
+
+    ConnectivityProber prober(transport);
+    std::string url = portal.GetBaseUrl() + "/generate_204";
+    prober.SetTargets({ { url, "GET", 204 } });
+    prober.SetPortalUrl(ChkstatusUrl(portal));
+    prober.SetDeadline(5000);
+
+    ConnectivityProber::Result result = prober.Probe();
+    CHECK(result.status == ConnectivityProber::Status::CaptivePortal);
+    CHECK(result.probeUrl == url);
+    CHECK(result.statusCode == 302);
+    CHECK(result.redirectLocation.find("/a79.htm") != std::string::npos);
+}
+
+// 外网探测全部不回复、状态查询可达时，在截止时间判断为需要登录
+void TestPortalFallback() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    SetProbeFaults(portal, 0, 100);
+    SocketHttpTransport transport;
+
+    ConnectivityProber prober(transport);
+    prober.SetTargets({ { portal.GetBaseUrl() + "/probe/a", "HEAD", 0 }, { portal.GetBaseUrl() + "/probe/b", "HEAD", 0 } });
+    prober.SetPortalUrl(ChkstatusUrl(portal));
+    prober.SetDeadline(300);
+
+    Clock::time_point start = Clock::now();
+    ConnectivityProber::Result result = prober.Probe();
+    uint64_t elapsedMs = ElapsedMs(start);
+
+    CHECK(result.status == ConnectivityProber::Status::CaptivePortal);
+    CHECK(result.probeUrl == ChkstatusUrl(portal));
+    CHECK(result.elapsedMs < 300);
+    CHECK(elapsedMs >= 290);
+    CHECK(elapsedMs < 2000);
+}
+
+// 所有目标都不回复时在总截止时间返回不在线，不会等待各请求自己的超时
+void TestDeadline() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    SetProbeFaults(portal, 0, 100);
+    MockPortalFaults hang;
+    hang.timeoutPercent = 100;
+    portal.SetFaults(MockEndpoint::Chkstatus, hang);
+    SocketHttpTransport transport;
+
+    ConnectivityProber prober(transport);
+    prober.SetTargets({ { portal.GetBaseUrl() + "/probe/a", "HEAD", 0 }, { portal.GetBaseUrl() + "/generate_204", "GET", 204 } });
+    prober.SetPortalUrl(ChkstatusUrl(portal));
+    prober.SetDeadline(300);
+
+    Clock::time_point start = Clock::now();
+    ConnectivityProber::Result result = prober.Probe();
+    uint64_t elapsedMs = ElapsedMs(start);
+
+    CHECK(result.status == ConnectivityProber::Status::Offline);
+    CHECK(result.probeUrl.empty());
+    CHECK(result.elapsedMs >= 290);
+    CHECK(elapsedMs < 2000);
+}
+
+// 所有目标都连接失败时不必等到截止时间
+void TestAllTargetsFail() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    std::string baseUrl = portal.GetBaseUrl();
+    portal.Stop();
+    SocketHttpTransport transport;
+
+    ConnectivityProber prober(transport);
+    prober.SetTargets({ { baseUrl + "/probe/a", "HEAD", 0 } });
+    prober.SetPortalUrl(baseUrl + "/drcom/chkstatus?callback=dr1002");
+    prober.SetDeadline(5000);
+
+    Clock::time_point start = Clock::now();
+    ConnectivityProber::Result result = prober.Probe();
+
+    CHECK(result.status == ConnectivityProber::Status::Offline);
+    CHECK(ElapsedMs(start) < 2000);
+}
+
+// 中断时取消所有探测并尽快返回
+void TestStop() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    SetProbeFaults(portal, 0, 100);
+    SocketHttpTransport transport;
+
+    ConnectivityProber prober(transport);
+    prober.SetTargets({ { portal.GetBaseUrl() + "/probe/a", "HEAD", 0 } });
+    prober.SetDeadline(10000);
+
+    HttpCancel stop;
+    std::thread stopper([&stop]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        stop.Cancel();
+    });
+    Clock::time_point start = Clock::now();
+    ConnectivityProber::Result result = prober.Probe(&stop);
+    uint64_t elapsedMs = ElapsedMs(start);
+    stopper.join();
+
+    CHECK(result.status == ConnectivityProber::Status::Offline);
+    CHECK(elapsedMs < 2000);
+
+    // 已中断时不再发出探测
+    uint64_t requests = portal.GetStats().probeRequests;
+    result = prober.Probe(&stop);
+    CHECK(result.status == ConnectivityProber::Status::Offline);
+    CHECK(portal.GetStats().probeRequests == requests);
+}
+
+} // namespace
+
+int main() {
+    TestClassify();
+    TestFastestTargetWins();
+    TestCaptivePortalRedirect();
+    TestPortalFallback();
+    TestDeadline();
+    TestAllTargetsFail();
+    TestStop();
+    return TestCheck::Report("connectivity_prober_test");
+}
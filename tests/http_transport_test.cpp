@@ -0,0 +1,323 @@
+﻿#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/mock_portal.h"
+#include "../include/socket_http_transport.h"
+#include "test_check.h"
+
+// 套接字传输层的单元测试：对本机的模拟认证服务器检查长连接复用、单主机并发上限、
+// 空闲连接回收、重定向和取消（包括排队等待名额时的取消）
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+uint64_t ElapsedMs(Clock::time_point start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+HttpRequest Get(const std::string& url) {
+    HttpRequest request;
+    request.url = url;
+    request.timeoutMs = 5000;
+    return request;
+}
+
+std::string ChkstatusUrl(const MockPortal& portal) {
+    return portal.GetBaseUrl() + "/drcom/chkstatus?callback=dr1002";
+}
+
+// 在另一个线程中延迟取消
+std::thread CancelAfter(HttpCancel& cancel, uint32_t delayMs) {
+    return std::thread([&cancel, delayMs]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        cancel.Cancel();
+    });
+}
+
+void TestParseUrl() {
+    std::string host, path;
+    uint16_t port = 0;
+    CHECK(SocketHttpTransport::ParseUrl("http://127.0.0.1:8080/drcom/chkstatus?a=1", host, port, path));
+    CHECK(host == "127.0.0.1" && port == 8080 && path == "/drcom/chkstatus?a=1");
+    CHECK(SocketHttpTransport::ParseUrl("http://example.com", host, port, path));
+    CHECK(host == "example.com" && port == 80 && path == "/");
+    CHECK(SocketHttpTransport::ParseUrl("http://example.com?q", host, port, path));
+    CHECK(path == "/?q");
+    CHECK(SocketHttpTransport::ParseUrl("http://[::1]:81/x", host, port, path));
+    CHECK(host == "::1" && port == 81 && path == "/x");
+    CHECK(!SocketHttpTransport::ParseUrl("https://example.com/", host, port, path));
+    CHECK(!SocketHttpTransport::ParseUrl("http://:80/", host, port, path));
+    CHECK(!SocketHttpTransport::ParseUrl("http://host:99999/", host, port, path));
+    CHECK(!SocketHttpTransport::ParseUrl("http://host:8a/", host, port, path));
+}
+
+// 连续的请求复用同一个连接
+void TestKeepAlive() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    SocketHttpTransport transport;
+
+    const int requestCount = 10;
+    int succeeded = 0;
+    for (int i = 0; i < requestCount; i++) {
+        HttpResponse response;
+        if (transport.Send(Get(ChkstatusUrl(portal)), response, nullptr) && response.statusCode == 200 &&
+            response.body.compare(0, 7, "dr1002(") == 0) {
+            succeeded++;
+        }
+    }
+    CHECK(succeeded == requestCount);
+
+    MockPortalStats stats = portal.GetStats();
+    CHECK(stats.requests == requestCount);
+    CHECK(stats.connections == 1);
+}
+
+// 同时发出的请求数超过单主机上限时排队，连接数不超过上限
+void TestPerHostCap() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    MockPortalFaults slow;
+    slow.latencyMs = 100;
+    portal.SetFaults(MockEndpoint::Chkstatus, slow);
+
+    SocketHttpTransport transport;
+    transport.SetLimits(2, 60000);
+
+    const int requestCount = 6;
+    std::atomic<int> succeeded(0);
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < requestCount; i++) {
+        threads.emplace_back([&]() {
+            HttpResponse response;
+            if (transport.Send(Get(ChkstatusUrl(portal)), response, nullptr) && response.statusCode == 200) {
+                succeeded++;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    uint64_t elapsed = ElapsedMs(start);
+
+    CHECK(succeeded == requestCount);
+    MockPortalStats stats = portal.GetStats();
+    CHECK(stats.requests == requestCount);
+    CHECK(stats.connections == 2);
+    // 每次最多两个请求同时进行，6个100毫秒的请求至少需要3轮
+    CHECK(elapsed >= 290);
+}
+
+// 超过空闲时间的连接被关闭，之后的请求建立新连接
+void TestIdleEviction() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    SocketHttpTransport transport;
+    transport.SetLimits(4, 50);
+
+    HttpResponse response;
+    CHECK(transport.Send(Get(ChkstatusUrl(portal)), response, nullptr));
+    CHECK(transport.Send(Get(ChkstatusUrl(portal)), response, nullptr));
+    CHECK(portal.GetStats().connections == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    transport.ReleaseIdleConnections();
+    CHECK(transport.Send(Get(ChkstatusUrl(portal)), response, nullptr));
+    CHECK(portal.GetStats().connections == 2);
+
+    // 不显式回收时，获取连接前也会关闭超时的空闲连接
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(transport.Send(Get(ChkstatusUrl(portal)), response, nullptr));
+    CHECK(portal.GetStats().connections == 3);
+}
+
+// 不跟随重定向时返回302和Location，跟随时返回最终的响应
+void TestRedirect() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    SocketHttpTransport transport;
+
+    HttpRequest request = Get(portal.GetBaseUrl() + "/generate_204");
+    request.followRedirects = false;
+    HttpResponse response;
+    CHECK(transport.Send(request, response, nullptr));
+    CHECK(response.statusCode == 302);
+    CHECK(response.location.find("/a79.htm?wlanuserip=127.0.0.1") != std::string::npos);
+
+    request.followRedirects = true;
+    CHECK(transport.Send(request, response, nullptr));
+    CHECK(response.statusCode == 404);
+    CHECK(response.body == "Not Found");
+    CHECK(portal.GetStats().connections == 1);
+}
+
+// HEAD响应没有响应体，连接可以继续使用；响应体超过上限时截断，连接不再复用
+void TestHeadAndTruncation() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    SocketHttpTransport transport;
+
+    HttpResponse response;
+    CHECK(transport.Send(Get(portal.GetBaseUrl() + "/eportal/portal/login?callback=dr1003&user_account=a&user_password=b"),
+        response, nullptr));
+    CHECK(portal.IsOnline("127.0.0.1"));
+
+    HttpRequest head = Get(portal.GetBaseUrl() + "/probe/baidu");
+    head.method = "HEAD";
+    CHECK(transport.Send(head, response, nullptr));
+    CHECK(response.statusCode == 200);
+    CHECK(response.body.empty());
+
+    HttpRequest get = Get(portal.GetBaseUrl() + "/probe/baidu");
+    CHECK(transport.Send(get, response, nullptr));
+    CHECK(response.body == "<html><body>ok</body></html>");
+    CHECK(!response.truncated);
+    CHECK(portal.GetStats().connections == 1);
+
+    get.maxBodyBytes = 6;
+    CHECK(transport.Send(get, response, nullptr));
+    CHECK(response.body == "<html>");
+    CHECK(response.truncated);
+    CHECK(transport.Send(Get(ChkstatusUrl(portal)), response, nullptr));
+    CHECK(portal.GetStats().connections == 2);
+}
+
+// 服务器只发送一半响应体就关闭连接：返回已收到的部分，之后的请求使用新连接
+void TestServerTruncation() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    MockPortalFaults truncate;
+    truncate.truncatePercent = 100;
+    portal.SetFaults(MockEndpoint::Chkstatus, truncate);
+
+    SocketHttpTransport transport;
+    HttpResponse response;
+    CHECK(transport.Send(Get(ChkstatusUrl(portal)), response, nullptr));
+    CHECK(response.statusCode == 200);
+    CHECK(!response.body.empty());
+    CHECK(response.body.back() != ')');
+
+    portal.SetFaults(MockEndpoint::Chkstatus, MockPortalFaults());
+    CHECK(transport.Send(Get(ChkstatusUrl(portal)), response, nullptr));
+    CHECK(response.body.compare(0, 7, "dr1002(") == 0);
+    CHECK(portal.GetStats().connections == 2);
+}
+
+// 服务器不回复时，其他线程取消请求后立即返回，名额被归还
+void TestCancelHungRequest() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    MockPortalFaults hang;
+    hang.timeoutPercent = 100;
+    portal.SetFaults(MockEndpoint::Chkstatus, hang);
+
+    SocketHttpTransport transport;
+    transport.SetLimits(1, 60000);
+
+    HttpCancel cancel;
+    HttpRequest request = Get(ChkstatusUrl(portal));
+    request.timeoutMs = 30000;
+    Clock::time_point start = Clock::now();
+    std::thread canceller = CancelAfter(cancel, 100);
+    HttpResponse response;
+    bool sent = transport.Send(request, response, &cancel);
+    uint64_t elapsed = ElapsedMs(start);
+    canceller.join();
+
+    CHECK(!sent);
+    CHECK(cancel.IsCancelled());
+    CHECK(elapsed >= 90 && elapsed < 1000);
+
+    // 唯一的名额已归还
+    portal.SetFaults(MockEndpoint::Chkstatus, MockPortalFaults());
+    CHECK(transport.Send(Get(ChkstatusUrl(portal)), response, nullptr));
+    CHECK(response.statusCode == 200);
+}
+
+// 排队等待名额的请求也可以被取消，不影响正在进行的请求
+void TestCancelWhileQueued() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    MockPortalFaults hang;
+    hang.timeoutPercent = 100;
+    portal.SetFaults(MockEndpoint::Chkstatus, hang);
+
+    SocketHttpTransport transport;
+    transport.SetLimits(1, 60000);
+
+    HttpCancel holderCancel;
+    std::atomic<bool> holderDone(false);
+    std::thread holder([&]() {
+        HttpResponse response;
+        transport.Send(Get(ChkstatusUrl(portal)), response, &holderCancel);
+        holderDone = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    HttpCancel queuedCancel;
+    Clock::time_point start = Clock::now();
+    std::thread canceller = CancelAfter(queuedCancel, 100);
+    HttpResponse response;
+    bool sent = transport.Send(Get(ChkstatusUrl(portal)), response, &queuedCancel);
+    uint64_t elapsed = ElapsedMs(start);
+    canceller.join();
+
+    CHECK(!sent);
+    CHECK(elapsed < 1000);
+    CHECK(!holderDone);
+    CHECK(portal.GetStats().requests == 1);
+
+    holderCancel.Cancel();
+    holder.join();
+    CHECK(holderDone);
+}
+
+// 已取消的请求不会发出
+void TestCancelledBeforeSend() {
+    MockPortal portal;
+    CHECK(portal.Start());
+    SocketHttpTransport transport;
+
+    HttpCancel cancel;
+    cancel.Cancel();
+    HttpResponse response;
+    CHECK(!transport.Send(Get(ChkstatusUrl(portal)), response, &cancel));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(portal.GetStats().connections == 0);
+}
+
+// 连接被拒绝时返回false
+void TestConnectFailure() {
+    uint16_t port;
+    {
+        MockPortal portal;
+        CHECK(portal.Start());
+        port = portal.GetPort();
+    }
+    SocketHttpTransport transport;
+    HttpResponse response;
+    CHECK(!transport.Send(Get("http://127.0.0.1:" + std::to_string(port) + "/"), response, nullptr));
+    CHECK(response.statusCode == 0);
+}
+
+} // namespace
+
+int main() {
+    TestParseUrl();
+    TestKeepAlive();
+    TestPerHostCap();
+    TestIdleEviction();
+    TestRedirect();
+    TestHeadAndTruncation();
+    TestServerTruncation();
+    TestCancelHungRequest();
+    TestCancelWhileQueued();
+    TestCancelledBeforeSend();
+    TestConnectFailure();
+    return TestCheck::Report("http_transport_test");
+}
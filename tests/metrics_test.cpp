@@ -0,0 +1,141 @@
+﻿#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/metrics.h"
+#include "test_check.h"
+
+// 指标的单元测试：直方图的分桶、分位数和并发记录，注册表的注册和导出
+
+namespace {
+
+const size_t kLastBucket = MetricHistogram::BucketIndex(std::numeric_limits<uint64_t>::max());
+
+// 小于16的值各占一个桶
+void TestLinearBuckets() {
+    for (uint64_t value = 0; value < 16; value++) {
+        CHECK(MetricHistogram::BucketIndex(value) == value);
+        CHECK(MetricHistogram::BucketUpperBound((size_t)value) == value);
+    }
+    CHECK(MetricHistogram::BucketIndex(16) == 16);
+}
+
+// 各桶首尾相接：每个桶的上界落在该桶内，上界加1落在下一个桶，桶宽不超过下界的1/8
+void TestBucketBoundaries() {
+    uint64_t lower = 0;
+    for (size_t index = 0; index <= kLastBucket; index++) {
+        uint64_t upper = MetricHistogram::BucketUpperBound(index);
+        CHECK(upper >= lower);
+        CHECK(MetricHistogram::BucketIndex(lower) == index);
+        CHECK(MetricHistogram::BucketIndex(upper) == index);
+        if (lower >= 16) {
+            CHECK(upper - lower < lower / 8 + 1);
+        }
+        if (index < kLastBucket) {
+            CHECK(MetricHistogram::BucketIndex(upper + 1) == index + 1);
+        }
+        lower = upper + 1;
+    }
+    CHECK(MetricHistogram::BucketUpperBound(kLastBucket) == std::numeric_limits<uint64_t>::max());
+}
+
+// 分位数返回所在桶的上界，不超过最大记录值
+void TestPercentile() {
+    MetricHistogram empty;
+    CHECK(empty.Percentile(0.5) == 0);
+    CHECK(empty.Count() == 0);
+
+    MetricHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; value++) {
+        histogram.Record(value);
+    }
+    CHECK(histogram.Count() == 1000);
+    CHECK(histogram.Sum() == 500500);
+    CHECK(histogram.Max() == 1000);
+
+    uint64_t p50 = histogram.Percentile(0.5);
+    uint64_t p90 = histogram.Percentile(0.9);
+    uint64_t p99 = histogram.Percentile(0.99);
+    CHECK(p50 >= 500 && p50 <= 500 + 500 / 8);
+    CHECK(p90 >= 900 && p90 <= 900 + 900 / 8);
+    CHECK(p99 >= 990 && p99 <= 1000);
+    CHECK(histogram.Percentile(1.0) == 1000);
+    CHECK(histogram.Percentile(2.0) == 1000);
+    CHECK(histogram.Percentile(0.0) == 1);
+    CHECK(histogram.Percentile(-1.0) == 1);
+
+    // 单个大值：桶上界超过该值时以最大记录值为准
+    MetricHistogram single;
+    single.Record(1000001);
+    CHECK(single.Percentile(0.5) == 1000001);
+}
+
+// 多个线程同时记录，计数、总和与最大值都不丢失
+void TestConcurrentRecord() {
+    MetricHistogram histogram;
+    MetricCounter counter;
+    const int threadCount = 4;
+    const uint64_t perThread = 100000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            for (uint64_t i = 1; i <= perThread; i++) {
+                histogram.Record(i + t);
+                counter.Add();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    uint64_t expectedSum = 0;
+    for (int t = 0; t < threadCount; t++) {
+        expectedSum += perThread * (perThread + 1) / 2 + perThread * t;
+    }
+    CHECK(histogram.Count() == threadCount * perThread);
+    CHECK(histogram.Sum() == expectedSum);
+    CHECK(histogram.Max() == perThread + threadCount - 1);
+    CHECK(histogram.Percentile(1.0) == perThread + threadCount - 1);
+    CHECK(counter.Value() == threadCount * perThread);
+}
+
+// 同名同标签的指标只注册一次，导出为Prometheus文本格式
+void TestRegistry() {
+    MetricsRegistry& registry = MetricsRegistry::Instance();
+    MetricCounter& a = registry.Counter("test_requests_total", "Requests", "reason=\"a\"");
+    MetricCounter& again = registry.Counter("test_requests_total", "Requests", "reason=\"a\"");
+    MetricCounter& b = registry.Counter("test_requests_total", "Requests", "reason=\"b\"");
+    CHECK(&a == &again);
+    CHECK(&a != &b);
+    a.Add(3);
+    b.Add();
+
+    MetricHistogram& latency = registry.Histogram("test_latency_ms", "Latency");
+    latency.Record(7);
+
+    std::string text = registry.ExportPrometheus();
+    CHECK(text.find("# TYPE test_requests_total counter\n") != std::string::npos);
+    CHECK(text.find("test_requests_total{reason=\"a\"} 3\n") != std::string::npos);
+    CHECK(text.find("test_requests_total{reason=\"b\"} 1\n") != std::string::npos);
+    CHECK(text.find("# TYPE test_latency_ms summary\n") != std::string::npos);
+    CHECK(text.find("test_latency_ms{quantile=\"0.5\"} 7\n") != std::string::npos);
+    CHECK(text.find("test_latency_ms_count 1\n") != std::string::npos);
+    CHECK(text.find("test_latency_ms_max 7\n") != std::string::npos);
+
+    CHECK(MetricsRegistry::EscapeLabelValue("a\\b\"c\nd") == "a\\\\b\\\"c\\nd");
+}
+
+} // namespace
+
+int main() {
+    TestLinearBuckets();
+    TestBucketBoundaries();
+    TestPercentile();
+    TestConcurrentRecord();
+    TestRegistry();
+    return TestCheck::Report("metrics_test");
+}
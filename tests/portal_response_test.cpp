@@ -0,0 +1,222 @@
+﻿#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../include/portal_response.h"
+#include "test_check.h"
+
+// 认证接口响应解析器的单元测试
+// 用法: portal_response_test <语料目录>
+// 语料目录中每个文件是一个响应样本：开头是期望值（每行“字段=值”，#开头的行为注释），
+// 接着是单独一行“---”，其后是响应体原文。只检查文件中列出的字段，值为none表示该字段不存在；
+// 字符串字段与未反转义的原始字节比较，msg_text与反转义后的提示信息比较；
+// address和same_address检查响应中的v46ip是否被认为是查询的地址（QuerySessionStatus据此判断结果是否属于该客户端）
+
+// 统计全局内存分配次数，用于确认解析过程不分配内存
+namespace {
+std::atomic<size_t> g_allocations{ 0 };
+}
+
+void* operator new(size_t size) {
+    g_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+// 一个语料样本
+struct CorpusEntry {
+    std::string name;
+    std::map<std::string, std::string> expected;
+    std::string body;
+};
+
+// 读取语料文件，格式错误时返回false
+bool LoadEntry(const std::filesystem::path& path, CorpusEntry& entry) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    std::string text = content.str();
+
+    size_t separator = text.find("\n---\n");
+    if (separator == std::string::npos) {
+        return false;
+    }
+
+    // 文件末尾的换行不属于响应体
+    entry.name = path.filename().string();
+    entry.body = text.substr(separator + 5);
+    if (!entry.body.empty() && entry.body.back() == '\n') {
+        entry.body.pop_back();
+    }
+
+    std::istringstream header(text.substr(0, separator));
+    std::string line;
+    while (std::getline(header, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        entry.expected[line.substr(0, equals)] = line.substr(equals + 1);
+    }
+    return entry.expected.count("ok") == 1;
+}
+
+// 比较一个字段，不相等时输出样本名称和两边的值
+bool Expect(const CorpusEntry& entry, const std::string& field, const std::string& actual) {
+    auto it = entry.expected.find(field);
+    if (it == entry.expected.end() || it->second == actual) {
+        return true;
+    }
+    std::cerr << entry.name << ": " << field << " expected \"" << it->second
+              << "\", got \"" << actual << "\"" << std::endl;
+    return false;
+}
+
+std::string IntegerField(bool present, long long value) {
+    return present ? std::to_string(value) : "none";
+}
+
+std::string StringField(std::string_view value) {
+    return value.data() == nullptr ? "none" : std::string(value);
+}
+
+// 语料中的每个样本都按期望值解析
+void TestCorpus(const std::filesystem::path& directory) {
+    std::vector<std::filesystem::path> files;
+    for (const auto& item : std::filesystem::directory_iterator(directory)) {
+        if (item.is_regular_file()) {
+            files.push_back(item.path());
+        }
+    }
+    CHECK(!files.empty());
+
+    for (const auto& path : files) {
+        CorpusEntry entry;
+        if (!CHECK(LoadEntry(path, entry))) {
+            std::cerr << "invalid corpus file: " << path.string() << std::endl;
+            continue;
+        }
+
+        PortalResponse response;
+        bool ok = PortalResponseParser::Parse(entry.body, response);
+        CHECK(Expect(entry, "ok", ok ? "1" : "0"));
+        if (!ok) {
+            continue;
+        }
+
+        CHECK(Expect(entry, "callback", std::string(response.callback)));
+        CHECK(Expect(entry, "result", IntegerField(response.hasResult, response.result)));
+        CHECK(Expect(entry, "ret_code", IntegerField(response.hasRetCode, response.retCode)));
+        CHECK(Expect(entry, "msg", StringField(response.msg)));
+        CHECK(Expect(entry, "uid", StringField(response.uid)));
+        CHECK(Expect(entry, "v46ip", StringField(response.v46ip)));
+        CHECK(Expect(entry, "flux", IntegerField(response.hasFlux, response.flux)));
+        CHECK(Expect(entry, "time", IntegerField(response.hasTime, response.time)));
+
+        auto text = entry.expected.find("msg_text");
+        if (text != entry.expected.end()) {
+            CHECK(PortalResponseParser::DecodeString(response.msg) == PortalResponseParser::DecodeString(text->second));
+        }
+
+        auto address = entry.expected.find("address");
+        if (address != entry.expected.end()) {
+            bool same = PortalResponseParser::IsSameAddress(response.v46ip, address->second);
+            CHECK(Expect(entry, "same_address", same ? "1" : "0"));
+        }
+    }
+}
+
+// 解析过程不分配内存
+void TestParseDoesNotAllocate() {
+    const std::string body =
+        "dr1002({\"result\":1,\"data\":{\"list\":[1,2,3]},\"msg\":\"\\u8ba4\\u8bc1\",\"uid\":\"202301010101\","
+        "\"v46ip\":\"10.71.32.118\",\"oltime\":\"386\",\"olflow\":1834212})";
+    PortalResponse response;
+
+    size_t before = g_allocations.load();
+    bool ok = PortalResponseParser::Parse(body, response);
+    size_t allocations = g_allocations.load() - before;
+
+    CHECK(ok);
+    CHECK(allocations == 0);
+    CHECK(response.flux == 1834212);
+    CHECK(response.time == 386);
+}
+
+// 反转义和UTF-8解码
+void TestDecodeString() {
+    CHECK(PortalResponseParser::DecodeString("abc") == L"abc");
+    CHECK(PortalResponseParser::DecodeString("a\\\"b\\\\c\\/d") == L"a\"b\\c/d");
+    CHECK(PortalResponseParser::DecodeString("\\n\\t") == L"\n\t");
+    CHECK(PortalResponseParser::DecodeString("\\u8ba4\\u8BC1") == std::wstring(L"\x8ba4\x8bc1"));
+    CHECK(PortalResponseParser::DecodeString("\xe8\xae\xa4\xe8\xaf\x81") == std::wstring(L"\x8ba4\x8bc1"));
+
+    // 非法字节和被截断的字符使用替换字符
+    CHECK(PortalResponseParser::DecodeString("a\xff") == std::wstring(L"a\xfffd"));
+    CHECK(PortalResponseParser::DecodeString("a\xe8\xae") == std::wstring(L"a\xfffd"));
+}
+
+// 数字边界：最大值可以解析，超出范围的数字视为不存在
+void TestIntegerLimits() {
+    PortalResponse response;
+    CHECK(PortalResponseParser::Parse("{\"olflow\":9223372036854775807,\"oltime\":\"-9223372036854775807\"}", response));
+    CHECK(response.hasFlux && response.flux == 9223372036854775807LL);
+    CHECK(response.hasTime && response.time == -9223372036854775807LL);
+
+    CHECK(PortalResponseParser::Parse("{\"olflow\":9223372036854775808,\"oltime\":99999999999999999999999999}", response));
+    CHECK(!response.hasFlux && response.flux == 0);
+    CHECK(!response.hasTime && response.time == 0);
+
+    CHECK(PortalResponseParser::Parse("{\"result\":\"\",\"ret_code\":null}", response));
+    CHECK(!response.hasResult);
+    CHECK(!response.hasRetCode);
+}
+
+// 地址比较：完全相同才算同一地址，IPv6忽略大小写
+void TestSameAddress() {
+    CHECK(PortalResponseParser::IsSameAddress("10.71.32.118", "10.71.32.118"));
+    CHECK(!PortalResponseParser::IsSameAddress("10.71.32.118", "10.71.32.11"));
+    CHECK(!PortalResponseParser::IsSameAddress("10.71.32.1", "10.71.32.118"));
+    CHECK(!PortalResponseParser::IsSameAddress("", ""));
+    CHECK(PortalResponseParser::IsSameAddress("2001:DA8:8005::1F", "2001:da8:8005::1f"));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: portal_response_test <corpus directory>" << std::endl;
+        return 2;
+    }
+
+    TestCorpus(argv[1]);
+    TestParseDoesNotAllocate();
+    TestDecodeString();
+    TestIntegerLimits();
+    TestSameAddress();
+    return TestCheck::Report("portal_response_test");
+}
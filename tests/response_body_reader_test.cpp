@@ -0,0 +1,165 @@
+﻿#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include "../include/response_body_reader.h"
+#include "../include/portal_response.h"
+#include "test_check.h"
+
+// 响应体分块读取的单元测试：用模拟的分块数据代替WinHttpReadData，
+// 检查分块拼接、响应体上限、提前结束，以及读取过程中的内存分配次数
+
+// 统计全局内存分配次数，用于确认读取过程不分配内存
+namespace {
+std::atomic<size_t> g_allocations{ 0 };
+}
+
+void* operator new(size_t size) {
+    g_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+// 与服务中的读取循环相同，每次最多返回chunkSize字节（模拟网络分块到达），返回读取次数
+int ReadChunks(ResponseBodyReader& reader, const std::string& data, size_t chunkSize) {
+    size_t offset = 0;
+    int reads = 0;
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    while (reader.NextBuffer(buffer, capacity)) {
+        size_t length = std::min(std::min(capacity, chunkSize), data.size() - offset);
+        memcpy(buffer, data.data() + offset, length);
+        offset += length;
+        reads++;
+        if (!reader.Commit(length)) {
+            break;
+        }
+    }
+    return reads;
+}
+
+// 带中文提示信息的登录响应
+const std::string kLoginBody =
+    u8"dr1003({\"result\":0,\"msg\":\"账号或密码错误，请重新输入\",\"ret_code\":1,\"uid\":\"202301010101\"})";
+
+// 分块拼接：多字节字符被分在两块中时，拼接后的响应体与原文一致，解码结果正确
+void TestChunksReassembled() {
+    for (size_t chunkSize : { (size_t)1, (size_t)2, (size_t)7, (size_t)64, ResponseBodyReader::kBufferSize }) {
+        std::string body;
+        ResponseBodyReader::Consumer consumer;
+        ResponseBodyReader reader(0, consumer, body);
+        ReadChunks(reader, kLoginBody, chunkSize);
+        CHECK(body == kLoginBody);
+        CHECK(reader.GetTotalRead() == kLoginBody.size());
+        CHECK(!reader.IsTruncated());
+    }
+
+    std::string body;
+    ResponseBodyReader::Consumer consumer;
+    ResponseBodyReader reader(0, consumer, body);
+    ReadChunks(reader, kLoginBody, 7);
+    PortalResponse response;
+    CHECK(PortalResponseParser::Parse(body, response));
+    CHECK(PortalResponseParser::DecodeString(response.msg) == L"账号或密码错误，请重新输入");
+}
+
+// 响应体上限：每次读取不超过剩余额度，达到上限后停止并标记为截断
+void TestMaxBytes() {
+    std::string data(300, 'x');
+    std::string body;
+    ResponseBodyReader::Consumer consumer;
+    ResponseBodyReader reader(100, consumer, body);
+    ReadChunks(reader, data, 64);
+    CHECK(body.size() == 100);
+    CHECK(reader.GetTotalRead() == 100);
+    CHECK(reader.IsTruncated());
+
+    // 响应体小于上限时不截断
+    std::string shortBody;
+    ResponseBodyReader shortReader(100, consumer, shortBody);
+    ReadChunks(shortReader, std::string(99, 'x'), 64);
+    CHECK(shortBody.size() == 99);
+    CHECK(!shortReader.IsTruncated());
+
+    // 预留空间不超过上限
+    std::string reserved;
+    ResponseBodyReader reserveReader(1024, consumer, reserved);
+    reserveReader.Reserve(64 * 1024 * 1024);
+    CHECK(reserved.capacity() >= 1024);
+    CHECK(reserved.capacity() < 64 * 1024 * 1024);
+}
+
+// consumer要求停止时不再读取后续数据，也不保存到body
+void TestConsumerStopsEarly() {
+    std::string data = kLoginBody + std::string(4096, ' ');
+    std::string seen;
+    ResponseBodyReader::Consumer consumer = [&seen](const char* data, size_t length) {
+        seen.append(data, length);
+        return seen.find("\"ret_code\"") == std::string::npos;
+    };
+    std::string body;
+    ResponseBodyReader reader(0, consumer, body);
+    int reads = ReadChunks(reader, data, 16);
+    CHECK(body.empty());
+    CHECK(seen.find("\"ret_code\"") != std::string::npos);
+    CHECK(reader.GetTotalRead() == seen.size());
+    CHECK(reader.GetTotalRead() < data.size());
+    CHECK(reads == (int)((seen.size() + 15) / 16));
+    CHECK(!reader.IsTruncated());
+}
+
+// 读取过程不分配内存：按Content-Length预留空间后追加不扩容，交给consumer时完全不分配
+void TestReadDoesNotAllocate() {
+    std::string data(200 * 1024, 'x');
+    std::string body;
+    ResponseBodyReader::Consumer none;
+    ResponseBodyReader reader(0, none, body);
+    reader.Reserve(data.size());
+
+    size_t before = g_allocations.load();
+    ReadChunks(reader, data, 1460);
+    size_t allocations = g_allocations.load() - before;
+    CHECK(allocations == 0);
+    CHECK(body.size() == data.size());
+
+    size_t total = 0;
+    ResponseBodyReader::Consumer consumer = [&total](const char*, size_t length) {
+        total += length;
+        return true;
+    };
+    std::string unused;
+    ResponseBodyReader streamReader(0, consumer, unused);
+    streamReader.Reserve(data.size());
+
+    before = g_allocations.load();
+    ReadChunks(streamReader, data, 1460);
+    allocations = g_allocations.load() - before;
+    CHECK(allocations == 0);
+    CHECK(total == data.size());
+    CHECK(unused.capacity() < data.size());
+}
+
+} // namespace
+
+int main() {
+    TestChunksReassembled();
+    TestMaxBytes();
+    TestConsumerStopsEarly();
+    TestReadDoesNotAllocate();
+    return TestCheck::Report("response_body_reader_test");
+}
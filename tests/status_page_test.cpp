@@ -0,0 +1,209 @@
+﻿#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/status_page.h"
+#include "test_check.h"
+
+// 共享状态页的单元测试：seqlock的发布和读取（包括与写者并发的读者）、地址和SSID的格式化
+// 状态页放在普通内存中，与共享内存中的读写方式相同
+
+namespace {
+
+// 除SSID外的所有计数字段都取同一个值，读者据此发现读到了写了一半的数据
+StatusPageData MakeData(uint64_t value) {
+    StatusPageData data = {};
+    data.publishTimeMs = value;
+    data.stateSinceMs = value;
+    data.lastProbeTimeMs = value;
+    data.lastLoginTimeMs = value;
+    data.connectCount = value;
+    data.disconnectCount = value;
+    data.loginCount = value;
+    data.loginFailureCount = value;
+    data.wakeupCount = value;
+    data.serviceRunning = 1;
+    data.state = (uint32_t)value;
+    data.lastProbeElapsedMs = (uint32_t)value;
+    data.ssidLength = 32;
+    memset(data.ssid, (int)(value & 0xff), sizeof(data.ssid));
+    return data;
+}
+
+// 读到的数据是否是某一次完整发布的内容
+bool IsConsistent(const StatusPageData& data) {
+    uint64_t value = data.publishTimeMs;
+    StatusPageData expected = MakeData(value);
+    return memcmp(&data, &expected, sizeof(data)) == 0;
+}
+
+// 未初始化或版本不符的页面不能读取
+void TestUninitialized() {
+    std::unique_ptr<StatusPage::Layout> page(new StatusPage::Layout());
+    page->magic.store(0);
+    StatusPageData data;
+    CHECK(!StatusPage::IsCompatible(page.get()));
+    CHECK(!StatusPage::TryRead(page.get(), data));
+    CHECK(!StatusPage::Read(page.get(), data));
+
+    StatusPage::Initialize(page.get());
+    CHECK(StatusPage::IsCompatible(page.get()));
+    page->version.store(StatusPage::kVersion + 1);
+    CHECK(!StatusPage::IsCompatible(page.get()));
+    CHECK(!StatusPage::TryRead(page.get(), data));
+}
+
+// 发布后读到相同的数据，序号每次发布加2
+void TestPublishRead() {
+    std::unique_ptr<StatusPage::Layout> page(new StatusPage::Layout());
+    StatusPage::Initialize(page.get());
+
+    StatusPageData data;
+    CHECK(StatusPage::TryRead(page.get(), data));
+    CHECK(data.publishTimeMs == 0 && data.serviceRunning == 0);
+
+    StatusPageData published = MakeData(42);
+    StatusPage::Publish(page.get(), published);
+    CHECK(page->sequence.load() == 2);
+    CHECK(StatusPage::TryRead(page.get(), data));
+    CHECK(memcmp(&data, &published, sizeof(data)) == 0);
+
+    StatusPage::Publish(page.get(), MakeData(43));
+    CHECK(page->sequence.load() == 4);
+    uint32_t retries = 99;
+    CHECK(StatusPage::Read(page.get(), data, 10, &retries));
+    CHECK(retries == 0);
+    CHECK(data.publishTimeMs == 43);
+}
+
+// 序号为奇数（写者正在写入）时读取失败，重试到上限后放弃
+void TestReadDuringWrite() {
+    std::unique_ptr<StatusPage::Layout> page(new StatusPage::Layout());
+    StatusPage::Initialize(page.get());
+    StatusPage::Publish(page.get(), MakeData(7));
+
+    page->sequence.fetch_add(1);
+    StatusPageData data;
+    CHECK(!StatusPage::TryRead(page.get(), data));
+    uint32_t retries = 0;
+    CHECK(!StatusPage::Read(page.get(), data, 5, &retries));
+    CHECK(retries == 5);
+
+    page->sequence.fetch_add(1);
+    CHECK(StatusPage::Read(page.get(), data, 5, &retries));
+    CHECK(retries == 0);
+    CHECK(data.publishTimeMs == 7);
+}
+
+// 一个写者不停发布，多个读者同时读取：读到的每份数据都完整，且不会倒退
+void TestConcurrentReaders() {
+    std::unique_ptr<StatusPage::Layout> page(new StatusPage::Layout());
+    StatusPage::Initialize(page.get());
+    StatusPage::Publish(page.get(), MakeData(1));
+
+    const uint64_t publishCount = 200000;
+    const int readerCount = 3;
+    std::atomic<bool> done(false);
+    std::atomic<uint64_t> torn(0);
+    std::atomic<uint64_t> backwards(0);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint64_t> retried(0);
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < readerCount; r++) {
+        readers.emplace_back([&]() {
+            uint64_t last = 0;
+            StatusPageData data;
+            while (!done.load(std::memory_order_relaxed)) {
+                uint32_t retries = 0;
+                if (!StatusPage::Read(page.get(), data, 1000000, &retries)) {
+                    continue;
+                }
+                reads.fetch_add(1, std::memory_order_relaxed);
+                retried.fetch_add(retries, std::memory_order_relaxed);
+                if (!IsConsistent(data)) {
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (data.publishTimeMs < last) {
+                    backwards.fetch_add(1, std::memory_order_relaxed);
+                }
+                last = data.publishTimeMs;
+            }
+        });
+    }
+
+    for (uint64_t value = 2; value <= publishCount; value++) {
+        StatusPage::Publish(page.get(), MakeData(value));
+    }
+    done.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    CHECK(reads.load() > 0);
+    CHECK(torn.load() == 0);
+    CHECK(backwards.load() == 0);
+    CHECK(page->sequence.load() == publishCount * 2);
+
+    StatusPageData last;
+    CHECK(StatusPage::TryRead(page.get(), last));
+    CHECK(last.publishTimeMs == publishCount);
+}
+
+std::string FormatIpv6(const uint8_t (&bytes)[16]) {
+    StatusPageData data = {};
+    data.addressFamily = 6;
+    memcpy(data.address, bytes, sizeof(bytes));
+    return StatusPage::FormatAddress(data);
+}
+
+// IPv4按点分十进制输出，IPv6按RFC 5952压缩最长的连续零组
+void TestFormatAddress() {
+    StatusPageData data = {};
+    CHECK(StatusPage::FormatAddress(data).empty());
+
+    data.addressFamily = 4;
+    const uint8_t ipv4[] = { 10, 0, 255, 1 };
+    memcpy(data.address, ipv4, sizeof(ipv4));
+    CHECK(StatusPage::FormatAddress(data) == "10.0.255.1");
+
+    const uint8_t any[16] = {};
+    CHECK(FormatIpv6(any) == "::");
+    const uint8_t loopback[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+    CHECK(FormatIpv6(loopback) == "::1");
+    const uint8_t documentation[16] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+    CHECK(FormatIpv6(documentation) == "2001:db8::1");
+    // 两段等长的连续零压缩前一段
+    const uint8_t twoRuns[16] = { 0, 1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1 };
+    CHECK(FormatIpv6(twoRuns) == "1::1:1:0:0:1");
+    // 单个零组不压缩
+    const uint8_t singleZero[16] = { 0, 1, 0, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1 };
+    CHECK(FormatIpv6(singleZero) == "1:0:1:1:1:1:1:1");
+    const uint8_t linkLocal[16] = { 0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0x02, 0x11, 0x22, 0xff, 0xfe, 0x33, 0x44, 0x55 };
+    CHECK(FormatIpv6(linkLocal) == "fe80::211:22ff:fe33:4455");
+}
+
+// SSID长度超过32字节时截断
+void TestSsid() {
+    StatusPageData data = {};
+    memcpy(data.ssid, "campus", 6);
+    data.ssidLength = 6;
+    CHECK(StatusPage::Ssid(data) == "campus");
+    data.ssidLength = 1000;
+    CHECK(StatusPage::Ssid(data).size() == sizeof(data.ssid));
+}
+
+} // namespace
+
+int main() {
+    TestUninitialized();
+    TestPublishRead();
+    TestReadDuringWrite();
+    TestConcurrentReaders();
+    TestFormatAddress();
+    TestSsid();
+    return TestCheck::Report("status_page_test");
+}
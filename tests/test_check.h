@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <iostream>
+
+// 单元测试使用的简单断言：失败时输出位置和表达式并计数，不中断后续检查
+namespace TestCheck {
+
+// 输出流：Windows上被测代码会把控制台切换为UTF-16模式（_O_U8TEXT），此时只能用宽字符流输出
+#ifdef _WIN32
+inline std::wostream& Out() { return std::wcout; }
+inline std::wostream& Err() { return std::wcerr; }
+#else
+inline std::ostream& Out() { return std::cout; }
+inline std::ostream& Err() { return std::cerr; }
+#endif
+
+// 失败的检查数
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+// 记录一次检查的结果
+inline bool Record(bool passed, const char* expression, const char* file, int line) {
+    if (!passed) {
+        Err() << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+        Failures()++;
+    }
+    return passed;
+}
+
+// 输出结果，作为main的返回值（0表示全部通过）
+inline int Report(const char* name) {
+    if (Failures() == 0) {
+        Out() << name << ": all checks passed" << std::endl;
+        return 0;
+    }
+    Err() << name << ": " << Failures() << " check(s) failed" << std::endl;
+    return 1;
+}
+
+} // namespace TestCheck
+
+#define CHECK(expression) TestCheck::Record((expression), #expression, __FILE__, __LINE__)
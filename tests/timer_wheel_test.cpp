@@ -0,0 +1,308 @@
+﻿#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+#include "../include/timer_wheel.h"
+#include "test_check.h"
+
+// 分层时间轮的单元测试，使用虚拟时钟，不依赖真实时间
+
+namespace {
+
+// 可以手动拨动的时钟
+struct VirtualClock {
+    uint64_t now = 0;
+
+    TimerWheel::Clock Function() {
+        return [this]() { return now; };
+    }
+};
+
+// 4层、每层64个槽，精度1毫秒时各层的范围
+const uint64_t kLevel1 = 64;
+const uint64_t kLevel2 = 64 * 64;
+const uint64_t kLevel3 = 64 * 64 * 64;
+const uint64_t kRange = 64ULL * 64 * 64 * 64;
+
+// 定时器在到期时间执行，不提前也不推迟
+void TestFiresOnTime() {
+    VirtualClock clock;
+    TimerWheel wheel(clock.Function(), 10);
+
+    int fired = 0;
+    wheel.Schedule(25, [&fired]() { fired++; });
+
+    // 到期时间向上取整到tick，不会提前执行
+    clock.now = 29;
+    CHECK(wheel.Advance() == 0);
+    CHECK(wheel.NextDeadline() == 30);
+    clock.now = 30;
+    CHECK(wheel.Advance() == 1);
+    CHECK(fired == 1);
+    CHECK(wheel.Size() == 0);
+    CHECK(wheel.NextDeadline() == TimerWheel::kNoDeadline);
+
+    // 0延迟的定时器在下一个tick执行
+    wheel.Schedule(0, [&fired]() { fired++; });
+    CHECK(wheel.Advance() == 0);
+    clock.now = 40;
+    CHECK(wheel.Advance() == 1);
+    CHECK(fired == 2);
+}
+
+// 各层的定时器逐层下移，在准确的时间执行
+void TestCascade() {
+    const uint64_t delays[] = {
+        1, kLevel1 - 1,                         // 第0层
+        kLevel1, kLevel1 + 1, kLevel2 - 1,      // 第1层
+        kLevel2, kLevel2 + 7, kLevel3 - 1,      // 第2层
+        kLevel3, kLevel3 * 5 + 3,               // 第3层
+        kRange - 1, kRange, kRange + kLevel3 + 3    // 第3层的最后一个槽和超出时间轮范围（只从一个起点测试，逐tick推进较慢）
+    };
+    const size_t farDelays = 3;
+
+    // 起点为0时到期时间正好落在各层的槽边界上，下移的同一个tick就要执行
+    const uint64_t starts[] = { 0, 1000, kLevel2 - 10 };
+
+    for (uint64_t start : starts) {
+        for (size_t d = 0; d < sizeof(delays) / sizeof(delays[0]); d++) {
+            uint64_t delay = delays[d];
+            if (d + farDelays >= sizeof(delays) / sizeof(delays[0]) && start != 1000) {
+                continue;
+            }
+            VirtualClock clock;
+            clock.now = start;
+            TimerWheel wheel(clock.Function(), 1);
+
+            uint64_t firedAt = 0;
+            wheel.Schedule(delay, [&]() { firedAt = clock.now; });
+            CHECK(wheel.NextDeadline() == start + delay);
+
+            clock.now = start + delay - 1;
+            wheel.Advance();
+            if (!CHECK(firedAt == 0)) {
+                std::cerr << "  start " << start << ", delay " << delay << " fired early" << std::endl;
+            }
+            CHECK(wheel.NextDeadline() == start + delay);
+
+            clock.now = start + delay;
+            wheel.Advance();
+            if (!CHECK(firedAt == start + delay)) {
+                std::cerr << "  start " << start << ", delay " << delay << " did not fire on time" << std::endl;
+            }
+        }
+    }
+}
+
+// 周期定时器
+void TestPeriodic() {
+    VirtualClock clock;
+    TimerWheel wheel(clock.Function(), 1);
+
+    std::vector<uint64_t> times;
+    TimerWheel::TimerId id = wheel.Schedule(100, [&]() { times.push_back(clock.now); }, 250);
+    for (clock.now = 0; clock.now <= 1000; clock.now += 50) {
+        wheel.Advance();
+    }
+    CHECK(times.size() == 4);
+    CHECK(times.size() == 4 && times[0] == 100 && times[1] == 350 && times[2] == 600 && times[3] == 850);
+    CHECK(wheel.IsScheduled(id));
+    CHECK(wheel.NextDeadline() == 1100);
+    CHECK(wheel.Cancel(id));
+    CHECK(!wheel.IsScheduled(id));
+    CHECK(!wheel.Cancel(id));
+}
+
+// 在回调中取消、重新安排和添加定时器
+void TestModifyFromCallback() {
+    VirtualClock clock;
+    TimerWheel wheel(clock.Function(), 1);
+
+    // 同一tick到期的另一个定时器被取消后不再执行
+    int firedB = 0;
+    TimerWheel::TimerId b = 0;
+    wheel.Schedule(10, [&]() { CHECK(wheel.Cancel(b)); });
+    b = wheel.Schedule(10, [&]() { firedB++; });
+
+    // 更晚的定时器被取消
+    int firedC = 0;
+    TimerWheel::TimerId c = wheel.Schedule(5000, [&]() { firedC++; });
+    wheel.Schedule(10, [&]() { CHECK(wheel.Cancel(c)); });
+
+    // 另一个定时器被推迟，高层的定时器被提前到第0层
+    std::vector<uint64_t> firedD;
+    TimerWheel::TimerId d = wheel.Schedule(20, [&]() { firedD.push_back(clock.now); });
+    std::vector<uint64_t> firedE;
+    TimerWheel::TimerId e = wheel.Schedule(100000, [&]() { firedE.push_back(clock.now); });
+    wheel.Schedule(10, [&]() {
+        CHECK(wheel.Reschedule(d, 90));
+        CHECK(wheel.Reschedule(e, 5));
+    });
+
+    // 一次性定时器在自己的回调中重新安排无效，但可以添加新的定时器
+    std::vector<uint64_t> chain;
+    std::function<void()> step = [&]() {
+        chain.push_back(clock.now);
+        if (chain.size() < 3) {
+            wheel.Schedule(7, step);
+        }
+    };
+    wheel.Schedule(10, step);
+
+    // 周期定时器在自己的回调中取消或修改下次执行时间
+    int periodicFired = 0;
+    TimerWheel::TimerId periodic = 0;
+    periodic = wheel.Schedule(10, [&]() {
+        periodicFired++;
+        if (periodicFired == 2) {
+            CHECK(wheel.Reschedule(periodic, 1000));
+        } else if (periodicFired == 3) {
+            CHECK(wheel.Cancel(periodic));
+        }
+    }, 10);
+
+    for (clock.now = 0; clock.now <= 200000; clock.now++) {
+        wheel.Advance();
+    }
+
+    CHECK(firedB == 0);
+    CHECK(firedC == 0);
+    CHECK(firedD.size() == 1 && firedD[0] == 100);
+    CHECK(firedE.size() == 1 && firedE[0] == 15);
+    CHECK(chain.size() == 3 && chain[0] == 10 && chain[1] == 17 && chain[2] == 24);
+    CHECK(periodicFired == 3);
+    CHECK(!wheel.IsScheduled(periodic));
+    CHECK(wheel.Size() == 0);
+}
+
+// NextDeadline在定时器执行、取消后更新；时钟跳过很长时间后一次执行所有到期的定时器
+void TestNextDeadline() {
+    VirtualClock clock;
+    TimerWheel wheel(clock.Function(), 1);
+    CHECK(wheel.NextDeadline() == TimerWheel::kNoDeadline);
+
+    TimerWheel::TimerId a = wheel.Schedule(30, []() {});
+    wheel.Schedule(70, []() {});
+    TimerWheel::TimerId c = wheel.Schedule(5000, []() {});
+    CHECK(wheel.NextDeadline() == 30);
+
+    clock.now = 30;
+    CHECK(wheel.Advance() == 1);
+    CHECK(!wheel.IsScheduled(a));
+    CHECK(wheel.NextDeadline() == 70);
+
+    clock.now = 100;
+    CHECK(wheel.Advance() == 1);
+    CHECK(wheel.NextDeadline() == 5000);
+
+    CHECK(wheel.Cancel(c));
+    CHECK(wheel.NextDeadline() == TimerWheel::kNoDeadline);
+
+    // 时钟跳过多层的范围
+    int fired = 0;
+    for (uint64_t delay : { (uint64_t)10, kLevel1 * 3, kLevel2 * 5, kLevel3 * 2 }) {
+        wheel.Schedule(delay, [&fired]() { fired++; });
+    }
+    clock.now += kLevel3 * 3;
+    CHECK(wheel.Advance() == 4);
+    CHECK(fired == 4);
+    CHECK(wheel.NextDeadline() == TimerWheel::kNoDeadline);
+
+    // 超出范围的定时器暂存在最高层较近的槽中，不能掩盖之后的槽中更早到期的定时器
+    VirtualClock farClock;
+    TimerWheel farWheel(farClock.Function(), 1);
+    farWheel.Schedule(kRange + kLevel3 * 5, []() {});
+    farClock.now = kLevel3 * 2;
+    farWheel.Advance();
+    farWheel.Schedule(kRange - kLevel3, []() {});
+    CHECK(farWheel.NextDeadline() == kRange + kLevel3);
+}
+
+// 随机起点（包括各层槽位回绕的边界）和随机延迟，与逐个比较到期时间的参考实现对照
+void TestRandomAgainstReference() {
+    const uint64_t starts[] = {
+        0, kLevel1 - 3, kLevel3 - 1, kRange - 5, 123456789
+    };
+    std::mt19937_64 random(20240601);
+
+    for (uint64_t start : starts) {
+        VirtualClock clock;
+        clock.now = start;
+        TimerWheel wheel(clock.Function(), 1);
+
+        std::map<TimerWheel::TimerId, uint64_t> pending;     // 参考实现：ID -> 到期时间
+        std::vector<std::pair<uint64_t, uint64_t>> fired;    // 执行时的时间和到期时间
+        uint64_t previous = start;
+
+        auto schedule = [&]() {
+            // 各层的延迟都要覆盖，少数超出时间轮范围
+            uint64_t ranges[] = { kLevel1, kLevel2, kLevel3, kLevel3 * 8, kRange + kLevel3 };
+            uint64_t delay = random() % ranges[random() % 5];
+            // 0延迟的定时器在下一个tick执行
+            uint64_t expires = delay > 0 ? clock.now + delay : clock.now + 1;
+            TimerWheel::TimerId id = wheel.Schedule(delay, [&, expires]() { fired.emplace_back(clock.now, expires); });
+            pending[id] = expires;
+        };
+
+        for (int i = 0; i < 200; i++) {
+            schedule();
+        }
+
+        for (int step = 0; step < 3000 && !pending.empty(); step++) {
+            // 下一步拨到参考实现的下一个到期时间附近，或随机跳过一段时间
+            uint64_t next = UINT64_MAX;
+            for (const auto& entry : pending) {
+                next = entry.second < next ? entry.second : next;
+            }
+            if (!CHECK(wheel.NextDeadline() == next)) {
+                std::cerr << "  start " << start << ", now " << clock.now << std::endl;
+                break;
+            }
+
+            switch (random() % 3) {
+            case 0: clock.now = next - 1; break;
+            case 1: clock.now = next; break;
+            default: clock.now = next + random() % kLevel2; break;
+            }
+
+            fired.clear();
+            wheel.Advance();
+
+            // 每个到期的定时器都执行了一次，未到期的都没有执行
+            size_t expected = 0;
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (it->second <= clock.now) {
+                    CHECK(!wheel.IsScheduled(it->first));
+                    expected++;
+                    it = pending.erase(it);
+                } else {
+                    CHECK(wheel.IsScheduled(it->first));
+                    ++it;
+                }
+            }
+            CHECK(fired.size() == expected);
+            for (const auto& entry : fired) {
+                CHECK(entry.second <= entry.first && entry.second > previous);
+            }
+            previous = clock.now;
+
+            if (step % 10 == 0 && step < 1000) {
+                schedule();
+            }
+        }
+        CHECK(wheel.Size() == pending.size());
+    }
+}
+
+} // namespace
+
+int main() {
+    TestFiresOnTime();
+    TestCascade();
+    TestPeriodic();
+    TestModifyFromCallback();
+    TestNextDeadline();
+    TestRandomAgainstReference();
+    return TestCheck::Report("timer_wheel_test");
+}
@@ -0,0 +1,241 @@
+﻿#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../include/fake_wlan.h"
+#include "../include/wifi_manager.h"
+#include "test_check.h"
+
+// WifiManager的单元测试：与wifi_bench一样，WLAN函数在编译时被替换为fake_wlan.cpp中的实现，
+// 由模拟的无线网卡按脚本发出扫描、连接、断开和信号强度通知，检查WifiManager产生的事件、顺序和反应时间
+
+namespace {
+
+const wchar_t kSsid[] = L"BenchNet";
+
+// 等待通知的上限：只用于在出错时结束测试，正常情况下通知在几毫秒内到达。
+// 测试机负载高时线程调度可能延迟数百毫秒，各项耗时检查只与被避免的等待（缓存过期、扫描超时、关联耗时）比较，
+// 不检查绝对的毫秒数
+const DWORD kEventTimeoutMs = 10000;
+
+// WifiManager的扫描超时（wifi_manager.cpp）
+const long long kScanTimeoutMs = 4000;
+
+// 模拟网卡的默认参数：扫描和关联都需要一段时间，通知在驱动线程中异步到达
+FakeWlanOptions DefaultOptions() {
+    FakeWlanOptions options;
+    options.ssid = kSsid;
+    options.scanMs = 20;
+    options.associateMs = 30;
+    options.addressMs = 10;
+    return options;
+}
+
+// 取出队列中已有的全部事件；事件句柄是自动重置的，先清除已触发的状态，之后的等待只被新事件唤醒
+std::vector<WifiEvent> DrainEvents(WifiManager& manager) {
+    WaitForSingleObject(manager.GetEventHandle(), 0);
+    std::vector<WifiEvent> events;
+    WifiEvent event;
+    while (manager.PopEvent(event)) {
+        events.push_back(event);
+    }
+    return events;
+}
+
+// 事件类型序列是否与期望一致
+bool HasTypes(const std::vector<WifiEvent>& events, const std::vector<WifiEventType>& expected) {
+    if (events.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].type != expected[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 等待事件句柄被触发，返回等待的毫秒数，超时返回-1
+long long WaitForEvent(WifiManager& manager, DWORD timeoutMs) {
+    auto start = std::chrono::steady_clock::now();
+    if (WaitForSingleObject(manager.GetEventHandle(), timeoutMs) != WAIT_OBJECT_0) {
+        return -1;
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 连接后断开，并取走断开事件
+void ConnectAndDrop(WifiManager& manager) {
+    CHECK(manager.ConnectToNetwork(kSsid));
+    DrainEvents(manager);
+    FakeWlan::Instance().DropLink();
+    CHECK(WaitForEvent(manager, kEventTimeoutMs) >= 0);
+    DrainEvents(manager);
+}
+
+// 第一次连接：先扫描，扫描完成后才发起连接
+void TestConnectScansFirst() {
+    FakeWlan::Instance().Reset(DefaultOptions());
+    WifiManager manager;
+    CHECK(manager.Initialize());
+    CHECK(manager.HasNotifications());
+
+    DWORD reasonCode = 0;
+    CHECK(manager.ConnectToNetwork(kSsid, L"", NULL, &reasonCode));
+    CHECK(reasonCode == 0);
+
+    std::vector<WifiEvent> events = DrainEvents(manager);
+    CHECK(HasTypes(events, { WifiEventType::ScanComplete, WifiEventType::ConnectComplete }));
+    CHECK(events.size() == 2 && events[1].ssid == kSsid);
+    CHECK(manager.IsConnected());
+    CHECK(manager.GetCurrentSSID() == kSsid);
+}
+
+// 断开通知直接唤醒等待事件句柄的线程，缓存的连接快照立即失效
+void TestDisconnectWakesWaiter() {
+    FakeWlan::Instance().Reset(DefaultOptions());
+    WifiManager manager;
+    CHECK(manager.Initialize());
+    CHECK(manager.ConnectToNetwork(kSsid));
+    DrainEvents(manager);
+
+    // 快照缓存时间远大于等待上限，断开后快照仍显示已连接就说明没有随通知失效
+    const DWORD snapshotTtlMs = 60000;
+    manager.SetSnapshotTtl(snapshotTtlMs);
+    CHECK(manager.IsConnected());
+
+    FakeWlan::Instance().DropLink();
+    long long latencyMs = WaitForEvent(manager, kEventTimeoutMs);
+    CHECK(latencyMs >= 0);
+
+    std::vector<WifiEvent> events = DrainEvents(manager);
+    CHECK(HasTypes(events, { WifiEventType::Disconnected }));
+    CHECK(!manager.IsConnected());
+}
+
+// 重新连接上次成功连接的网络时不再扫描
+void TestReconnectSkipsScan() {
+    FakeWlan::Instance().Reset(DefaultOptions());
+    WifiManager manager;
+    CHECK(manager.Initialize());
+    ConnectAndDrop(manager);
+
+    CHECK(manager.ConnectToNetwork(kSsid));
+    CHECK(HasTypes(DrainEvents(manager), { WifiEventType::ConnectComplete }));
+}
+
+// 用上次的网络信息连接失败后重新扫描再试一次，原因码返回给调用方
+void TestConnectFailureRescans() {
+    FakeWlan::Instance().Reset(DefaultOptions());
+    WifiManager manager;
+    CHECK(manager.Initialize());
+    ConnectAndDrop(manager);
+
+    FakeWlanOptions options = DefaultOptions();
+    options.connectFailReason = WLAN_REASON_CODE_NETWORK_NOT_AVAILABLE;
+    FakeWlan::Instance().SetOptions(options);
+
+    DWORD reasonCode = 0;
+    CHECK(!manager.ConnectToNetwork(kSsid, L"", NULL, &reasonCode));
+    CHECK(reasonCode == WLAN_REASON_CODE_NETWORK_NOT_AVAILABLE);
+
+    std::vector<WifiEvent> events = DrainEvents(manager);
+    CHECK(HasTypes(events, {
+        WifiEventType::ConnectFailed,
+        WifiEventType::ScanComplete,
+        WifiEventType::ConnectFailed
+    }));
+    CHECK(events.size() == 3 && events[2].reasonCode == WLAN_REASON_CODE_NETWORK_NOT_AVAILABLE);
+    CHECK(!manager.IsConnected());
+}
+
+// 扫描失败通知立即结束等待（不等到4秒的扫描超时），仍返回系统已有的网络列表
+void TestScanFailure() {
+    FakeWlanOptions options = DefaultOptions();
+    options.scanFailReason = WLAN_REASON_CODE_NETWORK_NOT_AVAILABLE;
+    FakeWlan::Instance().Reset(options);
+    WifiManager manager;
+    CHECK(manager.Initialize());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::wstring> networks = manager.GetAvailableNetworks();
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    CHECK(elapsedMs < kScanTimeoutMs / 2);
+    CHECK(networks.size() == 1 && networks[0] == kSsid);
+
+    std::vector<WifiEvent> events = DrainEvents(manager);
+    CHECK(HasTypes(events, { WifiEventType::ScanFailed }));
+    CHECK(events.size() == 1 && events[0].reasonCode == WLAN_REASON_CODE_NETWORK_NOT_AVAILABLE);
+}
+
+// 信号强度变化产生事件，连接快照随之更新
+void TestSignalChange() {
+    FakeWlan::Instance().Reset(DefaultOptions());
+    WifiManager manager;
+    CHECK(manager.Initialize());
+    CHECK(manager.ConnectToNetwork(kSsid));
+    DrainEvents(manager);
+    manager.SetSnapshotTtl(60000);
+    CHECK(manager.Snapshot()->signalQuality == 80);
+
+    FakeWlan::Instance().ChangeSignalQuality(35);
+    CHECK(WaitForEvent(manager, kEventTimeoutMs) >= 0);
+
+    std::vector<WifiEvent> events = DrainEvents(manager);
+    CHECK(HasTypes(events, { WifiEventType::SignalChanged }));
+    CHECK(events.size() == 1 && events[0].signalQuality == 35);
+    CHECK(manager.Snapshot()->signalQuality == 35);
+}
+
+// 等待关联时触发取消事件，连接立即返回ERROR_CANCELLED，之后到达的通知不影响下一次连接
+void TestConnectCancelled() {
+    FakeWlanOptions options = DefaultOptions();
+    options.associateMs = 10000;
+    FakeWlan::Instance().Reset(options);
+    WifiManager manager;
+    CHECK(manager.Initialize());
+
+    HANDLE hCancel = CreateEvent(NULL, TRUE, FALSE, NULL);
+    std::thread canceller([hCancel]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        SetEvent(hCancel);
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    DWORD reasonCode = 0;
+    CHECK(!manager.ConnectToNetwork(kSsid, L"", hCancel, &reasonCode));
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    canceller.join();
+    CloseHandle(hCancel);
+
+    // 关联需要10秒，只要没有等到关联结束就说明取消生效
+    CHECK(reasonCode == ERROR_CANCELLED);
+    CHECK(elapsedMs < (long long)options.associateMs / 2);
+    CHECK(HasTypes(DrainEvents(manager), { WifiEventType::ScanComplete }));
+
+    // 丢弃尚未完成的关联，按正常参数重新连接
+    FakeWlan::Instance().Reset(DefaultOptions());
+    CHECK(manager.ConnectToNetwork(kSsid));
+    std::vector<WifiEvent> events = DrainEvents(manager);
+    CHECK(!events.empty() && events.back().type == WifiEventType::ConnectComplete);
+}
+
+} // namespace
+
+int wmain() {
+    _setmode(_fileno(stdout), _O_U8TEXT);
+    _setmode(_fileno(stderr), _O_U8TEXT);
+
+    TestConnectScansFirst();
+    TestDisconnectWakesWaiter();
+    TestReconnectSkipsScan();
+    TestConnectFailureRescans();
+    TestScanFailure();
+    TestSignalChange();
+    TestConnectCancelled();
+
+    FakeWlan::Instance().Shutdown();
+    return TestCheck::Report("wifi_manager_test");
+}